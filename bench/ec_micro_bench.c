@@ -0,0 +1,715 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmarks of the hot path of the master, built against cherryecat_host by
+ * bench/CMakeLists.txt. The netdev port is a null device in this file, tx frames are dropped or
+ * kept as the wire image for the receive benchmark, so no network interface is involved.
+ *
+ * send_datagrams:    ec_master_send_datagrams() for depth queued datagrams of size bytes each
+ * receive_datagrams: ec_master_receive_datagrams() for the frames of the send benchmark, the
+ *                    datagrams are put back into the queue as sent before every call
+ * memcpy/memset:     ec_memcpy() and ec_memset() with dst/src offsets from a 64 byte boundary,
+ *                    against the libc and the 32 bit word version before the vector paths
+ * timestamp:         ec_timestamp_get_time_ns() of the linux port (CLOCK_MONOTONIC)
+ * dc_sync_with_pi:   ec_master_dc_sync_with_pi() with a jittering reference time
+ * pdo_dispatch:      ec_domain_process() calling the PDO callback of slaves slaves
+ *
+ * Every case runs rounds rounds of about target_us, ns_per_op is the median round, cycles come
+ * from the cpu cycle counter of perf_event_open(), else from the TSC on x86.
+ *
+ *     ./ec_micro_bench [-f name] [-r rounds] [-t target_us]
+ *
+ * prints one JSON object.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "ec_master.h"
+
+#define BENCH_FRAME_SIZE   1536
+#define BENCH_MAX_FRAMES   64
+#define BENCH_MAX_ROUNDS   64
+#define BENCH_MAX_DEPTH    64
+#define BENCH_PDO_SIZE     16
+#define BENCH_BUFFER_SIZE  2048
+
+#define BENCH_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+extern void ec_master_send_datagrams(ec_master_t *master, uint8_t netdev_idx);
+extern void ec_master_receive_datagrams(ec_master_t *master,
+                                        uint8_t netdev_idx,
+                                        const uint8_t *frame_data,
+                                        size_t size);
+extern void ec_master_dc_sync_with_pi(ec_master_t *master, uint64_t dc_ref_time, int32_t *offsettime);
+
+typedef struct {
+    const char *filter;
+    uint32_t rounds;
+    uint32_t target_us;
+} bench_config_t;
+
+typedef struct {
+    double ns_per_op;
+    double min_ns_per_op;
+    double cycles_per_op;
+} bench_result_t;
+
+typedef void (*bench_op_t)(void *arg);
+
+static bench_config_t g_config = { NULL, 15, 2000 };
+
+static ec_master_t g_master;
+static ec_datagram_t g_datagrams[BENCH_MAX_DEPTH];
+static volatile uint64_t g_sink;
+static bool g_first_result = true;
+
+static int g_cycles_fd = -1;
+static const char *g_cycles_source = "none";
+
+/* null netdev, tx frames can be kept as the wire image */
+
+ec_netdev_t g_netdev[CONFIG_EC_MAX_NETDEVS];
+static uint8_t g_txbuf[CONFIG_EC_MAX_ENET_TXBUF_COUNT][BENCH_FRAME_SIZE];
+static uint8_t g_wire[BENCH_MAX_FRAMES][BENCH_FRAME_SIZE];
+static uint32_t g_wire_size[BENCH_MAX_FRAMES];
+static uint32_t g_wire_count;
+static bool g_wire_capture;
+
+ec_netdev_t *ec_netdev_low_level_init(uint8_t netdev_index)
+{
+    return &g_netdev[netdev_index];
+}
+
+void ec_netdev_low_level_poll_link_state(ec_netdev_t *netdev)
+{
+    netdev->link_state = true;
+}
+
+EC_FAST_CODE_SECTION uint8_t *ec_netdev_low_level_get_txbuf(ec_netdev_t *netdev)
+{
+    return g_txbuf[netdev->tx_frame_index];
+}
+
+EC_FAST_CODE_SECTION int ec_netdev_low_level_output(ec_netdev_t *netdev, uint32_t size)
+{
+    if (g_wire_capture && (g_wire_count < BENCH_MAX_FRAMES)) {
+        memcpy(g_wire[g_wire_count], g_txbuf[netdev->tx_frame_index], size);
+        g_wire_size[g_wire_count++] = size;
+    }
+
+    netdev->tx_frame_index++;
+    netdev->tx_frame_index %= CONFIG_EC_MAX_ENET_TXBUF_COUNT;
+    return 0;
+}
+
+void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
+{
+    (void)us;
+    (void)cb;
+    (void)arg;
+}
+
+void ec_htimer_stop(void)
+{
+}
+
+void ec_htimer_update(uint32_t us)
+{
+    (void)us;
+}
+
+void ec_htimer_update_ns(uint32_t ns)
+{
+    (void)ns;
+}
+
+void ec_timestamp_init(void)
+{
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* measurement */
+
+static void bench_cycles_init(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    g_cycles_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (g_cycles_fd >= 0) {
+        g_cycles_source = "perf";
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    g_cycles_source = "tsc";
+#endif
+}
+
+static inline uint64_t bench_cycles(void)
+{
+    uint64_t cycles = 0;
+
+    if (g_cycles_fd >= 0) {
+        if (read(g_cycles_fd, &cycles, sizeof(cycles)) != sizeof(cycles)) {
+            cycles = 0;
+        }
+        return cycles;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    cycles = __rdtsc();
+#endif
+    return cycles;
+}
+
+static void bench_measure(bench_op_t op, void *arg, bench_result_t *result)
+{
+    double ns[BENCH_MAX_ROUNDS];
+    double cycles[BENCH_MAX_ROUNDS];
+    uint64_t start, start_cycles, elapsed;
+    uint32_t loops = 1;
+    uint32_t rounds = MIN(MAX(g_config.rounds, 1), BENCH_MAX_ROUNDS);
+    uint32_t median = rounds / 2;
+
+    // warm up and find the number of ops of one round
+    while (1) {
+        start = ec_timestamp_get_time_ns();
+        for (uint32_t i = 0; i < loops; i++) {
+            op(arg);
+        }
+        elapsed = ec_timestamp_get_time_ns() - start;
+        if ((elapsed >= g_config.target_us * 1000ULL) || (loops >= (1U << 30))) {
+            break;
+        }
+        loops = (elapsed < 1000) ? (loops * 16) : (uint32_t)MIN(loops * 2ULL * g_config.target_us * 1000 / elapsed, 1U << 30);
+    }
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        start_cycles = bench_cycles();
+        start = ec_timestamp_get_time_ns();
+        for (uint32_t i = 0; i < loops; i++) {
+            op(arg);
+        }
+        elapsed = ec_timestamp_get_time_ns() - start;
+        cycles[r] = (double)(bench_cycles() - start_cycles) / loops;
+        ns[r] = (double)elapsed / loops;
+    }
+
+    // cycles of the round with the median time
+    for (uint32_t i = 0; i < rounds; i++) {
+        for (uint32_t j = i + 1; j < rounds; j++) {
+            if (ns[j] < ns[i]) {
+                double t = ns[i];
+                ns[i] = ns[j];
+                ns[j] = t;
+                t = cycles[i];
+                cycles[i] = cycles[j];
+                cycles[j] = t;
+            }
+        }
+    }
+
+    result->ns_per_op = ns[median];
+    result->min_ns_per_op = ns[0];
+    result->cycles_per_op = cycles[median];
+}
+
+static bool bench_enabled(const char *name)
+{
+    return !g_config.filter || strstr(name, g_config.filter);
+}
+
+static void bench_print(const char *name, const char *params, const bench_result_t *result)
+{
+    printf("%s    { \"name\": \"%s\", %s, \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, \"cycles_per_op\": %.1f }",
+           g_first_result ? "" : ",\n", name, params,
+           result->ns_per_op, result->min_ns_per_op, result->cycles_per_op);
+    g_first_result = false;
+    fflush(stdout);
+}
+
+/* send and receive */
+
+typedef struct {
+    uint32_t depth;
+    uint32_t size;
+} bench_queue_arg_t;
+
+static void bench_queue_setup(uint32_t depth, uint32_t size)
+{
+    for (uint32_t i = 0; i < depth; i++) {
+        ec_datagram_lrw(&g_datagrams[i], i * size, size);
+        memset(g_datagrams[i].data, (int)i, size);
+        ec_master_queue_datagram(&g_master, &g_datagrams[i]);
+    }
+}
+
+static void bench_queue_teardown(uint32_t depth)
+{
+    for (uint32_t i = 0; i < depth; i++) {
+        ec_dlist_del_init(&g_datagrams[i].queue);
+        g_datagrams[i].state = EC_DATAGRAM_INIT;
+    }
+}
+
+/* The frames of one send are the input of the receive benchmark, send assigns new indexes. */
+static void bench_queue_capture(uint32_t depth, uint32_t size)
+{
+    bench_queue_setup(depth, size);
+    g_wire_count = 0;
+    g_wire_capture = true;
+    ec_master_send_datagrams(&g_master, EC_NETDEV_MAIN);
+    g_wire_capture = false;
+    bench_queue_teardown(depth);
+}
+
+static void bench_send_op(void *arg)
+{
+    bench_queue_arg_t *queue = arg;
+
+    for (uint32_t i = 0; i < queue->depth; i++) {
+        g_datagrams[i].state = EC_DATAGRAM_QUEUED;
+    }
+    ec_master_send_datagrams(&g_master, EC_NETDEV_MAIN);
+}
+
+static void bench_receive_op(void *arg)
+{
+    bench_queue_arg_t *queue = arg;
+
+    for (uint32_t i = 0; i < queue->depth; i++) {
+        ec_dlist_add_tail(&g_master.datagram_queue, &g_datagrams[i].queue);
+        g_datagrams[i].state = EC_DATAGRAM_SENT;
+    }
+
+    for (uint32_t i = 0; i < g_wire_count; i++) {
+        ec_master_receive_datagrams(&g_master, EC_NETDEV_MAIN, g_wire[i] + ETH_HLEN, g_wire_size[i] - ETH_HLEN);
+    }
+}
+
+static void bench_send_receive(void)
+{
+    static const uint32_t depths[] = { 1, 4, 16, 64 };
+    static const uint32_t sizes[] = { 2, 64, 256, 1024 };
+    bench_queue_arg_t queue;
+    bench_result_t result;
+    char params[128];
+
+    for (uint32_t d = 0; d < BENCH_ARRAY_SIZE(depths); d++) {
+        for (uint32_t s = 0; s < BENCH_ARRAY_SIZE(sizes); s++) {
+            queue.depth = depths[d];
+            queue.size = sizes[s];
+
+            bench_queue_capture(queue.depth, queue.size);
+            snprintf(params, sizeof(params), "\"depth\": %u, \"size\": %u, \"frames\": %u",
+                     queue.depth, queue.size, g_wire_count);
+
+            if (bench_enabled("send_datagrams")) {
+                bench_queue_setup(queue.depth, queue.size);
+                bench_measure(bench_send_op, &queue, &result);
+                bench_queue_teardown(queue.depth);
+                bench_print("send_datagrams", params, &result);
+            }
+
+            if (bench_enabled("receive_datagrams")) {
+                bench_queue_capture(queue.depth, queue.size);
+                bench_measure(bench_receive_op, &queue, &result);
+                bench_queue_teardown(queue.depth);
+                bench_print("receive_datagrams", params, &result);
+            }
+        }
+    }
+}
+
+/* memcpy and memset */
+
+typedef struct {
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t size;
+} bench_mem_arg_t;
+
+#define BENCH_ALIGN_UP_DWORD(x) ((uint32_t)(uintptr_t)(x) & (sizeof(uint32_t) - 1))
+
+/* ec_memcpy() and ec_memset() before the vector paths, for comparison */
+static inline void bench_dword2array(char *addr, uint32_t w)
+{
+    addr[0] = w;
+    addr[1] = w >> 8;
+    addr[2] = w >> 16;
+    addr[3] = w >> 24;
+}
+
+static __attribute__((noinline)) void *bench_memcpy_v1(void *s1, const void *s2, size_t n)
+{
+    char *b1 = (char *)s1;
+    const char *b2 = (const char *)s2;
+    uint32_t *w1;
+    const uint32_t *w2;
+
+    if (BENCH_ALIGN_UP_DWORD(b1) == BENCH_ALIGN_UP_DWORD(b2)) {
+        while (BENCH_ALIGN_UP_DWORD(b1) != 0 && n > 0) {
+            *b1++ = *b2++;
+            --n;
+        }
+
+        w1 = (uint32_t *)b1;
+        w2 = (const uint32_t *)b2;
+
+        while (n >= 4 * sizeof(uint32_t)) {
+            *w1++ = *w2++;
+            *w1++ = *w2++;
+            *w1++ = *w2++;
+            *w1++ = *w2++;
+            n -= 4 * sizeof(uint32_t);
+        }
+
+        while (n >= sizeof(uint32_t)) {
+            *w1++ = *w2++;
+            n -= sizeof(uint32_t);
+        }
+
+        b1 = (char *)w1;
+        b2 = (const char *)w2;
+
+        while (n--) {
+            *b1++ = *b2++;
+        }
+    } else {
+        while (n > 0 && BENCH_ALIGN_UP_DWORD(b2) != 0) {
+            *b1++ = *b2++;
+            --n;
+        }
+
+        w2 = (const uint32_t *)b2;
+
+        while (n >= 4 * sizeof(uint32_t)) {
+            bench_dword2array(b1, *w2++);
+            b1 += sizeof(uint32_t);
+            bench_dword2array(b1, *w2++);
+            b1 += sizeof(uint32_t);
+            bench_dword2array(b1, *w2++);
+            b1 += sizeof(uint32_t);
+            bench_dword2array(b1, *w2++);
+            b1 += sizeof(uint32_t);
+            n -= 4 * sizeof(uint32_t);
+        }
+
+        while (n >= sizeof(uint32_t)) {
+            bench_dword2array(b1, *w2++);
+            b1 += sizeof(uint32_t);
+            n -= sizeof(uint32_t);
+        }
+
+        b2 = (const char *)w2;
+
+        while (n--) {
+            *b1++ = *b2++;
+        }
+    }
+    return s1;
+}
+
+static __attribute__((noinline)) void bench_memset_v1(void *s, int c, size_t n)
+{
+    char *b = (char *)s;
+    uint32_t *w;
+
+    while (BENCH_ALIGN_UP_DWORD(b) != 0 && n > 0) {
+        *b++ = (char)c;
+        --n;
+    }
+
+    w = (uint32_t *)b;
+    c = (c & 0xff) | ((c & 0xff) << 8) | ((c & 0xff) << 16) | ((c & 0xff) << 24);
+
+    while (n >= 4 * sizeof(uint32_t)) {
+        *w++ = c;
+        *w++ = c;
+        *w++ = c;
+        *w++ = c;
+        n -= 4 * sizeof(uint32_t);
+    }
+
+    while (n >= sizeof(uint32_t)) {
+        *w++ = c;
+        n -= sizeof(uint32_t);
+    }
+
+    b = (char *)w;
+
+    while (n--) {
+        *b++ = (char)c;
+    }
+}
+
+static void *(*volatile g_libc_memcpy)(void *, const void *, size_t) = memcpy;
+static void *(*volatile g_libc_memset)(void *, int, size_t) = memset;
+
+static void bench_memcpy_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    ec_memcpy(mem->dst, mem->src, mem->size);
+}
+
+static void bench_memset_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    ec_memset(mem->dst, 0x5a, mem->size);
+}
+
+static void bench_memcpy_v1_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    bench_memcpy_v1(mem->dst, mem->src, mem->size);
+}
+
+static void bench_memset_v1_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    bench_memset_v1(mem->dst, 0x5a, mem->size);
+}
+
+static void bench_memcpy_libc_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    g_libc_memcpy(mem->dst, mem->src, mem->size);
+}
+
+static void bench_memset_libc_op(void *arg)
+{
+    bench_mem_arg_t *mem = arg;
+
+    g_libc_memset(mem->dst, 0x5a, mem->size);
+}
+
+static void bench_mem(void)
+{
+    static const uint32_t sizes[] = { 2, 8, 64, 256, 1024, 1486 };
+    static const uint32_t offsets[][2] = { { 0, 0 }, { 0, 1 }, { 1, 3 } }; // dst, src
+    static const struct {
+        const char *name;
+        bench_op_t memcpy_op;
+        bench_op_t memset_op;
+    } impls[] = {
+        { "ec", bench_memcpy_op, bench_memset_op },
+        { "v1", bench_memcpy_v1_op, bench_memset_v1_op },
+        { "libc", bench_memcpy_libc_op, bench_memset_libc_op },
+    };
+    static uint8_t dst[BENCH_BUFFER_SIZE] __attribute__((aligned(64)));
+    static uint8_t src[BENCH_BUFFER_SIZE] __attribute__((aligned(64)));
+    bench_mem_arg_t mem;
+    bench_result_t result;
+    char params[128];
+
+    for (uint32_t i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t)i;
+    }
+
+    for (uint32_t o = 0; o < BENCH_ARRAY_SIZE(offsets); o++) {
+        for (uint32_t s = 0; s < BENCH_ARRAY_SIZE(sizes); s++) {
+            for (uint32_t i = 0; i < BENCH_ARRAY_SIZE(impls); i++) {
+                mem.dst = dst + offsets[o][0];
+                mem.src = src + offsets[o][1];
+                mem.size = sizes[s];
+
+                if (bench_enabled("memcpy")) {
+                    snprintf(params, sizeof(params), "\"impl\": \"%s\", \"size\": %u, \"dst_offset\": %u, \"src_offset\": %u",
+                             impls[i].name, sizes[s], offsets[o][0], offsets[o][1]);
+                    bench_measure(impls[i].memcpy_op, &mem, &result);
+                    bench_print("memcpy", params, &result);
+                }
+
+                // memset only depends on the destination
+                if (bench_enabled("memset") && (offsets[o][1] != 1)) {
+                    snprintf(params, sizeof(params), "\"impl\": \"%s\", \"size\": %u, \"dst_offset\": %u",
+                             impls[i].name, sizes[s], offsets[o][0]);
+                    bench_measure(impls[i].memset_op, &mem, &result);
+                    bench_print("memset", params, &result);
+                }
+            }
+        }
+    }
+}
+
+/* timestamp and dc controller */
+
+static void bench_timestamp_op(void *arg)
+{
+    (void)arg;
+    g_sink += ec_timestamp_get_time_ns();
+}
+
+typedef struct {
+    uint64_t ref_time;
+    uint32_t seed;
+} bench_dc_arg_t;
+
+static void bench_dc_op(void *arg)
+{
+    bench_dc_arg_t *dc = arg;
+    int32_t offsettime;
+
+    // reference time of the next cycle with +-512 ns jitter
+    dc->seed = dc->seed * 1103515245 + 12345;
+    dc->ref_time += g_master.cycle_time + ((dc->seed >> 16) & 0x3ff) - 512;
+    ec_master_dc_sync_with_pi(&g_master, dc->ref_time, &offsettime);
+    g_sink += offsettime;
+}
+
+static void bench_time(void)
+{
+    bench_dc_arg_t dc = { 1000000000ULL, 1 };
+    bench_result_t result;
+
+    if (bench_enabled("timestamp")) {
+        bench_measure(bench_timestamp_op, NULL, &result);
+        bench_print("timestamp", "\"source\": \"CLOCK_MONOTONIC\"", &result);
+    }
+
+    if (bench_enabled("dc_sync_with_pi")) {
+        g_master.cycle_time = 1000000;
+        g_master.shift_time = 200000;
+        ec_dc_ctrl_default_config(&g_master.dc_ctrl_config);
+        ec_dc_ctrl_init(&g_master.dc_ctrl, &g_master.dc_ctrl_config, g_master.cycle_time);
+        bench_measure(bench_dc_op, &dc, &result);
+        bench_print("dc_sync_with_pi", "\"cycle_ns\": 1000000", &result);
+    }
+}
+
+/* pdo callback dispatch */
+
+static __attribute__((noinline)) void bench_pdo_callback(ec_slave_t *slave, uint8_t *output, uint8_t *input)
+{
+    (void)slave;
+    EC_WRITE_U32(input, EC_READ_U32(output) + 1);
+}
+
+static void bench_dispatch_op(void *arg)
+{
+    ec_domain_process(arg);
+}
+
+static void bench_dispatch(void)
+{
+    static const uint32_t counts[] = { 1, 10, 100, 1000 };
+    ec_slave_config_t config;
+    ec_pdo_dispatch_t *dispatch;
+    ec_domain_t *domain = &g_master.domains[0];
+    bench_result_t result;
+    char params[64];
+
+    if (!bench_enabled("pdo_dispatch")) {
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.pdo_callback = bench_pdo_callback;
+
+    for (uint32_t c = 0; c < BENCH_ARRAY_SIZE(counts); c++) {
+        g_master.slaves = calloc(counts[c], sizeof(ec_slave_t));
+        dispatch = calloc(counts[c], sizeof(ec_pdo_dispatch_t));
+        if (!g_master.slaves || !dispatch) {
+            free(g_master.slaves);
+            free(dispatch);
+            return;
+        }
+        g_master.slave_count = counts[c];
+
+        ec_domain_init(domain, &g_master, 0, 1, 0);
+        for (uint32_t i = 0; i < counts[c]; i++) {
+            g_master.slaves[i].index = i;
+            g_master.slaves[i].config = &config;
+            g_master.slaves[i].domain = domain;
+            g_master.slaves[i].logical_start_address = i * BENCH_PDO_SIZE;
+            g_master.slaves[i].odata_size = BENCH_PDO_SIZE / 2;
+        }
+        ec_domain_build_dispatch(domain, dispatch);
+
+        snprintf(params, sizeof(params), "\"slaves\": %u", counts[c]);
+        bench_measure(bench_dispatch_op, domain, &result);
+        bench_print("pdo_dispatch", params, &result);
+
+        ec_domain_clear(domain);
+        free(dispatch);
+        free(g_master.slaves);
+        g_master.slaves = NULL;
+        g_master.slave_count = 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:r:t:")) != -1) {
+        switch (opt) {
+            case 'f':
+                g_config.filter = optarg;
+                break;
+            case 'r':
+                g_config.rounds = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                g_config.target_us = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                printf("Usage: %s [-f name] [-r rounds] [-t target_us]\r\n", argv[0]);
+                return -1;
+        }
+    }
+
+    bench_cycles_init();
+
+    g_netdev[EC_NETDEV_MAIN].master = &g_master;
+    g_netdev[EC_NETDEV_MAIN].link_state = true;
+    snprintf(g_netdev[EC_NETDEV_MAIN].name, sizeof(g_netdev[EC_NETDEV_MAIN].name), "bench");
+    g_master.netdev[EC_NETDEV_MAIN] = &g_netdev[EC_NETDEV_MAIN];
+    ec_dlist_init(&g_master.datagram_queue);
+
+    for (uint32_t i = 0; i < BENCH_MAX_DEPTH; i++) {
+        ec_datagram_init(&g_datagrams[i], EC_MAX_DATA_SIZE);
+    }
+
+    printf("{\n");
+    printf("  \"cycles_source\": \"%s\",\n", g_cycles_source);
+    printf("  \"rounds\": %u,\n", g_config.rounds);
+    printf("  \"results\": [\n");
+
+    bench_send_receive();
+    bench_mem();
+    bench_time();
+    bench_dispatch();
+
+    printf("\n  ]\n");
+    printf("}\n");
+
+    return 0;
+}
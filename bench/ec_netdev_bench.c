@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Round trip latency and throughput of the Linux netdev ports against a plain raw socket, over
+ * a veth pair with demo/linux/ec_loopback on the peer. It links the netdev, osal and port like
+ * the master does and replaces ec_master_receive(), so only the frame path is measured.
+ *
+ * latency:    one frame per htimer cycle, the send time travels in the payload.
+ * throughput: frames sent back to back from one thread with a window of outstanding frames.
+ *
+ * Build demo/linux once with the AF_PACKET port and once with -DCHERRYECAT_LINUX_XDP=ON, then
+ *
+ *     ./ec_netdev_bench -i vethA [-m port|raw] [-p period_us] [-n cycles] [-s size] [-w window] [-t seconds]
+ *
+ * prints one JSON object, "backend" is packet, xdp or raw.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include "ec_master.h"
+
+#ifndef ETH_P_ECAT
+#define ETH_P_ECAT 0x88a4
+#endif
+
+extern void ec_netdev_linux_set_ifname(uint8_t netdev_index, const char *ifname);
+
+typedef struct {
+    const char *ifname;
+    bool raw;
+    uint32_t period_us;
+    uint32_t cycles;
+    uint32_t size;
+    uint32_t window;
+    uint32_t seconds;
+} bench_config_t;
+
+static bench_config_t g_config = { NULL, false, 250, 20000, 64, 8, 2 };
+
+static ec_netdev_t *g_bench_netdev;
+static int g_raw_fd = -1;
+static uint8_t g_raw_frame[ETH_FRAME_LEN];
+
+static uint32_t *g_rtt;
+static volatile uint32_t g_tx_count;
+static volatile uint32_t g_rx_count;
+static volatile uint64_t g_rx_bytes;
+static volatile bool g_latency_test;
+
+/* Replaces the master, called by ec_netdev_receive() of the port under test. */
+void ec_master_receive(ec_master_t *master, uint8_t netdev_index, const uint8_t *frame_data, size_t size)
+{
+    uint64_t now = ec_timestamp_get_time_ns();
+    uint64_t sent;
+    uint32_t seq;
+
+    (void)master;
+    (void)netdev_index;
+
+    if (size < 12) {
+        return;
+    }
+
+    seq = EC_READ_U32(frame_data);
+    sent = EC_READ_U64(frame_data + 4);
+
+    if (g_latency_test && (seq < g_config.cycles)) {
+        g_rtt[seq] = (uint32_t)(now - sent);
+    }
+
+    g_rx_bytes += size + ETH_HLEN;
+    __atomic_add_fetch(&g_rx_count, 1, __ATOMIC_RELEASE);
+}
+
+static int bench_send(uint32_t seq)
+{
+    uint8_t *data;
+
+    if (g_config.raw) {
+        data = g_raw_frame + ETH_HLEN;
+    } else {
+        data = ec_netdev_get_txbuf(g_bench_netdev);
+    }
+
+    EC_WRITE_U32(data, seq);
+    EC_WRITE_U64(data + 4, ec_timestamp_get_time_ns());
+
+    if (g_config.raw) {
+        return (send(g_raw_fd, g_raw_frame, g_config.size + ETH_HLEN, 0) < 0) ? -1 : 0;
+    } else {
+        return ec_netdev_send(g_bench_netdev, g_config.size);
+    }
+}
+
+static void *bench_raw_rx_thread(void *argument)
+{
+    uint8_t frame[ETH_FRAME_LEN + ETH_FCS_LEN];
+    ssize_t size;
+    uintptr_t flags;
+
+    (void)argument;
+
+    while (1) {
+        size = recv(g_raw_fd, frame, sizeof(frame), 0);
+        if (size > ETH_HLEN) {
+            flags = ec_osal_enter_critical_section();
+            ec_master_receive(NULL, 0, frame + ETH_HLEN, size - ETH_HLEN);
+            ec_osal_leave_critical_section(flags);
+        }
+    }
+
+    return NULL;
+}
+
+static int bench_raw_open(void)
+{
+    struct sockaddr_ll addr;
+    struct sched_param param;
+    struct ifreq ifr;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    g_raw_fd = socket(AF_PACKET, SOCK_RAW, ec_htons(ETH_P_ECAT));
+    if (g_raw_fd < 0) {
+        return -1;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, g_config.ifname, IFNAMSIZ - 1);
+    if ((ioctl(g_raw_fd, SIOCGIFINDEX, &ifr) < 0)) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = ec_htons(ETH_P_ECAT);
+    addr.sll_ifindex = ifr.ifr_ifindex;
+    if (bind(g_raw_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return -1;
+    }
+
+    if (ioctl(g_raw_fd, SIOCGIFHWADDR, &ifr) < 0) {
+        return -1;
+    }
+
+    memset(g_raw_frame, 0xff, 6);
+    memcpy(&g_raw_frame[6], ifr.ifr_hwaddr.sa_data, 6);
+    EC_WRITE_U16(&g_raw_frame[12], ec_htons(0x88a4));
+
+    // same priority as the receive thread of the ports
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_attr_setschedparam(&attr, &param);
+    if (pthread_create(&thread, &attr, bench_raw_rx_thread, NULL) != 0) {
+        pthread_create(&thread, NULL, bench_raw_rx_thread, NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    return 0;
+}
+
+static void bench_cycle(void *arg)
+{
+    (void)arg;
+
+    if (g_tx_count < g_config.cycles) {
+        bench_send(g_tx_count);
+        g_tx_count++;
+    }
+}
+
+static int bench_compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void bench_wait_rx(uint32_t count, uint32_t timeout_ms)
+{
+    while ((__atomic_load_n(&g_rx_count, __ATOMIC_ACQUIRE) < count) && timeout_ms--) {
+        ec_osal_msleep(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = 0;
+    uint32_t lost = 0;
+    uint64_t start;
+    uint64_t elapsed;
+    uint32_t sent;
+    uint32_t received;
+    uint64_t rx_bytes;
+    uintptr_t flags;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:m:p:n:s:w:t:")) != -1) {
+        switch (opt) {
+            case 'i':
+                g_config.ifname = optarg;
+                break;
+            case 'm':
+                g_config.raw = (strcmp(optarg, "raw") == 0);
+                break;
+            case 'p':
+                g_config.period_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                g_config.cycles = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                g_config.size = MAX(strtoul(optarg, NULL, 0), 46);
+                g_config.size = MIN(g_config.size, ETH_DATA_LEN);
+                break;
+            case 'w':
+                g_config.window = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                g_config.seconds = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!g_config.ifname) {
+        printf("Usage: %s -i <ifname> [-m port|raw] [-p period_us] [-n cycles] [-s size] [-w window] [-t seconds]\r\n", argv[0]);
+        return -1;
+    }
+
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    if (g_config.raw) {
+        if (bench_raw_open() < 0) {
+            printf("Open raw socket on %s failed\r\n", g_config.ifname);
+            return -1;
+        }
+    } else {
+        ec_netdev_linux_set_ifname(0, g_config.ifname);
+        g_bench_netdev = ec_netdev_init(0);
+        if (!g_bench_netdev) {
+            return -1;
+        }
+        g_bench_netdev->master = (ec_master_t *)&g_config; // only checked for NULL by the ports
+    }
+
+    g_rtt = calloc(g_config.cycles, sizeof(uint32_t));
+    memset(g_rtt, 0xff, g_config.cycles * sizeof(uint32_t));
+
+    // latency
+    g_latency_test = true;
+    ec_htimer_start(g_config.period_us, bench_cycle, NULL);
+    while (g_tx_count < g_config.cycles) {
+        ec_osal_msleep(10);
+    }
+    ec_htimer_stop();
+    bench_wait_rx(g_config.cycles, 100);
+    g_latency_test = false;
+
+    for (uint32_t i = 0; i < g_config.cycles; i++) {
+        if (g_rtt[i] == UINT32_MAX) {
+            lost++;
+        } else {
+            g_rtt[samples++] = g_rtt[i];
+        }
+    }
+    qsort(g_rtt, samples, sizeof(uint32_t), bench_compare_u32);
+
+    // throughput
+    g_rx_count = 0;
+    g_rx_bytes = 0;
+    sent = 0;
+    start = ec_timestamp_get_time_ns();
+    while ((elapsed = ec_timestamp_get_time_ns() - start) < g_config.seconds * 1000000000ULL) {
+        if ((sent - __atomic_load_n(&g_rx_count, __ATOMIC_ACQUIRE)) >= g_config.window) {
+            continue;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        if (bench_send(UINT32_MAX) == 0) {
+            sent++;
+        }
+        ec_osal_leave_critical_section(flags);
+    }
+    received = g_rx_count;
+    rx_bytes = g_rx_bytes;
+
+    printf("{\n");
+    printf("  \"backend\": \"%s\",\n", g_config.raw ? "raw" : CHERRYECAT_LINUX_BACKEND);
+    printf("  \"ifname\": \"%s\",\n", g_config.ifname);
+    printf("  \"frame_size\": %u,\n", g_config.size + ETH_HLEN);
+    printf("  \"latency\": {\n");
+    printf("    \"period_us\": %u,\n", g_config.period_us);
+    printf("    \"samples\": %u,\n", samples);
+    printf("    \"lost\": %u,\n", lost);
+    if (samples) {
+        printf("    \"min_ns\": %u,\n", g_rtt[0]);
+        printf("    \"p50_ns\": %u,\n", g_rtt[samples / 2]);
+        printf("    \"p99_ns\": %u,\n", g_rtt[(uint64_t)samples * 99 / 100]);
+        printf("    \"p999_ns\": %u,\n", g_rtt[(uint64_t)samples * 999 / 1000]);
+        printf("    \"max_ns\": %u\n", g_rtt[samples - 1]);
+    }
+    printf("  },\n");
+    printf("  \"throughput\": {\n");
+    printf("    \"window\": %u,\n", g_config.window);
+    printf("    \"seconds\": %.3f,\n", elapsed / 1e9);
+    printf("    \"tx_frames_per_s\": %.0f,\n", sent / (elapsed / 1e9));
+    printf("    \"rx_frames_per_s\": %.0f,\n", received / (elapsed / 1e9));
+    printf("    \"rx_mbit_per_s\": %.1f\n", rx_bytes * 8 / (elapsed / 1e3));
+    printf("  }\n");
+    printf("}\n");
+
+    return 0;
+}
@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Master against the simulated slaves of port/sim, no network interface needed. For every slave
+ * count it measures the bus scan (SII, DC delays and drift compensation, PREOP configuration
+ * over CoE), the bring up to OP and the cyclic path with one PDO domain per 90 slaves.
+ *
+ * scan_ms:   link up seen by the master until scan_done
+ * op_ms:     ec_master_start() until all slaves are in OP and the domains have their expected WC
+ * dc_diff:   max |SYS_TIME_DIFF| of the slaves after the scan and in OP
+ * send/recv: exec time of ec_master_period_process() and ec_master_receive() from the perf
+ *            histograms, sim_ns is the time one frame spends in the slave model
+ * start_us:  cpu time of the thread calling ec_master_start(), mostly the PDO layout of all
+ *            slaves, on the virtual clock the master threads are counted too
+ * pdo_bytes: process data of all slaves, with -s and -m the run fails if it is not the size of all
+ *            assigned PDOs in all PDO categories of the SII
+ * reg_errors: first entry of every slave sync manager registered with ec_domain_reg_pdo_entry_list(),
+ *            entries whose offset is not the place of the slave in the domain image, outputs first
+ * cpu_ms:    cpu time of the whole run
+ * digest:    hash of all frames behind the slaves, see ec_sim_stats_t
+ *
+ * Every slave count runs in its own process, like a fresh start of the master. Build demo/linux
+ * with -DCHERRYECAT_LINUX_SIM=ON, then
+ *
+ *     ./ec_sim_bench [-n 1,10,100,1000] [-p period_us] [-t seconds] [-e sii.bin] [-i | -s | -m]
+ *
+ * prints one JSON object. -i configures the slaves with only the configuration image of the ENI
+ * instead of its sync manager tables, -s with the default PDO layout of their SII. -m is -s with
+ * every PDO of the SII split in two and each one in its own PDO category, like many real devices. ec_sim_bench_vtime is the same bench on the virtual clock of
+ * port/sim/ec_osal_vtime.c: times are virtual, the exec times 0, and two runs with the same
+ * arguments print the same digest.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <time.h>
+#include "ec_master.h"
+#include "ec_sim.h"
+#include "ec_sim_sii.h"
+#include "ec_sim_eni.h"
+
+#define BENCH_SLAVES_PER_DOMAIN 90
+#define BENCH_TIMEOUT_MS        600000
+#define BENCH_POLL_US           50 /* first poll interval, later 1/1024 of the time waited */
+
+typedef struct {
+    const char *slave_counts;
+    uint32_t period_us;
+    uint32_t seconds;
+    const char *sii_file;
+    bool image;
+    bool sii;
+    bool split;
+} bench_config_t;
+
+static bench_config_t g_config = { "1,10,100,1000", 250, 2, NULL, false, false, false };
+
+typedef struct {
+    uint32_t offset;
+    uint8_t bit_position;
+    ec_direction_t dir;
+} bench_reg_t;
+
+static ec_master_t g_master;
+
+static uint32_t bench_max_dc_diff(uint32_t slave_count)
+{
+    uint32_t max_diff = 0;
+    uint32_t diff;
+
+    for (uint32_t i = 0; i < slave_count; i++) {
+        ec_sim_read_reg(i, ESCREG_OF(ESCREG->SYS_TIME_DIFF), &diff, 4);
+        max_diff = MAX(max_diff, diff & 0x7fffffff);
+    }
+    return max_diff;
+}
+
+static bool bench_all_op(uint32_t slave_count)
+{
+    for (uint32_t i = 0; i < slave_count; i++) {
+        if ((ec_sim_get_al_state(i) & 0x1f) != EC_SLAVE_STATE_OP) {
+            return false;
+        }
+    }
+
+    return g_master.expected_working_counter &&
+           (g_master.actual_working_counter == g_master.expected_working_counter);
+}
+
+static void bench_sleep_us(uint64_t us)
+{
+#ifdef CONFIG_EC_SIM_VTIME
+    ec_sim_vtime_sleep_until(ec_sim_vtime_now() + us * 1000);
+#else
+    usleep(us);
+#endif
+}
+
+static uint64_t bench_cpu_time_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool bench_wait(bool (*cond)(uint32_t), uint32_t arg, uint64_t *time_ns)
+{
+    uint64_t start = ec_timestamp_get_time_ns();
+    uint64_t waited;
+
+    // every poll costs two thread switches, a fixed interval dominates the cpu time of long scans
+    while (!cond(arg)) {
+        waited = ec_timestamp_get_time_ns() - start;
+        if (waited > BENCH_TIMEOUT_MS * 1000000ULL) {
+            return false;
+        }
+        bench_sleep_us(MAX(BENCH_POLL_US, waited / 1000 / 1024));
+    }
+
+    *time_ns = ec_timestamp_get_time_ns() - start;
+    return true;
+}
+
+static bool bench_scan_started(uint32_t slave_count)
+{
+    (void)slave_count;
+    return g_master.link_state[EC_NETDEV_MAIN];
+}
+
+static bool bench_scan_done(uint32_t slave_count)
+{
+    return g_master.scan_done && (g_master.slave_count == slave_count);
+}
+
+static int bench_configure(uint32_t slave_count, ec_slave_config_t *configs)
+{
+    ec_domain_t *domain = &g_master.domains[0];
+
+    for (uint32_t i = 0; i < slave_count; i++) {
+        if (g_config.image) {
+            // image only, the PDO entries are registered against the layout in the image
+            if (eni_find_slave_image(g_master.slaves[i].sii.vendor_id,
+                                     g_master.slaves[i].sii.product_code,
+                                     &configs[i].image) < 0) {
+                printf("No ENI config image for slave %u\r\n", i);
+                return -1;
+            }
+        } else if (g_config.sii) {
+            configs[i].sync = g_master.slaves[i].sii.sync;
+            configs[i].sync_count = g_master.slaves[i].sii.sync_count;
+        } else if (eni_find_slave_sync_info(g_master.slaves[i].sii.vendor_id,
+                                            g_master.slaves[i].sii.product_code,
+                                            &configs[i].sync,
+                                            &configs[i].sync_count) < 0) {
+            printf("No ENI config for slave %u\r\n", i);
+            return -1;
+        }
+
+        // one LRW per domain, a domain has to fit into one datagram
+        if (i && !(i % BENCH_SLAVES_PER_DOMAIN)) {
+            domain = ec_master_create_domain(&g_master, 1, EC_DOMAIN_CYCLE_OFFSET_AUTO);
+            if (!domain) {
+                return -1;
+            }
+        }
+
+        configs[i].domain = domain;
+        configs[i].dc_assign_activate = 0x300;
+        configs[i].dc_sync[0].cycle_time = g_config.period_us * 1000;
+        configs[i].dc_sync[0].shift_time = 0;
+        g_master.slaves[i].config = &configs[i];
+    }
+
+    g_master.cycle_time = g_config.period_us * 1000;
+    g_master.shift_time = g_master.cycle_time / 5;
+    g_master.dc_sync_with_dc_ref_enable = true;
+    return 0;
+}
+
+/* Like the first entry of every sync manager, the entry at the start of every FMMU page of an image. */
+static ec_pdo_entry_reg_t *bench_register_image(uint32_t slave_index, const ec_slave_image_t *image, ec_pdo_entry_reg_t *reg,
+                                                bench_reg_t *result)
+{
+    const uint8_t *fmmu_page;
+
+    for (uint8_t i = 0; i < image->fmmu_count; i++) {
+        fmmu_page = image->fmmu_pages + EC_FMMU_PAGE_SIZE * i;
+
+        for (uint16_t j = 0; j < image->entry_count; j++) {
+            if (image->entries[j].bit_offset != EC_READ_U32(fmmu_page) * 8) {
+                continue;
+            }
+
+            reg->slave_position = slave_index;
+            reg->index = image->entries[j].index;
+            reg->subindex = image->entries[j].subindex;
+            reg->offset = &result->offset;
+            reg->bit_position = &result->bit_position;
+            result->dir = (EC_READ_U8(fmmu_page + 11) == 0x02) ? EC_DIR_OUTPUT : EC_DIR_INPUT;
+            reg++;
+            result++;
+            break;
+        }
+    }
+
+    return reg;
+}
+
+static int bench_register(uint32_t slave_count, ec_slave_config_t *configs, ec_pdo_entry_reg_t *regs, bench_reg_t *results)
+{
+    const ec_sync_info_t *syncs;
+    ec_pdo_entry_reg_t *list = regs;
+    ec_pdo_entry_reg_t *reg = regs;
+
+    for (uint32_t i = 0; i < slave_count; i++) {
+        if (configs[i].image) {
+            reg = bench_register_image(i, configs[i].image, reg, &results[reg - regs]);
+        }
+
+        syncs = configs[i].sync;
+        for (uint8_t j = 0; !configs[i].image && (j < configs[i].sync_count); j++) {
+            if (!syncs[j].n_pdos || !syncs[j].pdos[0].n_entries) {
+                continue;
+            }
+
+            reg->slave_position = i;
+            reg->index = syncs[j].pdos[0].entries[0].index;
+            reg->subindex = syncs[j].pdos[0].entries[0].subindex;
+            reg->offset = &results[reg - regs].offset;
+            reg->bit_position = &results[reg - regs].bit_position;
+            results[reg - regs].dir = syncs[j].dir;
+            reg++;
+        }
+
+        // one list per domain, terminated by index 0
+        if ((i == (slave_count - 1)) || (configs[i + 1].domain != configs[i].domain)) {
+            reg->index = 0;
+            if (ec_domain_reg_pdo_entry_list(configs[i].domain, list) < 0) {
+                return -1;
+            }
+            list = ++reg;
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t bench_check_regs(uint32_t reg_count, const ec_pdo_entry_reg_t *regs, const bench_reg_t *results)
+{
+    const ec_slave_t *slave;
+    uint32_t expected;
+    uint32_t errors = 0;
+
+    for (uint32_t i = 0; i < reg_count; i++) {
+        if (!regs[i].index) {
+            continue;
+        }
+
+        slave = &g_master.slaves[regs[i].slave_position];
+        expected = slave->logical_start_address - slave->domain->logical_start_address;
+        if (results[i].dir == EC_DIR_INPUT) {
+            expected += slave->odata_size;
+        }
+
+        if ((results[i].offset != expected) || results[i].bit_position) {
+            printf("Slave %u: PDO entry 0x%04x:%02x at offset %u, expected %u\r\n",
+                   regs[i].slave_position, regs[i].index, regs[i].subindex, results[i].offset, expected);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+/* Bytes of the PDOs with a sync manager in all TXPDO and RXPDO categories of the SII. */
+static uint32_t bench_sii_pdo_bytes(const uint8_t *sii, uint32_t sii_size)
+{
+    uint32_t in = EC_SII_ADDRESS_ADDITIONAL_INFO * 2;
+    uint32_t bits[2] = { 0, 0 };
+    uint16_t cat_type;
+    uint32_t cat_size;
+    uint32_t offset;
+    const uint8_t *data;
+
+    while ((in + 4) <= sii_size) {
+        cat_type = EC_READ_U16(sii + in);
+        cat_size = EC_READ_U16(sii + in + 2) * 2;
+        if ((cat_type == EC_SII_TYPE_END) || ((in + 4 + cat_size) > sii_size)) {
+            break;
+        }
+
+        if ((cat_type == EC_SII_TYPE_TXPDO) || (cat_type == EC_SII_TYPE_RXPDO)) {
+            for (offset = 0; (offset + 8) <= cat_size; offset += 8 + data[2] * 8) {
+                data = sii + in + 4 + offset;
+                if ((offset + 8 + data[2] * 8) > cat_size) {
+                    break;
+                }
+                if (data[3] == 0xff) {
+                    continue;
+                }
+                for (uint8_t i = 0; i < data[2]; i++) {
+                    bits[cat_type == EC_SII_TYPE_TXPDO] += data[8 + i * 8 + 5];
+                }
+            }
+        }
+
+        in += 4 + cat_size;
+    }
+
+    return (bits[0] + 7) / 8 + (bits[1] + 7) / 8;
+}
+
+/* Copy of the SII with every PDO of at least two entries split into two PDOs, one category per PDO. */
+static int bench_split_pdos(const uint8_t *sii, uint32_t sii_size, uint8_t **split, uint32_t *split_size)
+{
+    uint32_t in = EC_SII_ADDRESS_ADDITIONAL_INFO * 2;
+    uint32_t out = in;
+    uint16_t cat_type;
+    uint32_t cat_size;
+    uint32_t offset;
+    uint8_t n_entries;
+    uint8_t first;
+    uint8_t *data;
+
+    // a split adds a category and a PDO header, 12 bytes, for at most one PDO per 16 bytes
+    *split_size = sii_size + sii_size;
+    *split = malloc(*split_size);
+    if (!*split) {
+        return -1;
+    }
+    memset(*split, 0xff, *split_size);
+    memcpy(*split, sii, in);
+
+    while ((in + 4) <= sii_size) {
+        cat_type = EC_READ_U16(sii + in);
+        cat_size = EC_READ_U16(sii + in + 2) * 2;
+        if ((cat_type == EC_SII_TYPE_END) || ((in + 4 + cat_size) > sii_size)) {
+            break;
+        }
+
+        if ((cat_type != EC_SII_TYPE_TXPDO) && (cat_type != EC_SII_TYPE_RXPDO)) {
+            memcpy(*split + out, sii + in, 4 + cat_size);
+            out += 4 + cat_size;
+        } else {
+            for (offset = 0; (offset + 8) <= cat_size; offset += 8 + n_entries * 8) {
+                data = (uint8_t *)sii + in + 4 + offset;
+                n_entries = data[2];
+                first = n_entries > 1 ? n_entries / 2 : n_entries;
+
+                // the first half keeps the PDO index, the second one gets the next index
+                EC_WRITE_U16(*split + out, cat_type);
+                EC_WRITE_U16(*split + out + 2, 4 + first * 4);
+                memcpy(*split + out + 4, data, 8 + first * 8);
+                EC_WRITE_U8(*split + out + 6, first);
+                out += 12 + first * 8;
+
+                if (first < n_entries) {
+                    EC_WRITE_U16(*split + out, cat_type);
+                    EC_WRITE_U16(*split + out + 2, 4 + (n_entries - first) * 4);
+                    memcpy(*split + out + 4, data, 8);
+                    EC_WRITE_U16(*split + out + 4, EC_READ_U16(data) + 1);
+                    EC_WRITE_U8(*split + out + 6, n_entries - first);
+                    memcpy(*split + out + 12, data + 8 + first * 8, (n_entries - first) * 8);
+                    out += 12 + (n_entries - first) * 8;
+                }
+            }
+        }
+
+        in += 4 + cat_size;
+    }
+
+    EC_WRITE_U16(*split + out, EC_SII_TYPE_END);
+    EC_WRITE_U16(*split + out + 2, 0);
+    return 0;
+}
+
+static void bench_perf_start(void)
+{
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    g_master.perf_enable = true;
+    ec_master_clear_perf_hist(&g_master);
+    ec_osal_leave_critical_section(flags);
+}
+
+static void bench_print_hist(const char *name, ec_perf_hist_type_t type, bool last)
+{
+    ec_perf_hist_t hist;
+
+    ec_master_get_perf_hist(&g_master, type, &hist);
+    printf("      \"%s\": { \"count\": %u, \"min_ns\": %u, \"avg_ns\": %u, \"p50_ns\": %u, \"p99_ns\": %u, \"max_ns\": %u }%s\n",
+           name, hist.count, hist.count ? hist.min : 0,
+           hist.count ? (uint32_t)(hist.total / hist.count) : 0,
+           ec_perf_hist_percentile(&hist, 500), ec_perf_hist_percentile(&hist, 990), hist.max,
+           last ? "" : ",");
+}
+
+static int bench_run(uint32_t slave_count, const uint8_t *sii, uint32_t sii_size, bool last)
+{
+    struct sched_param param;
+    ec_slave_config_t *configs;
+    ec_pdo_entry_reg_t *regs;
+    bench_reg_t *results;
+    uint32_t reg_count = slave_count * (EC_MAX_SYNC_MANAGERS + 1);
+    uint32_t reg_errors = 0;
+    uint32_t pdo_bytes = 0;
+    ec_sim_stats_t stats;
+    uint64_t scan_ns = 0;
+    uint64_t op_ns = 0;
+    uint64_t unused;
+    uint64_t cpu_ns = bench_cpu_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t start_ns = 0;
+    uint32_t scan_dc_diff;
+    uint32_t wc_errors;
+    uint8_t domains;
+    bool scanned;
+    bool op = false;
+
+    // the polling thread only sleeps, above the master threads it sees every state on one cpu too
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    sched_setscheduler(0, SCHED_FIFO, &param);
+
+    if (ec_sim_set_slaves(slave_count, sii, sii_size) < 0) {
+        return -1;
+    }
+
+    if (ec_master_init(&g_master, 0) < 0) {
+        return -1;
+    }
+
+    // the scan starts with the first link poll, time it from the master seeing the link
+    scanned = bench_wait(bench_scan_started, slave_count, &unused) &&
+              bench_wait(bench_scan_done, slave_count, &scan_ns);
+    scan_dc_diff = bench_max_dc_diff(slave_count);
+
+    configs = calloc(slave_count, sizeof(ec_slave_config_t));
+    regs = calloc(reg_count, sizeof(ec_pdo_entry_reg_t));
+    results = calloc(reg_count, sizeof(bench_reg_t));
+    if (scanned && configs && regs && results && (bench_configure(slave_count, configs) == 0) &&
+        (bench_register(slave_count, configs, regs, results) == 0)) {
+        start_ns = bench_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID);
+        ec_master_start(&g_master);
+        start_ns = bench_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID) - start_ns;
+        op = bench_wait(bench_all_op, slave_count, &op_ns);
+        reg_errors = bench_check_regs(reg_count, regs, results);
+        pdo_bytes = g_master.actual_pdo_size;
+    }
+    domains = g_master.domain_count;
+
+    if (op) {
+        bench_perf_start();
+        ec_master_clear_wc_error_count(&g_master);
+        ec_sim_reset_stats();
+        bench_sleep_us(g_config.seconds * 1000000ULL);
+        g_master.perf_enable = false;
+    }
+    ec_sim_get_stats(&stats);
+    wc_errors = ec_master_get_wc_error_count(&g_master);
+    cpu_ns = bench_cpu_time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_ns;
+
+    printf("    {\n");
+    printf("      \"slaves\": %u,\n", slave_count);
+    printf("      \"scanned\": %s,\n", scanned ? "true" : "false");
+    printf("      \"scan_ms\": %.3f,\n", scan_ns / 1e6);
+    printf("      \"scan_dc_diff_ns\": %u,\n", scan_dc_diff);
+    printf("      \"op\": %s,\n", op ? "true" : "false");
+    printf("      \"op_ms\": %.3f,\n", op_ns / 1e6);
+    printf("      \"domains\": %u,\n", domains);
+    printf("      \"expected_wc\": %u,\n", g_master.expected_working_counter);
+    printf("      \"actual_wc\": %u,\n", g_master.actual_working_counter);
+    printf("      \"wc_errors\": %u,\n", wc_errors);
+    printf("      \"op_dc_diff_ns\": %u,\n", op ? bench_max_dc_diff(slave_count) : 0);
+    printf("      \"period_us\": %u,\n", g_config.period_us);
+    printf("      \"frames\": %llu,\n", (unsigned long long)stats.frames);
+    printf("      \"sim_ns_per_frame\": %llu,\n",
+           (unsigned long long)(stats.frames ? stats.process_ns / stats.frames : 0));
+    printf("      \"start_us\": %.1f,\n", start_ns / 1e3);
+    printf("      \"pdo_bytes\": %u,\n", pdo_bytes);
+    printf("      \"reg_errors\": %u,\n", reg_errors);
+    printf("      \"cpu_ms\": %.3f,\n", cpu_ns / 1e6);
+    printf("      \"digest\": \"%016llx\",\n", (unsigned long long)stats.digest);
+    bench_print_hist("send_exec", EC_PERF_HIST_SEND_EXEC, false);
+    bench_print_hist("recv_exec", EC_PERF_HIST_RECV_EXEC, false);
+    bench_print_hist("period", EC_PERF_HIST_PERIOD, true);
+    printf("    }%s\n", last ? "" : ",");
+    fflush(stdout);
+
+    if (g_config.sii && (pdo_bytes != slave_count * bench_sii_pdo_bytes(sii, sii_size))) {
+        return -1;
+    }
+
+    return (scanned && op && !reg_errors) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *sii = ec_sim_default_sii;
+    uint32_t sii_size = sizeof(ec_sim_default_sii);
+    uint32_t counts[16];
+    uint32_t count_num = 0;
+    char *list;
+    char *token;
+    int status;
+    int failed = 0;
+    pid_t pid;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:t:e:ism")) != -1) {
+        switch (opt) {
+            case 'n':
+                g_config.slave_counts = optarg;
+                break;
+            case 'p':
+                g_config.period_us = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                g_config.seconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                g_config.sii_file = optarg;
+                break;
+            case 'i':
+                g_config.image = true;
+                break;
+            case 's':
+                g_config.sii = true;
+                break;
+            case 'm':
+                g_config.sii = true;
+                g_config.split = true;
+                break;
+            default:
+                printf("Usage: %s [-n 1,10,100,1000] [-p period_us] [-t seconds] [-e sii.bin] [-i | -s | -m]\r\n", argv[0]);
+                return -1;
+        }
+    }
+
+    list = strdup(g_config.slave_counts);
+    for (token = strtok(list, ","); token && (count_num < 16); token = strtok(NULL, ",")) {
+        counts[count_num++] = strtoul(token, NULL, 0);
+    }
+
+    if (g_config.sii_file && (ec_sim_load_sii_file(g_config.sii_file, &sii, &sii_size) < 0)) {
+        printf("Load SII image %s failed\r\n", g_config.sii_file);
+        return -1;
+    }
+
+    if (g_config.split && (bench_split_pdos(sii, sii_size, &sii, &sii_size) < 0)) {
+        return -1;
+    }
+
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    printf("{\n");
+    printf("  \"backend\": \"sim\",\n");
+#ifdef CONFIG_EC_SIM_VTIME
+    printf("  \"clock\": \"virtual\",\n");
+#else
+    printf("  \"clock\": \"host\",\n");
+#endif
+    printf("  \"config\": \"%s\",\n", g_config.image ? "image" : (g_config.split ? "sii_split" : (g_config.sii ? "sii" : "sync")));
+    printf("  \"runs\": [\n");
+    fflush(stdout);
+
+    for (uint32_t i = 0; i < count_num; i++) {
+        pid = fork();
+        if (pid == 0) {
+            exit(bench_run(counts[i], sii, sii_size, i == (count_num - 1)) < 0 ? 1 : 0);
+        }
+
+        if ((pid < 0) || (waitpid(pid, &status, 0) < 0) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            failed++;
+        }
+    }
+
+    printf("  ],\n");
+    printf("  \"failed\": %d\n", failed);
+    printf("}\n");
+
+    return failed ? 1 : 0;
+}
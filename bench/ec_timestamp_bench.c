@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host microbenchmark of the cycle counter to ns conversion used by ec_timestamp_get_time_ns().
+ * It compares the former (cycles * 1000) / (freq / 10^6) division with the multiply-shift
+ * conversion of src/ec_timestamp.c and estimates the cost saved per master cycle by passing the
+ * cycle start time down the cyclic path. Built by bench/CMakeLists.txt, a 32 bit build with
+ * -DCMAKE_C_FLAGS=-m32 divides 64 bit in software like RV32/Cortex-M.
+ *
+ *     ./ec_timestamp_bench [cpu_freq_hz] [datagrams_per_cycle]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "ec_master.h"
+
+#define BENCH_LOOPS 20000000UL
+
+static uint32_t g_clock_time_div;
+
+/* conversion before the multiply-shift */
+static __attribute__((noinline)) uint64_t cycles_to_ns_div(uint64_t cycles)
+{
+    return (cycles * 1000) / g_clock_time_div;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double bench(uint64_t (*conv)(uint64_t), uint64_t *sink)
+{
+    uint64_t cycles = 0x123456789ULL;
+    uint64_t sum = 0;
+    uint64_t start;
+
+    start = now_ns();
+    for (unsigned long i = 0; i < BENCH_LOOPS; i++) {
+        sum += conv(cycles);
+        cycles += 997;
+    }
+    *sink += sum;
+
+    return (double)(now_ns() - start) / BENCH_LOOPS;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t freq = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 600000000;
+    uint32_t datagrams = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 8;
+    uint64_t sink = 0;
+    uint64_t max_err = 0;
+    double div_ns, mult_ns;
+    uint32_t calls_before, calls_after;
+
+    g_clock_time_div = freq / 1000000;
+    ec_timestamp_calc_mult(freq);
+
+    // accuracy against the exact result over one hour of cycles
+    for (uint64_t cycles = 0; cycles < (uint64_t)freq * 3600; cycles += (uint64_t)freq / 7 + 12345) {
+        uint64_t exact = (cycles / freq) * 1000000000ULL + ((cycles % freq) * 1000000000ULL) / freq;
+        uint64_t value = ec_timestamp_cycles_to_ns(cycles);
+        uint64_t err = (value > exact) ? (value - exact) : (exact - value);
+        max_err = (err > max_err) ? err : max_err;
+    }
+
+    div_ns = bench(cycles_to_ns_div, &sink);
+    mult_ns = bench(ec_timestamp_cycles_to_ns, &sink);
+
+    /*
+     * Timestamps taken per cycle before: period start, two dc ref sync writes, one per netdev for
+     * the statistics, one per sent datagram in the timeout sweep, one per frame, period end.
+     * Now the cycle start time taken once in ec_master_period_process() and passed to
+     * ec_master_send_at() replaces all but period start, frame and period end.
+     */
+    calls_before = 1 + 2 + 1 + datagrams + 1 + 1;
+    calls_after = 1 + 1 + 1;
+
+    printf("{\n");
+    printf("  \"cpu_freq_hz\": %u,\n", freq);
+    printf("  \"max_error_ns_1h\": %llu,\n", (unsigned long long)max_err);
+    printf("  \"div_ns_per_op\": %.3f,\n", div_ns);
+    printf("  \"mult_shift_ns_per_op\": %.3f,\n", mult_ns);
+    printf("  \"datagrams_per_cycle\": %u,\n", datagrams);
+    printf("  \"conv_ns_per_cycle_before\": %.3f,\n", div_ns * calls_before);
+    printf("  \"conv_ns_per_cycle_after\": %.3f,\n", mult_ns * calls_after);
+    printf("  \"sink\": %llu\n", (unsigned long long)(sink & 1));
+    printf("}\n");
+
+    return 0;
+}
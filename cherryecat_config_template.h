@@ -21,7 +21,6 @@
 
 #define EC_FAST_CODE_SECTION
 
-// #define CONFIG_EC_PDO_MULTI_DOMAIN
 #define CONFIG_EC_CMD_ENABLE
 // #define CONFIG_EC_TIMESTAMP_CUSTOM
 // #define CONFIG_EC_PHY_CUSTOM
@@ -70,6 +69,63 @@
 #define CONFIG_EC_MAX_PDO_BUFSIZE 2048
 #endif
 
+#ifndef CONFIG_EC_MAX_DOMAINS
+#define CONFIG_EC_MAX_DOMAINS 4
+#endif
+
+/* Minimum interval between two WC fault diagnoses */
+#ifndef CONFIG_EC_WC_DIAG_INTERVAL_MS
+#define CONFIG_EC_WC_DIAG_INTERVAL_MS 1000
+#endif
+
+/* Number of FRMW datagrams of the static DC drift compensation */
+#ifndef CONFIG_EC_DC_DRIFT_COMP_COUNT
+#define CONFIG_EC_DC_DRIFT_COMP_COUNT 15000
+#endif
+
+/* Sample SYS_TIME_DIFF of the DC slaves cyclically */
+// #define CONFIG_EC_DC_MONITOR
+
+/* Cycles between two SYS_TIME_DIFF samples */
+#ifndef CONFIG_EC_DC_MONITOR_INTERVAL
+#define CONFIG_EC_DC_MONITOR_INTERVAL 10
+#endif
+
+/* System time difference above which a slave counts as out of sync */
+#ifndef CONFIG_EC_DC_MONITOR_THRESHOLD_NS
+#define CONFIG_EC_DC_MONITOR_THRESHOLD_NS 1000
+#endif
+
+/* Keep latency histograms of the cyclic path while perf is enabled */
+// #define CONFIG_EC_PERF_HIST
+
+/* Record a timeline of the last master cycles, dump it as Chrome/Perfetto trace */
+// #define CONFIG_EC_TRACE
+
+/* Number of master cycles kept by the trace */
+#ifndef CONFIG_EC_TRACE_CYCLES
+#define CONFIG_EC_TRACE_CYCLES 64
+#endif
+
+/* Keep a ring of the last sent and received frames, exported as pcap */
+// #define CONFIG_EC_CAPTURE
+
+/* Number of frames kept by the capture ring */
+#ifndef CONFIG_EC_CAPTURE_FRAMES
+#define CONFIG_EC_CAPTURE_FRAMES 32
+#endif
+
+/* Bytes captured of every frame */
+#ifndef CONFIG_EC_CAPTURE_SNAPLEN
+#define CONFIG_EC_CAPTURE_SNAPLEN 128
+#endif
+
+/* ec_memcpy/ec_memset call memcpy/memset of the libc, e.g. an optimized one of the toolchain */
+// #define CONFIG_EC_MEMCPY_LIBC
+
+/* ec_memcpy/ec_memset only use machine words, not the vector unit the compiler targets (SSE2/AVX2, NEON, Helium, RVV) */
+// #define CONFIG_EC_MEMCPY_NO_SIMD
+
 #ifndef CONFIG_EC_MAX_ENET_TXBUF_COUNT
 #define CONFIG_EC_MAX_ENET_TXBUF_COUNT 10
 #endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+ * Sends every EtherCAT frame received on an interface back unchanged, except for the source
+ * address bit an ESC sets on the way. Run it on the peer of a veth pair to close the ring without
+ * slaves, the master then sees an empty bus with real round trips.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+
+#ifndef ETH_P_ECAT
+#define ETH_P_ECAT 0x88a4
+#endif
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_ll addr;
+    struct sched_param param;
+    struct ifreq ifr;
+    unsigned char frame[ETH_FRAME_LEN + ETH_FCS_LEN];
+    ssize_t size;
+    int fd;
+
+    if (argc != 2) {
+        printf("Usage: %s <ifname>\r\n", argv[0]);
+        return -1;
+    }
+
+    fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ECAT));
+    if (fd < 0) {
+        printf("Create packet socket failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, argv[1], IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        printf("Interface %s not found\r\n", argv[1]);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ECAT);
+    addr.sll_ifindex = ifr.ifr_ifindex;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        printf("Bind to %s failed: %s\r\n", argv[1], strerror(errno));
+        return -1;
+    }
+
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+        printf("No permission for SCHED_FIFO, round trips will jitter\r\n");
+    }
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    while (1) {
+        size = recv(fd, frame, sizeof(frame), 0);
+        if (size < ETH_HLEN) {
+            continue;
+        }
+
+        frame[6] |= 0x02; // port 0 of the first ESC marks the frame as processed
+        send(fd, frame, size, 0);
+    }
+
+    return 0;
+}
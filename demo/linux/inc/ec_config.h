@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_CONFIG_H
+#define EC_CONFIG_H
+
+#define CONFIG_EC_PRINTF(...) printf(__VA_ARGS__)
+
+#ifndef CONFIG_EC_DBG_LEVEL
+#define CONFIG_EC_DBG_LEVEL EC_DBG_INFO
+#endif
+
+#ifndef CONFIG_EC_SLAVE_DBG_LEVEL
+#define CONFIG_EC_SLAVE_DBG_LEVEL EC_DBG_INFO
+#endif
+
+/* Enable print with color */
+#define CONFIG_EC_PRINTF_COLOR_ENABLE
+
+#define EC_FAST_CODE_SECTION
+
+#define CONFIG_EC_CMD_ENABLE
+#define CONFIG_EC_TIMESTAMP_CUSTOM
+#define CONFIG_EC_PHY_CUSTOM
+
+#ifndef CONFIG_EC_MAX_NETDEVS
+#define CONFIG_EC_MAX_NETDEVS 1
+#endif
+
+#ifndef CONFIG_EC_NONPERIOD_PRIO
+#define CONFIG_EC_NONPERIOD_PRIO 0
+#endif
+
+#ifndef CONFIG_EC_NONPERIOD_STACKSIZE
+#define CONFIG_EC_NONPERIOD_STACKSIZE 2048
+#endif
+
+#ifndef CONFIG_EC_NONPERIOD_INTERVAL_MS
+#define CONFIG_EC_NONPERIOD_INTERVAL_MS 10
+#endif
+
+#ifndef CONFIG_EC_NONPERIOD_WAITERS
+#define CONFIG_EC_NONPERIOD_WAITERS 20
+#endif
+
+#ifndef CONFIG_EC_SCAN_PRIO
+#define CONFIG_EC_SCAN_PRIO 10
+#endif
+
+#ifndef CONFIG_EC_SCAN_STACKSIZE
+#define CONFIG_EC_SCAN_STACKSIZE 4096
+#endif
+
+#ifndef CONFIG_EC_SCAN_INTERVAL_MS
+#define CONFIG_EC_SCAN_INTERVAL_MS 100
+#endif
+
+#ifndef CONFIG_EC_PER_SM_MAX_PDOS
+#define CONFIG_EC_PER_SM_MAX_PDOS 3
+#endif
+
+#ifndef CONFIG_EC_PER_PDO_MAX_PDO_ENTRIES
+#define CONFIG_EC_PER_PDO_MAX_PDO_ENTRIES 8
+#endif
+
+#ifndef CONFIG_EC_MAX_PDO_BUFSIZE
+#define CONFIG_EC_MAX_PDO_BUFSIZE 2048
+#endif
+
+#ifndef CONFIG_EC_MAX_DOMAINS
+#define CONFIG_EC_MAX_DOMAINS 4
+#endif
+
+/* Minimum interval between two WC fault diagnoses */
+#ifndef CONFIG_EC_WC_DIAG_INTERVAL_MS
+#define CONFIG_EC_WC_DIAG_INTERVAL_MS 1000
+#endif
+
+/* Number of FRMW datagrams of the static DC drift compensation */
+#ifndef CONFIG_EC_DC_DRIFT_COMP_COUNT
+#define CONFIG_EC_DC_DRIFT_COMP_COUNT 15000
+#endif
+
+/* Sample SYS_TIME_DIFF of the DC slaves cyclically */
+// #define CONFIG_EC_DC_MONITOR
+
+/* Cycles between two SYS_TIME_DIFF samples */
+#ifndef CONFIG_EC_DC_MONITOR_INTERVAL
+#define CONFIG_EC_DC_MONITOR_INTERVAL 10
+#endif
+
+/* System time difference above which a slave counts as out of sync */
+#ifndef CONFIG_EC_DC_MONITOR_THRESHOLD_NS
+#define CONFIG_EC_DC_MONITOR_THRESHOLD_NS 1000
+#endif
+
+/* Keep latency histograms of the cyclic path while perf is enabled */
+#define CONFIG_EC_PERF_HIST
+
+/* Record a timeline of the last master cycles, dump it as Chrome/Perfetto trace */
+// #define CONFIG_EC_TRACE
+
+/* Number of master cycles kept by the trace */
+#ifndef CONFIG_EC_TRACE_CYCLES
+#define CONFIG_EC_TRACE_CYCLES 64
+#endif
+
+/* Keep a ring of the last sent and received frames, exported as pcap */
+// #define CONFIG_EC_CAPTURE
+
+/* Number of frames kept by the capture ring */
+#ifndef CONFIG_EC_CAPTURE_FRAMES
+#define CONFIG_EC_CAPTURE_FRAMES 32
+#endif
+
+/* Bytes captured of every frame */
+#ifndef CONFIG_EC_CAPTURE_SNAPLEN
+#define CONFIG_EC_CAPTURE_SNAPLEN 128
+#endif
+
+/* ec_memcpy/ec_memset call memcpy/memset of the libc, e.g. an optimized one of the toolchain */
+// #define CONFIG_EC_MEMCPY_LIBC
+
+/* ec_memcpy/ec_memset only use machine words, not the vector unit the compiler targets (SSE2/AVX2, NEON, Helium, RVV) */
+// #define CONFIG_EC_MEMCPY_NO_SIMD
+
+#ifndef CONFIG_EC_MAX_ENET_TXBUF_COUNT
+#define CONFIG_EC_MAX_ENET_TXBUF_COUNT 10
+#endif
+
+#ifndef CONFIG_EC_MAX_ENET_RXBUF_COUNT
+#define CONFIG_EC_MAX_ENET_RXBUF_COUNT 32
+#endif
+
+// #define CONFIG_EC_FOE
+
+// #define CONFIG_EC_EOE
+
+#ifndef CONFIG_EC_EOE_PRIO
+#define CONFIG_EC_EOE_PRIO 30
+#endif
+
+#ifndef CONFIG_EC_EOE_STACKSIZE
+#define CONFIG_EC_EOE_STACKSIZE 4096
+#endif
+
+#endif
\ No newline at end of file
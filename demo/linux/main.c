@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ec_master.h"
+#ifdef CHERRYECAT_LINUX_SIM
+#include "ec_sim.h"
+#include "ec_sim_sii.h"
+#endif
+
+#define EC_SHELL_MAX_ARGS 16
+
+ec_master_t g_ec_master;
+
+#ifdef CHERRYECAT_LINUX_SIM
+static void usage(const char *name)
+{
+    printf("Usage: %s [-n <slave count>] [-e <sii.bin>]\r\n", name);
+}
+
+static int sim_setup(uint32_t slave_count, const char *sii_file)
+{
+    uint8_t *sii = ec_sim_default_sii;
+    uint32_t sii_size = sizeof(ec_sim_default_sii);
+    int ret;
+
+    if (sii_file && (ec_sim_load_sii_file(sii_file, &sii, &sii_size) < 0)) {
+        printf("Load SII image %s failed\r\n", sii_file);
+        return -1;
+    }
+
+    ret = ec_sim_set_slaves(slave_count, sii, sii_size);
+    if (sii_file) {
+        ec_osal_free(sii);
+    }
+
+    printf("Simulating %u slaves\r\n", slave_count);
+    return ret;
+}
+#else
+extern void ec_netdev_linux_set_ifname(uint8_t netdev_index, const char *ifname);
+
+static void usage(const char *name)
+{
+    printf("Usage: %s -i <ifname>"
+#if CONFIG_EC_MAX_NETDEVS > 1
+           " -b <backup ifname>"
+#endif
+           "\r\n",
+           name);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    const char *shell_argv[EC_SHELL_MAX_ARGS];
+    char line[256];
+    char *token;
+    int shell_argc;
+    int opt;
+#ifdef CHERRYECAT_LINUX_SIM
+    uint32_t sim_slave_count = 2;
+    const char *sim_sii_file = NULL;
+#endif
+
+    while ((opt = getopt(argc, argv, "i:b:n:e:h")) != -1) {
+        switch (opt) {
+#ifdef CHERRYECAT_LINUX_SIM
+            case 'n':
+                sim_slave_count = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                sim_sii_file = optarg;
+                break;
+#else
+            case 'i':
+                ec_netdev_linux_set_ifname(EC_NETDEV_MAIN, optarg);
+                break;
+#if CONFIG_EC_MAX_NETDEVS > 1
+            case 'b':
+                ec_netdev_linux_set_ifname(EC_NETDEV_BACKUP, optarg);
+                break;
+#endif
+#endif
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
+
+    // page faults in the cycle would show up as jitter
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        printf("mlockall failed, memory is not locked\r\n");
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+#ifdef CHERRYECAT_LINUX_SIM
+    if (sim_setup(sim_slave_count, sim_sii_file) < 0) {
+        return -1;
+    }
+#endif
+
+    ec_master_cmd_init(&g_ec_master);
+    if (ec_master_init(&g_ec_master, 0) < 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    printf("Type ethercat commands, for example \"ethercat start 1000\"\r\n");
+
+    while (fgets(line, sizeof(line), stdin)) {
+        shell_argc = 0;
+        shell_argv[shell_argc++] = "ethercat";
+
+        for (token = strtok(line, " \t\r\n"); token && (shell_argc < EC_SHELL_MAX_ARGS); token = strtok(NULL, " \t\r\n")) {
+            if ((shell_argc == 1) && (strcmp(token, "ethercat") == 0)) {
+                continue;
+            }
+            shell_argv[shell_argc++] = token;
+        }
+
+        if (shell_argc == 1) {
+            continue;
+        }
+
+        if ((strcmp(shell_argv[1], "exit") == 0) || (strcmp(shell_argv[1], "quit") == 0)) {
+            break;
+        }
+
+        ethercat(shell_argc, shell_argv);
+    }
+
+    ec_master_stop(&g_ec_master);
+    return 0;
+}
+
+// weak api used in ec_cmd.c
+unsigned char cherryecat_eepromdata[2048]; // EEPROM data buffer, please generate by esi_parse.py
+
+// weak api used in ec_cmd.c
+void ec_pdo_callback(ec_slave_t *slave, uint8_t *output, uint8_t *input)
+{
+    (void)slave;
+    (void)output;
+    (void)input;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_CAPTURE_H
+#define EC_CAPTURE_H
+
+#ifdef CONFIG_EC_CAPTURE
+
+typedef struct ec_master ec_master_t;
+
+#define EC_CAPTURE_TRIGGER_TIMEOUT   (1 << 0) /**< A datagram timed out. */
+#define EC_CAPTURE_TRIGGER_WC        (1 << 1) /**< The working counter of a domain dropped. */
+#define EC_CAPTURE_TRIGGER_UNMATCHED (1 << 2) /**< A received datagram matched no sent datagram. */
+
+#define EC_CAPTURE_DIR_TX 0
+#define EC_CAPTURE_DIR_RX 1
+
+typedef struct {
+    uint64_t time;                            /**< Local time when the frame was sent or received [ns]. */
+    uint16_t size;                            /**< Size of the frame including the ethernet header. */
+    uint16_t caplen;                          /**< Number of bytes captured. */
+    uint8_t netdev_idx;                       /**< Netdev the frame was sent or received on. */
+    uint8_t dir;                              /**< EC_CAPTURE_DIR_TX or EC_CAPTURE_DIR_RX. */
+    uint8_t data[CONFIG_EC_CAPTURE_SNAPLEN];  /**< First caplen bytes of the frame. */
+} ec_capture_frame_t;
+
+typedef struct {
+    volatile bool enable;   /**< Frames are captured. */
+    uint8_t trigger_mask;   /**< Triggers that stop the capture, 0 captures until stopped. */
+    uint8_t triggered;      /**< Trigger that fired, 0 if none. */
+    uint32_t post_count;    /**< Frames still captured after the trigger. */
+    uint32_t count;         /**< Number of captured frames. */
+    uint32_t head;          /**< Slot of the next frame. */
+    ec_capture_frame_t frames[CONFIG_EC_CAPTURE_FRAMES];
+} ec_capture_t;
+
+/* Receives the pcap stream in chunks. */
+typedef void (*ec_capture_write_t)(void *arg, const uint8_t *data, uint32_t size);
+
+void ec_capture_frame(ec_master_t *master, uint8_t netdev_idx, uint8_t dir, const uint8_t *frame, uint32_t size);
+void ec_capture_trigger(ec_master_t *master, uint8_t trigger);
+
+#define EC_CAPTURE_FRAME(master, netdev_idx, dir, frame, size)      \
+    do {                                                            \
+        if ((master)->capture.enable) {                             \
+            ec_capture_frame(master, netdev_idx, dir, frame, size); \
+        }                                                           \
+    } while (0)
+
+#define EC_CAPTURE_TRIGGER(master, trigger)      \
+    do {                                         \
+        if ((master)->capture.enable) {          \
+            ec_capture_trigger(master, trigger); \
+        }                                        \
+    } while (0)
+
+void ec_master_capture_start(ec_master_t *master, uint8_t trigger_mask);
+void ec_master_capture_stop(ec_master_t *master);
+uint32_t ec_master_capture_export(ec_master_t *master, ec_capture_write_t write, void *arg);
+
+#else
+#define EC_CAPTURE_FRAME(master, netdev_idx, dir, frame, size)
+#define EC_CAPTURE_TRIGGER(master, trigger)
+#endif
+#endif
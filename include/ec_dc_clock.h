@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_DC_CLOCK_H
+#define EC_DC_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Errors above this (in ns) restart the model instead of being filtered, e.g. after lost frames. */
+#define EC_DC_CLOCK_RESYNC_NS 20000
+
+typedef struct {
+    uint64_t local_ref;    /**< Local time of the last sample [ns]. */
+    uint64_t dc_ref;       /**< Estimated DC time at local_ref [ns]. */
+    int64_t drift;         /**< Rate of DC time against local time minus 1 (Q32). */
+    uint32_t inv_interval; /**< 2^32 / nominal sample interval. */
+    int32_t last_error;    /**< Prediction error of the last sample [ns]. */
+    uint32_t samples;      /**< Samples since the last restart. */
+    bool valid;            /**< Model can be used. */
+} ec_dc_clock_t;
+
+void ec_dc_clock_init(ec_dc_clock_t *clock, uint32_t interval_ns);
+void ec_dc_clock_update(ec_dc_clock_t *clock, uint64_t local_ns, uint64_t dc_ns);
+
+/* Extrapolates DC time from a local timestamp in O(1). */
+static inline uint64_t ec_dc_clock_predict(const ec_dc_clock_t *clock, uint64_t local_ns)
+{
+    int64_t dt = (int64_t)(local_ns - clock->local_ref);
+
+    return clock->dc_ref + dt + ((dt * clock->drift) >> 32);
+}
+
+static inline int32_t ec_dc_clock_get_drift_ppb(const ec_dc_clock_t *clock)
+{
+    return (int32_t)((clock->drift * 1000000000LL) >> 32);
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_DC_CTRL_H
+#define EC_DC_CTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Gains are Q16 fixed point, 65536 is 1.0 */
+#define EC_DC_CTRL_Q16(x) ((int32_t)((x)*65536))
+
+typedef struct {
+    int32_t kp;                 /**< Proportional gain (Q16). */
+    int32_t ki;                 /**< Integral gain (Q16). */
+    int32_t kf;                 /**< Drift estimation filter gain (Q16), 0 disables feed-forward. */
+    int32_t integral_limit_ns;  /**< Anti-windup limit of the integral term [ns]. */
+    int32_t output_limit_ns;    /**< Limit of the period correction [ns]. */
+    uint32_t lock_threshold_ns; /**< Phase error below which the loop counts as locked [ns]. */
+    uint32_t lock_cycles;       /**< Consecutive cycles below the threshold needed for lock. */
+} ec_dc_ctrl_config_t;
+
+typedef struct {
+    ec_dc_ctrl_config_t config;
+    uint32_t cycle_time;  /**< Cycle time [ns]. */
+    uint64_t phase_ref;   /**< Expected cycle boundary of the next phase error sample [ns]. */
+    bool phase_valid;     /**< phase_ref is valid. */
+    int64_t integral;     /**< Integral term (Q16 ns). */
+    int64_t drift;        /**< Estimated drift per cycle (Q16 ns). */
+    int32_t last_error;   /**< Phase error of the previous update [ns]. */
+    int32_t last_output;  /**< Correction of the previous update [ns]. */
+    bool first;           /**< No previous update yet. */
+    uint32_t lock_count;  /**< Consecutive cycles below the lock threshold. */
+    bool locked;          /**< Loop is locked. */
+} ec_dc_ctrl_t;
+
+void ec_dc_ctrl_default_config(ec_dc_ctrl_config_t *config);
+void ec_dc_ctrl_init(ec_dc_ctrl_t *ctrl, const ec_dc_ctrl_config_t *config, uint32_t cycle_time);
+void ec_dc_ctrl_reset(ec_dc_ctrl_t *ctrl);
+int32_t ec_dc_ctrl_phase_error(ec_dc_ctrl_t *ctrl, uint64_t time);
+int32_t ec_dc_ctrl_update(ec_dc_ctrl_t *ctrl, int32_t error_ns);
+
+static inline bool ec_dc_ctrl_is_locked(const ec_dc_ctrl_t *ctrl)
+{
+    return ctrl->locked;
+}
+
+static inline int32_t ec_dc_ctrl_get_drift(const ec_dc_ctrl_t *ctrl)
+{
+    return (int32_t)(ctrl->drift >> 16);
+}
+
+#endif
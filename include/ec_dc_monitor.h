@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_DC_MONITOR_H
+#define EC_DC_MONITOR_H
+
+#ifdef CONFIG_EC_DC_MONITOR
+
+typedef struct ec_master ec_master_t;
+
+/* Histogram bucket i counts |deviation| in [32 << i, 64 << i) ns, bucket 0 starts at 0, the last bucket is open. */
+#define EC_DC_MONITOR_HIST_BUCKETS 8
+
+typedef struct {
+    uint32_t samples;                           /**< Number of valid samples. */
+    uint32_t no_response;                       /**< Samples without response. */
+    int32_t last_ns;                            /**< Last system time difference [ns]. */
+    uint32_t max_ns;                            /**< Maximum |system time difference| [ns]. */
+    uint32_t hist[EC_DC_MONITOR_HIST_BUCKETS];  /**< Histogram of |system time difference|. */
+    uint32_t sync_loss_count;                   /**< Number of times the slave lost sync. */
+    bool out_of_sync;                           /**< Last deviation exceeded the threshold. */
+} ec_dc_monitor_stats_t;
+
+typedef struct {
+    ec_datagram_t datagram; /**< BRD/FPRD of SYS_TIME_DIFF, at most one in flight. */
+    uint8_t data[4];        /**< SYS_TIME_DIFF (0x092C). */
+    uint32_t cycle_count;   /**< Master cycles left until the next sample. */
+    uint32_t next_index;    /**< Next slave to sample, slave_count selects the bus wide BRD. */
+    uint32_t slave_index;   /**< Slave of the sample in flight, slave_count for the BRD. */
+    bool pending;           /**< Sample is in flight. */
+    uint32_t bus_max_ns;    /**< Upper bound of |system time difference| of all slaves from the last BRD [ns]. */
+    uint32_t bus_samples;   /**< Number of BRD samples. */
+    uint32_t out_of_sync;   /**< Number of slaves currently out of sync. */
+} ec_dc_monitor_t;
+
+void ec_dc_monitor_init(ec_master_t *master);
+void ec_dc_monitor_clear(ec_master_t *master);
+void ec_dc_monitor_process(ec_master_t *master);
+
+int ec_master_get_slave_dc_stats(ec_master_t *master, uint32_t slave_index, ec_dc_monitor_stats_t *stats);
+uint32_t ec_master_get_dc_bus_deviation(ec_master_t *master);
+void ec_master_clear_dc_stats(ec_master_t *master);
+
+#endif
+#endif
@@ -396,17 +396,10 @@ typedef struct __PACKED ec_pdo_mapping_t {
     uint32_t entry[CONFIG_EC_PER_PDO_MAX_PDO_ENTRIES];
 } ec_pdo_mapping_t;
 
-typedef struct __PACKED ec_mailbox_header {
-    uint16_t length;
-    uint16_t address;
-    uint8_t channel  : 6;
-    uint8_t priority : 2;
-    uint8_t type     : 4;
-    uint8_t counter  : 3;
-    uint8_t reserved : 1;
-} ec_mailbox_header_t;
-
 /** Size of the mailbox header.
+ *
+ * length (2), address (2), channel/priority (1), type (bits 0-3)/counter (bits 4-6) (1),
+ * little endian on the wire, written and read with EC_WRITE_*()/EC_READ_*().
  */
 #define EC_MBOX_HEADER_SIZE 6
 
@@ -439,36 +432,20 @@ enum {
 #define EC_MBXERR_INVALIDSIZE         0x08 /**< \brief Mailbox error "Invalid size"*/
 #define EC_MBXERR_SERVICEINWORK       0x09 /**< \brief Mailbox error "Service in work"*/
 
-typedef struct __PACKED ec_coe_header {
-    uint16_t number   : 9;
-    uint16_t reserved : 3;
-    uint16_t service  : 4;
-} ec_coe_header_t;
-
-typedef struct __PACKED ec_sdo_header_common {
-    uint8_t size_indicator  : 1;
-    uint8_t transfertype    : 1; // expedited transfer
-    uint8_t data_set_size   : 2;
-    uint8_t complete_access : 1;
-    uint8_t command         : 3;
-} ec_sdo_header_common_t;
-
-typedef struct __PACKED ec_sdo_header_segment {
-    uint8_t more_follows : 1;
-    uint8_t segdata_size : 3;
-    uint8_t toggle       : 1;
-    uint8_t command      : 3;
-} ec_sdo_header_segment_t;
-
-typedef struct __PACKED ec_sdo_header {
-    union {
-        uint8_t byte;
-        ec_sdo_header_common_t common;
-        ec_sdo_header_segment_t segment;
-    };
-    uint16_t index;
-    uint8_t subindex;
-} ec_sdo_header_t;
+/** CoE header word, number (bits 0-8) is 0 and service (bits 12-15). */
+#define EC_COE_HEADER(service) ((uint16_t)((service) << 12))
+
+/** SDO command byte of initiate requests and responses. */
+#define EC_SDO_CMD_SIZE_INDICATOR    0x01                   /**< Size is given. */
+#define EC_SDO_CMD_EXPEDITED         0x02                   /**< Data in the header. */
+#define EC_SDO_CMD_DATA_SET_SIZE(n)  (((n) & 0x03) << 2)    /**< Unused bytes of expedited data. */
+#define EC_SDO_CMD_COMPLETE_ACCESS   0x10                   /**< Complete access. */
+#define EC_SDO_CMD(command)          ((uint8_t)((command) << 5))
+
+/** SDO command byte of segments, the command is EC_SDO_CMD(). */
+#define EC_SDO_SEG_LAST              0x01                   /**< Last segment. */
+#define EC_SDO_SEG_DATA_SIZE(n)      (((n) & 0x07) << 1)    /**< Unused bytes of the 7 byte minimum. */
+#define EC_SDO_SEG_TOGGLE            0x10                   /**< Toggle bit. */
 
 #define EC_COE_SERVICE_EMERGENCY            0x01
 #define EC_COE_SERVICE_SDO_REQUEST          0x02
@@ -490,14 +467,7 @@ typedef struct __PACKED ec_sdo_header {
 #define EC_COE_RESPONSE_UPLOAD           0x02
 #define EC_COE_RESPONSE_DOWNLOAD         0x03
 
-typedef struct __PACKED {
-    uint16_t opcode;
-    union {
-        uint32_t password;
-        uint32_t packet_number;
-        uint32_t error_code;
-    };
-} ec_foe_header_t;
+/* FoE header: opcode (2), password, packet number or error code (4) */
 
 #define EC_FOE_OPCODE_READ  0x0001
 #define EC_FOE_OPCODE_WRITE 0x0002
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_DOMAIN_H
+#define EC_DOMAIN_H
+
+/** Let the master choose the cycle offset so that frames stay balanced. */
+#define EC_DOMAIN_CYCLE_OFFSET_AUTO 0xffffffff
+
+/** PDO entry registration, a list is terminated by an entry with index 0. */
+typedef struct {
+    uint16_t slave_position; /**< Index of the slave in the master slave array. */
+    uint32_t vendor_id;      /**< Expected vendor id, 0 to skip the check. */
+    uint32_t product_code;   /**< Expected product code, 0 to skip the check. */
+    uint16_t index;          /**< PDO entry index. */
+    uint8_t subindex;        /**< PDO entry subindex. */
+    uint32_t *offset;        /**< Receives the byte offset of the entry in the domain image. */
+    uint8_t *bit_position;   /**< Receives the bit position of the entry, NULL if it must be byte aligned. */
+} ec_pdo_entry_reg_t;
+
+typedef void (*ec_domain_callback_t)(ec_domain_t *domain, uint8_t *data, void *arg);
+
+/** PDO callback dispatch entry, built at master start for slaves with a callback. */
+typedef struct {
+    ec_pdo_callback_t callback; /**< Slave PDO callback. */
+    ec_slave_t *slave;          /**< Slave passed to the callback. */
+    uint8_t *output;            /**< Slave output image. */
+    uint8_t *input;             /**< Slave input image. */
+} ec_pdo_dispatch_t;
+
+typedef struct ec_domain {
+    ec_master_t *master; /**< Master owning the domain. */
+    uint8_t index;       /**< Index of the domain, 0 is the default domain. */
+
+    uint32_t cycle_divisor;       /**< Domain is exchanged every cycle_divisor master cycles. */
+    uint32_t cycle_offset;        /**< Requested cycle offset, or EC_DOMAIN_CYCLE_OFFSET_AUTO. */
+    uint32_t actual_cycle_offset; /**< Cycle offset used for the current operation. */
+    uint32_t cycle_count;         /**< Master cycles left until the domain is exchanged again. */
+
+    uint32_t logical_start_address; /**< Logical start address of the domain image. */
+    uint32_t data_size;             /**< Size of the domain image. */
+    uint32_t lrw_data_size;         /**< Size of slaves with LRW support, slaves without LRW follow it. */
+    uint32_t slave_count;           /**< Number of slaves in the domain. */
+
+    uint32_t expected_working_counter;     /**< Expected working counter of the domain. */
+    uint32_t actual_working_counter;       /**< Working counter of the last exchange. */
+    uint32_t lrw_expected_working_counter; /**< Expected working counter for the LRW datagram. */
+    uint32_t lwr_expected_working_counter; /**< Expected working counter for the LWR datagram. */
+    uint32_t lrd_expected_working_counter; /**< Expected working counter for the LRD datagram. */
+    uint32_t lrw_actual_working_counter;   /**< Working counter of the last LRW datagram, 0 if it has no data. */
+    uint32_t lwr_actual_working_counter;   /**< Working counter of the last LWR datagram, 0 if it has no data. */
+    uint32_t lrd_actual_working_counter;   /**< Working counter of the last LRD datagram, 0 if it has no data. */
+
+    uint64_t input_dc_time; /**< DC system time when the frame with the inputs passed the reference clock, 0 if unknown [ns]. */
+
+    bool scheduled; /**< Datagrams are queued and not processed yet. */
+    bool wc_check;  /**< Working counter must be checked in the next cycle. */
+    bool wc_valid;  /**< Working counter has reached the expected value once. */
+
+    ec_datagram_t lrw_datagram; /**< PDO datagram for slaves with LRW support. */
+    ec_datagram_t lwr_datagram; /**< PDO output datagram for slaves without LRW support. */
+    ec_datagram_t lrd_datagram; /**< PDO input datagram for slaves without LRW support. */
+
+    const ec_pdo_entry_reg_t *regs; /**< Registered PDO entries, resolved at master start. */
+
+    ec_domain_callback_t callback; /**< Domain callback, replaces the slave PDO callbacks if set. */
+    void *callback_arg;            /**< Argument of the domain callback. */
+    ec_pdo_dispatch_t *dispatch;   /**< Slave PDO callbacks of the domain. */
+    uint32_t dispatch_count;       /**< Number of slave PDO callbacks. */
+} ec_domain_t;
+
+void ec_domain_init(ec_domain_t *domain, ec_master_t *master, uint8_t index, uint32_t cycle_divisor, uint32_t cycle_offset);
+void ec_domain_clear(ec_domain_t *domain);
+void ec_domain_layout(ec_domain_t *domain);
+void ec_domain_queue(ec_domain_t *domain);
+bool ec_domain_done(ec_domain_t *domain);
+void ec_domain_build_dispatch(ec_domain_t *domain, ec_pdo_dispatch_t *dispatch);
+void ec_domain_process(ec_domain_t *domain);
+bool ec_domain_wc_check(ec_domain_t *domain);
+int ec_domain_resolve_pdo_entries(ec_domain_t *domain);
+
+ec_domain_t *ec_master_create_domain(ec_master_t *master, uint32_t cycle_divisor, uint32_t cycle_offset);
+uint8_t *ec_domain_data(ec_domain_t *domain);
+uint32_t ec_domain_size(ec_domain_t *domain);
+int ec_domain_reg_pdo_entry_list(ec_domain_t *domain, const ec_pdo_entry_reg_t *regs);
+int ec_domain_set_callback(ec_domain_t *domain, ec_domain_callback_t callback, void *arg);
+
+/** DC time of the current input image, valid inside the PDO and domain callbacks. */
+static inline uint64_t ec_domain_get_input_dc_time(const ec_domain_t *domain)
+{
+    return domain->input_dc_time;
+}
+
+/* Accessors for registered PDO entries, data is the domain image from ec_domain_data(). */
+static inline uint8_t ec_domain_read_u8(const uint8_t *data, uint32_t offset)
+{
+    return EC_READ_U8(data + offset);
+}
+
+static inline uint16_t ec_domain_read_u16(const uint8_t *data, uint32_t offset)
+{
+    return EC_READ_U16(data + offset);
+}
+
+static inline uint32_t ec_domain_read_u32(const uint8_t *data, uint32_t offset)
+{
+    return EC_READ_U32(data + offset);
+}
+
+static inline uint64_t ec_domain_read_u64(const uint8_t *data, uint32_t offset)
+{
+    return EC_READ_U64(data + offset);
+}
+
+static inline int8_t ec_domain_read_s8(const uint8_t *data, uint32_t offset)
+{
+    return (int8_t)EC_READ_U8(data + offset);
+}
+
+static inline int16_t ec_domain_read_s16(const uint8_t *data, uint32_t offset)
+{
+    return (int16_t)EC_READ_U16(data + offset);
+}
+
+static inline int32_t ec_domain_read_s32(const uint8_t *data, uint32_t offset)
+{
+    return (int32_t)EC_READ_U32(data + offset);
+}
+
+static inline bool ec_domain_read_bit(const uint8_t *data, uint32_t offset, uint8_t bit_position)
+{
+    return (EC_READ_U8(data + offset) >> bit_position) & 0x01;
+}
+
+static inline void ec_domain_write_u8(uint8_t *data, uint32_t offset, uint8_t value)
+{
+    EC_WRITE_U8(data + offset, value);
+}
+
+static inline void ec_domain_write_u16(uint8_t *data, uint32_t offset, uint16_t value)
+{
+    EC_WRITE_U16(data + offset, value);
+}
+
+static inline void ec_domain_write_u32(uint8_t *data, uint32_t offset, uint32_t value)
+{
+    EC_WRITE_U32(data + offset, value);
+}
+
+static inline void ec_domain_write_u64(uint8_t *data, uint32_t offset, uint64_t value)
+{
+    EC_WRITE_U64(data + offset, value);
+}
+
+static inline void ec_domain_write_s8(uint8_t *data, uint32_t offset, int8_t value)
+{
+    EC_WRITE_U8(data + offset, (uint8_t)value);
+}
+
+static inline void ec_domain_write_s16(uint8_t *data, uint32_t offset, int16_t value)
+{
+    EC_WRITE_U16(data + offset, (uint16_t)value);
+}
+
+static inline void ec_domain_write_s32(uint8_t *data, uint32_t offset, int32_t value)
+{
+    EC_WRITE_U32(data + offset, (uint32_t)value);
+}
+
+static inline void ec_domain_write_bit(uint8_t *data, uint32_t offset, uint8_t bit_position, bool value)
+{
+    uint8_t byte = EC_READ_U8(data + offset);
+
+    if (value) {
+        byte |= (uint8_t)(1 << bit_position);
+    } else {
+        byte &= (uint8_t)~(1 << bit_position);
+    }
+    EC_WRITE_U8(data + offset, byte);
+}
+
+#endif
@@ -21,11 +21,18 @@
 #include "ec_osal.h"
 #include "ec_port.h"
 #include "ec_timestamp.h"
+#include "ec_dc_ctrl.h"
+#include "ec_dc_clock.h"
 #include "ec_version.h"
 #include "ec_datagram.h"
+#include "ec_dc_monitor.h"
+#include "ec_perf.h"
+#include "ec_trace.h"
+#include "ec_capture.h"
 #include "ec_common.h"
 #include "ec_sii.h"
 #include "ec_slave.h"
+#include "ec_domain.h"
 #include "ec_mailbox.h"
 #include "ec_coe.h"
 #include "ec_foe.h"
@@ -36,6 +43,8 @@ typedef struct {
     unsigned int timeouts;
     unsigned int corrupted;
     unsigned int unmatched;
+    unsigned int wc_errors; /**< Cycles with PDO working counter mismatch. */
+    unsigned int wc_diags;  /**< WC fault diagnoses that were run. */
 } ec_master_stats_t;
 
 typedef enum {
@@ -58,7 +67,10 @@ typedef struct ec_master {
     ec_master_phase_t phase;
 
     ec_datagram_t main_datagram; /**< Main datagram for slave scan & state change & config & sii */
-    ec_datagram_t pdo_datagram;  /**< pdo datagram */
+
+    ec_domain_t domains[CONFIG_EC_MAX_DOMAINS]; /**< PDO domains, domain 0 is the default domain. */
+    uint8_t domain_count;                       /**< Number of created domains. */
+    ec_pdo_dispatch_t *pdo_dispatch;            /**< Slave PDO callbacks of all domains. */
 
     ec_dlist_t datagram_queue; /**< Queue of pending datagrams*/
     uint8_t datagram_index;
@@ -70,7 +82,12 @@ typedef struct ec_master {
     bool dc_sync_with_dc_ref_enable; /**< true: Sync the reference clock by dc ref clock, false: by master */
     uint32_t cycle_time;             /**< Cycle time [ns]. */
     int32_t shift_time;              /**< Shift time [ns]. */
-    int64_t dc_sync_integral;        /**< DC integral value. */
+    ec_dc_ctrl_config_t dc_ctrl_config; /**< DC controller configuration, applied at master start. */
+    ec_dc_ctrl_t dc_ctrl;               /**< DC controller syncing the master period to the dc ref clock. */
+    ec_dc_clock_t dc_clock;             /**< Model of DC time against the local timestamp. */
+#ifdef CONFIG_EC_DC_MONITOR
+    ec_dc_monitor_t dc_monitor; /**< Cyclic SYS_TIME_DIFF monitor. */
+#endif
 
     uint64_t interval;
 
@@ -93,6 +110,15 @@ typedef struct ec_master {
     uint64_t recv_exec_count;
     int32_t min_offset_ns;
     int32_t max_offset_ns;
+#ifdef CONFIG_EC_PERF_HIST
+    ec_perf_hist_t perf_hist[EC_PERF_HIST_NUM]; /**< Latency histograms, updated while perf is enabled. */
+#endif
+#ifdef CONFIG_EC_TRACE
+    ec_trace_t trace; /**< Timeline of the last master cycles. */
+#endif
+#ifdef CONFIG_EC_CAPTURE
+    ec_capture_t capture; /**< Ring of the last sent and received frames. */
+#endif
 
     ec_osal_mutex_t scan_lock;
     ec_osal_thread_t scan_thread;
@@ -103,21 +129,35 @@ typedef struct ec_master {
 
     uint8_t pdo_buffer[CONFIG_EC_MAX_NETDEVS][CONFIG_EC_MAX_PDO_BUFSIZE];
     uint32_t actual_pdo_size;          /**< Actual PDO size for current setting. */
-    uint32_t expected_working_counter; /**< Expected working counter for PDO datagrams. */
-    uint32_t actual_working_counter;   /**< Actual working counter for PDO datagrams. */
+    uint32_t expected_working_counter; /**< Expected working counter of all domains. */
+    uint32_t actual_working_counter;   /**< Last working counter of all domains. */
+    ec_datagram_t wc_diag_datagram;    /**< BRD/FPRD of AL status for WC fault diagnosis, at most one in flight. */
+    uint8_t wc_diag_data[6];           /**< AL status (0x0130) up to AL status code (0x0134). */
+    uint32_t wc_diag_index;            /**< Slave read by the datagram in flight, slave_count for the BRD. */
+    bool wc_diag_pending;              /**< WC fault diagnosis is running. */
+    uint64_t wc_diag_time;             /**< Time of the last WC fault diagnosis [ns]. */
 } ec_master_t;
 
 int ec_master_init(ec_master_t *master, uint8_t master_index);
 void ec_master_deinit(ec_master_t *master);
 int ec_master_start(ec_master_t *master);
 int ec_master_stop(ec_master_t *master);
+void ec_master_queue_datagram(ec_master_t *master, ec_datagram_t *datagram);
 int ec_master_queue_ext_datagram(ec_master_t *master, ec_datagram_t *datagram, bool wakep_poll, bool waiter);
 uint8_t *ec_master_get_slave_domain(ec_master_t *master, uint32_t slave_index);
 uint8_t *ec_master_get_slave_domain_output(ec_master_t *master, uint32_t slave_index);
 uint8_t *ec_master_get_slave_domain_input(ec_master_t *master, uint32_t slave_index);
+uint64_t ec_master_get_slave_input_dc_time(ec_master_t *master, uint32_t slave_index);
+int ec_master_get_slave_input_snapshot(ec_master_t *master, uint32_t slave_index, uint8_t *buf, uint32_t size, uint64_t *dc_time);
 uint32_t ec_master_get_slave_domain_size(ec_master_t *master, uint32_t slave_index);
 uint32_t ec_master_get_slave_domain_osize(ec_master_t *master, uint32_t slave_index);
 uint32_t ec_master_get_slave_domain_isize(ec_master_t *master, uint32_t slave_index);
+uint32_t ec_master_get_wc_error_count(ec_master_t *master);
+uint32_t ec_master_get_slave_wc_fault_count(ec_master_t *master, uint32_t slave_index);
+void ec_master_clear_wc_error_count(ec_master_t *master);
+uint64_t ec_master_dc_sync_time(ec_master_t *master);
+uint64_t ec_master_get_dc_time_ns(ec_master_t *master);
+uint64_t ec_master_dc_time_from_local(ec_master_t *master, uint64_t local_ns);
 
 int ec_master_find_slave_sync_info(uint32_t vendor_id,
                                    uint32_t product_code,
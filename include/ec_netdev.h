@@ -43,7 +43,7 @@ typedef struct ec_netdev {
     ec_netdev_stats_t stats;
 } ec_netdev_t;
 
-void ec_netdev_update_stats(ec_netdev_t *netdev);
+void ec_netdev_update_stats(ec_netdev_t *netdev, uint64_t now);
 
 ec_netdev_t *ec_netdev_init(uint8_t netdev_index);
 void ec_netdev_poll_link_state(ec_netdev_t *netdev);
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_PERF_H
+#define EC_PERF_H
+
+#ifdef CONFIG_EC_PERF_HIST
+
+typedef struct ec_master ec_master_t;
+
+/*
+ * Log-linear histogram: values below 2^EC_PERF_HIST_SUB_BITS get one bucket each, every power of
+ * two above is split into 2^EC_PERF_HIST_SUB_BITS linear buckets (12.5% resolution), values of
+ * 2^EC_PERF_HIST_MAX_BITS ns and more share the last bucket.
+ */
+#define EC_PERF_HIST_SUB_BITS 3
+#define EC_PERF_HIST_MAX_BITS 24
+#define EC_PERF_HIST_BUCKETS  (((EC_PERF_HIST_MAX_BITS - EC_PERF_HIST_SUB_BITS + 1) << EC_PERF_HIST_SUB_BITS) + 1)
+
+typedef enum {
+    EC_PERF_HIST_PERIOD = 0, /**< Period of the master cycle. */
+    EC_PERF_HIST_SEND_EXEC,  /**< Execution time of ec_master_period_process(). */
+    EC_PERF_HIST_RECV_EXEC,  /**< Execution time of ec_master_receive(). */
+    EC_PERF_HIST_RTT,        /**< Round trip time of the LRW/LRD datagram of the domains. */
+    EC_PERF_HIST_DC_OFFSET,  /**< |Offset| of the master period to the dc ref clock. */
+    EC_PERF_HIST_NUM
+} ec_perf_hist_type_t;
+
+typedef struct {
+    uint32_t count;                         /**< Number of samples. */
+    uint32_t min;                           /**< Minimum sample [ns]. */
+    uint32_t max;                           /**< Maximum sample [ns]. */
+    uint64_t total;                         /**< Sum of all samples [ns]. */
+    uint32_t buckets[EC_PERF_HIST_BUCKETS]; /**< Sample count per bucket. */
+} ec_perf_hist_t;
+
+static inline uint32_t ec_perf_hist_msb(uint32_t value)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(value);
+#else
+    uint32_t msb = 0;
+
+    if (value >= (1UL << 16)) {
+        value >>= 16;
+        msb += 16;
+    }
+    if (value >= (1UL << 8)) {
+        value >>= 8;
+        msb += 8;
+    }
+    if (value >= (1UL << 4)) {
+        value >>= 4;
+        msb += 4;
+    }
+    if (value >= (1UL << 2)) {
+        value >>= 2;
+        msb += 2;
+    }
+    if (value >= (1UL << 1)) {
+        msb += 1;
+    }
+    return msb;
+#endif
+}
+
+static inline uint32_t ec_perf_hist_index(uint32_t value)
+{
+    uint32_t msb;
+
+    if (value < (1UL << EC_PERF_HIST_SUB_BITS)) {
+        return value;
+    }
+
+    msb = ec_perf_hist_msb(value);
+    if (msb >= EC_PERF_HIST_MAX_BITS) {
+        return EC_PERF_HIST_BUCKETS - 1;
+    }
+
+    return ((msb - EC_PERF_HIST_SUB_BITS + 1) << EC_PERF_HIST_SUB_BITS) |
+           ((value >> (msb - EC_PERF_HIST_SUB_BITS)) & ((1UL << EC_PERF_HIST_SUB_BITS) - 1));
+}
+
+/* O(1), no division, called from the cyclic path. */
+static inline void ec_perf_hist_record(ec_perf_hist_t *hist, uint32_t value)
+{
+    hist->buckets[ec_perf_hist_index(value)]++;
+    hist->count++;
+    hist->total += value;
+    hist->min = (value < hist->min) ? value : hist->min;
+    hist->max = (value > hist->max) ? value : hist->max;
+}
+
+void ec_perf_hist_clear(ec_perf_hist_t *hist);
+uint32_t ec_perf_hist_bucket_low(uint32_t index);
+uint32_t ec_perf_hist_percentile(const ec_perf_hist_t *hist, uint32_t permille);
+
+int ec_master_get_perf_hist(ec_master_t *master, ec_perf_hist_type_t type, ec_perf_hist_t *hist);
+void ec_master_clear_perf_hist(ec_master_t *master);
+
+#endif
+#endif
@@ -25,6 +25,8 @@ uint16_t ec_mdio_low_level_read(struct chry_phy_device *phydev, uint16_t phy_add
 void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg);
 void ec_htimer_stop(void);
 void ec_htimer_update(uint32_t us);
+/* Set the next period in ns, the sub tick remainder is carried over to the following periods. */
+void ec_htimer_update_ns(uint32_t ns);
 
 uint32_t ec_get_cpu_frequency(void);
 
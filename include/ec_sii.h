@@ -32,6 +32,10 @@ typedef struct ec_sii {
     // Strings
     char **strings;        /**< Strings in SII categories. */
     uint32_t string_count; /**< Number of SII strings. */
+
+    // TxPDO and RxPDO
+    ec_sync_info_t *sync; /**< Default PDO layout, sync managers, PDOs and entries in one allocation. */
+    uint8_t sync_count;   /**< Number of sync managers with PDOs. */
 } ec_sii_t;
 
 int ec_sii_read(ec_master_t *master, uint16_t slave_index, ec_datagram_t *datagram, uint16_t woffset, uint32_t *buf, uint32_t len);
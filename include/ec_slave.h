@@ -8,6 +8,7 @@
 
 typedef struct ec_master ec_master_t;
 typedef struct ec_slave ec_slave_t;
+typedef struct ec_domain ec_domain_t;
 
 typedef void (*ec_pdo_callback_t)(ec_slave_t *slave, uint8_t *output, uint8_t *input);
 
@@ -29,12 +30,51 @@ typedef struct {
     bool fmmu_enable;
 } ec_sm_info_t;
 
+/** Mailbox init command of a configuration image. */
+typedef struct {
+    uint8_t state;        /**< Sent before the slave is requested to this state, EC_SLAVE_STATE_SAFEOP or EC_SLAVE_STATE_OP. */
+    bool complete_access; /**< Download with CoE complete access. */
+    uint16_t index;       /**< Object index. */
+    uint8_t subindex;     /**< Object subindex. */
+    uint16_t size;        /**< Size of the data. */
+    const uint8_t *data;  /**< Object data. */
+} ec_slave_image_cmd_t;
+
+/** PDO entry of a configuration image, for ec_domain_reg_pdo_entry_list(). */
+typedef struct {
+    uint16_t index;      /**< PDO entry index. */
+    uint8_t subindex;    /**< PDO entry subindex. */
+    uint16_t bit_offset; /**< Bit offset in the process data of the slave, outputs first. */
+} ec_slave_image_entry_t;
+
+/** Precomputed slave configuration, generated from an ENI file by scripts/eni_parser.py.
+ *
+ * The master writes the register pages as they are, only the logical addresses in
+ * fmmu_pages are relative to the slave and get the logical start address of the slave added.
+ */
+typedef struct {
+    uint16_t odata_size;                   /**< Output bytes, first in the slave image. */
+    uint16_t idata_size;                   /**< Input bytes, behind the outputs. */
+    uint8_t expected_working_counter;      /**< Working counter of the slave in an LRW datagram. */
+    uint8_t sm_start;                      /**< First process data sync manager. */
+    uint8_t sm_count;                      /**< Number of sync manager pages. */
+    uint8_t fmmu_count;                    /**< Number of FMMU pages. */
+    const uint8_t *sm_pages;               /**< EC_SYNC_PAGE_SIZE bytes per sync manager from sm_start on. */
+    const uint8_t *fmmu_pages;             /**< EC_FMMU_PAGE_SIZE bytes per FMMU from FMMU 0 on. */
+    const ec_slave_image_cmd_t *cmds;      /**< Mailbox init commands. */
+    uint16_t cmd_count;                    /**< Number of mailbox init commands. */
+    const ec_slave_image_entry_t *entries; /**< Mapped PDO entries, resolve registered PDO entries. */
+    uint16_t entry_count;                  /**< Number of mapped PDO entries. */
+} ec_slave_image_t;
+
 typedef struct {
     ec_sync_info_t *sync;                           /**< Sync manager configuration. */
     uint8_t sync_count;                             /**< Number of sync managers. */
     ec_pdo_callback_t pdo_callback;                 /**< PDO process data callback. */
     uint16_t dc_assign_activate;                    /**< dc assign control */
     ec_sync_signal_t dc_sync[EC_SYNC_SIGNAL_COUNT]; /**< DC sync signals. */
+    ec_domain_t *domain;                            /**< PDO domain, NULL for the default domain. */
+    const ec_slave_image_t *image;                  /**< Precomputed configuration, NULL to compute it from sync at master start. */
 } ec_slave_config_t;
 
 /** EtherCAT slave port information.
@@ -49,8 +89,10 @@ typedef struct {
     ec_slave_port_desc_t desc; /**< Port descriptors. */
     ec_slave_port_link_t link; /**< Port link status. */
     ec_slave_t *next_slave;    /**< Connected slaves. */
-    uint32_t receive_time;     /**< Port receive times for delay measurement. */
-    uint32_t delay_to_next_dc; /**< Delay to next slave with DC support behind this port [ns]. */
+    uint32_t receive_time;         /**< Averaged port receive time relative to port 0 for delay measurement [ns]. */
+    uint32_t receive_time_var;     /**< Variance of the receive time over the delay samples [ns^2]. */
+    uint8_t receive_time_samples;  /**< Delay samples left after outlier rejection. */
+    uint32_t delay_to_next_dc;     /**< Delay to next slave with DC support behind this port [ns]. */
 } ec_slave_port_t;
 
 typedef struct ec_slave {
@@ -89,7 +131,9 @@ typedef struct ec_slave {
     uint32_t odata_size;
     uint32_t idata_size;
     uint32_t expected_working_counter;
-    uint32_t actual_working_counter;
+    uint32_t wc_fault_count;        /**< Number of WC diagnoses that found this slave faulty. */
+    uint16_t wc_diag_alstatus;      /**< AL status read by the last WC diagnosis. */
+    uint16_t wc_diag_alstatus_code; /**< AL status code read by the last WC diagnosis. */
 
     uint16_t *sii_image; /**< Complete SII image. */
     size_t sii_nwords;   /**< Size of the SII contents in words. */
@@ -99,12 +143,17 @@ typedef struct ec_slave {
     ec_sm_info_t *sm_info;
     uint8_t sm_count; /**< Number of sync managers. */
 
-    ec_slave_config_t *config; /**< Slave custom configuration. */
+    ec_slave_config_t *config;         /**< Slave custom configuration. */
+    ec_slave_config_t default_config; /**< Configuration with the PDO layout of the SII, used without config. */
 
-    ec_datagram_t pdo_datagram; /**< PDO datagram for the slave. */
+    ec_domain_t *domain;            /**< PDO domain the slave is exchanged in. */
+#ifdef CONFIG_EC_DC_MONITOR
+    ec_dc_monitor_stats_t dc_stats; /**< System time difference statistics. */
+#endif
 } ec_slave_t;
 
 void ec_slaves_scanning(ec_master_t *master);
+int ec_slave_image_check(const ec_slave_t *slave);
 char *ec_slave_get_sii_string(const ec_slave_t *slave, uint32_t index);
 
 #endif
\ No newline at end of file
@@ -9,6 +9,10 @@
 void ec_timestamp_init(void);
 uint64_t ec_timestamp_get_time_ns(void);
 
+/* Cycle counter to ns conversion of the default ec_timestamp_get_time_ns(), set up by ec_timestamp_init(). */
+void ec_timestamp_calc_mult(uint32_t freq);
+uint64_t ec_timestamp_cycles_to_ns(uint64_t cycles);
+
 #define jiffies ec_timestamp_get_time_ns()
 
 #endif
\ No newline at end of file
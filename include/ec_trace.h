@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_TRACE_H
+#define EC_TRACE_H
+
+#ifdef CONFIG_EC_TRACE
+
+typedef struct ec_master ec_master_t;
+
+/* Points of the master cycle, recorded relative to the period start. */
+typedef enum {
+    EC_TRACE_PERIOD_START = 0, /**< Timer callback entered ec_master_period_process(). */
+    EC_TRACE_SEND_START,       /**< Frame build of the cyclic datagrams starts. */
+    EC_TRACE_NETDEV_SEND,      /**< ec_netdev_send() of the last frame called. */
+    EC_TRACE_NETDEV_SENT,      /**< ec_netdev_send() of the last frame returned. */
+    EC_TRACE_PERIOD_END,       /**< ec_master_period_process() done. */
+    EC_TRACE_RX_ENTRY,         /**< Frame with the domain data entered ec_master_receive(). */
+    EC_TRACE_RX_PARSED,        /**< Datagrams of the frame parsed. */
+    EC_TRACE_RX_END,           /**< Domain processing and PDO callbacks done. */
+    EC_TRACE_POINT_NUM
+} ec_trace_point_t;
+
+#define EC_TRACE_NONE 0xffffffff
+
+typedef struct {
+    uint64_t start;                       /**< Local time of the period start [ns]. */
+    uint32_t cycle;                       /**< Cycle number since the trace was started. */
+    uint32_t offset[EC_TRACE_POINT_NUM];  /**< Time of each point after start, EC_TRACE_NONE if not reached [ns]. */
+} ec_trace_record_t;
+
+typedef struct {
+    volatile bool enable;        /**< Records are written. */
+    bool in_period;              /**< ec_master_period_process() is running, tx points belong to the cycle. */
+    bool freeze_pending;         /**< Stop at the next period start, so the current cycle is complete. */
+    uint32_t freeze_ns;          /**< Stop if the period deviates more than this from the cycle time, 0 never [ns]. */
+    uint32_t cycle;              /**< Number of recorded cycles. */
+    uint32_t head;               /**< Record of the next cycle. */
+    ec_trace_record_t *current;  /**< Record of the current cycle. */
+    ec_trace_record_t records[CONFIG_EC_TRACE_CYCLES];
+} ec_trace_t;
+
+static inline void ec_trace_point_at(ec_trace_t *trace, ec_trace_point_t point, uint64_t time)
+{
+    if (trace->enable) {
+        trace->current->offset[point] = (uint32_t)(time - trace->current->start);
+    }
+}
+
+static inline void ec_trace_cycle_begin(ec_trace_t *trace, uint64_t start)
+{
+    ec_trace_record_t *record;
+
+    if (trace->freeze_pending) {
+        trace->freeze_pending = false;
+        trace->enable = false;
+    }
+
+    if (!trace->enable) {
+        return;
+    }
+
+    record = &trace->records[trace->head];
+    trace->head = (trace->head + 1 == CONFIG_EC_TRACE_CYCLES) ? 0 : (trace->head + 1);
+
+    record->start = start;
+    record->cycle = trace->cycle++;
+    memset(record->offset, 0xff, sizeof(record->offset));
+    record->offset[EC_TRACE_PERIOD_START] = 0;
+
+    // the record is complete before receive may see it
+    trace->current = record;
+    trace->in_period = true;
+}
+
+static inline void ec_trace_cycle_end(ec_trace_t *trace, uint64_t end, uint32_t period_ns, uint32_t cycle_time)
+{
+    uint32_t deviation;
+
+    if (!trace->enable) {
+        return;
+    }
+
+    ec_trace_point_at(trace, EC_TRACE_PERIOD_END, end);
+    trace->in_period = false;
+
+    // the first period is measured against the last cycle before the trace started
+    if (trace->freeze_ns && (trace->cycle > 1)) {
+        deviation = (period_ns > cycle_time) ? (period_ns - cycle_time) : (cycle_time - period_ns);
+        if (deviation > trace->freeze_ns) {
+            trace->freeze_pending = true;
+        }
+    }
+}
+
+/* Timestamps are only taken while the trace is enabled. */
+#define EC_TRACE_POINT(master, point)                                               \
+    do {                                                                            \
+        if ((master)->trace.enable) {                                               \
+            ec_trace_point_at(&(master)->trace, point, ec_timestamp_get_time_ns()); \
+        }                                                                           \
+    } while (0)
+
+#define EC_TRACE_POINT_AT(master, point, time) ec_trace_point_at(&(master)->trace, point, time)
+
+/* Frames sent by the nonperiod thread between two cycles are not part of the timeline. */
+#define EC_TRACE_PERIOD_POINT(master, point) \
+    do {                                     \
+        if ((master)->trace.in_period) {     \
+            EC_TRACE_POINT(master, point);   \
+        }                                    \
+    } while (0)
+
+#define EC_TRACE_PERIOD_POINT_AT(master, point, time) \
+    do {                                              \
+        if ((master)->trace.in_period) {              \
+            EC_TRACE_POINT_AT(master, point, time);   \
+        }                                             \
+    } while (0)
+
+void ec_master_trace_start(ec_master_t *master, uint32_t freeze_ns);
+void ec_master_trace_stop(ec_master_t *master);
+bool ec_master_trace_running(ec_master_t *master);
+void ec_master_trace_dump(ec_master_t *master);
+
+#else
+#define EC_TRACE_POINT(master, point)
+#define EC_TRACE_POINT_AT(master, point, time)
+#define EC_TRACE_PERIOD_POINT(master, point)
+#define EC_TRACE_PERIOD_POINT_AT(master, point, time)
+#endif
+#endif
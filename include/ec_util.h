@@ -118,38 +118,125 @@
 
 #define EC_ALIGN_UP(size, align) (((size) + (align)-1) & ~((align)-1))
 
+/*
+ * EtherCAT data is little endian and datagrams sit at any offset of a frame. With gcc and clang
+ * the accessors copy through __builtin_memcpy(): a single load or store on cores with unaligned
+ * access, byte accesses where -mstrict-align or the like says otherwise, plus a byte swap on big
+ * endian hosts. Other compilers assemble the bytes.
+ *
+ * Frames, mailbox and CoE headers and the SII words are built and parsed with them. The SII
+ * general category is still copied into ec_sii_general_t as it is, its 16 bit fields and
+ * bitfields assume a little endian host.
+ */
+#if defined(__GNUC__) && !defined(__CC_ARM) && defined(__BYTE_ORDER__)
+#define EC_ACCESS_MEMCPY
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define EC_LE16(x) __builtin_bswap16(x)
+#define EC_LE32(x) __builtin_bswap32(x)
+#define EC_LE64(x) __builtin_bswap64(x)
+#else
+#define EC_LE16(x) (x)
+#define EC_LE32(x) (x)
+#define EC_LE64(x) (x)
+#endif
+#endif
+
+static inline uint16_t ec_read_u16(const void *data)
+{
+#ifdef EC_ACCESS_MEMCPY
+    uint16_t val;
+
+    __builtin_memcpy(&val, data, sizeof(val));
+    return EC_LE16(val);
+#else
+    const uint8_t *p = (const uint8_t *)data;
+
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+#endif
+}
+
+static inline uint32_t ec_read_u32(const void *data)
+{
+#ifdef EC_ACCESS_MEMCPY
+    uint32_t val;
+
+    __builtin_memcpy(&val, data, sizeof(val));
+    return EC_LE32(val);
+#else
+    const uint8_t *p = (const uint8_t *)data;
+
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#endif
+}
+
+static inline uint64_t ec_read_u64(const void *data)
+{
+#ifdef EC_ACCESS_MEMCPY
+    uint64_t val;
+
+    __builtin_memcpy(&val, data, sizeof(val));
+    return EC_LE64(val);
+#else
+    return (uint64_t)ec_read_u32(data) | ((uint64_t)ec_read_u32((const uint8_t *)data + 4) << 32);
+#endif
+}
+
+static inline void ec_write_u16(void *data, uint16_t val)
+{
+#ifdef EC_ACCESS_MEMCPY
+    val = EC_LE16(val);
+    __builtin_memcpy(data, &val, sizeof(val));
+#else
+    uint8_t *p = (uint8_t *)data;
+
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+#endif
+}
+
+static inline void ec_write_u32(void *data, uint32_t val)
+{
+#ifdef EC_ACCESS_MEMCPY
+    val = EC_LE32(val);
+    __builtin_memcpy(data, &val, sizeof(val));
+#else
+    uint8_t *p = (uint8_t *)data;
+
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+    p[2] = (uint8_t)(val >> 16);
+    p[3] = (uint8_t)(val >> 24);
+#endif
+}
+
+static inline void ec_write_u64(void *data, uint64_t val)
+{
+#ifdef EC_ACCESS_MEMCPY
+    val = EC_LE64(val);
+    __builtin_memcpy(data, &val, sizeof(val));
+#else
+    ec_write_u32(data, (uint32_t)val);
+    ec_write_u32((uint8_t *)data + 4, (uint32_t)(val >> 32));
+#endif
+}
+
 #define EC_WRITE_U8(DATA, VAL)                   \
     do {                                         \
         *((uint8_t *)(DATA)) = ((uint8_t)(VAL)); \
     } while (0)
 
-#define EC_WRITE_U16(DATA, VAL)                    \
-    do {                                           \
-        *((uint16_t *)(DATA)) = ((uint16_t)(VAL)); \
-    } while (0)
-
-#define EC_WRITE_U32(DATA, VAL)                    \
-    do {                                           \
-        *((uint32_t *)(DATA)) = ((uint32_t)(VAL)); \
-    } while (0)
-
-#define EC_WRITE_U64(DATA, VAL)                    \
-    do {                                           \
-        *((uint64_t *)(DATA)) = ((uint64_t)(VAL)); \
-    } while (0)
+#define EC_WRITE_U16(DATA, VAL) ec_write_u16((DATA), (uint16_t)(VAL))
+#define EC_WRITE_U32(DATA, VAL) ec_write_u32((DATA), (uint32_t)(VAL))
+#define EC_WRITE_U64(DATA, VAL) ec_write_u64((DATA), (uint64_t)(VAL))
 
 #define EC_READ_U8(DATA) \
-    ((uint8_t) * ((uint8_t *)(DATA)))
-
-#define EC_READ_U16(DATA) \
-    ((uint16_t) * ((uint16_t *)(DATA)))
-
-#define EC_READ_U32(DATA) \
-    ((uint32_t) * ((uint32_t *)(DATA)))
+    ((uint8_t) * ((const uint8_t *)(DATA)))
 
-#define EC_READ_U64(DATA) \
-    ((uint64_t) * ((uint64_t *)(DATA)))
+#define EC_READ_U16(DATA) ec_read_u16(DATA)
+#define EC_READ_U32(DATA) ec_read_u32(DATA)
+#define EC_READ_U64(DATA) ec_read_u64(DATA)
 
+/* byte swap, EC_WRITE_U16(p, ec_htons(x)) stores x big endian like the EtherType */
 #define ec_htons(A) ((((uint16_t)(A)&0xff00) >> 8) | \
                      (((uint16_t)(A)&0x00ff) << 8))
 #define ec_htonl(A) ((((uint32_t)(A)&0xff000000) >> 24) | \
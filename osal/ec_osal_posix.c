@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+#include "ec_master.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+
+/*
+ * There are no interrupts on a host, the htimer and the receive path of the port run in
+ * threads. The critical section is one recursive lock which those threads hold while they
+ * call into the stack, so it excludes them like disabling interrupts does on a MCU.
+ */
+static pthread_mutex_t g_ec_osal_critical_lock;
+static pthread_once_t g_ec_osal_critical_once = PTHREAD_ONCE_INIT;
+
+typedef struct {
+    pthread_t thread;
+    ec_thread_entry_t entry;
+    void *args;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool suspended;
+} ec_osal_posix_thread_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max_count;
+} ec_osal_posix_sem_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t max_msgs;
+    uint32_t head;
+    uint32_t count;
+    uintptr_t msgs[];
+} ec_osal_posix_mq_t;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool running;
+    bool exit;
+} ec_osal_posix_timer_t;
+
+static void ec_osal_posix_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void ec_osal_posix_abstime(struct timespec *ts, uint32_t timeout_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/* Waits on cond with the lock held, returns -EC_ERR_TIMEOUT when the absolute time passed. */
+static int ec_osal_posix_wait(pthread_cond_t *cond, pthread_mutex_t *lock, uint32_t timeout, const struct timespec *ts)
+{
+    if (timeout == EC_OSAL_WAITING_FOREVER) {
+        pthread_cond_wait(cond, lock);
+        return 0;
+    }
+
+    return (pthread_cond_timedwait(cond, lock, ts) == ETIMEDOUT) ? -EC_ERR_TIMEOUT : 0;
+}
+
+static void *ec_osal_posix_thread_entry(void *argument)
+{
+    ec_osal_posix_thread_t *htask = (ec_osal_posix_thread_t *)argument;
+
+    htask->entry(htask->args);
+    return NULL;
+}
+
+ec_osal_thread_t ec_osal_thread_create(const char *name, uint32_t stack_size, uint32_t prio, ec_thread_entry_t entry, void *args)
+{
+    ec_osal_posix_thread_t *htask;
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    (void)stack_size; // host stacks are large enough for every stack thread
+
+    htask = calloc(1, sizeof(ec_osal_posix_thread_t));
+    if (htask == NULL) {
+        EC_LOG_ERR("Create thread %s failed\r\n", name);
+        while (1) {
+        }
+    }
+
+    htask->entry = entry;
+    htask->args = args;
+    pthread_mutex_init(&htask->lock, NULL);
+    ec_osal_posix_cond_init(&htask->cond);
+
+    // smaller prio value means higher priority, SCHED_FIFO needs CAP_SYS_NICE
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = MAX(sched_get_priority_max(SCHED_FIFO) - 10 - (int)prio, sched_get_priority_min(SCHED_FIFO));
+    pthread_attr_setschedparam(&attr, &param);
+
+    ret = pthread_create(&htask->thread, &attr, ec_osal_posix_thread_entry, htask);
+    if (ret == EPERM) {
+        EC_LOG_WRN("No permission for SCHED_FIFO, thread %s uses the default policy\r\n", name);
+        ret = pthread_create(&htask->thread, NULL, ec_osal_posix_thread_entry, htask);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        EC_LOG_ERR("Create thread %s failed\r\n", name);
+        while (1) {
+        }
+    }
+
+    pthread_setname_np(htask->thread, name);
+    return (ec_osal_thread_t)htask;
+}
+
+void ec_osal_thread_delete(ec_osal_thread_t thread)
+{
+    ec_osal_posix_thread_t *htask = (ec_osal_posix_thread_t *)thread;
+
+    if (htask == NULL) {
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel(htask->thread);
+    pthread_join(htask->thread, NULL);
+    free(htask);
+}
+
+/* pthreads can not stop another thread, a thread can only suspend itself like the master does. */
+void ec_osal_thread_suspend(ec_osal_thread_t thread)
+{
+    ec_osal_posix_thread_t *htask = (ec_osal_posix_thread_t *)thread;
+
+    EC_ASSERT_MSG(pthread_equal(htask->thread, pthread_self()), "Only the calling thread can be suspended\r\n");
+
+    pthread_mutex_lock(&htask->lock);
+    htask->suspended = true;
+    while (htask->suspended) {
+        pthread_cond_wait(&htask->cond, &htask->lock);
+    }
+    pthread_mutex_unlock(&htask->lock);
+}
+
+void ec_osal_thread_resume(ec_osal_thread_t thread)
+{
+    ec_osal_posix_thread_t *htask = (ec_osal_posix_thread_t *)thread;
+
+    pthread_mutex_lock(&htask->lock);
+    htask->suspended = false;
+    pthread_cond_signal(&htask->cond);
+    pthread_mutex_unlock(&htask->lock);
+}
+
+ec_osal_sem_t ec_osal_sem_create(uint32_t max_count, uint32_t initial_count)
+{
+    ec_osal_posix_sem_t *sem = calloc(1, sizeof(ec_osal_posix_sem_t));
+
+    if (sem == NULL) {
+        EC_LOG_ERR("Create semaphore failed\r\n");
+        while (1) {
+        }
+    }
+
+    pthread_mutex_init(&sem->lock, NULL);
+    ec_osal_posix_cond_init(&sem->cond);
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return (ec_osal_sem_t)sem;
+}
+
+void ec_osal_sem_delete(ec_osal_sem_t sem)
+{
+    ec_osal_posix_sem_t *psem = (ec_osal_posix_sem_t *)sem;
+
+    pthread_cond_destroy(&psem->cond);
+    pthread_mutex_destroy(&psem->lock);
+    free(psem);
+}
+
+int ec_osal_sem_take(ec_osal_sem_t sem, uint32_t timeout)
+{
+    ec_osal_posix_sem_t *psem = (ec_osal_posix_sem_t *)sem;
+    struct timespec ts;
+    int ret = 0;
+
+    ec_osal_posix_abstime(&ts, (timeout == EC_OSAL_WAITING_FOREVER) ? 0 : timeout);
+
+    pthread_mutex_lock(&psem->lock);
+    while (psem->count == 0) {
+        ret = ec_osal_posix_wait(&psem->cond, &psem->lock, timeout, &ts);
+        if (ret < 0) {
+            break;
+        }
+    }
+    if (psem->count) {
+        psem->count--;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&psem->lock);
+
+    return ret;
+}
+
+int ec_osal_sem_give(ec_osal_sem_t sem)
+{
+    ec_osal_posix_sem_t *psem = (ec_osal_posix_sem_t *)sem;
+    int ret = 0;
+
+    pthread_mutex_lock(&psem->lock);
+    if (psem->count < psem->max_count) {
+        psem->count++;
+        pthread_cond_signal(&psem->cond);
+    } else {
+        ret = -EC_ERR_TIMEOUT;
+    }
+    pthread_mutex_unlock(&psem->lock);
+
+    return ret;
+}
+
+void ec_osal_sem_reset(ec_osal_sem_t sem)
+{
+    ec_osal_posix_sem_t *psem = (ec_osal_posix_sem_t *)sem;
+
+    pthread_mutex_lock(&psem->lock);
+    psem->count = 0;
+    pthread_mutex_unlock(&psem->lock);
+}
+
+ec_osal_mutex_t ec_osal_mutex_create(void)
+{
+    pthread_mutex_t *mutex = calloc(1, sizeof(pthread_mutex_t));
+    pthread_mutexattr_t attr;
+
+    if (mutex == NULL) {
+        EC_LOG_ERR("Create mutex failed\r\n");
+        while (1) {
+        }
+    }
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return (ec_osal_mutex_t)mutex;
+}
+
+void ec_osal_mutex_delete(ec_osal_mutex_t mutex)
+{
+    pthread_mutex_destroy((pthread_mutex_t *)mutex);
+    free(mutex);
+}
+
+int ec_osal_mutex_take(ec_osal_mutex_t mutex)
+{
+    return (pthread_mutex_lock((pthread_mutex_t *)mutex) == 0) ? 0 : -EC_ERR_TIMEOUT;
+}
+
+int ec_osal_mutex_give(ec_osal_mutex_t mutex)
+{
+    return (pthread_mutex_unlock((pthread_mutex_t *)mutex) == 0) ? 0 : -EC_ERR_TIMEOUT;
+}
+
+ec_osal_mq_t ec_osal_mq_create(uint32_t max_msgs)
+{
+    ec_osal_posix_mq_t *mq = calloc(1, sizeof(ec_osal_posix_mq_t) + max_msgs * sizeof(uintptr_t));
+
+    if (mq == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&mq->lock, NULL);
+    ec_osal_posix_cond_init(&mq->cond);
+    mq->max_msgs = max_msgs;
+    return (ec_osal_mq_t)mq;
+}
+
+void ec_osal_mq_delete(ec_osal_mq_t mq)
+{
+    ec_osal_posix_mq_t *pmq = (ec_osal_posix_mq_t *)mq;
+
+    pthread_cond_destroy(&pmq->cond);
+    pthread_mutex_destroy(&pmq->lock);
+    free(pmq);
+}
+
+int ec_osal_mq_send(ec_osal_mq_t mq, uintptr_t addr)
+{
+    ec_osal_posix_mq_t *pmq = (ec_osal_posix_mq_t *)mq;
+    int ret = 0;
+
+    pthread_mutex_lock(&pmq->lock);
+    if (pmq->count < pmq->max_msgs) {
+        pmq->msgs[(pmq->head + pmq->count) % pmq->max_msgs] = addr;
+        pmq->count++;
+        pthread_cond_signal(&pmq->cond);
+    } else {
+        ret = -EC_ERR_TIMEOUT;
+    }
+    pthread_mutex_unlock(&pmq->lock);
+
+    return ret;
+}
+
+int ec_osal_mq_recv(ec_osal_mq_t mq, uintptr_t *addr, uint32_t timeout)
+{
+    ec_osal_posix_mq_t *pmq = (ec_osal_posix_mq_t *)mq;
+    struct timespec ts;
+    int ret = 0;
+
+    ec_osal_posix_abstime(&ts, (timeout == EC_OSAL_WAITING_FOREVER) ? 0 : timeout);
+
+    pthread_mutex_lock(&pmq->lock);
+    while (pmq->count == 0) {
+        ret = ec_osal_posix_wait(&pmq->cond, &pmq->lock, timeout, &ts);
+        if (ret < 0) {
+            break;
+        }
+    }
+    if (pmq->count) {
+        *addr = pmq->msgs[pmq->head];
+        pmq->head = (pmq->head + 1) % pmq->max_msgs;
+        pmq->count--;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&pmq->lock);
+
+    return ret;
+}
+
+static void *ec_osal_posix_timer_thread(void *argument)
+{
+    struct ec_osal_timer *timer = (struct ec_osal_timer *)argument;
+    ec_osal_posix_timer_t *ptimer = (ec_osal_posix_timer_t *)timer->timer;
+    struct timespec ts;
+
+    pthread_mutex_lock(&ptimer->lock);
+    while (!ptimer->exit) {
+        if (!ptimer->running) {
+            pthread_cond_wait(&ptimer->cond, &ptimer->lock);
+            continue;
+        }
+
+        ec_osal_posix_abstime(&ts, timer->timeout_ms);
+        if (pthread_cond_timedwait(&ptimer->cond, &ptimer->lock, &ts) != ETIMEDOUT) {
+            continue; // restarted or stopped
+        }
+
+        if (!timer->is_period) {
+            ptimer->running = false;
+        }
+
+        pthread_mutex_unlock(&ptimer->lock);
+        timer->handler(timer->argument);
+        pthread_mutex_lock(&ptimer->lock);
+    }
+    pthread_mutex_unlock(&ptimer->lock);
+
+    return NULL;
+}
+
+struct ec_osal_timer *ec_osal_timer_create(const char *name, uint32_t timeout_ms, ec_timer_handler_t handler, void *argument, bool is_period)
+{
+    struct ec_osal_timer *timer;
+    ec_osal_posix_timer_t *ptimer;
+
+    timer = calloc(1, sizeof(struct ec_osal_timer));
+    ptimer = calloc(1, sizeof(ec_osal_posix_timer_t));
+
+    if ((timer == NULL) || (ptimer == NULL)) {
+        EC_LOG_ERR("Create ec_osal_timer failed\r\n");
+        while (1) {
+        }
+    }
+
+    timer->handler = handler;
+    timer->argument = argument;
+    timer->is_period = is_period;
+    timer->timeout_ms = timeout_ms;
+    timer->timer = ptimer;
+
+    pthread_mutex_init(&ptimer->lock, NULL);
+    ec_osal_posix_cond_init(&ptimer->cond);
+
+    if (pthread_create(&ptimer->thread, NULL, ec_osal_posix_timer_thread, timer) != 0) {
+        EC_LOG_ERR("Create timer failed\r\n");
+        while (1) {
+        }
+    }
+    pthread_setname_np(ptimer->thread, name);
+
+    return timer;
+}
+
+void ec_osal_timer_delete(struct ec_osal_timer *timer)
+{
+    ec_osal_posix_timer_t *ptimer = (ec_osal_posix_timer_t *)timer->timer;
+
+    pthread_mutex_lock(&ptimer->lock);
+    ptimer->exit = true;
+    pthread_cond_signal(&ptimer->cond);
+    pthread_mutex_unlock(&ptimer->lock);
+    pthread_join(ptimer->thread, NULL);
+
+    free(ptimer);
+    free(timer);
+}
+
+void ec_osal_timer_start(struct ec_osal_timer *timer)
+{
+    ec_osal_posix_timer_t *ptimer = (ec_osal_posix_timer_t *)timer->timer;
+
+    pthread_mutex_lock(&ptimer->lock);
+    ptimer->running = true;
+    pthread_cond_signal(&ptimer->cond);
+    pthread_mutex_unlock(&ptimer->lock);
+}
+
+void ec_osal_timer_stop(struct ec_osal_timer *timer)
+{
+    ec_osal_posix_timer_t *ptimer = (ec_osal_posix_timer_t *)timer->timer;
+
+    pthread_mutex_lock(&ptimer->lock);
+    ptimer->running = false;
+    pthread_cond_signal(&ptimer->cond);
+    pthread_mutex_unlock(&ptimer->lock);
+}
+
+static void ec_osal_posix_critical_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    // priority inheritance, a non realtime thread holding the lock must not stall the cycle
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&g_ec_osal_critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+size_t ec_osal_enter_critical_section(void)
+{
+    pthread_once(&g_ec_osal_critical_once, ec_osal_posix_critical_init);
+    pthread_mutex_lock(&g_ec_osal_critical_lock);
+    return 1;
+}
+
+void ec_osal_leave_critical_section(size_t flag)
+{
+    (void)flag;
+    pthread_mutex_unlock(&g_ec_osal_critical_lock);
+}
+
+void ec_osal_msleep(uint32_t delay)
+{
+    struct timespec ts;
+
+    ts.tv_sec = delay / 1000;
+    ts.tv_nsec = (delay % 1000) * 1000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+    }
+}
+
+void *ec_osal_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void ec_osal_free(void *ptr)
+{
+    free(ptr);
+}
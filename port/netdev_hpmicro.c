@@ -344,6 +344,8 @@ SDK_DECLARE_EXT_ISR_M(IRQn_ENET1, isr_enet1)
 static ec_htimer_cb g_ec_htimer_cb = NULL;
 static void *g_ec_htimer_arg = NULL;
 static uint32_t g_timer_reload_us_div = 0;
+static uint64_t g_timer_reload_ns_mult = 0; /* timer ticks per ns, Q32 */
+static uint32_t g_timer_reload_ns_frac = 0; /* sub tick phase accumulator, Q32 */
 
 void ec_htimer_isr(void)
 {
@@ -367,6 +369,8 @@ void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
     clock_add_to_group(EC_HTIMER_CLK_NAME, 0);
     gptmr_freq = clock_get_frequency(EC_HTIMER_CLK_NAME);
     g_timer_reload_us_div = gptmr_freq / 1000000;
+    g_timer_reload_ns_mult = ((uint64_t)gptmr_freq << 32) / 1000000000;
+    g_timer_reload_ns_frac = 0;
 
     config.reload = g_timer_reload_us_div * us;
     gptmr_stop_counter(EC_HTIMER, EC_HTIMER_CH);
@@ -389,6 +393,14 @@ EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
     gptmr_channel_config_update_reload(EC_HTIMER, EC_HTIMER_CH, us * g_timer_reload_us_div);
 }
 
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    uint64_t ticks = (uint64_t)ns * g_timer_reload_ns_mult + g_timer_reload_ns_frac;
+
+    g_timer_reload_ns_frac = (uint32_t)ticks;
+    gptmr_channel_config_update_reload(EC_HTIMER, EC_HTIMER_CH, (uint32_t)(ticks >> 32));
+}
+
 #ifndef CONFIG_EC_TIMESTAMP_CUSTOM
 uint32_t ec_get_cpu_frequency(void)
 {
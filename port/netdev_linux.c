@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+#include "ec_master.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+
+#if !defined(CONFIG_EC_TIMESTAMP_CUSTOM)
+#error "CONFIG_EC_TIMESTAMP_CUSTOM must be defined for linux"
+#endif
+
+#if !defined(CONFIG_EC_PHY_CUSTOM)
+#error "CONFIG_EC_PHY_CUSTOM must be defined for linux"
+#endif
+
+#ifndef ETH_P_ECAT
+#define ETH_P_ECAT 0x88a4
+#endif
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+/*
+ * Frames go through AF_PACKET rings in the TPACKET_V2 format, which the kernel hands over frame
+ * by frame. TPACKET_V3 only passes rx blocks to user space when they are full or retired by a
+ * timer with millisecond resolution, that alone is longer than a 1 ms cycle.
+ *
+ * The receive thread and the htimer thread run with SCHED_FIFO and call into the stack inside
+ * the osal critical section, like the rx and timer interrupts on a MCU.
+ */
+
+#define EC_LINUX_FRAME_SIZE  2048
+#define EC_LINUX_BLOCK_SIZE  4096
+#define EC_LINUX_TX_FRAMES   ((CONFIG_EC_MAX_ENET_TXBUF_COUNT + 1) & ~1)
+#define EC_LINUX_RX_FRAMES   ((CONFIG_EC_MAX_ENET_RXBUF_COUNT + 1) & ~1)
+#define EC_LINUX_TX_DATA_OFF (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+#define EC_LINUX_RT_PRIO (sched_get_priority_max(SCHED_FIFO) - 1)
+
+typedef struct {
+    char ifname[IFNAMSIZ];
+    int fd;
+    uint8_t *ring;
+    size_t ring_size;
+    uint8_t *rx_ring;
+    uint8_t *tx_ring;
+    uint32_t rx_frame_index;
+    pthread_t rx_thread;
+} ec_netdev_linux_t;
+
+ec_netdev_t g_netdev[CONFIG_EC_MAX_NETDEVS];
+static ec_netdev_linux_t g_netdev_linux[CONFIG_EC_MAX_NETDEVS];
+
+void ec_netdev_linux_set_ifname(uint8_t netdev_index, const char *ifname)
+{
+    EC_ASSERT_MSG(netdev_index < CONFIG_EC_MAX_NETDEVS, "Invalid netdev index %u\n", netdev_index);
+
+    strncpy(g_netdev_linux[netdev_index].ifname, ifname, IFNAMSIZ - 1);
+}
+
+static int ec_linux_create_thread(pthread_t *thread, void *(*entry)(void *), void *arg, const char *name)
+{
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = EC_LINUX_RT_PRIO;
+    pthread_attr_setschedparam(&attr, &param);
+
+    ret = pthread_create(thread, &attr, entry, arg);
+    if (ret == EPERM) {
+        EC_LOG_WRN("No permission for SCHED_FIFO, %s uses the default policy\r\n", name);
+        ret = pthread_create(thread, NULL, entry, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (ret == 0) {
+        pthread_setname_np(*thread, name);
+    }
+    return ret;
+}
+
+static void *ec_netdev_linux_rx_thread(void *argument)
+{
+    ec_netdev_t *netdev = (ec_netdev_t *)argument;
+    ec_netdev_linux_t *linux_dev = &g_netdev_linux[netdev->index];
+    struct tpacket2_hdr *hdr;
+    struct sockaddr_ll *sll;
+    struct pollfd pfd;
+    uintptr_t flags;
+
+    pfd.fd = linux_dev->fd;
+    pfd.events = POLLIN | POLLERR;
+
+    while (1) {
+        hdr = (struct tpacket2_hdr *)(linux_dev->rx_ring + linux_dev->rx_frame_index * EC_LINUX_FRAME_SIZE);
+
+        if (!(__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            pfd.revents = 0;
+            poll(&pfd, 1, 100);
+            continue;
+        }
+
+        sll = (struct sockaddr_ll *)((uint8_t *)hdr + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+
+        // own frames on older kernels without PACKET_IGNORE_OUTGOING
+        if ((sll->sll_pkttype != PACKET_OUTGOING) && !(hdr->tp_status & TP_STATUS_COPY) && netdev->master) {
+            flags = ec_osal_enter_critical_section();
+            ec_netdev_receive(netdev, (uint8_t *)hdr + hdr->tp_mac, hdr->tp_snaplen);
+            ec_osal_leave_critical_section(flags);
+        }
+
+        __atomic_store_n(&hdr->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        linux_dev->rx_frame_index = (linux_dev->rx_frame_index + 1) % EC_LINUX_RX_FRAMES;
+    }
+
+    return NULL;
+}
+
+static int ec_netdev_linux_open(ec_netdev_t *netdev, ec_netdev_linux_t *linux_dev)
+{
+    struct tpacket_req req;
+    struct sockaddr_ll addr;
+    struct ifreq ifr;
+    int version = TPACKET_V2;
+    int one = 1;
+
+    linux_dev->fd = socket(AF_PACKET, SOCK_RAW, ec_htons(ETH_P_ECAT));
+    if (linux_dev->fd < 0) {
+        EC_LOG_ERR("Create packet socket failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, linux_dev->ifname, IFNAMSIZ - 1);
+    if (ioctl(linux_dev->fd, SIOCGIFINDEX, &ifr) < 0) {
+        EC_LOG_ERR("Interface %s not found\r\n", linux_dev->ifname);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = ec_htons(ETH_P_ECAT);
+    addr.sll_ifindex = ifr.ifr_ifindex;
+
+    if (ioctl(linux_dev->fd, SIOCGIFHWADDR, &ifr) < 0) {
+        EC_LOG_ERR("Get mac address of %s failed\r\n", linux_dev->ifname);
+        return -1;
+    }
+    ec_memcpy(netdev->mac_addr, ifr.ifr_hwaddr.sa_data, 6);
+
+    if (setsockopt(linux_dev->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        EC_LOG_ERR("TPACKET_V2 not supported\r\n");
+        return -1;
+    }
+
+    // optional, older kernels fall back to the pkttype check and the qdisc path
+    setsockopt(linux_dev->fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+    setsockopt(linux_dev->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    req.tp_block_size = EC_LINUX_BLOCK_SIZE;
+    req.tp_frame_size = EC_LINUX_FRAME_SIZE;
+    req.tp_frame_nr = EC_LINUX_RX_FRAMES;
+    req.tp_block_nr = EC_LINUX_RX_FRAMES * EC_LINUX_FRAME_SIZE / EC_LINUX_BLOCK_SIZE;
+    if (setsockopt(linux_dev->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        EC_LOG_ERR("Setup rx ring failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    req.tp_frame_nr = EC_LINUX_TX_FRAMES;
+    req.tp_block_nr = EC_LINUX_TX_FRAMES * EC_LINUX_FRAME_SIZE / EC_LINUX_BLOCK_SIZE;
+    if (setsockopt(linux_dev->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+        EC_LOG_ERR("Setup tx ring failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    // rx ring first, tx ring behind it in one mapping
+    linux_dev->ring_size = (EC_LINUX_RX_FRAMES + EC_LINUX_TX_FRAMES) * EC_LINUX_FRAME_SIZE;
+    linux_dev->ring = mmap(NULL, linux_dev->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, linux_dev->fd, 0);
+    if (linux_dev->ring == MAP_FAILED) {
+        linux_dev->ring = mmap(NULL, linux_dev->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, linux_dev->fd, 0);
+    }
+    if (linux_dev->ring == MAP_FAILED) {
+        EC_LOG_ERR("Map packet rings failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+    linux_dev->rx_ring = linux_dev->ring;
+    linux_dev->tx_ring = linux_dev->ring + EC_LINUX_RX_FRAMES * EC_LINUX_FRAME_SIZE;
+
+    if (bind(linux_dev->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        EC_LOG_ERR("Bind to %s failed: %s\r\n", linux_dev->ifname, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+ec_netdev_t *ec_netdev_low_level_init(uint8_t netdev_index)
+{
+    ec_netdev_t *netdev = &g_netdev[netdev_index];
+    ec_netdev_linux_t *linux_dev = &g_netdev_linux[netdev_index];
+    uint8_t *frame;
+
+    if (linux_dev->ifname[0] == '\0') {
+        EC_LOG_ERR("No interface for netdev %u, call ec_netdev_linux_set_ifname() first\r\n", netdev_index);
+        return NULL;
+    }
+
+    if (ec_netdev_linux_open(netdev, linux_dev) < 0) {
+        if (linux_dev->fd >= 0) {
+            close(linux_dev->fd);
+        }
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < EC_LINUX_TX_FRAMES; i++) {
+        frame = linux_dev->tx_ring + i * EC_LINUX_FRAME_SIZE + EC_LINUX_TX_DATA_OFF;
+        for (uint8_t j = 0; j < 6; j++) { // dst MAC
+            EC_WRITE_U8(&frame[j], 0xFF);
+        }
+        for (uint8_t j = 0; j < 6; j++) { // src MAC
+            EC_WRITE_U8(&frame[6 + j], netdev->mac_addr[j]);
+        }
+        EC_WRITE_U16(&frame[12], ec_htons(0x88a4));
+    }
+
+    netdev->index = netdev_index;
+    if (ec_linux_create_thread(&linux_dev->rx_thread, ec_netdev_linux_rx_thread, netdev, "ec_rx") != 0) {
+        EC_LOG_ERR("Create rx thread failed\r\n");
+        return NULL;
+    }
+
+    EC_LOG_INFO("netdev%u on %s\r\n", netdev_index, linux_dev->ifname);
+    return netdev;
+}
+
+void ec_netdev_low_level_poll_link_state(ec_netdev_t *netdev)
+{
+    ec_netdev_linux_t *linux_dev = &g_netdev_linux[netdev->index];
+    struct ifreq ifr;
+    bool link_state;
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, linux_dev->ifname, IFNAMSIZ - 1);
+    if (ioctl(linux_dev->fd, SIOCGIFFLAGS, &ifr) < 0) {
+        return;
+    }
+
+    link_state = (ifr.ifr_flags & IFF_UP) && (ifr.ifr_flags & IFF_RUNNING);
+    if (link_state != netdev->link_state) {
+        EC_LOG_INFO("%s link %s\r\n", linux_dev->ifname, link_state ? "up" : "down");
+        netdev->link_state = link_state;
+    }
+}
+
+EC_FAST_CODE_SECTION uint8_t *ec_netdev_low_level_get_txbuf(ec_netdev_t *netdev)
+{
+    ec_netdev_linux_t *linux_dev = &g_netdev_linux[netdev->index];
+
+    return linux_dev->tx_ring + netdev->tx_frame_index * EC_LINUX_FRAME_SIZE + EC_LINUX_TX_DATA_OFF;
+}
+
+EC_FAST_CODE_SECTION int ec_netdev_low_level_output(ec_netdev_t *netdev, uint32_t size)
+{
+    ec_netdev_linux_t *linux_dev = &g_netdev_linux[netdev->index];
+    struct tpacket2_hdr *hdr;
+
+    hdr = (struct tpacket2_hdr *)(linux_dev->tx_ring + netdev->tx_frame_index * EC_LINUX_FRAME_SIZE);
+
+    // the slot is still owned by the kernel, the frame before was not sent out yet
+    if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE) {
+        if (hdr->tp_status & TP_STATUS_WRONG_FORMAT) {
+            __atomic_store_n(&hdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+        }
+        return -1;
+    }
+
+    hdr->tp_len = size;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    if (send(linux_dev->fd, NULL, 0, MSG_DONTWAIT) < 0) {
+        __atomic_store_n(&hdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    netdev->tx_frame_index++;
+    netdev->tx_frame_index %= EC_LINUX_TX_FRAMES;
+
+    return 0;
+}
+
+static ec_htimer_cb g_ec_htimer_cb = NULL;
+static void *g_ec_htimer_arg = NULL;
+static pthread_t g_ec_htimer_thread;
+static volatile bool g_ec_htimer_running = false;
+static volatile uint32_t g_ec_htimer_period_ns = 0;
+
+static void *ec_htimer_thread(void *argument)
+{
+    struct timespec next;
+    struct timespec now;
+    uintptr_t flags;
+    uint64_t late;
+
+    (void)argument;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (g_ec_htimer_running) {
+        // the period set in the callback applies to the period that just started, like a reload register
+        next.tv_nsec += g_ec_htimer_period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+
+        if (!g_ec_htimer_running) {
+            break;
+        }
+
+        // after an overrun of more than one period restart from now instead of firing back to back
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = (uint64_t)(now.tv_sec - next.tv_sec) * 1000000000ULL + now.tv_nsec - next.tv_nsec;
+        if ((int64_t)late > (int64_t)g_ec_htimer_period_ns) {
+            next = now;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        g_ec_htimer_cb(g_ec_htimer_arg);
+        ec_osal_leave_critical_section(flags);
+    }
+
+    return NULL;
+}
+
+void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
+{
+    g_ec_htimer_cb = cb;
+    g_ec_htimer_arg = arg;
+    g_ec_htimer_period_ns = us * 1000;
+    g_ec_htimer_running = true;
+
+    if (ec_linux_create_thread(&g_ec_htimer_thread, ec_htimer_thread, NULL, "ec_htimer") != 0) {
+        EC_LOG_ERR("ec_htimer_start failed\r\n");
+        g_ec_htimer_running = false;
+    }
+}
+
+void ec_htimer_stop(void)
+{
+    if (!g_ec_htimer_running) {
+        return;
+    }
+
+    g_ec_htimer_running = false;
+    if (pthread_equal(g_ec_htimer_thread, pthread_self())) {
+        pthread_detach(g_ec_htimer_thread);
+    } else {
+        pthread_join(g_ec_htimer_thread, NULL);
+    }
+}
+
+EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
+{
+    g_ec_htimer_period_ns = us * 1000;
+}
+
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    g_ec_htimer_period_ns = ns;
+}
+
+void ec_timestamp_init(void)
+{
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
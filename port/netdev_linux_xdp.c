@@ -0,0 +1,666 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+#include "ec_master.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <stddef.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+
+#if !defined(CONFIG_EC_TIMESTAMP_CUSTOM)
+#error "CONFIG_EC_TIMESTAMP_CUSTOM must be defined for linux"
+#endif
+
+#if !defined(CONFIG_EC_PHY_CUSTOM)
+#error "CONFIG_EC_PHY_CUSTOM must be defined for linux"
+#endif
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+/*
+ * AF_XDP socket on one UMEM. The first CONFIG_EC_MAX_ENET_TXBUF_COUNT frames of the UMEM are
+ * the tx buffers, ec_netdev_low_level_get_txbuf() returns them directly and the header is
+ * written once, the rest is given to the fill ring for rx. A small XDP program redirects
+ * EtherCAT frames to the socket, everything else goes to the kernel stack. It is built from raw
+ * instructions and attached with a bpf link, so no libbpf is needed and the program is detached
+ * when the process exits.
+ *
+ * While the htimer runs, rx is busy polled from the htimer thread right after the cycle until
+ * all frames of the cycle returned or half of the period passed, no wakeup sits in the round
+ * trip. Otherwise a receive thread waits in poll().
+ */
+
+#define EC_XDP_FRAME_SIZE 2048
+#define EC_XDP_RING_SIZE  256
+#define EC_XDP_TX_FRAMES  CONFIG_EC_MAX_ENET_TXBUF_COUNT
+#define EC_XDP_RX_FRAMES  CONFIG_EC_MAX_ENET_RXBUF_COUNT
+#define EC_XDP_FRAMES     (EC_XDP_TX_FRAMES + EC_XDP_RX_FRAMES)
+#define EC_XDP_QUEUE      0
+
+#define EC_LINUX_RT_PRIO (sched_get_priority_max(SCHED_FIFO) - 1)
+
+#if (EC_XDP_TX_FRAMES > EC_XDP_RING_SIZE) || (EC_XDP_RX_FRAMES > EC_XDP_RING_SIZE)
+#error "CONFIG_EC_MAX_ENET_TXBUF_COUNT and CONFIG_EC_MAX_ENET_RXBUF_COUNT must not exceed EC_XDP_RING_SIZE"
+#endif
+
+typedef struct {
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void *descs;
+    void *map;
+    size_t map_size;
+} ec_xdp_ring_t;
+
+typedef struct {
+    char ifname[IFNAMSIZ];
+    int fd;
+    int ctl_fd; /**< plain socket for the interface ioctls, AF_XDP sockets do not handle them */
+    int map_fd;
+    int prog_fd;
+    int link_fd;
+    uint8_t *umem;
+    ec_xdp_ring_t fill;
+    ec_xdp_ring_t comp;
+    ec_xdp_ring_t rx;
+    ec_xdp_ring_t tx;
+    bool need_wakeup;
+    bool tx_busy[EC_XDP_TX_FRAMES];
+    pthread_t rx_thread;
+} ec_netdev_xdp_t;
+
+ec_netdev_t g_netdev[CONFIG_EC_MAX_NETDEVS];
+static ec_netdev_xdp_t g_netdev_xdp[CONFIG_EC_MAX_NETDEVS];
+static uint8_t g_netdev_xdp_count = 0;
+
+static volatile bool g_ec_htimer_running = false;
+
+void ec_netdev_linux_set_ifname(uint8_t netdev_index, const char *ifname)
+{
+    EC_ASSERT_MSG(netdev_index < CONFIG_EC_MAX_NETDEVS, "Invalid netdev index %u\n", netdev_index);
+
+    strncpy(g_netdev_xdp[netdev_index].ifname, ifname, IFNAMSIZ - 1);
+}
+
+static int ec_linux_create_thread(pthread_t *thread, void *(*entry)(void *), void *arg, const char *name)
+{
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = EC_LINUX_RT_PRIO;
+    pthread_attr_setschedparam(&attr, &param);
+
+    ret = pthread_create(thread, &attr, entry, arg);
+    if (ret == EPERM) {
+        EC_LOG_WRN("No permission for SCHED_FIFO, %s uses the default policy\r\n", name);
+        ret = pthread_create(thread, NULL, entry, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (ret == 0) {
+        pthread_setname_np(*thread, name);
+    }
+    return ret;
+}
+
+static int ec_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+#define EC_BPF_INSN(_code, _dst, _src, _off, _imm) \
+    ((struct bpf_insn){ .code = (_code), .dst_reg = (_dst), .src_reg = (_src), .off = (_off), .imm = (_imm) })
+
+static int ec_netdev_xdp_attach(ec_netdev_xdp_t *xdp_dev, int ifindex)
+{
+    static const uint32_t modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+    union bpf_attr attr;
+    uint32_t key = EC_XDP_QUEUE;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = EC_XDP_QUEUE + 1;
+    xdp_dev->map_fd = ec_bpf(BPF_MAP_CREATE, &attr);
+    if (xdp_dev->map_fd < 0) {
+        EC_LOG_ERR("Create xsk map failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    // if (ethertype == 0x88a4) return bpf_redirect_map(&xsks, rx_queue_index, XDP_PASS); return XDP_PASS;
+    struct bpf_insn insns[] = {
+        EC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0),
+        EC_BPF_INSN(BPF_LDX | BPF_MEM | BPF_W, 2, 6, offsetof(struct xdp_md, data), 0),
+        EC_BPF_INSN(BPF_LDX | BPF_MEM | BPF_W, 3, 6, offsetof(struct xdp_md, data_end), 0),
+        EC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0),
+        EC_BPF_INSN(BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, ETH_HLEN),
+        EC_BPF_INSN(BPF_JMP | BPF_JGT | BPF_X, 4, 3, 8, 0),
+        EC_BPF_INSN(BPF_LDX | BPF_MEM | BPF_H, 4, 2, 12, 0),
+        EC_BPF_INSN(BPF_JMP | BPF_JNE | BPF_K, 4, 0, 6, ec_htons(0x88a4)),
+        EC_BPF_INSN(BPF_LDX | BPF_MEM | BPF_W, 2, 6, offsetof(struct xdp_md, rx_queue_index), 0),
+        EC_BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, xdp_dev->map_fd),
+        EC_BPF_INSN(0, 0, 0, 0, 0),
+        EC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS),
+        EC_BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+        EC_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+        EC_BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, XDP_PASS),
+        EC_BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    };
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uintptr_t)insns;
+    attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+    attr.license = (uintptr_t) "Dual BSD/GPL";
+    xdp_dev->prog_fd = ec_bpf(BPF_PROG_LOAD, &attr);
+    if (xdp_dev->prog_fd < 0) {
+        EC_LOG_ERR("Load xdp program failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    // native mode if the driver supports it, generic mode otherwise
+    for (uint8_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd = xdp_dev->prog_fd;
+        attr.link_create.target_ifindex = ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = modes[i];
+        xdp_dev->link_fd = ec_bpf(BPF_LINK_CREATE, &attr);
+        if (xdp_dev->link_fd >= 0) {
+            EC_LOG_INFO("%s: xdp program attached in %s mode\r\n", xdp_dev->ifname,
+                        (modes[i] == XDP_FLAGS_DRV_MODE) ? "native" : "generic");
+            break;
+        }
+    }
+    if (xdp_dev->link_fd < 0) {
+        EC_LOG_ERR("Attach xdp program to %s failed: %s\r\n", xdp_dev->ifname, strerror(errno));
+        return -1;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = xdp_dev->map_fd;
+    attr.key = (uintptr_t)&key;
+    attr.value = (uintptr_t)&xdp_dev->fd;
+    if (ec_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        EC_LOG_ERR("Update xsk map failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int ec_netdev_xdp_map_ring(ec_netdev_xdp_t *xdp_dev, ec_xdp_ring_t *ring, const struct xdp_ring_offset *off,
+                                  size_t desc_size, off_t pgoff)
+{
+    ring->map_size = off->desc + EC_XDP_RING_SIZE * desc_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xdp_dev->fd, pgoff);
+    if (ring->map == MAP_FAILED) {
+        return -1;
+    }
+
+    ring->producer = (uint32_t *)((uint8_t *)ring->map + off->producer);
+    ring->consumer = (uint32_t *)((uint8_t *)ring->map + off->consumer);
+    ring->flags = (uint32_t *)((uint8_t *)ring->map + off->flags);
+    ring->descs = (uint8_t *)ring->map + off->desc;
+    return 0;
+}
+
+static void ec_xdp_fill(ec_netdev_xdp_t *xdp_dev, uint64_t addr)
+{
+    uint32_t prod = *xdp_dev->fill.producer;
+
+    // the fill ring holds all rx frames, it is never full
+    ((uint64_t *)xdp_dev->fill.descs)[prod & (EC_XDP_RING_SIZE - 1)] = addr;
+    __atomic_store_n(xdp_dev->fill.producer, prod + 1, __ATOMIC_RELEASE);
+}
+
+static void ec_xdp_complete(ec_netdev_xdp_t *xdp_dev)
+{
+    uint32_t cons = *xdp_dev->comp.consumer;
+    uint32_t prod = __atomic_load_n(xdp_dev->comp.producer, __ATOMIC_ACQUIRE);
+    uint64_t addr;
+
+    while (cons != prod) {
+        addr = ((uint64_t *)xdp_dev->comp.descs)[cons & (EC_XDP_RING_SIZE - 1)];
+        xdp_dev->tx_busy[addr / EC_XDP_FRAME_SIZE] = false;
+        cons++;
+    }
+    __atomic_store_n(xdp_dev->comp.consumer, cons, __ATOMIC_RELEASE);
+}
+
+static int ec_netdev_xdp_open(ec_netdev_t *netdev, ec_netdev_xdp_t *xdp_dev)
+{
+    struct xdp_mmap_offsets off;
+    struct xdp_umem_reg umem_reg;
+    struct sockaddr_xdp addr;
+    struct ifreq ifr;
+    socklen_t optlen;
+    int ring_size = EC_XDP_RING_SIZE;
+    int busy_poll = 20;
+    int one = 1;
+    int ifindex;
+    bool bound = false;
+
+    xdp_dev->fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xdp_dev->fd < 0) {
+        EC_LOG_ERR("Create xdp socket failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    xdp_dev->ctl_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (xdp_dev->ctl_fd < 0) {
+        EC_LOG_ERR("Create control socket failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, xdp_dev->ifname, IFNAMSIZ - 1);
+    if (ioctl(xdp_dev->ctl_fd, SIOCGIFINDEX, &ifr) < 0) {
+        EC_LOG_ERR("Interface %s not found\r\n", xdp_dev->ifname);
+        return -1;
+    }
+    ifindex = ifr.ifr_ifindex;
+
+    if (ioctl(xdp_dev->ctl_fd, SIOCGIFHWADDR, &ifr) < 0) {
+        EC_LOG_ERR("Get mac address of %s failed\r\n", xdp_dev->ifname);
+        return -1;
+    }
+    ec_memcpy(netdev->mac_addr, ifr.ifr_hwaddr.sa_data, 6);
+
+    xdp_dev->umem = mmap(NULL, EC_XDP_FRAMES * EC_XDP_FRAME_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (xdp_dev->umem == MAP_FAILED) {
+        EC_LOG_ERR("Allocate umem failed\r\n");
+        return -1;
+    }
+
+    memset(&umem_reg, 0, sizeof(umem_reg));
+    umem_reg.addr = (uintptr_t)xdp_dev->umem;
+    umem_reg.len = EC_XDP_FRAMES * EC_XDP_FRAME_SIZE;
+    umem_reg.chunk_size = EC_XDP_FRAME_SIZE;
+    if (setsockopt(xdp_dev->fd, SOL_XDP, XDP_UMEM_REG, &umem_reg, sizeof(umem_reg)) < 0) {
+        EC_LOG_ERR("Register umem failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    if ((setsockopt(xdp_dev->fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0) ||
+        (setsockopt(xdp_dev->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0) ||
+        (setsockopt(xdp_dev->fd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0) ||
+        (setsockopt(xdp_dev->fd, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) < 0)) {
+        EC_LOG_ERR("Setup xdp rings failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    optlen = sizeof(off);
+    if (getsockopt(xdp_dev->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0) {
+        EC_LOG_ERR("Get xdp ring offsets failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    if ((ec_netdev_xdp_map_ring(xdp_dev, &xdp_dev->fill, &off.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) < 0) ||
+        (ec_netdev_xdp_map_ring(xdp_dev, &xdp_dev->comp, &off.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) < 0) ||
+        (ec_netdev_xdp_map_ring(xdp_dev, &xdp_dev->rx, &off.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) < 0) ||
+        (ec_netdev_xdp_map_ring(xdp_dev, &xdp_dev->tx, &off.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) < 0)) {
+        EC_LOG_ERR("Map xdp rings failed: %s\r\n", strerror(errno));
+        return -1;
+    }
+
+    for (uint32_t i = EC_XDP_TX_FRAMES; i < EC_XDP_FRAMES; i++) {
+        ec_xdp_fill(xdp_dev, (uint64_t)i * EC_XDP_FRAME_SIZE);
+    }
+
+    // zero copy if the driver supports it, copy mode otherwise, e.g. on veth
+    memset(&addr, 0, sizeof(addr));
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_ifindex = ifindex;
+    addr.sxdp_queue_id = EC_XDP_QUEUE;
+    // the queue stays busy for a moment after the socket of a previous run was closed
+    for (uint32_t retry = 0; !bound && (retry < 100); retry++) {
+        addr.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+        bound = (bind(xdp_dev->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        if (!bound) {
+            addr.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+            bound = (bind(xdp_dev->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        }
+        if (!bound) {
+            if (errno != EBUSY) {
+                break;
+            }
+            ec_osal_msleep(10);
+        }
+    }
+    if (!bound) {
+        EC_LOG_ERR("Bind xdp socket to %s failed: %s\r\n", xdp_dev->ifname, strerror(errno));
+        return -1;
+    }
+    xdp_dev->need_wakeup = true;
+    EC_LOG_INFO("%s: xdp socket in %s mode\r\n", xdp_dev->ifname, (addr.sxdp_flags & XDP_ZEROCOPY) ? "zero copy" : "copy");
+
+    // optional, lets the cyclic thread drive the napi of native drivers
+    setsockopt(xdp_dev->fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+    setsockopt(xdp_dev->fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll));
+
+    return ec_netdev_xdp_attach(xdp_dev, ifindex);
+}
+
+/* Must be called inside the critical section, returns the number of received frames. */
+static uint32_t ec_netdev_xdp_rx_poll(ec_netdev_t *netdev)
+{
+    ec_netdev_xdp_t *xdp_dev = &g_netdev_xdp[netdev->index];
+    struct xdp_desc *desc;
+    uint32_t cons = *xdp_dev->rx.consumer;
+    uint32_t prod = __atomic_load_n(xdp_dev->rx.producer, __ATOMIC_ACQUIRE);
+    uint32_t count = prod - cons;
+
+    while (cons != prod) {
+        desc = &((struct xdp_desc *)xdp_dev->rx.descs)[cons & (EC_XDP_RING_SIZE - 1)];
+        if (netdev->master) {
+            ec_netdev_receive(netdev, xdp_dev->umem + desc->addr, desc->len);
+        }
+        ec_xdp_fill(xdp_dev, desc->addr & ~((uint64_t)EC_XDP_FRAME_SIZE - 1));
+        cons++;
+    }
+    __atomic_store_n(xdp_dev->rx.consumer, cons, __ATOMIC_RELEASE);
+
+    if (xdp_dev->need_wakeup && (__atomic_load_n(xdp_dev->fill.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)) {
+        recvfrom(xdp_dev->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+
+    return count;
+}
+
+static uint32_t ec_netdev_xdp_rx_poll_all(void)
+{
+    uint32_t count = 0;
+
+    for (uint8_t i = 0; i < g_netdev_xdp_count; i++) {
+        count += ec_netdev_xdp_rx_poll(&g_netdev[i]);
+    }
+    return count;
+}
+
+static void *ec_netdev_xdp_rx_thread(void *argument)
+{
+    ec_netdev_t *netdev = (ec_netdev_t *)argument;
+    struct pollfd pfd;
+    uintptr_t flags;
+
+    pfd.fd = g_netdev_xdp[netdev->index].fd;
+    pfd.events = POLLIN;
+
+    while (1) {
+        // the htimer thread polls while it runs
+        if (g_ec_htimer_running) {
+            ec_osal_msleep(10);
+            continue;
+        }
+
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        ec_netdev_xdp_rx_poll(netdev);
+        ec_osal_leave_critical_section(flags);
+    }
+
+    return NULL;
+}
+
+ec_netdev_t *ec_netdev_low_level_init(uint8_t netdev_index)
+{
+    ec_netdev_t *netdev = &g_netdev[netdev_index];
+    ec_netdev_xdp_t *xdp_dev = &g_netdev_xdp[netdev_index];
+    uint8_t *frame;
+
+    if (xdp_dev->ifname[0] == '\0') {
+        EC_LOG_ERR("No interface for netdev %u, call ec_netdev_linux_set_ifname() first\r\n", netdev_index);
+        return NULL;
+    }
+
+    if (ec_netdev_xdp_open(netdev, xdp_dev) < 0) {
+        close(xdp_dev->fd);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < EC_XDP_TX_FRAMES; i++) {
+        frame = xdp_dev->umem + i * EC_XDP_FRAME_SIZE;
+        for (uint8_t j = 0; j < 6; j++) { // dst MAC
+            EC_WRITE_U8(&frame[j], 0xFF);
+        }
+        for (uint8_t j = 0; j < 6; j++) { // src MAC
+            EC_WRITE_U8(&frame[6 + j], netdev->mac_addr[j]);
+        }
+        EC_WRITE_U16(&frame[12], ec_htons(0x88a4));
+    }
+
+    netdev->index = netdev_index;
+    if (ec_linux_create_thread(&xdp_dev->rx_thread, ec_netdev_xdp_rx_thread, netdev, "ec_rx") != 0) {
+        EC_LOG_ERR("Create rx thread failed\r\n");
+        return NULL;
+    }
+    g_netdev_xdp_count = MAX(g_netdev_xdp_count, netdev_index + 1);
+
+    EC_LOG_INFO("netdev%u on %s\r\n", netdev_index, xdp_dev->ifname);
+    return netdev;
+}
+
+void ec_netdev_low_level_poll_link_state(ec_netdev_t *netdev)
+{
+    ec_netdev_xdp_t *xdp_dev = &g_netdev_xdp[netdev->index];
+    struct ifreq ifr;
+    bool link_state;
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, xdp_dev->ifname, IFNAMSIZ - 1);
+    if (ioctl(xdp_dev->ctl_fd, SIOCGIFFLAGS, &ifr) < 0) {
+        return;
+    }
+
+    link_state = (ifr.ifr_flags & IFF_UP) && (ifr.ifr_flags & IFF_RUNNING);
+    if (link_state != netdev->link_state) {
+        EC_LOG_INFO("%s link %s\r\n", xdp_dev->ifname, link_state ? "up" : "down");
+        netdev->link_state = link_state;
+    }
+}
+
+EC_FAST_CODE_SECTION uint8_t *ec_netdev_low_level_get_txbuf(ec_netdev_t *netdev)
+{
+    return g_netdev_xdp[netdev->index].umem + netdev->tx_frame_index * EC_XDP_FRAME_SIZE;
+}
+
+EC_FAST_CODE_SECTION int ec_netdev_low_level_output(ec_netdev_t *netdev, uint32_t size)
+{
+    ec_netdev_xdp_t *xdp_dev = &g_netdev_xdp[netdev->index];
+    struct xdp_desc *desc;
+    uint32_t prod;
+
+    ec_xdp_complete(xdp_dev);
+
+    // the frame before in this slot was not sent out yet
+    if (xdp_dev->tx_busy[netdev->tx_frame_index]) {
+        return -1;
+    }
+
+    prod = *xdp_dev->tx.producer;
+    desc = &((struct xdp_desc *)xdp_dev->tx.descs)[prod & (EC_XDP_RING_SIZE - 1)];
+    desc->addr = (uint64_t)netdev->tx_frame_index * EC_XDP_FRAME_SIZE;
+    desc->len = size;
+    desc->options = 0;
+    xdp_dev->tx_busy[netdev->tx_frame_index] = true;
+    __atomic_store_n(xdp_dev->tx.producer, prod + 1, __ATOMIC_RELEASE);
+
+    if (!xdp_dev->need_wakeup || (__atomic_load_n(xdp_dev->tx.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)) {
+        sendto(xdp_dev->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+    }
+
+    netdev->tx_frame_index++;
+    netdev->tx_frame_index %= EC_XDP_TX_FRAMES;
+
+    return 0;
+}
+
+static ec_htimer_cb g_ec_htimer_cb = NULL;
+static void *g_ec_htimer_arg = NULL;
+static pthread_t g_ec_htimer_thread;
+static volatile uint32_t g_ec_htimer_period_ns = 0;
+
+static uint64_t ec_htimer_tx_count(void)
+{
+    uint64_t count = 0;
+
+    for (uint8_t i = 0; i < g_netdev_xdp_count; i++) {
+        count += g_netdev[i].stats.tx_count;
+    }
+    return count;
+}
+
+static void *ec_htimer_thread(void *argument)
+{
+    struct timespec next;
+    struct timespec now;
+    uintptr_t flags;
+    uint64_t late;
+    uint64_t deadline;
+    uint64_t pending;
+    uint64_t received;
+    uint64_t now_ns;
+    struct timespec timeout;
+    struct pollfd pfds[CONFIG_EC_MAX_NETDEVS];
+    bool busy_poll = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+
+    (void)argument;
+
+    for (uint8_t i = 0; i < g_netdev_xdp_count; i++) {
+        pfds[i].fd = g_netdev_xdp[i].fd;
+        pfds[i].events = POLLIN;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (g_ec_htimer_running) {
+        // the period set in the callback applies to the period that just started, like a reload register
+        next.tv_nsec += g_ec_htimer_period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+
+        if (!g_ec_htimer_running) {
+            break;
+        }
+
+        // after an overrun of more than one period restart from now instead of firing back to back
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = (uint64_t)(now.tv_sec - next.tv_sec) * 1000000000ULL + now.tv_nsec - next.tv_nsec;
+        if ((int64_t)late > (int64_t)g_ec_htimer_period_ns) {
+            next = now;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        ec_netdev_xdp_rx_poll_all(); // frames which missed the last cycle
+        pending = ec_htimer_tx_count();
+        g_ec_htimer_cb(g_ec_htimer_arg);
+        pending = ec_htimer_tx_count() - pending;
+        ec_osal_leave_critical_section(flags);
+
+        // busy poll the frames of this cycle, on a single cpu spinning would starve the softirq
+        // that delivers them, so wait in ppoll() instead
+        deadline = ec_timestamp_get_time_ns() + g_ec_htimer_period_ns / 2;
+        received = 0;
+        while ((received < pending) && ((now_ns = ec_timestamp_get_time_ns()) < deadline)) {
+            if (!busy_poll) {
+                timeout.tv_sec = 0;
+                timeout.tv_nsec = deadline - now_ns;
+                ppoll(pfds, g_netdev_xdp_count, &timeout, NULL);
+            }
+            flags = ec_osal_enter_critical_section();
+            received += ec_netdev_xdp_rx_poll_all();
+            ec_osal_leave_critical_section(flags);
+        }
+    }
+
+    return NULL;
+}
+
+void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
+{
+    g_ec_htimer_cb = cb;
+    g_ec_htimer_arg = arg;
+    g_ec_htimer_period_ns = us * 1000;
+    g_ec_htimer_running = true;
+
+    if (ec_linux_create_thread(&g_ec_htimer_thread, ec_htimer_thread, NULL, "ec_htimer") != 0) {
+        EC_LOG_ERR("ec_htimer_start failed\r\n");
+        g_ec_htimer_running = false;
+    }
+}
+
+void ec_htimer_stop(void)
+{
+    if (!g_ec_htimer_running) {
+        return;
+    }
+
+    g_ec_htimer_running = false;
+    if (pthread_equal(g_ec_htimer_thread, pthread_self())) {
+        pthread_detach(g_ec_htimer_thread);
+    } else {
+        pthread_join(g_ec_htimer_thread, NULL);
+    }
+}
+
+EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
+{
+    g_ec_htimer_period_ns = us * 1000;
+}
+
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    g_ec_htimer_period_ns = ns;
+}
+
+void ec_timestamp_init(void)
+{
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -332,6 +332,8 @@ EC_FAST_CODE_SECTION int ec_netdev_low_level_input(ec_netdev_t *netdev)
 static ec_htimer_cb g_ec_htimer_cb = NULL;
 static void *g_ec_htimer_arg = NULL;
 static uint32_t g_timer_reload_us_div = 0;
+static uint64_t g_timer_reload_ns_mult = 0; /* timer ticks per ns, Q32 */
+static uint32_t g_timer_reload_ns_frac = 0; /* sub tick phase accumulator, Q32 */
 
 void timer0_esc_callback(timer_callback_args_t *p_args)
 {
@@ -352,6 +354,8 @@ void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
     R_GPT_InfoGet(&g_timer0_ctrl, &time_info);
 
     g_timer_reload_us_div = time_info.clock_frequency / 1000000;
+    g_timer_reload_ns_mult = ((uint64_t)time_info.clock_frequency << 32) / 1000000000;
+    g_timer_reload_ns_frac = 0;
 
     g_ec_htimer_cb = cb;
     g_ec_htimer_arg = arg;
@@ -375,6 +379,14 @@ EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
     R_GPT_PeriodSet(&g_timer0_ctrl, us * g_timer_reload_us_div);
 }
 
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    uint64_t ticks = (uint64_t)ns * g_timer_reload_ns_mult + g_timer_reload_ns_frac;
+
+    g_timer_reload_ns_frac = (uint32_t)ticks;
+    R_GPT_PeriodSet(&g_timer0_ctrl, (uint32_t)(ticks >> 32));
+}
+
 void user_ether0_callback(ether_callback_args_t *p_args)
 {
     rt_interrupt_enter();
@@ -235,6 +235,7 @@ EC_FAST_CODE_SECTION int ec_netdev_low_level_output(ec_netdev_t *netdev, uint32_
 
 static ec_htimer_cb g_ec_htimer_cb = NULL;
 static void *g_ec_htimer_arg = NULL;
+static uint32_t g_timer_reload_ns_frac = 0; /* sub tick phase accumulator [ns] */
 
 static TIM_HandleTypeDef ECTimHandle;
 
@@ -255,6 +256,7 @@ void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
 
     g_ec_htimer_cb = cb;
     g_ec_htimer_arg = arg;
+    g_timer_reload_ns_frac = 0;
 
     /* Enable TIM7 clock */
     __HAL_RCC_TIM7_CLK_ENABLE();
@@ -310,6 +312,17 @@ EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
     TIM7->ARR = us - 1U;
 }
 
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    uint32_t us;
+
+    /* TIM7 counts in us, keep the remainder for the next periods */
+    ns += g_timer_reload_ns_frac;
+    us = ns / 1000U;
+    g_timer_reload_ns_frac = ns - us * 1000U;
+    TIM7->ARR = us - 1U;
+}
+
 #ifndef CONFIG_EC_TIMESTAMP_CUSTOM
 extern uint32_t SystemCoreClock;
 uint32_t ec_get_cpu_frequency(void)
@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+#include "ec_master.h"
+#include "ec_sim.h"
+#include <ucontext.h>
+
+#if !defined(CONFIG_EC_SIM_VTIME)
+#error "CONFIG_EC_SIM_VTIME must be defined for the virtual time osal"
+#endif
+
+/*
+ * Osal on a virtual clock for the simulator. All threads are coroutines of the process thread
+ * that calls into the osal first, which becomes the "main" thread with the lowest priority. A
+ * thread runs until it blocks in the osal, then the ready thread with the highest priority
+ * runs, first come first served among equal priorities. When no thread is ready the clock jumps
+ * to the earliest timeout, so waiting costs no host time and a run depends on nothing but its
+ * inputs: the same run gives the same frames at the same virtual times.
+ *
+ * There is no preemption, the critical section only checks that no thread blocks inside it.
+ * Code on this osal must wait with the osal or ec_sim_vtime_sleep_until(), a thread polling
+ * ec_timestamp_get_time_ns() stops the clock.
+ */
+
+#define EC_VTIME_FOREVER    UINT64_MAX
+#define EC_VTIME_EPOCH_NS   1000000000ULL
+#define EC_VTIME_STACK_SIZE (256 * 1024)
+#define EC_VTIME_MAIN_PRIO  UINT32_MAX
+
+typedef struct ec_osal_vtime_thread ec_osal_vtime_thread_t;
+
+/* Threads waiting for one object, in priority order. */
+typedef struct {
+    ec_osal_vtime_thread_t *head;
+} ec_osal_vtime_queue_t;
+
+struct ec_osal_vtime_thread {
+    ucontext_t context;
+    void *stack;
+    const char *name;
+    uint32_t prio;
+    ec_thread_entry_t entry;
+    void *args;
+    ec_osal_vtime_thread_t *next;       /**< Next thread in the ready queue or in queue. */
+    ec_osal_vtime_thread_t *sleep_next; /**< Next thread in the sleep list. */
+    ec_osal_vtime_queue_t *queue;       /**< Wait queue of the blocked thread, NULL if none. */
+    uint64_t wakeup;                    /**< Virtual time of the timeout [ns]. */
+    bool sleeping;
+    bool timed_out;
+    bool suspended;
+    uintptr_t msg;     /**< Message handed over by ec_osal_mq_send(). */
+    uint32_t critical; /**< Nesting of the critical section. */
+};
+
+typedef struct {
+    ec_osal_vtime_queue_t waiters;
+    uint32_t count;
+    uint32_t max_count;
+} ec_osal_vtime_sem_t;
+
+typedef struct {
+    ec_osal_vtime_queue_t waiters;
+    ec_osal_vtime_thread_t *owner;
+} ec_osal_vtime_mutex_t;
+
+typedef struct {
+    ec_osal_vtime_queue_t waiters;
+    uint32_t max_msgs;
+    uint32_t head;
+    uint32_t count;
+    uintptr_t msgs[];
+} ec_osal_vtime_mq_t;
+
+typedef struct {
+    ec_osal_vtime_queue_t waiters;
+    bool running;
+    bool exit;
+} ec_osal_vtime_timer_t;
+
+static struct {
+    ec_osal_vtime_thread_t main;
+    ec_osal_vtime_thread_t *current;
+    ec_osal_vtime_queue_t ready;
+    ec_osal_vtime_thread_t *sleepers; /**< Threads with a timeout, earliest first. */
+    ec_osal_vtime_thread_t *zombie;   /**< Exited thread, freed by the next thread that runs. */
+    uint64_t now;
+} g_ec_osal_vtime;
+
+static ec_osal_vtime_thread_t *ec_osal_vtime_self(void)
+{
+    if (g_ec_osal_vtime.current == NULL) {
+        g_ec_osal_vtime.main.name = "main";
+        g_ec_osal_vtime.main.prio = EC_VTIME_MAIN_PRIO;
+        g_ec_osal_vtime.current = &g_ec_osal_vtime.main;
+        g_ec_osal_vtime.now = EC_VTIME_EPOCH_NS;
+    }
+    return g_ec_osal_vtime.current;
+}
+
+static void ec_osal_vtime_enqueue(ec_osal_vtime_queue_t *queue, ec_osal_vtime_thread_t *thread)
+{
+    ec_osal_vtime_thread_t **pos = &queue->head;
+
+    while (*pos && ((*pos)->prio <= thread->prio)) {
+        pos = &(*pos)->next;
+    }
+    thread->next = *pos;
+    *pos = thread;
+}
+
+static void ec_osal_vtime_dequeue(ec_osal_vtime_queue_t *queue, ec_osal_vtime_thread_t *thread)
+{
+    ec_osal_vtime_thread_t **pos = &queue->head;
+
+    while (*pos && (*pos != thread)) {
+        pos = &(*pos)->next;
+    }
+    if (*pos) {
+        *pos = thread->next;
+    }
+}
+
+/* Takes a thread out of its wait queue and the sleep list. */
+static void ec_osal_vtime_unblock(ec_osal_vtime_thread_t *thread)
+{
+    ec_osal_vtime_thread_t **pos;
+
+    if (thread->queue) {
+        ec_osal_vtime_dequeue(thread->queue, thread);
+        thread->queue = NULL;
+    }
+
+    if (thread->sleeping) {
+        pos = &g_ec_osal_vtime.sleepers;
+        while (*pos != thread) {
+            pos = &(*pos)->sleep_next;
+        }
+        *pos = thread->sleep_next;
+        thread->sleeping = false;
+    }
+}
+
+static void ec_osal_vtime_make_ready(ec_osal_vtime_thread_t *thread, bool timed_out)
+{
+    ec_osal_vtime_unblock(thread);
+    thread->timed_out = timed_out;
+    ec_osal_vtime_enqueue(&g_ec_osal_vtime.ready, thread);
+}
+
+/* Readies the first waiter of queue, returns NULL if there is none. */
+static ec_osal_vtime_thread_t *ec_osal_vtime_wake(ec_osal_vtime_queue_t *queue)
+{
+    ec_osal_vtime_thread_t *thread = queue->head;
+
+    if (thread) {
+        ec_osal_vtime_make_ready(thread, false);
+    }
+    return thread;
+}
+
+static void ec_osal_vtime_reap(void)
+{
+    if (g_ec_osal_vtime.zombie) {
+        free(g_ec_osal_vtime.zombie->stack);
+        free(g_ec_osal_vtime.zombie);
+        g_ec_osal_vtime.zombie = NULL;
+    }
+}
+
+/* Switches to the next ready thread, advancing the clock while there is none. */
+static void ec_osal_vtime_schedule(void)
+{
+    ec_osal_vtime_thread_t *self = g_ec_osal_vtime.current;
+    ec_osal_vtime_thread_t *next;
+
+    while (g_ec_osal_vtime.ready.head == NULL) {
+        EC_ASSERT_MSG(g_ec_osal_vtime.sleepers != NULL, "All threads wait forever, %s blocked last", self->name);
+
+        g_ec_osal_vtime.now = MAX(g_ec_osal_vtime.now, g_ec_osal_vtime.sleepers->wakeup);
+        while (g_ec_osal_vtime.sleepers && (g_ec_osal_vtime.sleepers->wakeup <= g_ec_osal_vtime.now)) {
+            ec_osal_vtime_make_ready(g_ec_osal_vtime.sleepers, true);
+        }
+    }
+
+    next = g_ec_osal_vtime.ready.head;
+    g_ec_osal_vtime.ready.head = next->next;
+
+    if (next != self) {
+        g_ec_osal_vtime.current = next;
+        swapcontext(&self->context, &next->context);
+        ec_osal_vtime_reap();
+    }
+}
+
+/* Blocks the calling thread on queue (NULL for none), returns -EC_ERR_TIMEOUT after timeout_ns. */
+static int ec_osal_vtime_block(ec_osal_vtime_queue_t *queue, uint64_t timeout_ns)
+{
+    ec_osal_vtime_thread_t *self = ec_osal_vtime_self();
+    ec_osal_vtime_thread_t **pos;
+
+    EC_ASSERT_MSG(self->critical == 0, "Thread %s blocks in the critical section", self->name);
+
+    self->timed_out = false;
+
+    if (queue) {
+        ec_osal_vtime_enqueue(queue, self);
+        self->queue = queue;
+    }
+
+    if (timeout_ns != EC_VTIME_FOREVER) {
+        self->wakeup = g_ec_osal_vtime.now + timeout_ns;
+        pos = &g_ec_osal_vtime.sleepers;
+        while (*pos && ((*pos)->wakeup <= self->wakeup)) {
+            pos = &(*pos)->sleep_next;
+        }
+        self->sleep_next = *pos;
+        *pos = self;
+        self->sleeping = true;
+    }
+
+    ec_osal_vtime_schedule();
+
+    return self->timed_out ? -EC_ERR_TIMEOUT : 0;
+}
+
+static uint64_t ec_osal_vtime_timeout_ns(uint32_t timeout_ms)
+{
+    return (timeout_ms == EC_OSAL_WAITING_FOREVER) ? EC_VTIME_FOREVER : timeout_ms * 1000000ULL;
+}
+
+static void ec_osal_vtime_exit(void)
+{
+    ec_osal_vtime_thread_t *self = g_ec_osal_vtime.current;
+
+    EC_ASSERT_MSG(self != &g_ec_osal_vtime.main, "The main thread can not exit");
+
+    ec_osal_vtime_reap();
+    g_ec_osal_vtime.zombie = self;
+    ec_osal_vtime_schedule();
+}
+
+static void ec_osal_vtime_thread_entry(void)
+{
+    ec_osal_vtime_thread_t *self = g_ec_osal_vtime.current;
+
+    ec_osal_vtime_reap();
+    self->entry(self->args);
+    ec_osal_vtime_exit();
+}
+
+ec_osal_thread_t ec_osal_thread_create(const char *name, uint32_t stack_size, uint32_t prio, ec_thread_entry_t entry, void *args)
+{
+    ec_osal_vtime_thread_t *thread;
+
+    ec_osal_vtime_self();
+
+    // the mcu stack sizes are too small for the host libc
+    stack_size = MAX(stack_size, EC_VTIME_STACK_SIZE);
+
+    thread = calloc(1, sizeof(ec_osal_vtime_thread_t));
+    if (thread) {
+        thread->stack = malloc(stack_size);
+    }
+
+    if ((thread == NULL) || (thread->stack == NULL)) {
+        EC_LOG_ERR("Create thread %s failed\r\n", name);
+        while (1) {
+        }
+    }
+
+    thread->name = name;
+    thread->prio = prio;
+    thread->entry = entry;
+    thread->args = args;
+
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = stack_size;
+    thread->context.uc_link = NULL;
+    makecontext(&thread->context, ec_osal_vtime_thread_entry, 0);
+
+    // starts when the creator blocks
+    ec_osal_vtime_enqueue(&g_ec_osal_vtime.ready, thread);
+    return (ec_osal_thread_t)thread;
+}
+
+void ec_osal_thread_delete(ec_osal_thread_t thread)
+{
+    ec_osal_vtime_thread_t *vthread = (ec_osal_vtime_thread_t *)thread;
+
+    if ((vthread == NULL) || (vthread == ec_osal_vtime_self())) {
+        ec_osal_vtime_exit();
+    }
+
+    ec_osal_vtime_unblock(vthread);
+    ec_osal_vtime_dequeue(&g_ec_osal_vtime.ready, vthread);
+    free(vthread->stack);
+    free(vthread);
+}
+
+/* Like the posix osal a thread can only suspend itself. */
+void ec_osal_thread_suspend(ec_osal_thread_t thread)
+{
+    ec_osal_vtime_thread_t *vthread = (ec_osal_vtime_thread_t *)thread;
+
+    EC_ASSERT_MSG(vthread == ec_osal_vtime_self(), "Only the calling thread can be suspended");
+
+    vthread->suspended = true;
+    while (vthread->suspended) {
+        ec_osal_vtime_block(NULL, EC_VTIME_FOREVER);
+    }
+}
+
+void ec_osal_thread_resume(ec_osal_thread_t thread)
+{
+    ec_osal_vtime_thread_t *vthread = (ec_osal_vtime_thread_t *)thread;
+
+    if (vthread->suspended) {
+        vthread->suspended = false;
+        ec_osal_vtime_make_ready(vthread, false);
+    }
+}
+
+ec_osal_sem_t ec_osal_sem_create(uint32_t max_count, uint32_t initial_count)
+{
+    ec_osal_vtime_sem_t *sem = calloc(1, sizeof(ec_osal_vtime_sem_t));
+
+    if (sem == NULL) {
+        EC_LOG_ERR("Create semaphore failed\r\n");
+        while (1) {
+        }
+    }
+
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return (ec_osal_sem_t)sem;
+}
+
+void ec_osal_sem_delete(ec_osal_sem_t sem)
+{
+    free(sem);
+}
+
+int ec_osal_sem_take(ec_osal_sem_t sem, uint32_t timeout)
+{
+    ec_osal_vtime_sem_t *vsem = (ec_osal_vtime_sem_t *)sem;
+
+    if (vsem->count) {
+        vsem->count--;
+        return 0;
+    }
+
+    if (timeout == 0) {
+        return -EC_ERR_TIMEOUT;
+    }
+
+    // a give hands its count over to the woken thread
+    return ec_osal_vtime_block(&vsem->waiters, ec_osal_vtime_timeout_ns(timeout));
+}
+
+int ec_osal_sem_give(ec_osal_sem_t sem)
+{
+    ec_osal_vtime_sem_t *vsem = (ec_osal_vtime_sem_t *)sem;
+
+    if (ec_osal_vtime_wake(&vsem->waiters)) {
+        return 0;
+    }
+
+    if (vsem->count < vsem->max_count) {
+        vsem->count++;
+        return 0;
+    }
+
+    return -EC_ERR_TIMEOUT;
+}
+
+void ec_osal_sem_reset(ec_osal_sem_t sem)
+{
+    ((ec_osal_vtime_sem_t *)sem)->count = 0;
+}
+
+ec_osal_mutex_t ec_osal_mutex_create(void)
+{
+    ec_osal_vtime_mutex_t *mutex = calloc(1, sizeof(ec_osal_vtime_mutex_t));
+
+    if (mutex == NULL) {
+        EC_LOG_ERR("Create mutex failed\r\n");
+        while (1) {
+        }
+    }
+
+    return (ec_osal_mutex_t)mutex;
+}
+
+void ec_osal_mutex_delete(ec_osal_mutex_t mutex)
+{
+    free(mutex);
+}
+
+int ec_osal_mutex_take(ec_osal_mutex_t mutex)
+{
+    ec_osal_vtime_mutex_t *vmutex = (ec_osal_vtime_mutex_t *)mutex;
+    ec_osal_vtime_thread_t *self = ec_osal_vtime_self();
+
+    if (vmutex->owner == NULL) {
+        vmutex->owner = self;
+        return 0;
+    }
+
+    // a give hands the mutex over to the woken thread
+    return ec_osal_vtime_block(&vmutex->waiters, EC_VTIME_FOREVER);
+}
+
+int ec_osal_mutex_give(ec_osal_mutex_t mutex)
+{
+    ec_osal_vtime_mutex_t *vmutex = (ec_osal_vtime_mutex_t *)mutex;
+
+    if (vmutex->owner != ec_osal_vtime_self()) {
+        return -EC_ERR_TIMEOUT;
+    }
+
+    vmutex->owner = ec_osal_vtime_wake(&vmutex->waiters);
+    return 0;
+}
+
+ec_osal_mq_t ec_osal_mq_create(uint32_t max_msgs)
+{
+    ec_osal_vtime_mq_t *mq = calloc(1, sizeof(ec_osal_vtime_mq_t) + max_msgs * sizeof(uintptr_t));
+
+    if (mq == NULL) {
+        return NULL;
+    }
+
+    mq->max_msgs = max_msgs;
+    return (ec_osal_mq_t)mq;
+}
+
+void ec_osal_mq_delete(ec_osal_mq_t mq)
+{
+    free(mq);
+}
+
+int ec_osal_mq_send(ec_osal_mq_t mq, uintptr_t addr)
+{
+    ec_osal_vtime_mq_t *vmq = (ec_osal_vtime_mq_t *)mq;
+    ec_osal_vtime_thread_t *thread;
+
+    thread = ec_osal_vtime_wake(&vmq->waiters);
+    if (thread) {
+        thread->msg = addr;
+        return 0;
+    }
+
+    if (vmq->count < vmq->max_msgs) {
+        vmq->msgs[(vmq->head + vmq->count) % vmq->max_msgs] = addr;
+        vmq->count++;
+        return 0;
+    }
+
+    return -EC_ERR_TIMEOUT;
+}
+
+int ec_osal_mq_recv(ec_osal_mq_t mq, uintptr_t *addr, uint32_t timeout)
+{
+    ec_osal_vtime_mq_t *vmq = (ec_osal_vtime_mq_t *)mq;
+    int ret;
+
+    if (vmq->count) {
+        *addr = vmq->msgs[vmq->head];
+        vmq->head = (vmq->head + 1) % vmq->max_msgs;
+        vmq->count--;
+        return 0;
+    }
+
+    if (timeout == 0) {
+        return -EC_ERR_TIMEOUT;
+    }
+
+    ret = ec_osal_vtime_block(&vmq->waiters, ec_osal_vtime_timeout_ns(timeout));
+    if (ret == 0) {
+        *addr = ec_osal_vtime_self()->msg;
+    }
+    return ret;
+}
+
+static void ec_osal_vtime_timer_thread(void *argument)
+{
+    struct ec_osal_timer *timer = (struct ec_osal_timer *)argument;
+    ec_osal_vtime_timer_t *vtimer = (ec_osal_vtime_timer_t *)timer->timer;
+
+    while (!vtimer->exit) {
+        if (!vtimer->running) {
+            ec_osal_vtime_block(&vtimer->waiters, EC_VTIME_FOREVER);
+            continue;
+        }
+
+        if (ec_osal_vtime_block(&vtimer->waiters, timer->timeout_ms * 1000000ULL) == 0) {
+            continue; // restarted or stopped
+        }
+
+        if (!timer->is_period) {
+            vtimer->running = false;
+        }
+
+        timer->handler(timer->argument);
+    }
+
+    // deleted, nobody else references the timer any more
+    free(vtimer);
+    free(timer);
+}
+
+struct ec_osal_timer *ec_osal_timer_create(const char *name, uint32_t timeout_ms, ec_timer_handler_t handler, void *argument, bool is_period)
+{
+    struct ec_osal_timer *timer;
+    ec_osal_vtime_timer_t *vtimer;
+
+    timer = calloc(1, sizeof(struct ec_osal_timer));
+    vtimer = calloc(1, sizeof(ec_osal_vtime_timer_t));
+
+    if ((timer == NULL) || (vtimer == NULL)) {
+        EC_LOG_ERR("Create ec_osal_timer failed\r\n");
+        while (1) {
+        }
+    }
+
+    timer->handler = handler;
+    timer->argument = argument;
+    timer->is_period = is_period;
+    timer->timeout_ms = timeout_ms;
+    timer->timer = vtimer;
+
+    // like the timer task of a rtos above the stack threads
+    ec_osal_thread_create(name, 0, 0, ec_osal_vtime_timer_thread, timer);
+    return timer;
+}
+
+void ec_osal_timer_delete(struct ec_osal_timer *timer)
+{
+    ec_osal_vtime_timer_t *vtimer = (ec_osal_vtime_timer_t *)timer->timer;
+
+    vtimer->exit = true;
+    ec_osal_vtime_wake(&vtimer->waiters);
+}
+
+void ec_osal_timer_start(struct ec_osal_timer *timer)
+{
+    ec_osal_vtime_timer_t *vtimer = (ec_osal_vtime_timer_t *)timer->timer;
+
+    vtimer->running = true;
+    ec_osal_vtime_wake(&vtimer->waiters);
+}
+
+void ec_osal_timer_stop(struct ec_osal_timer *timer)
+{
+    ec_osal_vtime_timer_t *vtimer = (ec_osal_vtime_timer_t *)timer->timer;
+
+    vtimer->running = false;
+    ec_osal_vtime_wake(&vtimer->waiters);
+}
+
+size_t ec_osal_enter_critical_section(void)
+{
+    ec_osal_vtime_self()->critical++;
+    return 1;
+}
+
+void ec_osal_leave_critical_section(size_t flag)
+{
+    (void)flag;
+    ec_osal_vtime_self()->critical--;
+}
+
+void ec_osal_msleep(uint32_t delay)
+{
+    ec_osal_vtime_block(NULL, delay * 1000000ULL);
+}
+
+void *ec_osal_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void ec_osal_free(void *ptr)
+{
+    free(ptr);
+}
+
+uint64_t ec_sim_vtime_now(void)
+{
+    ec_osal_vtime_self();
+    return g_ec_osal_vtime.now;
+}
+
+void ec_sim_vtime_sleep_until(uint64_t time_ns)
+{
+    uint64_t now = ec_sim_vtime_now();
+
+    ec_osal_vtime_block(NULL, (time_ns > now) ? (time_ns - now) : 0);
+}
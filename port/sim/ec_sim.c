@@ -0,0 +1,1932 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+#include "ec_sim.h"
+#include <stdio.h>
+#include <time.h>
+
+#define EC_SIM_MEM_SIZE     0x3000 /* registers and 8 KB process data ram */
+#define EC_SIM_OD_SIZE      128
+#define EC_SIM_OD_POOL_SIZE 4096
+
+#define EC_SIM_REG(x) ((uint16_t)ESCREG_OF(ESCREG->x))
+
+#define EC_SIM_DRIFT_PPB    50000      /* spread of the local clocks */
+#define EC_SIM_MAX_CORR_PPB 200000     /* range of the drift compensation */
+#define EC_SIM_RATE_MIN_NS  100000     /* min interval of one rate estimation */
+#define EC_SIM_ANCHOR_NS    1000000000 /* max distance to the clock anchor */
+
+#define EC_SIM_ACCESS_READ  0x01
+#define EC_SIM_ACCESS_WRITE 0x02
+#define EC_SIM_ACCESS_OR    0x04 /* broadcast read, the slaves or their data into the frame */
+
+#define EC_SIM_MBX_NONE  0
+#define EC_SIM_MBX_WRITE 1 /* written by the master */
+#define EC_SIM_MBX_READ  2 /* read by the master */
+
+#define EC_SIM_SM_STATUS_FULL 0x08
+
+#define EC_SIM_TOUCHES(ado, len, reg, size) (((ado) < (reg) + (size)) && ((reg) < (ado) + (len)))
+
+typedef struct {
+    uint16_t index;
+    uint8_t subindex;
+    uint8_t read_only;
+    uint16_t size;
+    uint16_t capacity;
+    uint16_t offset;
+} ec_sim_obj_t;
+
+typedef struct {
+    uint8_t mem[EC_SIM_MEM_SIZE];
+    uint8_t *sii;
+    uint32_t sii_size;
+
+    /* local(t) = anchor_local + (t - anchor_time) * (1 + (drift_ppb + corr_ppb) / 1e9) */
+    uint64_t anchor_time;
+    uint64_t anchor_local;
+    int32_t drift_ppb;
+    int32_t corr_ppb;
+    uint64_t compare_time; /* host time of the last system time compare, 0 after an offset write */
+    int64_t residual;      /* difference expected at the next compare without any drift */
+    int64_t drift_sum;
+    uint64_t drift_time;
+    uint32_t dc_event; /* next entry of the compare log to replay */
+
+    uint32_t mbx_start; /* range of the active mailbox sync managers */
+    uint32_t mbx_end;
+    bool mbx_pending;   /* request waits for the master to read the last response */
+    ec_sim_obj_t *seg_obj;
+    uint32_t seg_offset;
+    uint8_t seg_toggle;
+    bool seg_upload;
+
+    ec_sim_obj_t od[EC_SIM_OD_SIZE];
+    uint16_t od_count;
+    uint16_t od_used;
+    uint8_t od_pool[EC_SIM_OD_POOL_SIZE];
+} ec_sim_slave_t;
+
+/* An enabled FMMU of a slave in SAFEOP or OP. */
+typedef struct {
+    uint32_t logical;
+    uint32_t slave_index;
+    uint16_t length;
+    uint16_t physical;
+    uint8_t type;   /* bit 0 read, bit 1 write */
+    bool covered;   /* the whole range lies in one active sync manager */
+} ec_sim_fmmu_t;
+
+/* Entries [first, last) of the FMMU map a logical datagram can hit. */
+typedef struct {
+    uint32_t laddr;
+    uint16_t len;
+    uint32_t first;
+    uint32_t last;
+} ec_sim_span_t;
+
+#define EC_SIM_SPAN_CACHE 16
+
+/* A FRMW/ARMW of the system time, the compares of the writing slaves wait in a log. */
+typedef struct {
+    uint64_t t0;
+    uint64_t before; /* system time in front of the reference clock */
+    uint64_t after;  /* system time behind it */
+    int32_t target;
+    uint32_t hop_ns;
+    bool dc64;
+} ec_sim_dc_event_t;
+
+#define EC_SIM_DC_EVENTS 256
+
+static void ec_sim_default_app(uint32_t slave_index,
+                               const uint8_t *output, uint32_t output_size,
+                               uint8_t *input, uint32_t input_size,
+                               void *arg);
+
+static ec_sim_slave_t *g_sim_slaves = NULL;
+static uint32_t g_sim_slave_count = 0;
+static uint32_t g_sim_hop_ns = 500;
+static ec_sim_app_cb_t g_sim_app_cb = ec_sim_default_app;
+static void *g_sim_app_arg = NULL;
+static ec_sim_stats_t g_sim_stats;
+static int32_t g_sim_station_map[65536];
+static bool g_sim_station_dirty = true;
+static ec_sim_fmmu_t *g_sim_fmmu_map = NULL; /* 8 entries per slave */
+static uint32_t g_sim_fmmu_count = 0;
+static bool g_sim_fmmu_dirty = true;
+static ec_sim_span_t g_sim_spans[EC_SIM_SPAN_CACHE];
+static uint32_t g_sim_span_count = 0;
+static uint32_t g_sim_span_next = 0;
+static ec_sim_dc_event_t g_sim_dc_events[EC_SIM_DC_EVENTS];
+static uint32_t g_sim_dc_event_count = 0;
+static uint32_t g_sim_mbx_sys_time = 0; /* slaves with a mailbox over the system time */
+
+static void ec_sim_default_app(uint32_t slave_index,
+                               const uint8_t *output, uint32_t output_size,
+                               uint8_t *input, uint32_t input_size,
+                               void *arg)
+{
+    (void)slave_index;
+    (void)arg;
+
+    if (output && input) {
+        memcpy(input, output, MIN(output_size, input_size));
+    }
+}
+
+/*
+ * SII
+ */
+
+static uint16_t ec_sim_sii_word(ec_sim_slave_t *s, uint32_t word)
+{
+    if ((word * 2 + 2) > s->sii_size) {
+        return 0xffff;
+    }
+    return EC_READ_U16(&s->sii[word * 2]);
+}
+
+/* Next category of type behind prev with *size bytes, the first one if prev is NULL. */
+static uint8_t *ec_sim_sii_next_category(ec_sim_slave_t *s, uint16_t type, const uint8_t *prev, uint32_t *size)
+{
+    uint32_t word = prev ? (uint32_t)(prev - s->sii + *size) / 2 : EC_SII_ADDRESS_ADDITIONAL_INFO;
+    uint16_t cat_type;
+    uint16_t cat_words;
+
+    while (((word + 2) * 2) <= s->sii_size) {
+        cat_type = EC_READ_U16(&s->sii[word * 2]);
+        cat_words = EC_READ_U16(&s->sii[word * 2 + 2]);
+
+        if ((cat_type == EC_SII_TYPE_END) || (((word + 2 + cat_words) * 2) > s->sii_size)) {
+            break;
+        }
+
+        if (cat_type == type) {
+            *size = cat_words * 2;
+            return &s->sii[(word + 2) * 2];
+        }
+        word += 2 + cat_words;
+    }
+
+    return NULL;
+}
+
+static uint8_t *ec_sim_sii_category(ec_sim_slave_t *s, uint16_t type, uint32_t *size)
+{
+    return ec_sim_sii_next_category(s, type, NULL, size);
+}
+
+static const uint8_t *ec_sim_sii_string(ec_sim_slave_t *s, uint8_t index, uint8_t *len)
+{
+    uint8_t *data;
+    uint32_t size;
+    uint32_t offset = 1;
+
+    data = ec_sim_sii_category(s, EC_SII_TYPE_STRINGS, &size);
+    if (!data || (index == 0) || (index > data[0])) {
+        return NULL;
+    }
+
+    for (uint8_t i = 1; i < index; i++) {
+        offset += 1 + data[offset];
+        if (offset >= size) {
+            return NULL;
+        }
+    }
+
+    if ((offset + 1 + data[offset]) > size) {
+        return NULL;
+    }
+
+    *len = data[offset];
+    return &data[offset + 1];
+}
+
+/*
+ * Object dictionary of the CoE server
+ */
+
+static ec_sim_obj_t *ec_sim_od_find(ec_sim_slave_t *s, uint16_t index, uint8_t subindex)
+{
+    for (uint16_t i = 0; i < s->od_count; i++) {
+        if ((s->od[i].index == index) && (s->od[i].subindex == subindex)) {
+            return &s->od[i];
+        }
+    }
+    return NULL;
+}
+
+static bool ec_sim_od_has_index(ec_sim_slave_t *s, uint16_t index)
+{
+    for (uint16_t i = 0; i < s->od_count; i++) {
+        if (s->od[i].index == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ec_sim_obj_t *ec_sim_od_add(ec_sim_slave_t *s, uint16_t index, uint8_t subindex, uint32_t size)
+{
+    ec_sim_obj_t *obj = ec_sim_od_find(s, index, subindex);
+    uint32_t capacity = MAX(size, 4);
+
+    if (obj && (obj->capacity >= size)) {
+        return obj;
+    }
+
+    if ((s->od_used + capacity) > EC_SIM_OD_POOL_SIZE) {
+        return NULL;
+    }
+
+    if (!obj) {
+        if (s->od_count == EC_SIM_OD_SIZE) {
+            return NULL;
+        }
+        obj = &s->od[s->od_count++];
+        obj->index = index;
+        obj->subindex = subindex;
+        obj->read_only = 0;
+        obj->size = 0;
+    } else {
+        // the old space stays unused, objects rarely grow
+        memcpy(&s->od_pool[s->od_used], &s->od_pool[obj->offset], obj->size);
+    }
+
+    obj->offset = s->od_used;
+    obj->capacity = capacity;
+    s->od_used += capacity;
+    return obj;
+}
+
+static void ec_sim_od_set(ec_sim_slave_t *s, uint16_t index, uint8_t subindex, const void *data, uint16_t size, bool read_only)
+{
+    ec_sim_obj_t *obj = ec_sim_od_add(s, index, subindex, size);
+
+    if (!obj) {
+        return;
+    }
+
+    memcpy(&s->od_pool[obj->offset], data, size);
+    obj->size = size;
+    obj->read_only = read_only;
+}
+
+static void ec_sim_od_set_u8(ec_sim_slave_t *s, uint16_t index, uint8_t subindex, uint8_t value, bool read_only)
+{
+    ec_sim_od_set(s, index, subindex, &value, 1, read_only);
+}
+
+static void ec_sim_od_set_u16(ec_sim_slave_t *s, uint16_t index, uint8_t subindex, uint16_t value, bool read_only)
+{
+    uint8_t data[2];
+
+    EC_WRITE_U16(data, value);
+    ec_sim_od_set(s, index, subindex, data, 2, read_only);
+}
+
+static void ec_sim_od_set_u32(ec_sim_slave_t *s, uint16_t index, uint8_t subindex, uint32_t value, bool read_only)
+{
+    uint8_t data[4];
+
+    EC_WRITE_U32(data, value);
+    ec_sim_od_set(s, index, subindex, data, 4, read_only);
+}
+
+/* Default PDO mapping and assignment from all TXPDO or RXPDO categories of the SII. */
+static void ec_sim_od_add_pdos(ec_sim_slave_t *s, uint16_t type, uint16_t assign_index)
+{
+    uint8_t *data;
+    uint32_t size;
+    uint32_t offset;
+    uint8_t assigned = 0;
+    uint8_t *entry;
+    uint8_t nentry;
+
+    ec_sim_od_set_u8(s, assign_index, 0, 0, false);
+
+    // one category for all PDOs or one per PDO
+    for (data = ec_sim_sii_category(s, type, &size); data; data = ec_sim_sii_next_category(s, type, data, &size)) {
+        for (offset = 0; (offset + 8) <= size; offset += 8 + nentry * 8) {
+            nentry = data[offset + 2];
+            if ((offset + 8 + nentry * 8) > size) {
+                break;
+            }
+
+            ec_sim_od_set_u8(s, EC_READ_U16(&data[offset]), 0, nentry, false);
+            for (uint8_t i = 0; i < nentry; i++) {
+                entry = &data[offset + 8 + i * 8];
+                ec_sim_od_set_u32(s, EC_READ_U16(&data[offset]), i + 1,
+                                  ((uint32_t)EC_READ_U16(entry) << 16) | ((uint32_t)entry[2] << 8) | entry[5],
+                                  false);
+            }
+
+            // PDOs with a sync manager are assigned by default
+            if (data[offset + 3] != 0xff) {
+                ec_sim_od_set_u16(s, assign_index, ++assigned, EC_READ_U16(&data[offset]), false);
+            }
+        }
+    }
+
+    ec_sim_od_set_u8(s, assign_index, 0, assigned, false);
+}
+
+static void ec_sim_od_init(ec_sim_slave_t *s)
+{
+    ec_sii_general_t *general;
+    const uint8_t *name = NULL;
+    uint32_t size;
+    uint8_t len = 0;
+
+    s->od_count = 0;
+    s->od_used = 0;
+
+    general = (ec_sii_general_t *)ec_sim_sii_category(s, EC_SII_TYPE_GENERAL, &size);
+    if (general && (size < sizeof(ec_sii_general_t))) {
+        general = NULL;
+    }
+
+    ec_sim_od_set_u32(s, 0x1000, 0, (general && general->ds402_channels) ? 0x00020192 : 0, true);
+
+    if (general) {
+        name = ec_sim_sii_string(s, general->nameidx, &len);
+    }
+    if (name) {
+        ec_sim_od_set(s, 0x1008, 0, name, len, true);
+    } else {
+        ec_sim_od_set(s, 0x1008, 0, "ec_sim", 6, true);
+    }
+
+    ec_sim_od_set_u8(s, 0x1018, 0, 4, true);
+    ec_sim_od_set_u32(s, 0x1018, 1, EC_READ_U32(&s->sii[EC_SII_ADDRESS_MANUF * 2]), true);
+    ec_sim_od_set_u32(s, 0x1018, 2, EC_READ_U32(&s->sii[EC_SII_ADDRESS_PRODUCTCODE * 2]), true);
+    ec_sim_od_set_u32(s, 0x1018, 3, EC_READ_U32(&s->sii[EC_SII_ADDRESS_REVISION * 2]), true);
+    ec_sim_od_set_u32(s, 0x1018, 4, EC_READ_U32(&s->sii[EC_SII_ADDRESS_SN * 2]), true);
+
+    ec_sim_od_set_u8(s, 0x1C00, 0, 4, true);
+    for (uint8_t i = 1; i <= 4; i++) {
+        ec_sim_od_set_u8(s, 0x1C00, i, i, true);
+    }
+
+    ec_sim_od_add_pdos(s, EC_SII_TYPE_RXPDO, 0x1C12);
+    ec_sim_od_add_pdos(s, EC_SII_TYPE_TXPDO, 0x1C13);
+}
+
+/* Size of the PDOs assigned in assign_index [byte], -1 if a mapping object is unknown. */
+static int32_t ec_sim_od_assign_size(ec_sim_slave_t *s, uint16_t assign_index)
+{
+    ec_sim_obj_t *assign;
+    ec_sim_obj_t *pdo;
+    ec_sim_obj_t *entries;
+    ec_sim_obj_t *entry;
+    uint32_t bits = 0;
+    uint16_t pdo_index;
+
+    assign = ec_sim_od_find(s, assign_index, 0);
+    if (!assign || !assign->size) {
+        return -1;
+    }
+
+    for (uint8_t i = 1; i <= s->od_pool[assign->offset]; i++) {
+        pdo = ec_sim_od_find(s, assign_index, i);
+        if (!pdo || (pdo->size < 2)) {
+            return -1;
+        }
+        pdo_index = EC_READ_U16(&s->od_pool[pdo->offset]);
+
+        entries = ec_sim_od_find(s, pdo_index, 0);
+        if (!entries || !entries->size) {
+            return -1;
+        }
+
+        for (uint8_t j = 1; j <= s->od_pool[entries->offset]; j++) {
+            entry = ec_sim_od_find(s, pdo_index, j);
+            if (!entry || !entry->size) {
+                return -1;
+            }
+            bits += s->od_pool[entry->offset]; // bit length in the low byte
+        }
+    }
+
+    return (bits + 7) / 8;
+}
+
+/*
+ * Sync managers
+ */
+
+static uint16_t ec_sim_sm_start(ec_sim_slave_t *s, uint8_t sm)
+{
+    return EC_READ_U16(&s->mem[EC_SIM_REG(SYNCM[sm].PHYSICAL_START_ADDR)]);
+}
+
+static uint16_t ec_sim_sm_length(ec_sim_slave_t *s, uint8_t sm)
+{
+    return EC_READ_U16(&s->mem[EC_SIM_REG(SYNCM[sm].LENGTH)]);
+}
+
+static bool ec_sim_sm_active(ec_sim_slave_t *s, uint8_t sm)
+{
+    return (s->mem[EC_SIM_REG(SYNCM[sm].ACTIVATE)] & 0x01) && ec_sim_sm_length(s, sm);
+}
+
+static uint8_t ec_sim_sm_mailbox(ec_sim_slave_t *s, uint8_t sm)
+{
+    uint8_t control = s->mem[EC_SIM_REG(SYNCM[sm].CONTROL)];
+
+    if (!ec_sim_sm_active(s, sm) || ((control & 0x03) != 0x02)) {
+        return EC_SIM_MBX_NONE;
+    }
+    return ((control & 0x0c) == 0x04) ? EC_SIM_MBX_WRITE : EC_SIM_MBX_READ;
+}
+
+static bool ec_sim_sm_covers(ec_sim_slave_t *s, uint16_t address, uint16_t len)
+{
+    uint16_t start;
+
+    for (uint8_t sm = 0; sm < 8; sm++) {
+        if (!ec_sim_sm_active(s, sm)) {
+            continue;
+        }
+        start = ec_sim_sm_start(s, sm);
+        if ((address >= start) && ((address + len) <= (start + ec_sim_sm_length(s, sm)))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Accesses outside of the mailbox sync managers skip the mailbox checks. */
+static bool ec_sim_mbx_sys_time(ec_sim_slave_t *s)
+{
+    return EC_SIM_TOUCHES(EC_SIM_REG(SYS_TIME), 8, s->mbx_start, s->mbx_end - s->mbx_start);
+}
+
+static void ec_sim_mbx_window_update(ec_sim_slave_t *s)
+{
+    uint32_t start;
+
+    if (ec_sim_mbx_sys_time(s)) {
+        g_sim_mbx_sys_time--;
+    }
+
+    s->mbx_start = 0;
+    s->mbx_end = 0;
+    for (uint8_t sm = 0; sm < 8; sm++) {
+        if (ec_sim_sm_mailbox(s, sm) == EC_SIM_MBX_NONE) {
+            continue;
+        }
+
+        start = ec_sim_sm_start(s, sm);
+        if (s->mbx_start == s->mbx_end) {
+            s->mbx_start = start;
+            s->mbx_end = start + ec_sim_sm_length(s, sm);
+        } else {
+            s->mbx_start = MIN(s->mbx_start, start);
+            s->mbx_end = MAX(s->mbx_end, start + ec_sim_sm_length(s, sm));
+        }
+    }
+
+    if (ec_sim_mbx_sys_time(s)) {
+        g_sim_mbx_sys_time++;
+    }
+}
+
+/* The FMMUs of a slave only work in SAFEOP and OP. */
+static bool ec_sim_fmmu_active(ec_sim_slave_t *s)
+{
+    uint8_t state = s->mem[EC_SIM_REG(AL_STAT)] & EC_SLAVE_STATE_MASK;
+
+    return (state == EC_SLAVE_STATE_SAFEOP) || (state == EC_SLAVE_STATE_OP);
+}
+
+static bool ec_sim_check_mbx_sm(ec_sim_slave_t *s, uint8_t sm, uint8_t type, uint16_t start, uint16_t len)
+{
+    return (ec_sim_sm_mailbox(s, sm) == type) &&
+           (ec_sim_sm_start(s, sm) == start) &&
+           (ec_sim_sm_length(s, sm) == len);
+}
+
+static uint16_t ec_sim_check_pd_sm(ec_sim_slave_t *s, uint8_t sm, uint16_t assign_index, uint16_t code)
+{
+    int32_t size = ec_sim_od_assign_size(s, assign_index);
+
+    if (size <= 0) {
+        return EC_ALSTATUSCODE_NOERROR;
+    }
+
+    if (!ec_sim_sm_active(s, sm) || (ec_sim_sm_length(s, sm) != size)) {
+        return code;
+    }
+    return EC_ALSTATUSCODE_NOERROR;
+}
+
+/*
+ * Distributed clocks
+ */
+
+static uint64_t ec_sim_local_time(ec_sim_slave_t *s, uint64_t t)
+{
+    int64_t dt = (int64_t)(t - s->anchor_time);
+    int64_t ppb = s->drift_ppb + s->corr_ppb;
+
+    if (dt > EC_SIM_ANCHOR_NS) {
+        s->anchor_local += dt + dt * ppb / 1000000000;
+        s->anchor_time = t;
+        dt = 0;
+    }
+
+    return s->anchor_local + dt + dt * ppb / 1000000000;
+}
+
+static void ec_sim_dc_latch(ec_sim_slave_t *s, uint64_t t_in, uint64_t t_return)
+{
+    uint64_t local_in = ec_sim_local_time(s, t_in);
+
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(RCV_TIME[0])], (uint32_t)local_in);
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(RCV_TIME[1])], (uint32_t)ec_sim_local_time(s, t_return));
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(RCV_TIME[2])], (uint32_t)local_in);
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(RCV_TIME[3])], (uint32_t)local_in);
+    EC_WRITE_U64(&s->mem[EC_SIM_REG(RCVT_ECAT_PU)], local_in);
+}
+
+/*
+ * A write to the system time compares it with the local copy. Like the control loop of an ESC,
+ * the local clock is steered by a part of the difference and its rate by the drift measured
+ * between the compares.
+ */
+static void ec_sim_dc_compare(ec_sim_slave_t *s, uint64_t received, bool dc64, uint64_t t)
+{
+    uint64_t system = ec_sim_local_time(s, t) + EC_READ_U64(&s->mem[EC_SIM_REG(SYS_TIME_OFFSET)]);
+    uint64_t reference = received + EC_READ_U32(&s->mem[EC_SIM_REG(SYS_TIME_DELAY)]);
+    int64_t diff;
+    uint64_t abs_diff;
+    int64_t ppb;
+
+    if (dc64) {
+        diff = (int64_t)(system - reference);
+    } else {
+        diff = (int32_t)((uint32_t)system - (uint32_t)reference);
+    }
+
+    abs_diff = (diff < 0) ? -diff : diff;
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(SYS_TIME_DIFF)],
+                 (uint32_t)MIN(abs_diff, 0x7fffffff) | ((diff < 0) ? 0x80000000 : 0));
+
+    if (s->compare_time) {
+        s->drift_sum += diff - s->residual;
+        s->drift_time += t - s->compare_time;
+
+        if (s->drift_time >= EC_SIM_RATE_MIN_NS) {
+            s->anchor_local = ec_sim_local_time(s, t);
+            s->anchor_time = t;
+
+            ppb = s->corr_ppb - s->drift_sum * 1000000000 / (int64_t)s->drift_time / 2;
+            s->corr_ppb = (int32_t)MAX(MIN(ppb, EC_SIM_MAX_CORR_PPB), -EC_SIM_MAX_CORR_PPB);
+            s->drift_sum = 0;
+            s->drift_time = 0;
+        }
+    }
+
+    s->compare_time = t;
+    s->anchor_local -= diff / 4;
+    s->residual = diff - diff / 4;
+}
+
+/* Runs the logged compares of a slave, before anything else sees its state. */
+static void ec_sim_dc_replay(uint32_t slave_index)
+{
+    ec_sim_slave_t *s = &g_sim_slaves[slave_index];
+    ec_sim_dc_event_t *e;
+
+    for (; s->dc_event < g_sim_dc_event_count; s->dc_event++) {
+        e = &g_sim_dc_events[s->dc_event];
+        if ((int32_t)slave_index == e->target) {
+            continue;
+        }
+        ec_sim_dc_compare(s, ((int32_t)slave_index < e->target) ? e->before : e->after, e->dc64,
+                          e->t0 + (uint64_t)(slave_index + 1) * e->hop_ns);
+    }
+}
+
+static void ec_sim_dc_flush(void)
+{
+    for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+        ec_sim_dc_replay(i);
+        g_sim_slaves[i].dc_event = 0;
+    }
+    g_sim_dc_event_count = 0;
+}
+
+/*
+ * AL state machine
+ */
+
+static void ec_sim_mbx_reset(ec_sim_slave_t *s)
+{
+    s->mbx_pending = false;
+    s->seg_obj = NULL;
+}
+
+static uint16_t ec_sim_al_transition(ec_sim_slave_t *s, uint8_t current, uint8_t requested)
+{
+    uint16_t protocols = ec_sim_sii_word(s, EC_SII_ADDRESS_MBXPROTO);
+    uint16_t code;
+
+    switch (requested) {
+        case EC_SLAVE_STATE_INIT:
+        case EC_SLAVE_STATE_PREOP:
+        case EC_SLAVE_STATE_BOOT:
+        case EC_SLAVE_STATE_SAFEOP:
+        case EC_SLAVE_STATE_OP:
+            break;
+        default:
+            return EC_ALSTATUSCODE_UNKNOWNALCONTROL;
+    }
+
+    if ((requested == current) || (requested == EC_SLAVE_STATE_INIT)) {
+        return EC_ALSTATUSCODE_NOERROR;
+    }
+
+    if (current == EC_SLAVE_STATE_BOOT) {
+        return EC_ALSTATUSCODE_INVALIDALCONTROL;
+    }
+
+    if (requested == EC_SLAVE_STATE_BOOT) {
+        if (current != EC_SLAVE_STATE_INIT) {
+            return EC_ALSTATUSCODE_INVALIDALCONTROL;
+        }
+        return (protocols & EC_MBXPROT_FOE) ? EC_ALSTATUSCODE_NOERROR : EC_ALSTATUSCODE_BOOTNOTSUPP;
+    }
+
+    if (requested < current) {
+        return EC_ALSTATUSCODE_NOERROR;
+    }
+
+    // up only one state at a time
+    if (requested != (current << 1)) {
+        return EC_ALSTATUSCODE_INVALIDALCONTROL;
+    }
+
+    if ((requested == EC_SLAVE_STATE_PREOP) && protocols) {
+        if (!ec_sim_check_mbx_sm(s, EC_SM_INDEX_MBX_WRITE, EC_SIM_MBX_WRITE,
+                                 ec_sim_sii_word(s, EC_SII_ADDRESS_RXMBXADR),
+                                 ec_sim_sii_word(s, EC_SII_ADDRESS_MBXSIZE)) ||
+            !ec_sim_check_mbx_sm(s, EC_SM_INDEX_MBX_READ, EC_SIM_MBX_READ,
+                                 ec_sim_sii_word(s, EC_SII_ADDRESS_TXMBXADR),
+                                 ec_sim_sii_word(s, EC_SII_ADDRESS_TXMBXADR + 1))) {
+            return EC_ALSTATUSCODE_INVALIDMBXCFGINPREOP;
+        }
+    }
+
+    if ((requested == EC_SLAVE_STATE_SAFEOP) && (protocols & EC_MBXPROT_COE)) {
+        code = ec_sim_check_pd_sm(s, EC_SM_INDEX_PROCESS_DATA_OUTPUT, 0x1C12, EC_ALSTATUSCODE_INVALIDSMOUTCFG);
+        if (code == EC_ALSTATUSCODE_NOERROR) {
+            code = ec_sim_check_pd_sm(s, EC_SM_INDEX_PROCESS_DATA_INPUT, 0x1C13, EC_ALSTATUSCODE_INVALIDSMINCFG);
+        }
+        return code;
+    }
+
+    return EC_ALSTATUSCODE_NOERROR;
+}
+
+static void ec_sim_al_control(ec_sim_slave_t *s)
+{
+    uint16_t control = EC_READ_U16(&s->mem[EC_SIM_REG(AL_CTRL)]);
+    uint16_t status = EC_READ_U16(&s->mem[EC_SIM_REG(AL_STAT)]);
+    uint8_t current = status & EC_SLAVE_STATE_MASK;
+    uint8_t requested = control & EC_SLAVE_STATE_MASK;
+    uint16_t code;
+
+    // a pending error has to be acknowledged first
+    if (status & EC_SLAVE_STATE_ACK_ERR) {
+        if (!(control & EC_SLAVE_STATE_ACK_ERR)) {
+            return;
+        }
+        status &= ~EC_SLAVE_STATE_ACK_ERR;
+        EC_WRITE_U16(&s->mem[EC_SIM_REG(AL_STAT_CODE)], EC_ALSTATUSCODE_NOERROR);
+    }
+
+    code = ec_sim_al_transition(s, current, requested);
+    if (code != EC_ALSTATUSCODE_NOERROR) {
+        EC_WRITE_U16(&s->mem[EC_SIM_REG(AL_STAT)], current | EC_SLAVE_STATE_ACK_ERR);
+        EC_WRITE_U16(&s->mem[EC_SIM_REG(AL_STAT_CODE)], code);
+        return;
+    }
+
+    if ((requested == EC_SLAVE_STATE_INIT) || (requested == EC_SLAVE_STATE_BOOT)) {
+        ec_sim_mbx_reset(s);
+    }
+    EC_WRITE_U16(&s->mem[EC_SIM_REG(AL_STAT)], requested);
+}
+
+/*
+ * EEPROM, commands execute at once
+ */
+
+static void ec_sim_eeprom_command(ec_sim_slave_t *s)
+{
+    uint16_t control = EC_READ_U16(&s->mem[EC_SIM_REG(EEPROM_CTRL_STAT)]);
+    uint32_t word = EC_READ_U32(&s->mem[EC_SIM_REG(EEPROM_ADDR)]);
+    uint8_t command = ESC_EEPROM_CTRL_STAT_CMD_GET(control);
+
+    control &= ~(ESC_EEPROM_CTRL_STAT_CMD_MASK | ESC_EEPROM_CTRL_STAT_BUSY_MASK |
+                 ESC_EEPROM_CTRL_STAT_ERR_WEN_MASK | ESC_EEPROM_CTRL_STAT_ERR_ACK_CMD_MASK);
+
+    switch (command) {
+        case 0x01: // read
+            EC_WRITE_U16(&s->mem[EC_SIM_REG(EEPROM_DATA)], ec_sim_sii_word(s, word));
+            EC_WRITE_U16(&s->mem[EC_SIM_REG(EEPROM_DATA) + 2], ec_sim_sii_word(s, word + 1));
+            break;
+        case 0x02: // write
+            if (!(control & 0x0001)) {
+                control |= ESC_EEPROM_CTRL_STAT_ERR_WEN_MASK;
+            } else if ((word * 2 + 2) <= s->sii_size) {
+                EC_WRITE_U16(&s->sii[word * 2], EC_READ_U16(&s->mem[EC_SIM_REG(EEPROM_DATA)]));
+            }
+            control &= ~0x0001; // write enable clears itself
+            break;
+        default: // reload
+            break;
+    }
+
+    EC_WRITE_U16(&s->mem[EC_SIM_REG(EEPROM_CTRL_STAT)], control);
+}
+
+/*
+ * Mailbox and CoE server
+ */
+
+static uint16_t ec_sim_sdo_abort(uint8_t *resp, uint16_t index, uint8_t subindex, uint32_t code)
+{
+    EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_REQUEST << 12);
+    EC_WRITE_U8(resp + 2, EC_COE_REQUEST_ABORT << 5);
+    EC_WRITE_U16(resp + 3, index);
+    EC_WRITE_U8(resp + 5, subindex);
+    EC_WRITE_U32(resp + 6, code);
+    return 10;
+}
+
+static uint32_t ec_sim_sdo_check_write(ec_sim_slave_t *s, uint16_t index, uint8_t subindex)
+{
+    ec_sim_obj_t *obj = ec_sim_od_find(s, index, subindex);
+    ec_sim_obj_t *count;
+
+    if (obj && obj->read_only) {
+        return 0x06010002;
+    }
+
+    // PDO assignment and mapping
+    if ((index == 0x1C12) || (index == 0x1C13) ||
+        ((index >= 0x1600) && (index < 0x1800)) || ((index >= 0x1A00) && (index < 0x1C00))) {
+        if ((s->mem[EC_SIM_REG(AL_STAT)] & EC_SLAVE_STATE_MASK) != EC_SLAVE_STATE_PREOP) {
+            return 0x08000022;
+        }
+
+        count = ec_sim_od_find(s, index, 0);
+        if (subindex && count && count->size && s->od_pool[count->offset]) {
+            return 0x06010003;
+        }
+    }
+
+    return 0;
+}
+
+/* Complete access download from subindex 0: SI0 padded to 16 bit, then every subindex with the
+ * size it already has, 16 bit in the PDO assignment and 32 bit elsewhere for new ones. */
+static uint32_t ec_sim_sdo_download_complete(ec_sim_slave_t *s, uint16_t index, const uint8_t *data, uint32_t size)
+{
+    ec_sim_obj_t *obj;
+    uint32_t offset = 2;
+    uint32_t entry_size;
+    uint32_t code;
+    uint8_t count;
+
+    if (size < 2) {
+        return 0x06070013;
+    }
+
+    code = ec_sim_sdo_check_write(s, index, 0);
+    if (code) {
+        return code;
+    }
+
+    count = data[0];
+    for (uint8_t i = 1; i <= count; i++) {
+        obj = ec_sim_od_find(s, index, i);
+        entry_size = (obj && obj->size) ? obj->size : (((index & 0xFFF0) == 0x1C10) ? 2 : 4);
+        if ((offset + entry_size) > size) {
+            return 0x06070013;
+        }
+
+        ec_sim_od_set(s, index, i, &data[offset], entry_size, false);
+        offset += entry_size;
+    }
+    ec_sim_od_set_u8(s, index, 0, count, false);
+
+    return 0;
+}
+
+static uint16_t ec_sim_sdo(ec_sim_slave_t *s, const uint8_t *req, uint16_t req_len, uint8_t *resp, uint16_t resp_max)
+{
+    uint8_t header = EC_READ_U8(req + 2);
+    uint16_t index = EC_READ_U16(req + 3);
+    uint8_t subindex = EC_READ_U8(req + 5);
+    ec_sim_obj_t *obj;
+    const uint8_t *data;
+    uint32_t total;
+    uint32_t size;
+    uint32_t code;
+    uint8_t toggle;
+    bool last;
+
+    if (req_len < 10) {
+        return ec_sim_sdo_abort(resp, index, subindex, 0x05040001);
+    }
+
+    switch (header >> 5) {
+        case EC_COE_REQUEST_DOWNLOAD:
+            if (header & 0x02) {
+                total = (header & 0x01) ? (4 - ((header >> 2) & 0x03)) : 4;
+                size = total;
+                data = req + 6;
+            } else {
+                total = EC_READ_U32(req + 6);
+                size = MIN((uint32_t)(req_len - 10), total);
+                data = req + 10;
+            }
+
+            // complete access only without segments
+            if (header & 0x10) {
+                code = (subindex || (size < total)) ? 0x06010000 : ec_sim_sdo_download_complete(s, index, data, size);
+                if (code) {
+                    return ec_sim_sdo_abort(resp, index, subindex, code);
+                }
+
+                EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_RESPONSE << 12);
+                EC_WRITE_U8(resp + 2, (EC_COE_RESPONSE_DOWNLOAD << 5) | 0x10);
+                EC_WRITE_U16(resp + 3, index);
+                EC_WRITE_U8(resp + 5, subindex);
+                return 10;
+            }
+
+            code = ec_sim_sdo_check_write(s, index, subindex);
+            if (code) {
+                return ec_sim_sdo_abort(resp, index, subindex, code);
+            }
+
+            obj = (total <= 0xffff) ? ec_sim_od_add(s, index, subindex, total) : NULL;
+            if (!obj) {
+                return ec_sim_sdo_abort(resp, index, subindex, 0x05040005);
+            }
+
+            memcpy(&s->od_pool[obj->offset], data, size);
+            obj->size = total;
+
+            s->seg_obj = NULL;
+            if (size < total) {
+                s->seg_obj = obj;
+                s->seg_offset = size;
+                s->seg_toggle = 0;
+                s->seg_upload = false;
+            }
+
+            EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_RESPONSE << 12);
+            EC_WRITE_U8(resp + 2, EC_COE_RESPONSE_DOWNLOAD << 5);
+            EC_WRITE_U16(resp + 3, index);
+            EC_WRITE_U8(resp + 5, subindex);
+            return 10;
+
+        case EC_COE_REQUEST_SEGMENT_DOWNLOAD:
+            obj = s->seg_obj;
+            if (!obj || s->seg_upload) {
+                return ec_sim_sdo_abort(resp, 0, 0, 0x05040001);
+            }
+
+            toggle = (header >> 4) & 0x01;
+            if (toggle != s->seg_toggle) {
+                s->seg_obj = NULL;
+                return ec_sim_sdo_abort(resp, obj->index, obj->subindex, 0x05030000);
+            }
+
+            size = (req_len == 10) ? (7 - ((header >> 1) & 0x07)) : (uint32_t)(req_len - 3);
+            size = MIN(size, obj->size - s->seg_offset);
+            memcpy(&s->od_pool[obj->offset + s->seg_offset], req + 3, size);
+            s->seg_offset += size;
+            s->seg_toggle ^= 1;
+
+            if ((header & 0x01) || (s->seg_offset >= obj->size)) {
+                s->seg_obj = NULL;
+            }
+
+            EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_RESPONSE << 12);
+            EC_WRITE_U8(resp + 2, (EC_COE_RESPONSE_SEGMENT_DOWNLOAD << 5) | (toggle << 4));
+            return 10;
+
+        case EC_COE_REQUEST_UPLOAD:
+            if (header & 0x10) {
+                return ec_sim_sdo_abort(resp, index, subindex, 0x06010000);
+            }
+
+            obj = ec_sim_od_find(s, index, subindex);
+            if (!obj) {
+                return ec_sim_sdo_abort(resp, index, subindex,
+                                        ec_sim_od_has_index(s, index) ? 0x06090011 : 0x06020000);
+            }
+
+            s->seg_obj = NULL;
+            EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_RESPONSE << 12);
+            EC_WRITE_U16(resp + 3, index);
+            EC_WRITE_U8(resp + 5, subindex);
+
+            if (obj->size <= 4) {
+                EC_WRITE_U8(resp + 2, (EC_COE_RESPONSE_UPLOAD << 5) | ((4 - obj->size) << 2) | 0x03);
+                memcpy(resp + 6, &s->od_pool[obj->offset], obj->size);
+                return 10;
+            }
+
+            size = MIN(obj->size, (uint32_t)(resp_max - 10));
+            EC_WRITE_U8(resp + 2, (EC_COE_RESPONSE_UPLOAD << 5) | 0x01);
+            EC_WRITE_U32(resp + 6, obj->size);
+            memcpy(resp + 10, &s->od_pool[obj->offset], size);
+
+            if (size < obj->size) {
+                s->seg_obj = obj;
+                s->seg_offset = size;
+                s->seg_toggle = 0;
+                s->seg_upload = true;
+            }
+            return 10 + size;
+
+        case EC_COE_REQUEST_SEGMENT_UPLOAD:
+            obj = s->seg_obj;
+            if (!obj || !s->seg_upload) {
+                return ec_sim_sdo_abort(resp, 0, 0, 0x05040001);
+            }
+
+            toggle = (header >> 4) & 0x01;
+            if (toggle != s->seg_toggle) {
+                s->seg_obj = NULL;
+                return ec_sim_sdo_abort(resp, obj->index, obj->subindex, 0x05030000);
+            }
+
+            size = MIN(obj->size - s->seg_offset, (uint32_t)(resp_max - 3));
+            last = (s->seg_offset + size) >= obj->size;
+
+            EC_WRITE_U16(resp, EC_COE_SERVICE_SDO_RESPONSE << 12);
+            EC_WRITE_U8(resp + 2, (EC_COE_RESPONSE_SEGMENT_UPLOAD << 5) | (toggle << 4) | (last ? 0x01 : 0x00));
+            memcpy(resp + 3, &s->od_pool[obj->offset + s->seg_offset], size);
+            s->seg_offset += size;
+            s->seg_toggle ^= 1;
+
+            if (last) {
+                s->seg_obj = NULL;
+            }
+
+            // segments are at least 7 bytes long
+            if (size < 7) {
+                resp[2] |= (7 - size) << 1;
+                return 10;
+            }
+            return 3 + size;
+
+        case EC_COE_REQUEST_ABORT:
+            s->seg_obj = NULL;
+            return 0;
+
+        default:
+            return ec_sim_sdo_abort(resp, index, subindex, 0x05040001);
+    }
+}
+
+static void ec_sim_mbx_error(uint8_t *resp, uint16_t code)
+{
+    EC_WRITE_U16(resp, 0x01);
+    EC_WRITE_U16(resp + 2, code);
+}
+
+/* Serves the request in the write mailbox once the master has read the last response. */
+static void ec_sim_mbx_request(ec_sim_slave_t *s)
+{
+    uint8_t *status_in = &s->mem[EC_SIM_REG(SYNCM[EC_SM_INDEX_MBX_WRITE].STATUS)];
+    uint8_t *status_out = &s->mem[EC_SIM_REG(SYNCM[EC_SM_INDEX_MBX_READ].STATUS)];
+    uint16_t in_size = ec_sim_sm_length(s, EC_SM_INDEX_MBX_WRITE);
+    uint16_t out_size = ec_sim_sm_length(s, EC_SM_INDEX_MBX_READ);
+    uint16_t protocols = ec_sim_sii_word(s, EC_SII_ADDRESS_MBXPROTO);
+    uint8_t *req;
+    uint8_t *resp;
+    uint16_t req_len;
+    uint16_t resp_len;
+    uint8_t type;
+
+    if (!(*status_in & EC_SIM_SM_STATUS_FULL)) {
+        return;
+    }
+
+    if ((*status_out & EC_SIM_SM_STATUS_FULL) || (ec_sim_sm_mailbox(s, EC_SM_INDEX_MBX_READ) != EC_SIM_MBX_READ)) {
+        s->mbx_pending = true;
+        return;
+    }
+
+    s->mbx_pending = false;
+    *status_in &= ~EC_SIM_SM_STATUS_FULL;
+
+    if ((in_size <= EC_MBOX_HEADER_SIZE) || (out_size <= (EC_MBOX_HEADER_SIZE + 10))) {
+        return;
+    }
+
+    req = &s->mem[ec_sim_sm_start(s, EC_SM_INDEX_MBX_WRITE)];
+    resp = &s->mem[ec_sim_sm_start(s, EC_SM_INDEX_MBX_READ)];
+    req_len = MIN(EC_READ_U16(req), in_size - EC_MBOX_HEADER_SIZE);
+    type = EC_READ_U8(req + 5) & 0x0f;
+
+    memset(resp, 0, out_size);
+
+    if ((type != EC_MBOX_TYPE_COE) || !(protocols & EC_MBXPROT_COE)) {
+        ec_sim_mbx_error(resp + EC_MBOX_HEADER_SIZE, EC_MBXERR_UNSUPPORTEDPROTOCOL);
+        resp_len = 4;
+        type = 0;
+    } else if (req_len < 3) {
+        ec_sim_mbx_error(resp + EC_MBOX_HEADER_SIZE, EC_MBXERR_SIZETOOSHORT);
+        resp_len = 4;
+        type = 0;
+    } else if ((EC_READ_U16(req + EC_MBOX_HEADER_SIZE) >> 12) != EC_COE_SERVICE_SDO_REQUEST) {
+        ec_sim_mbx_error(resp + EC_MBOX_HEADER_SIZE, EC_MBXERR_SERVICENOTSUPPORTED);
+        resp_len = 4;
+        type = 0;
+    } else {
+        resp_len = ec_sim_sdo(s, req + EC_MBOX_HEADER_SIZE, req_len,
+                              resp + EC_MBOX_HEADER_SIZE, out_size - EC_MBOX_HEADER_SIZE);
+    }
+
+    if (!resp_len) {
+        return;
+    }
+
+    EC_WRITE_U16(resp, resp_len);
+    EC_WRITE_U16(resp + 2, EC_READ_U16(&s->mem[EC_SIM_REG(STATION_ADDR)]));
+    EC_WRITE_U8(resp + 4, 0);
+    EC_WRITE_U8(resp + 5, type);
+    *status_out |= EC_SIM_SM_STATUS_FULL;
+}
+
+/*
+ * Register access
+ */
+
+static inline bool ec_sim_reg_writable(uint16_t address)
+{
+    if (address >= 0x1000) {
+        return true;
+    }
+
+    if ((address < EC_SIM_REG(STATION_ADDR)) ||
+        ((address >= EC_SIM_REG(ESC_DL_STAT)) && (address < EC_SIM_REG(AL_CTRL))) ||
+        ((address >= EC_SIM_REG(AL_STAT)) && (address < EC_SIM_REG(PDI_CTRL))) ||
+        ((address >= EC_SIM_REG(RCV_TIME[0])) && (address < EC_SIM_REG(SYS_TIME_OFFSET))) ||
+        ((address >= EC_SIM_REG(SYS_TIME_DIFF)) && (address < EC_SIM_REG(SPD_CNT_START)))) {
+        return false;
+    }
+
+    // sync manager status
+    if ((address >= EC_SIM_REG(SYNCM[0])) && (address < EC_SIM_REG(RESERVED26)) &&
+        ((address & 0x07) == 0x05)) {
+        return false;
+    }
+
+    return true;
+}
+
+static void ec_sim_sys_time_write(ec_sim_slave_t *s, uint16_t ado, const uint8_t *data, uint16_t len, uint64_t t_in)
+{
+    uint16_t sys_time = EC_SIM_REG(SYS_TIME);
+
+    if ((ado <= sys_time) && ((ado + len) >= (sys_time + 4))) {
+        if ((ado + len) >= (sys_time + 8)) {
+            ec_sim_dc_compare(s, EC_READ_U64(data + sys_time - ado), true, t_in);
+        } else {
+            ec_sim_dc_compare(s, EC_READ_U32(data + sys_time - ado), false, t_in);
+        }
+    }
+}
+
+static void ec_sim_reg_write(uint32_t slave_index, uint16_t ado, const uint8_t *data, uint16_t len, uint64_t t0)
+{
+    ec_sim_slave_t *s = &g_sim_slaves[slave_index];
+    uint64_t t_in = t0 + (uint64_t)(slave_index + 1) * g_sim_hop_ns;
+    uint64_t t_return = t0 + (uint64_t)(2 * g_sim_slave_count - 1 - slave_index) * g_sim_hop_ns;
+    uint16_t sys_time = EC_SIM_REG(SYS_TIME);
+    bool active;
+
+    if (ado >= 0x1000) {
+        memcpy(&s->mem[ado], data, len);
+        return;
+    }
+
+    // the system time is read only, e.g. the FRMW of the reference clock only compares it
+    if ((ado >= sys_time) && ((ado + len) <= (sys_time + 8))) {
+        ec_sim_sys_time_write(s, ado, data, len, t_in);
+        return;
+    }
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (ec_sim_reg_writable(ado + i)) {
+            s->mem[ado + i] = data[i];
+        }
+    }
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(STATION_ADDR), 2)) {
+        g_sim_station_dirty = true;
+    }
+
+    // the FMMU map only holds the slaves in SAFEOP and OP
+    active = ec_sim_fmmu_active(s);
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(AL_CTRL), 2)) {
+        ec_sim_al_control(s);
+        if (ec_sim_fmmu_active(s) != active) {
+            g_sim_fmmu_dirty = true;
+        }
+    }
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(FMMU[0]), EC_SIM_REG(RESERVED25) - EC_SIM_REG(FMMU[0])) && active) {
+        g_sim_fmmu_dirty = true;
+    }
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(SYNCM[0]), EC_SIM_REG(RESERVED26) - EC_SIM_REG(SYNCM[0]))) {
+        ec_sim_mbx_window_update(s);
+        if (active) {
+            g_sim_fmmu_dirty = true;
+        }
+    }
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(EEPROM_CTRL_STAT), 2)) {
+        ec_sim_eeprom_command(s);
+    }
+
+    // a new configuration of a sync manager empties its buffer
+    for (uint8_t sm = 0; sm < 8; sm++) {
+        if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(SYNCM[sm]), 8)) {
+            s->mem[EC_SIM_REG(SYNCM[sm].STATUS)] = 0;
+            if (sm <= EC_SM_INDEX_MBX_READ) {
+                ec_sim_mbx_reset(s);
+            }
+        }
+    }
+
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(RCV_TIME[0]), 4)) {
+        ec_sim_dc_latch(s, t_in, (slave_index == g_sim_slave_count - 1) ? t_in : t_return);
+    }
+
+    ec_sim_sys_time_write(s, ado, data, len, t_in);
+
+    // a new offset is a step of the system time, no drift
+    if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(SYS_TIME_OFFSET), 8)) {
+        s->compare_time = 0;
+        s->drift_sum = 0;
+        s->drift_time = 0;
+    }
+}
+
+static uint16_t ec_sim_reg_access(uint32_t slave_index, uint8_t access, uint16_t ado, uint8_t *data, uint16_t len, uint64_t t0)
+{
+    ec_sim_slave_t *s = &g_sim_slaves[slave_index];
+    uint8_t mailbox[8];
+    uint8_t tmp[EC_MAX_DATA_SIZE];
+    const uint8_t *src = NULL;
+    uint16_t start;
+    uint16_t wc = 0;
+    bool mbx;
+
+    if (((uint32_t)ado + len) > EC_SIM_MEM_SIZE) {
+        return 0;
+    }
+
+    ec_sim_dc_replay(slave_index);
+
+    // no access to a full write or an empty read mailbox
+    mbx = EC_SIM_TOUCHES(ado, len, s->mbx_start, s->mbx_end - s->mbx_start);
+    for (uint8_t sm = 0; mbx && (sm < 8); sm++) {
+        mailbox[sm] = ec_sim_sm_mailbox(s, sm);
+        if ((mailbox[sm] == EC_SIM_MBX_NONE) ||
+            !EC_SIM_TOUCHES(ado, len, ec_sim_sm_start(s, sm), ec_sim_sm_length(s, sm))) {
+            mailbox[sm] = EC_SIM_MBX_NONE;
+            continue;
+        }
+
+        if ((mailbox[sm] == EC_SIM_MBX_WRITE) && (access & EC_SIM_ACCESS_WRITE) &&
+            (s->mem[EC_SIM_REG(SYNCM[sm].STATUS)] & EC_SIM_SM_STATUS_FULL)) {
+            return 0;
+        }
+        if ((mailbox[sm] == EC_SIM_MBX_READ) && (access & EC_SIM_ACCESS_READ) &&
+            !(s->mem[EC_SIM_REG(SYNCM[sm].STATUS)] & EC_SIM_SM_STATUS_FULL)) {
+            return 0;
+        }
+    }
+
+    if (access & EC_SIM_ACCESS_READ) {
+        if (EC_SIM_TOUCHES(ado, len, EC_SIM_REG(SYS_TIME), 8)) {
+            EC_WRITE_U64(&s->mem[EC_SIM_REG(SYS_TIME)],
+                         ec_sim_local_time(s, t0 + (uint64_t)(slave_index + 1) * g_sim_hop_ns) +
+                             EC_READ_U64(&s->mem[EC_SIM_REG(SYS_TIME_OFFSET)]));
+        }
+
+        src = &s->mem[ado];
+        if (access & EC_SIM_ACCESS_WRITE) {
+            memcpy(tmp, src, len);
+            src = tmp;
+        }
+    }
+
+    if (access & EC_SIM_ACCESS_WRITE) {
+        ec_sim_reg_write(slave_index, ado, data, len, t0);
+        wc += (access & EC_SIM_ACCESS_READ) ? 2 : 1;
+    }
+
+    if (access & EC_SIM_ACCESS_READ) {
+        if (access & EC_SIM_ACCESS_OR) {
+            for (uint16_t i = 0; i < len; i++) {
+                data[i] |= src[i];
+            }
+        } else {
+            memcpy(data, src, len);
+        }
+        wc += 1;
+    }
+
+    // accesses up to the last byte of a mailbox switch its buffer
+    for (uint8_t sm = 0; mbx && (sm < 8); sm++) {
+        if (mailbox[sm] == EC_SIM_MBX_NONE) {
+            continue;
+        }
+
+        start = ec_sim_sm_start(s, sm);
+        if ((ado + len) < (start + ec_sim_sm_length(s, sm))) {
+            continue;
+        }
+
+        if ((mailbox[sm] == EC_SIM_MBX_WRITE) && (access & EC_SIM_ACCESS_WRITE)) {
+            s->mem[EC_SIM_REG(SYNCM[sm].STATUS)] |= EC_SIM_SM_STATUS_FULL;
+            ec_sim_mbx_request(s);
+        } else if ((mailbox[sm] == EC_SIM_MBX_READ) && (access & EC_SIM_ACCESS_READ)) {
+            s->mem[EC_SIM_REG(SYNCM[sm].STATUS)] &= ~EC_SIM_SM_STATUS_FULL;
+            if (s->mbx_pending) {
+                ec_sim_mbx_request(s);
+            }
+        }
+    }
+
+    return wc;
+}
+
+/*
+ * Logical access through the FMMUs
+ */
+
+static void ec_sim_run_app(ec_sim_slave_t *s, uint32_t slave_index)
+{
+    uint8_t *output = NULL;
+    uint8_t *input = NULL;
+    uint32_t output_size = 0;
+    uint32_t input_size = 0;
+
+    if (ec_sim_sm_active(s, EC_SM_INDEX_PROCESS_DATA_OUTPUT)) {
+        output = &s->mem[ec_sim_sm_start(s, EC_SM_INDEX_PROCESS_DATA_OUTPUT)];
+        output_size = ec_sim_sm_length(s, EC_SM_INDEX_PROCESS_DATA_OUTPUT);
+    }
+    if (ec_sim_sm_active(s, EC_SM_INDEX_PROCESS_DATA_INPUT)) {
+        input = &s->mem[ec_sim_sm_start(s, EC_SM_INDEX_PROCESS_DATA_INPUT)];
+        input_size = ec_sim_sm_length(s, EC_SM_INDEX_PROCESS_DATA_INPUT);
+    }
+
+    if ((output && (ec_sim_sm_start(s, EC_SM_INDEX_PROCESS_DATA_OUTPUT) + output_size > EC_SIM_MEM_SIZE)) ||
+        (input && (ec_sim_sm_start(s, EC_SM_INDEX_PROCESS_DATA_INPUT) + input_size > EC_SIM_MEM_SIZE))) {
+        return;
+    }
+
+    g_sim_app_cb(slave_index, output, output_size, input, input_size, g_sim_app_arg);
+}
+
+/* Rebuilds the map of the enabled FMMUs, in the order of the line, after the FMMUs, sync managers or states changed. */
+static void ec_sim_fmmu_map_update(void)
+{
+    ec_sim_slave_t *s;
+    ec_sim_fmmu_t *entry;
+    uint8_t *fmmu;
+
+    g_sim_fmmu_count = 0;
+    g_sim_span_count = 0;
+    g_sim_span_next = 0;
+    g_sim_fmmu_dirty = false;
+
+    for (uint32_t slave_index = 0; slave_index < g_sim_slave_count; slave_index++) {
+        s = &g_sim_slaves[slave_index];
+        if (!ec_sim_fmmu_active(s)) {
+            continue;
+        }
+
+        for (uint8_t i = 0; i < 8; i++) {
+            fmmu = &s->mem[EC_SIM_REG(FMMU[i])];
+            if (!(fmmu[12] & 0x01)) {
+                continue;
+            }
+
+            entry = &g_sim_fmmu_map[g_sim_fmmu_count++];
+            entry->logical = EC_READ_U32(fmmu);
+            entry->slave_index = slave_index;
+            entry->length = EC_READ_U16(fmmu + 4);
+            entry->physical = EC_READ_U16(fmmu + 8);
+            entry->type = fmmu[11] & 0x03;
+            entry->covered = ((uint32_t)entry->physical + entry->length <= EC_SIM_MEM_SIZE) &&
+                            ec_sim_sm_covers(s, entry->physical, entry->length);
+        }
+    }
+}
+
+/* The cyclic datagrams repeat, so the part of the map they hit is looked up once. */
+static ec_sim_span_t *ec_sim_fmmu_span(uint32_t laddr, uint16_t len)
+{
+    ec_sim_span_t *span;
+    ec_sim_fmmu_t *entry;
+
+    if (g_sim_fmmu_dirty) {
+        ec_sim_fmmu_map_update();
+    }
+
+    for (uint32_t i = 0; i < g_sim_span_count; i++) {
+        if ((g_sim_spans[i].laddr == laddr) && (g_sim_spans[i].len == len)) {
+            return &g_sim_spans[i];
+        }
+    }
+
+    if (g_sim_span_count < EC_SIM_SPAN_CACHE) {
+        span = &g_sim_spans[g_sim_span_count++];
+    } else {
+        span = &g_sim_spans[g_sim_span_next];
+        g_sim_span_next = (g_sim_span_next + 1) % EC_SIM_SPAN_CACHE;
+    }
+
+    span->laddr = laddr;
+    span->len = len;
+    span->first = g_sim_fmmu_count;
+    span->last = 0;
+    for (uint32_t i = 0; i < g_sim_fmmu_count; i++) {
+        entry = &g_sim_fmmu_map[i];
+        if ((entry->logical < laddr + len) && (laddr < entry->logical + entry->length)) {
+            span->first = MIN(span->first, i);
+            span->last = i + 1;
+        }
+    }
+    if (span->first > span->last) {
+        span->first = span->last;
+    }
+    return span;
+}
+
+/* Part of the entry inside the datagram, false if the slave cannot reach it through a sync manager. */
+static bool ec_sim_fmmu_clip(ec_sim_slave_t *s, const ec_sim_fmmu_t *entry, uint32_t laddr, uint16_t len,
+                             uint32_t *start, uint32_t *end, uint16_t *physical)
+{
+    *start = MAX(entry->logical, laddr);
+    *end = MIN(entry->logical + entry->length, laddr + len);
+    if (*start >= *end) {
+        return false;
+    }
+
+    *physical = entry->physical + (*start - entry->logical);
+    if (entry->covered) {
+        return true;
+    }
+    return ((uint32_t)*physical + (*end - *start) <= EC_SIM_MEM_SIZE) && ec_sim_sm_covers(s, *physical, *end - *start);
+}
+
+static uint16_t ec_sim_logical(uint8_t cmd, uint32_t laddr, uint8_t *data, uint16_t len)
+{
+    ec_sim_span_t *span = ec_sim_fmmu_span(laddr, len);
+    ec_sim_fmmu_t *entry;
+    ec_sim_slave_t *s;
+    uint32_t slave_index;
+    uint32_t first;
+    uint32_t last;
+    uint32_t start;
+    uint32_t end;
+    uint16_t physical;
+    uint16_t wc = 0;
+    bool read;
+    bool write;
+    bool hit;
+
+    for (first = span->first; first < span->last; first = last) {
+        slave_index = g_sim_fmmu_map[first].slave_index;
+        s = &g_sim_slaves[slave_index];
+        last = first + 1;
+        while ((last < span->last) && (g_sim_fmmu_map[last].slave_index == slave_index)) {
+            last++;
+        }
+
+        read = false;
+        write = false;
+        hit = false;
+
+        // writes first, a LRW through a read and a write FMMU of one slave sees the data of the master
+        for (uint32_t i = first; i < last; i++) {
+            entry = &g_sim_fmmu_map[i];
+            if (!ec_sim_fmmu_clip(s, entry, laddr, len, &start, &end, &physical)) {
+                continue;
+            }
+
+            hit = true;
+            if ((entry->type & 0x02) && (cmd != EC_DATAGRAM_LRD)) {
+                memcpy(&s->mem[physical], data + (start - laddr), end - start);
+                write = true;
+            }
+        }
+
+        if (hit && ((s->mem[EC_SIM_REG(AL_STAT)] & EC_SLAVE_STATE_MASK) == EC_SLAVE_STATE_OP)) {
+            ec_sim_run_app(s, slave_index);
+        }
+
+        for (uint32_t i = first; (i < last) && (cmd != EC_DATAGRAM_LWR); i++) {
+            entry = &g_sim_fmmu_map[i];
+            if (!(entry->type & 0x01) || !ec_sim_fmmu_clip(s, entry, laddr, len, &start, &end, &physical)) {
+                continue;
+            }
+
+            memcpy(data + (start - laddr), &s->mem[physical], end - start);
+            read = true;
+        }
+
+        if (write) {
+            wc += (cmd == EC_DATAGRAM_LRW) ? 2 : 1;
+        }
+        if (read) {
+            wc += 1;
+        }
+    }
+
+    return wc;
+}
+
+/*
+ * Frame processing
+ */
+
+static int32_t ec_sim_station_lookup(uint16_t station)
+{
+    if (g_sim_station_dirty) {
+        memset(g_sim_station_map, 0xff, sizeof(g_sim_station_map));
+        // the first slave in the line wins on duplicate addresses
+        for (uint32_t i = g_sim_slave_count; i > 0; i--) {
+            g_sim_station_map[EC_READ_U16(&g_sim_slaves[i - 1].mem[EC_SIM_REG(STATION_ADDR)])] = i - 1;
+        }
+        g_sim_station_dirty = false;
+    }
+
+    return g_sim_station_map[station];
+}
+
+/*
+ * A FRMW/ARMW that only passes the system time costs one read of the reference clock. The other
+ * slaves log their compare and replay it on their next access, in the same order as without the log.
+ */
+static bool ec_sim_dc_defer(uint16_t ado, uint8_t *data, uint16_t len, int32_t target, uint64_t t0, uint16_t *wc)
+{
+    uint16_t sys_time = EC_SIM_REG(SYS_TIME);
+    ec_sim_dc_event_t *e = NULL;
+
+    if ((ado < sys_time) || ((ado + len) > (sys_time + 8)) || g_sim_mbx_sys_time) {
+        return false;
+    }
+
+    if ((ado == sys_time) && (len >= 4)) {
+        if (g_sim_dc_event_count == EC_SIM_DC_EVENTS) {
+            ec_sim_dc_flush();
+        }
+        e = &g_sim_dc_events[g_sim_dc_event_count];
+        e->dc64 = (len >= 8);
+        e->before = e->dc64 ? EC_READ_U64(data) : EC_READ_U32(data);
+    }
+
+    *wc = g_sim_slave_count;
+    if (target >= 0) {
+        *wc += ec_sim_reg_access(target, EC_SIM_ACCESS_READ, ado, data, len, t0) - 1;
+    }
+
+    if (e) {
+        e->after = e->dc64 ? EC_READ_U64(data) : EC_READ_U32(data);
+        e->t0 = t0;
+        e->target = target;
+        e->hop_ns = g_sim_hop_ns;
+        g_sim_dc_event_count++;
+    }
+    return true;
+}
+
+static uint16_t ec_sim_datagram(uint8_t cmd, uint8_t *address, uint8_t *data, uint16_t len, uint64_t t0)
+{
+    uint16_t adp = EC_READ_U16(address);
+    uint16_t ado = EC_READ_U16(address + 2);
+    int32_t target = -1;
+    uint16_t wc = 0;
+
+    switch (cmd) {
+        case EC_DATAGRAM_APRD:
+        case EC_DATAGRAM_APWR:
+        case EC_DATAGRAM_APRW:
+        case EC_DATAGRAM_ARMW:
+            // every slave increments the position, the one that sees 0 is addressed
+            if ((uint16_t)(0 - adp) < g_sim_slave_count) {
+                target = (uint16_t)(0 - adp);
+            }
+            EC_WRITE_U16(address, adp + g_sim_slave_count);
+            break;
+        case EC_DATAGRAM_FPRD:
+        case EC_DATAGRAM_FPWR:
+        case EC_DATAGRAM_FPRW:
+        case EC_DATAGRAM_FRMW:
+            target = ec_sim_station_lookup(adp);
+            break;
+        default:
+            break;
+    }
+
+    switch (cmd) {
+        case EC_DATAGRAM_APRD:
+        case EC_DATAGRAM_FPRD:
+            if (target >= 0) {
+                wc = ec_sim_reg_access(target, EC_SIM_ACCESS_READ, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_APWR:
+        case EC_DATAGRAM_FPWR:
+            if (target >= 0) {
+                wc = ec_sim_reg_access(target, EC_SIM_ACCESS_WRITE, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_APRW:
+        case EC_DATAGRAM_FPRW:
+            if (target >= 0) {
+                wc = ec_sim_reg_access(target, EC_SIM_ACCESS_READ | EC_SIM_ACCESS_WRITE, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_ARMW:
+        case EC_DATAGRAM_FRMW:
+            // the addressed slave reads, all others write what passes them
+            if (ec_sim_dc_defer(ado, data, len, target, t0, &wc)) {
+                break;
+            }
+            for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+                wc += ec_sim_reg_access(i, ((int32_t)i == target) ? EC_SIM_ACCESS_READ : EC_SIM_ACCESS_WRITE, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_BRD:
+            for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+                wc += ec_sim_reg_access(i, EC_SIM_ACCESS_READ | EC_SIM_ACCESS_OR, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_BWR:
+            for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+                wc += ec_sim_reg_access(i, EC_SIM_ACCESS_WRITE, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_BRW:
+            for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+                wc += ec_sim_reg_access(i, EC_SIM_ACCESS_READ | EC_SIM_ACCESS_WRITE | EC_SIM_ACCESS_OR, ado, data, len, t0);
+            }
+            break;
+        case EC_DATAGRAM_LRD:
+        case EC_DATAGRAM_LWR:
+        case EC_DATAGRAM_LRW:
+            wc = ec_sim_logical(cmd, EC_READ_U32(address), data, len);
+            break;
+        default:
+            break;
+    }
+
+    return wc;
+}
+
+/* Host time for the statistics, the timestamp of the port may be a virtual clock. */
+static uint64_t ec_sim_host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* FNV-1a over 64 bit words, the tail byte by byte. */
+static uint64_t ec_sim_digest(uint64_t digest, const uint8_t *data, uint32_t size)
+{
+    uint64_t word;
+    uint32_t i;
+
+    for (i = 0; (i + 8) <= size; i += 8) {
+        word = EC_READ_U64(&data[i]);
+        digest = (digest ^ word) * 0x100000001b3ULL;
+    }
+    for (; i < size; i++) {
+        digest = (digest ^ data[i]) * 0x100000001b3ULL;
+    }
+    return digest;
+}
+
+void ec_sim_process_frame(uint8_t *frame, uint32_t size, uint64_t t0)
+{
+    uint64_t start = ec_sim_host_time_ns();
+    uint8_t *cur;
+    uint8_t *end;
+    uint16_t len;
+    uint16_t wc;
+    bool more;
+
+    if (size < EC_FRAME_HEADER_SIZE) {
+        return;
+    }
+
+    len = EC_READ_U16(frame) & 0x07ff;
+    if (((uint32_t)len + EC_FRAME_HEADER_SIZE) > size) {
+        return;
+    }
+
+    cur = frame + EC_FRAME_HEADER_SIZE;
+    end = cur + len;
+
+    do {
+        if ((cur + EC_DATAGRAM_HEADER_SIZE + EC_DATAGRAM_WC_SIZE) > end) {
+            break;
+        }
+
+        len = EC_READ_U16(cur + 6) & 0x07ff;
+        more = (EC_READ_U16(cur + 6) & 0x8000) != 0;
+        if ((cur + EC_DATAGRAM_HEADER_SIZE + len + EC_DATAGRAM_WC_SIZE) > end) {
+            break;
+        }
+
+        wc = EC_READ_U16(cur + EC_DATAGRAM_HEADER_SIZE + len);
+        wc += ec_sim_datagram(EC_READ_U8(cur), cur + 2, cur + EC_DATAGRAM_HEADER_SIZE, len, t0);
+        EC_WRITE_U16(cur + EC_DATAGRAM_HEADER_SIZE + len, wc);
+
+        cur += EC_DATAGRAM_HEADER_SIZE + len + EC_DATAGRAM_WC_SIZE;
+        g_sim_stats.datagrams++;
+    } while (more);
+
+    g_sim_stats.frames++;
+    g_sim_stats.digest = ec_sim_digest(g_sim_stats.digest ^ t0, frame, size);
+    g_sim_stats.process_ns += ec_sim_host_time_ns() - start;
+}
+
+/*
+ * Setup
+ */
+
+static void ec_sim_update_dl_status(void)
+{
+    uint16_t status;
+
+    for (uint32_t i = 0; i < g_sim_slave_count; i++) {
+        // port 0 has a link, port 1 goes to the next slave or is closed, ports 2 and 3 are closed
+        status = 0x0001 | (1 << 4) | (1 << 9) | (1 << 12) | (1 << 14);
+        if (i < (g_sim_slave_count - 1)) {
+            status |= (1 << 5) | (1 << 11);
+        } else {
+            status |= (1 << 10);
+        }
+        EC_WRITE_U16(&g_sim_slaves[i].mem[EC_SIM_REG(ESC_DL_STAT)], status);
+    }
+}
+
+static int ec_sim_slave_load(ec_sim_slave_t *s, uint32_t slave_index, const uint8_t *sii, uint32_t sii_size)
+{
+    uint8_t *copy;
+
+    if (sii_size < (EC_SII_ADDRESS_ADDITIONAL_INFO * 2)) {
+        return -EC_ERR_INVAL;
+    }
+
+    // a copy per slave, the master may write the SII
+    copy = ec_osal_malloc(sii_size);
+    if (!copy) {
+        return -EC_ERR_NOMEM;
+    }
+    memcpy(copy, sii, sii_size);
+
+    if (s->sii) {
+        ec_osal_free(s->sii);
+    }
+    memset(s, 0, sizeof(ec_sim_slave_t));
+    s->sii = copy;
+    s->sii_size = sii_size;
+
+    s->mem[EC_SIM_REG(TYPE)] = 0xec;
+    s->mem[EC_SIM_REG(FMMU_NUM)] = 8;
+    s->mem[EC_SIM_REG(SYNCM_NUM)] = 8;
+    s->mem[EC_SIM_REG(RAM_SIZE)] = 8;
+    s->mem[EC_SIM_REG(PORT_DESC)] = 0x0f;
+    EC_WRITE_U16(&s->mem[EC_SIM_REG(FEATURE)], 0x000d); // byte FMMUs, DC, 64 bit DC
+    EC_WRITE_U16(&s->mem[EC_SIM_REG(STATION_ALS)], ec_sim_sii_word(s, 4));
+    EC_WRITE_U16(&s->mem[EC_SIM_REG(AL_STAT)], EC_SLAVE_STATE_INIT);
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(PID)], EC_READ_U32(&s->sii[EC_SII_ADDRESS_PRODUCTCODE * 2]));
+    EC_WRITE_U32(&s->mem[EC_SIM_REG(VID)], EC_READ_U32(&s->sii[EC_SII_ADDRESS_MANUF * 2]));
+
+    // every slave gets its own offset and drift, the same on every run
+    s->anchor_time = ec_timestamp_get_time_ns();
+    s->anchor_local = (uint64_t)(slave_index + 1) * 1000000007ULL;
+    s->drift_ppb = (int32_t)((slave_index * 7919 + 13) % (2 * EC_SIM_DRIFT_PPB + 1)) - EC_SIM_DRIFT_PPB;
+
+    ec_sim_od_init(s);
+    return 0;
+}
+
+static void ec_sim_free_slaves(ec_sim_slave_t *slaves, uint32_t count)
+{
+    if (!slaves) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (slaves[i].sii) {
+            ec_osal_free(slaves[i].sii);
+        }
+    }
+    ec_osal_free(slaves);
+}
+
+int ec_sim_set_slaves(uint32_t count, const uint8_t *sii, uint32_t sii_size)
+{
+    ec_sim_slave_t *slaves = NULL;
+    ec_sim_slave_t *old_slaves;
+    ec_sim_fmmu_t *fmmu_map = NULL;
+    ec_sim_fmmu_t *old_fmmu_map;
+    uint32_t old_count;
+    uintptr_t flags;
+    int ret;
+
+    if (count) {
+        slaves = ec_osal_malloc(count * sizeof(ec_sim_slave_t));
+        if (!slaves) {
+            return -EC_ERR_NOMEM;
+        }
+        memset(slaves, 0, count * sizeof(ec_sim_slave_t));
+
+        fmmu_map = ec_osal_malloc(count * 8 * sizeof(ec_sim_fmmu_t));
+        if (!fmmu_map) {
+            ec_osal_free(slaves);
+            return -EC_ERR_NOMEM;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            ret = ec_sim_slave_load(&slaves[i], i, sii, sii_size);
+            if (ret < 0) {
+                ec_sim_free_slaves(slaves, count);
+                ec_osal_free(fmmu_map);
+                return ret;
+            }
+        }
+    }
+
+    flags = ec_osal_enter_critical_section();
+    old_slaves = g_sim_slaves;
+    old_count = g_sim_slave_count;
+    old_fmmu_map = g_sim_fmmu_map;
+    g_sim_slaves = slaves;
+    g_sim_slave_count = count;
+    g_sim_fmmu_map = fmmu_map;
+    g_sim_station_dirty = true;
+    g_sim_fmmu_dirty = true;
+    g_sim_dc_event_count = 0;
+    g_sim_mbx_sys_time = 0;
+    ec_sim_update_dl_status();
+    ec_osal_leave_critical_section(flags);
+
+    ec_sim_free_slaves(old_slaves, old_count);
+    if (old_fmmu_map) {
+        ec_osal_free(old_fmmu_map);
+    }
+    return 0;
+}
+
+int ec_sim_set_slave_sii(uint32_t slave_index, const uint8_t *sii, uint32_t sii_size)
+{
+    uintptr_t flags;
+    bool mbx_sys_time;
+    int ret;
+
+    flags = ec_osal_enter_critical_section();
+    if (slave_index >= g_sim_slave_count) {
+        ec_osal_leave_critical_section(flags);
+        return -EC_ERR_INVAL;
+    }
+
+    mbx_sys_time = ec_sim_mbx_sys_time(&g_sim_slaves[slave_index]);
+    ret = ec_sim_slave_load(&g_sim_slaves[slave_index], slave_index, sii, sii_size);
+    if (ret == 0) {
+        g_sim_mbx_sys_time -= mbx_sys_time ? 1 : 0;
+        g_sim_slaves[slave_index].dc_event = g_sim_dc_event_count;
+    }
+    g_sim_station_dirty = true;
+    g_sim_fmmu_dirty = true;
+    ec_sim_update_dl_status();
+    ec_osal_leave_critical_section(flags);
+
+    return ret;
+}
+
+int ec_sim_load_sii_file(const char *path, uint8_t **sii, uint32_t *sii_size)
+{
+    FILE *fp;
+    long size;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return -EC_ERR_IO;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size < (EC_SII_ADDRESS_ADDITIONAL_INFO * 2)) {
+        fclose(fp);
+        return -EC_ERR_SII;
+    }
+
+    *sii = ec_osal_malloc(size);
+    if (!*sii) {
+        fclose(fp);
+        return -EC_ERR_NOMEM;
+    }
+
+    if (fread(*sii, 1, size, fp) != (size_t)size) {
+        ec_osal_free(*sii);
+        fclose(fp);
+        return -EC_ERR_IO;
+    }
+
+    fclose(fp);
+    *sii_size = size;
+    return 0;
+}
+
+void ec_sim_set_app_callback(ec_sim_app_cb_t cb, void *arg)
+{
+    g_sim_app_cb = cb ? cb : ec_sim_default_app;
+    g_sim_app_arg = arg;
+}
+
+void ec_sim_set_hop_delay(uint32_t ns)
+{
+    g_sim_hop_ns = ns;
+}
+
+uint64_t ec_sim_frame_latency(uint32_t size)
+{
+    return EC_SIM_WIRE_TIME_NS(size) + (uint64_t)2 * g_sim_slave_count * g_sim_hop_ns;
+}
+
+uint16_t ec_sim_get_al_state(uint32_t slave_index)
+{
+    if (slave_index >= g_sim_slave_count) {
+        return 0;
+    }
+    return EC_READ_U16(&g_sim_slaves[slave_index].mem[EC_SIM_REG(AL_STAT)]);
+}
+
+int ec_sim_read_reg(uint32_t slave_index, uint16_t address, void *data, uint16_t len)
+{
+    uintptr_t flags;
+
+    if ((slave_index >= g_sim_slave_count) || (((uint32_t)address + len) > EC_SIM_MEM_SIZE)) {
+        return -EC_ERR_INVAL;
+    }
+
+    flags = ec_osal_enter_critical_section();
+    ec_sim_dc_replay(slave_index);
+    memcpy(data, &g_sim_slaves[slave_index].mem[address], len);
+    ec_osal_leave_critical_section(flags);
+    return 0;
+}
+
+uint32_t ec_sim_get_slave_count(void)
+{
+    return g_sim_slave_count;
+}
+
+void ec_sim_get_stats(ec_sim_stats_t *stats)
+{
+    *stats = g_sim_stats;
+}
+
+void ec_sim_frame_dropped(void)
+{
+    g_sim_stats.dropped++;
+}
+
+void ec_sim_reset_stats(void)
+{
+    memset(&g_sim_stats, 0, sizeof(g_sim_stats));
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EC_SIM_H
+#define EC_SIM_H
+
+#include <stdint.h>
+
+/*
+ * Software model of a line of EtherCAT slave controllers, used by the netdev_sim port.
+ *
+ * Every simulated slave has the ESC register space and 8 KB process data ram (12 KB in total),
+ * auto increment, configured and logical addressing with FMMUs, sync managers, an SII image,
+ * the AL state machine, mailbox sync managers with a CoE server and the DC registers with a
+ * drifting local clock. Frames are processed in place, like they pass the line of slaves.
+ */
+
+/** Application callback of one slave, runs when a frame updated its outputs.
+ *
+ * \param output Content of the output process data SM (SM2), NULL if there is none.
+ * \param input  Content of the input process data SM (SM3), NULL if there is none.
+ */
+typedef void (*ec_sim_app_cb_t)(uint32_t slave_index,
+                                const uint8_t *output, uint32_t output_size,
+                                uint8_t *input, uint32_t input_size,
+                                void *arg);
+
+typedef struct {
+    uint64_t frames;     /**< Number of processed frames. */
+    uint64_t datagrams;  /**< Number of processed datagrams. */
+    uint64_t dropped;    /**< Number of frames dropped because the rx ring was full. */
+    uint64_t process_ns; /**< Host time spent in the simulation [ns]. */
+    uint64_t digest;     /**< Hash of every frame behind the slaves and its t0, equal for equal runs on the virtual clock. */
+} ec_sim_stats_t;
+
+/** Replaces the simulated bus by count slaves, all with the same SII image.
+ *
+ * Can be called at runtime, the master sees the new bus on its next scan.
+ * \return 0 on success, -EC_ERR_NOMEM if the slaves can not be allocated.
+ */
+int ec_sim_set_slaves(uint32_t count, const uint8_t *sii, uint32_t sii_size);
+
+/** Gives one slave its own SII image, e.g. to mix devices on one bus. */
+int ec_sim_set_slave_sii(uint32_t slave_index, const uint8_t *sii, uint32_t sii_size);
+
+/** Reads a binary SII image as written by scripts/esi_parser.py, free it with ec_osal_free(). */
+int ec_sim_load_sii_file(const char *path, uint8_t **sii, uint32_t *sii_size);
+
+/** Sets the application of all slaves, the default one copies the outputs to the inputs. */
+void ec_sim_set_app_callback(ec_sim_app_cb_t cb, void *arg);
+
+/** Sets the forwarding delay of one slave [ns], default 500 ns. */
+void ec_sim_set_hop_delay(uint32_t ns);
+
+/** Time a frame of size bytes (with ethernet header) occupies 100 Mbit/s ethernet, with preamble, FCS and interframe gap [ns]. */
+#define EC_SIM_WIRE_TIME_NS(size) ((uint64_t)(((size) < 60 ? 60 : (size)) + 24) * 80)
+
+/** Time from the first bit of a frame leaving the master until its last bit is back [ns]. */
+uint64_t ec_sim_frame_latency(uint32_t size);
+
+/** Returns AL_STAT of a slave, 0 for an invalid index. */
+uint16_t ec_sim_get_al_state(uint32_t slave_index);
+
+/** Copies ESC memory of a slave without side effects, e.g. SYS_TIME_DIFF in a test. */
+int ec_sim_read_reg(uint32_t slave_index, uint16_t address, void *data, uint16_t len);
+
+uint32_t ec_sim_get_slave_count(void);
+void ec_sim_get_stats(ec_sim_stats_t *stats);
+void ec_sim_reset_stats(void);
+
+/** Counts a frame the netdev port could not queue. */
+void ec_sim_frame_dropped(void);
+
+/** Passes an EtherCAT frame (behind the ethernet header) through all slaves.
+ *
+ * \param t0 Time the frame left the master [ns], base of the DC receive times.
+ */
+void ec_sim_process_frame(uint8_t *frame, uint32_t size, uint64_t t0);
+
+/*
+ * Virtual clock of port/sim/ec_osal_vtime.c, built with CONFIG_EC_SIM_VTIME. The port takes its
+ * timestamp and htimer from it and the clock only advances when all threads wait, so a run is
+ * deterministic and takes only the cpu time of the stack and the slave model.
+ */
+
+/** Current virtual time [ns]. */
+uint64_t ec_sim_vtime_now(void);
+
+/** Blocks the calling thread until the virtual time reaches time_ns. */
+void ec_sim_vtime_sleep_until(uint64_t time_ns);
+
+#endif
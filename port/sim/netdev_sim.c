@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+#include "ec_master.h"
+#include "ec_sim.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+
+#if !defined(CONFIG_EC_TIMESTAMP_CUSTOM)
+#error "CONFIG_EC_TIMESTAMP_CUSTOM must be defined for the simulator"
+#endif
+
+#if !defined(CONFIG_EC_PHY_CUSTOM)
+#error "CONFIG_EC_PHY_CUSTOM must be defined for the simulator"
+#endif
+
+/*
+ * Frames sent on netdev 0 pass the simulated slaves of ec_sim.c and come back on netdev 0, the
+ * other netdevs have no link. output() only queues the frame like a MAC does, the "ec_sim"
+ * thread passes it through the slaves and hands it to the master inside the osal critical
+ * section, like the rx interrupt on a MCU. Frames of the cyclic task are answered right after
+ * the htimer callback, so every cycle sees the answer of the cycle before.
+ *
+ * Lock order: osal critical section, then the ring lock.
+ *
+ * With CONFIG_EC_SIM_VTIME the port runs on the virtual clock of ec_osal_vtime.c instead: the
+ * "ec_sim" and "ec_htimer" threads are osal threads, output() puts the frame on a modelled
+ * 100 Mbit/s wire behind the frames before it and the "ec_sim" thread hands it to the master
+ * when its last bit is back, ec_sim_frame_latency() after it left.
+ */
+
+#define EC_SIM_FRAME_SIZE 1536
+
+#define EC_SIM_RT_PRIO (sched_get_priority_max(SCHED_FIFO) - 1)
+
+typedef struct {
+    uint8_t frame[EC_SIM_FRAME_SIZE];
+    uint32_t size;
+    uint64_t t0;
+} ec_netdev_sim_frame_t;
+
+typedef struct {
+    ec_netdev_sim_frame_t ring[CONFIG_EC_MAX_ENET_RXBUF_COUNT];
+    uint32_t head;
+    uint32_t tail;
+#ifdef CONFIG_EC_SIM_VTIME
+    ec_osal_sem_t sem;
+    ec_osal_thread_t thread;
+    uint64_t wire_free; /**< Virtual time the wire is free after the queued frames [ns]. */
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+#endif
+    bool running;
+} ec_netdev_sim_t;
+
+ec_netdev_t g_netdev[CONFIG_EC_MAX_NETDEVS];
+static uint8_t g_netdev_sim_txbuf[CONFIG_EC_MAX_NETDEVS][CONFIG_EC_MAX_ENET_TXBUF_COUNT][EC_SIM_FRAME_SIZE];
+#ifdef CONFIG_EC_SIM_VTIME
+static ec_netdev_sim_t g_netdev_sim;
+
+/* Delivers the queued frames in order, each when it is back at the master. */
+static void ec_netdev_sim_thread(void *argument)
+{
+    ec_netdev_t *netdev = &g_netdev[0];
+    ec_netdev_sim_frame_t *entry;
+    uintptr_t flags;
+
+    (void)argument;
+
+    while (1) {
+        while (g_netdev_sim.head == g_netdev_sim.tail) {
+            ec_osal_sem_take(g_netdev_sim.sem, EC_OSAL_WAITING_FOREVER);
+        }
+
+        entry = &g_netdev_sim.ring[g_netdev_sim.tail % CONFIG_EC_MAX_ENET_RXBUF_COUNT];
+        ec_sim_vtime_sleep_until(entry->t0 + ec_sim_frame_latency(entry->size));
+
+        flags = ec_osal_enter_critical_section();
+        ec_sim_process_frame(entry->frame + ETH_HLEN, entry->size - ETH_HLEN, entry->t0);
+        if (netdev->master) {
+            ec_netdev_receive(netdev, entry->frame, entry->size);
+        }
+        g_netdev_sim.tail++;
+        ec_osal_leave_critical_section(flags);
+    }
+}
+#else
+static ec_netdev_sim_t g_netdev_sim = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int ec_sim_create_thread(pthread_t *thread, void *(*entry)(void *), void *arg, const char *name)
+{
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = EC_SIM_RT_PRIO;
+    pthread_attr_setschedparam(&attr, &param);
+
+    ret = pthread_create(thread, &attr, entry, arg);
+    if (ret == EPERM) {
+        EC_LOG_WRN("No permission for SCHED_FIFO, %s uses the default policy\r\n", name);
+        ret = pthread_create(thread, NULL, entry, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (ret == 0) {
+        pthread_setname_np(*thread, name);
+    }
+    return ret;
+}
+
+/* Passes the queued frames through the slaves, called inside the critical section. */
+static void ec_netdev_sim_flush(void)
+{
+    ec_netdev_t *netdev = &g_netdev[0];
+    ec_netdev_sim_frame_t *entry;
+
+    while (1) {
+        pthread_mutex_lock(&g_netdev_sim.lock);
+        if (g_netdev_sim.head == g_netdev_sim.tail) {
+            pthread_mutex_unlock(&g_netdev_sim.lock);
+            break;
+        }
+        entry = &g_netdev_sim.ring[g_netdev_sim.tail % CONFIG_EC_MAX_ENET_RXBUF_COUNT];
+        pthread_mutex_unlock(&g_netdev_sim.lock);
+
+        ec_sim_process_frame(entry->frame + ETH_HLEN, entry->size - ETH_HLEN, entry->t0);
+        if (netdev->master) {
+            ec_netdev_receive(netdev, entry->frame, entry->size);
+        }
+
+        pthread_mutex_lock(&g_netdev_sim.lock);
+        g_netdev_sim.tail++;
+        pthread_mutex_unlock(&g_netdev_sim.lock);
+    }
+}
+
+static void *ec_netdev_sim_thread(void *argument)
+{
+    uintptr_t flags;
+
+    (void)argument;
+
+    while (1) {
+        pthread_mutex_lock(&g_netdev_sim.lock);
+        while (g_netdev_sim.head == g_netdev_sim.tail) {
+            pthread_cond_wait(&g_netdev_sim.cond, &g_netdev_sim.lock);
+        }
+        pthread_mutex_unlock(&g_netdev_sim.lock);
+
+        flags = ec_osal_enter_critical_section();
+        ec_netdev_sim_flush();
+        ec_osal_leave_critical_section(flags);
+    }
+
+    return NULL;
+}
+#endif
+
+ec_netdev_t *ec_netdev_low_level_init(uint8_t netdev_index)
+{
+    ec_netdev_t *netdev = &g_netdev[netdev_index];
+    uint8_t *frame;
+
+    netdev->mac_addr[0] = 0x02; // locally administered
+    netdev->mac_addr[1] = 0x00;
+    netdev->mac_addr[2] = 0x00;
+    netdev->mac_addr[3] = 0x00;
+    netdev->mac_addr[4] = 0x00;
+    netdev->mac_addr[5] = netdev_index;
+
+    for (uint32_t i = 0; i < CONFIG_EC_MAX_ENET_TXBUF_COUNT; i++) {
+        frame = g_netdev_sim_txbuf[netdev_index][i];
+        for (uint8_t j = 0; j < 6; j++) { // dst MAC
+            EC_WRITE_U8(&frame[j], 0xFF);
+        }
+        for (uint8_t j = 0; j < 6; j++) { // src MAC
+            EC_WRITE_U8(&frame[6 + j], netdev->mac_addr[j]);
+        }
+        EC_WRITE_U16(&frame[12], ec_htons(0x88a4));
+    }
+
+    netdev->index = netdev_index;
+
+    if ((netdev_index == 0) && !g_netdev_sim.running) {
+#ifdef CONFIG_EC_SIM_VTIME
+        // above the stack threads, like the rx interrupt
+        g_netdev_sim.sem = ec_osal_sem_create(CONFIG_EC_MAX_ENET_RXBUF_COUNT, 0);
+        g_netdev_sim.thread = ec_osal_thread_create("ec_sim", 0, 0, ec_netdev_sim_thread, NULL);
+#else
+        if (ec_sim_create_thread(&g_netdev_sim.thread, ec_netdev_sim_thread, NULL, "ec_sim") != 0) {
+            EC_LOG_ERR("Create sim thread failed\r\n");
+            return NULL;
+        }
+#endif
+        g_netdev_sim.running = true;
+    }
+
+    EC_LOG_INFO("netdev%u on the simulated bus with %u slaves\r\n", netdev_index,
+                (netdev_index == 0) ? ec_sim_get_slave_count() : 0);
+    return netdev;
+}
+
+void ec_netdev_low_level_poll_link_state(ec_netdev_t *netdev)
+{
+    bool link_state = (netdev->index == 0);
+
+    if (link_state != netdev->link_state) {
+        EC_LOG_INFO("netdev%u link %s\r\n", netdev->index, link_state ? "up" : "down");
+        netdev->link_state = link_state;
+    }
+}
+
+EC_FAST_CODE_SECTION uint8_t *ec_netdev_low_level_get_txbuf(ec_netdev_t *netdev)
+{
+    return g_netdev_sim_txbuf[netdev->index][netdev->tx_frame_index];
+}
+
+EC_FAST_CODE_SECTION int ec_netdev_low_level_output(ec_netdev_t *netdev, uint32_t size)
+{
+    ec_netdev_sim_frame_t *entry;
+    uint64_t t0 = ec_timestamp_get_time_ns();
+
+    if ((netdev->index != 0) || (size > EC_SIM_FRAME_SIZE) || (size <= ETH_HLEN)) {
+        return -1;
+    }
+
+#ifdef CONFIG_EC_SIM_VTIME
+    if ((g_netdev_sim.head - g_netdev_sim.tail) >= CONFIG_EC_MAX_ENET_RXBUF_COUNT) {
+        ec_sim_frame_dropped();
+        return -1;
+    }
+
+    // the frame starts when the ones before are on the wire
+    t0 = MAX(t0, g_netdev_sim.wire_free);
+    g_netdev_sim.wire_free = t0 + EC_SIM_WIRE_TIME_NS(size);
+
+    entry = &g_netdev_sim.ring[g_netdev_sim.head % CONFIG_EC_MAX_ENET_RXBUF_COUNT];
+    memcpy(entry->frame, g_netdev_sim_txbuf[netdev->index][netdev->tx_frame_index], size);
+    entry->size = size;
+    entry->t0 = t0;
+    g_netdev_sim.head++;
+    ec_osal_sem_give(g_netdev_sim.sem);
+#else
+    pthread_mutex_lock(&g_netdev_sim.lock);
+    if ((g_netdev_sim.head - g_netdev_sim.tail) >= CONFIG_EC_MAX_ENET_RXBUF_COUNT) {
+        pthread_mutex_unlock(&g_netdev_sim.lock);
+        ec_sim_frame_dropped();
+        return -1;
+    }
+
+    entry = &g_netdev_sim.ring[g_netdev_sim.head % CONFIG_EC_MAX_ENET_RXBUF_COUNT];
+    memcpy(entry->frame, g_netdev_sim_txbuf[netdev->index][netdev->tx_frame_index], size);
+    entry->size = size;
+    entry->t0 = t0;
+    g_netdev_sim.head++;
+    pthread_cond_signal(&g_netdev_sim.cond);
+    pthread_mutex_unlock(&g_netdev_sim.lock);
+#endif
+
+    netdev->tx_frame_index++;
+    netdev->tx_frame_index %= CONFIG_EC_MAX_ENET_TXBUF_COUNT;
+
+    return 0;
+}
+
+static ec_htimer_cb g_ec_htimer_cb = NULL;
+static void *g_ec_htimer_arg = NULL;
+static volatile bool g_ec_htimer_running = false;
+static volatile uint32_t g_ec_htimer_period_ns = 0;
+
+#ifdef CONFIG_EC_SIM_VTIME
+static uint32_t g_ec_htimer_generation = 0;
+
+/* One thread per start, it ends at its next period after a stop or a restart. */
+static void ec_htimer_thread(void *argument)
+{
+    uint32_t generation = (uint32_t)(uintptr_t)argument;
+    uint64_t next = ec_sim_vtime_now();
+    uintptr_t flags;
+
+    while (1) {
+        // the period set in the callback applies to the period that just started, like a reload register
+        next += g_ec_htimer_period_ns;
+        ec_sim_vtime_sleep_until(next);
+
+        if (!g_ec_htimer_running || (generation != g_ec_htimer_generation)) {
+            break;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        g_ec_htimer_cb(g_ec_htimer_arg);
+        ec_osal_leave_critical_section(flags);
+    }
+}
+
+void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
+{
+    g_ec_htimer_cb = cb;
+    g_ec_htimer_arg = arg;
+    g_ec_htimer_period_ns = us * 1000;
+    g_ec_htimer_running = true;
+    g_ec_htimer_generation++;
+
+    ec_osal_thread_create("ec_htimer", 0, 0, ec_htimer_thread, (void *)(uintptr_t)g_ec_htimer_generation);
+}
+
+void ec_htimer_stop(void)
+{
+    g_ec_htimer_running = false;
+}
+#else
+static pthread_t g_ec_htimer_thread;
+
+static void *ec_htimer_thread(void *argument)
+{
+    struct timespec next;
+    struct timespec now;
+    uintptr_t flags;
+    uint64_t late;
+
+    (void)argument;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (g_ec_htimer_running) {
+        // the period set in the callback applies to the period that just started, like a reload register
+        next.tv_nsec += g_ec_htimer_period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+
+        if (!g_ec_htimer_running) {
+            break;
+        }
+
+        // after an overrun of more than one period restart from now instead of firing back to back
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = (uint64_t)(now.tv_sec - next.tv_sec) * 1000000000ULL + now.tv_nsec - next.tv_nsec;
+        if ((int64_t)late > (int64_t)g_ec_htimer_period_ns) {
+            next = now;
+        }
+
+        flags = ec_osal_enter_critical_section();
+        g_ec_htimer_cb(g_ec_htimer_arg);
+        ec_netdev_sim_flush();
+        ec_osal_leave_critical_section(flags);
+    }
+
+    return NULL;
+}
+
+void ec_htimer_start(uint32_t us, ec_htimer_cb cb, void *arg)
+{
+    g_ec_htimer_cb = cb;
+    g_ec_htimer_arg = arg;
+    g_ec_htimer_period_ns = us * 1000;
+    g_ec_htimer_running = true;
+
+    if (ec_sim_create_thread(&g_ec_htimer_thread, ec_htimer_thread, NULL, "ec_htimer") != 0) {
+        EC_LOG_ERR("ec_htimer_start failed\r\n");
+        g_ec_htimer_running = false;
+    }
+}
+
+void ec_htimer_stop(void)
+{
+    if (!g_ec_htimer_running) {
+        return;
+    }
+
+    g_ec_htimer_running = false;
+    if (pthread_equal(g_ec_htimer_thread, pthread_self())) {
+        pthread_detach(g_ec_htimer_thread);
+    } else {
+        pthread_join(g_ec_htimer_thread, NULL);
+    }
+}
+#endif
+
+EC_FAST_CODE_SECTION void ec_htimer_update(uint32_t us)
+{
+    g_ec_htimer_period_ns = us * 1000;
+}
+
+EC_FAST_CODE_SECTION void ec_htimer_update_ns(uint32_t ns)
+{
+    g_ec_htimer_period_ns = ns;
+}
+
+void ec_timestamp_init(void)
+{
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
+{
+#ifdef CONFIG_EC_SIM_VTIME
+    return ec_sim_vtime_now();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
@@ -36,6 +36,18 @@ class ENIParser:
                 except:
                     return 0
 
+    def parse_int_value(self, value_str: str) -> int:
+        """解析整数, #x 或 0x 开头为十六进制, 否则为十进制"""
+        if not value_str:
+            return 0
+        value_str = value_str.strip()
+        if value_str.startswith('#x') or value_str.startswith('0x'):
+            return int(value_str[2:], 16)
+        try:
+            return int(value_str, 10)
+        except:
+            return 0
+
     def parse_slave_info(self, slave_elem):
         """解析从站基本信息"""
         slave_info = {}
@@ -133,6 +145,10 @@ class ENIParser:
             if index_elem is not None:
                 pdo_info['index'] = self.parse_hex_value(index_elem.text)
 
+            # 解析PDO所属的同步管理器
+            if rxpdo_elem.get('Sm') is not None:
+                pdo_info['sm'] = self.parse_int_value(rxpdo_elem.get('Sm'))
+
             # 解析PDO Name
             name_elem = rxpdo_elem.find('Name')
             if name_elem is not None:
@@ -156,6 +172,10 @@ class ENIParser:
             if index_elem is not None:
                 pdo_info['index'] = self.parse_hex_value(index_elem.text)
 
+            # 解析PDO所属的同步管理器
+            if txpdo_elem.get('Sm') is not None:
+                pdo_info['sm'] = self.parse_int_value(txpdo_elem.get('Sm'))
+
             # 解析PDO Name
             name_elem = txpdo_elem.find('Name')
             if name_elem is not None:
@@ -170,6 +190,20 @@ class ENIParser:
             pdo_info['entries'] = entries
             process_data['tx_pdos'].append(pdo_info)
 
+        # 解析过程数据同步管理器寄存器
+        process_data['sms'] = []
+        for sm_index in range(8):
+            sm_elem = process_elem.find(f'Sm{sm_index}')
+            if sm_elem is None:
+                continue
+            process_data['sms'].append({
+                'index': sm_index,
+                'type': sm_elem.findtext('Type', 'Outputs').strip(),
+                'start_address': self.parse_int_value(sm_elem.findtext('StartAddress')),
+                'control': self.parse_int_value(sm_elem.findtext('ControlByte')),
+                'enable': self.parse_int_value(sm_elem.findtext('Enable')),
+            })
+
         # 解析同步管理器配置
         sm2_elem = process_elem.find('Sm2')
         if sm2_elem is not None:
@@ -191,6 +225,29 @@ class ENIParser:
 
         return process_data
 
+    def parse_coe_init_cmds(self, slave_elem):
+        """解析CoE初始化命令, 只保留PS和SO的SDO下载"""
+        cmds = []
+
+        for cmd_elem in slave_elem.findall('Mailbox/CoE/InitCmds/InitCmd'):
+            transitions = [t.text.strip() for t in cmd_elem.findall('Transition') if t.text]
+            if self.parse_int_value(cmd_elem.findtext('Ccs')) != 1:
+                continue
+
+            data = cmd_elem.findtext('Data', '').strip()
+            for transition, state in (('PS', 'EC_SLAVE_STATE_SAFEOP'), ('SO', 'EC_SLAVE_STATE_OP')):
+                if transition in transitions:
+                    cmds.append({
+                        'state': state,
+                        'complete_access': cmd_elem.get('CompleteAccess', 'false').lower() == 'true',
+                        'index': self.parse_int_value(cmd_elem.findtext('Index')),
+                        'subindex': self.parse_int_value(cmd_elem.findtext('SubIndex')),
+                        'data': bytes.fromhex(data),
+                        'comment': cmd_elem.findtext('Comment', '').strip(),
+                    })
+
+        return cmds
+
     def parse_eni(self, eni_file: str) -> bool:
         """解析ENI文件"""
         try:
@@ -204,7 +261,8 @@ class ENIParser:
 
                 slave_config = {
                     'info': slave_info,
-                    'process_data': process_data
+                    'process_data': process_data,
+                    'coe_init_cmds': self.parse_coe_init_cmds(slave_elem)
                 }
 
                 self.slaves.append(slave_config)
@@ -228,6 +286,107 @@ class ENIParser:
         product_code = slave_info.get('product_code', 0)
         return f'eni_{product_code:04x}'
 
+    def c_bytes(self, data: bytes, indent: str = "    ") -> List[str]:
+        """生成C字节数组的内容, 每行8个字节"""
+        lines = []
+        for i in range(0, len(data), 8):
+            lines.append(indent + ", ".join(f"0x{b:02x}" for b in data[i:i + 8]) + ",")
+        return lines
+
+    def generate_image(self, slave, slave_name) -> List[str]:
+        """生成预先计算的配置镜像: SM和FMMU寄存器页, 过程数据大小, 期望WC, CoE初始化命令和PDO条目偏移
+
+        FMMU的逻辑地址相对于从站的过程数据, 输出在前, 输入在后, 与主站的布局一致
+        PDO条目表只记录注册所需的索引和在从站过程数据中的位偏移
+        """
+        process_data = slave['process_data']
+        sms = process_data.get('sms', [])
+        lines = []
+
+        sm_pages = {}
+        fmmus = []
+        sizes = {'Outputs': 0, 'Inputs': 0}
+        for sm in sms:
+            is_output = sm['type'] == 'Outputs'
+            pdos = process_data['rx_pdos'] if is_output else process_data['tx_pdos']
+            bitlen = sum(e['bit_length'] for pdo in pdos if pdo.get('sm', sm['index']) == sm['index']
+                         for e in pdo.get('entries', []))
+            length = (bitlen + 7) // 8
+
+            # 物理地址, 长度, 控制, 状态, 激活, PDI控制
+            sm_pages[sm['index']] = (sm['start_address'].to_bytes(2, 'little') + length.to_bytes(2, 'little') +
+                                     bytes([sm['control'], 0x00, sm['enable'], 0x00]))
+            if length:
+                entries = [e for pdo in pdos if pdo.get('sm', sm['index']) == sm['index'] for e in pdo.get('entries', [])]
+                fmmus.append((is_output, sm['start_address'], length, entries))
+                sizes[sm['type']] += length
+
+        if not sm_pages:
+            return lines
+
+        sm_start = min(sm_pages)
+        sm_count = max(sm_pages) - sm_start + 1
+        sm_data = b''.join(sm_pages.get(i, bytes(8)) for i in range(sm_start, sm_start + sm_count))
+
+        # 逻辑地址, 长度, 起始位, 结束位, 物理地址, 物理起始位, 类型, 激活, 保留
+        fmmu_data = b''
+        entry_offsets = []
+        logical = 0
+        for is_output, physical, length, entries in sorted(fmmus, key=lambda f: not f[0]):
+            fmmu_data += (logical.to_bytes(4, 'little') + length.to_bytes(2, 'little') + bytes([0x00, 0x07]) +
+                          physical.to_bytes(2, 'little') + bytes([0x00, 0x02 if is_output else 0x01, 0x01, 0x00, 0x00, 0x00]))
+
+            # 填充条目(index为0)不能注册
+            bit_offset = logical * 8
+            for e in entries:
+                if e['index']:
+                    entry_offsets.append((e, bit_offset))
+                bit_offset += e['bit_length']
+            logical += length
+
+        expected_wc = (2 if sizes['Outputs'] else 0) + (1 if sizes['Inputs'] else 0)
+
+        lines.append(f"static const uint8_t {slave_name}_sm_pages[] = {{")
+        lines.extend(self.c_bytes(sm_data))
+        lines.append("};")
+        lines.append("")
+        lines.append(f"static const uint8_t {slave_name}_fmmu_pages[] = {{")
+        lines.extend(self.c_bytes(fmmu_data))
+        lines.append("};")
+        lines.append("")
+
+        if entry_offsets:
+            lines.append(f"static const ec_slave_image_entry_t {slave_name}_image_entries[] = {{")
+            for e, bit_offset in entry_offsets:
+                lines.append(f"    {{ 0x{e['index']:04x}, 0x{e['subindex']:02x}, {bit_offset} }},  // {e.get('name', '')}")
+            lines.append("};")
+            lines.append("")
+
+        cmds = slave.get('coe_init_cmds', [])
+        for i, cmd in enumerate(cmds):
+            lines.append(f"static const uint8_t {slave_name}_cmd{i}_data[] = {{ {', '.join(f'0x{b:02x}' for b in cmd['data'])} }};")
+        if cmds:
+            lines.append("")
+            lines.append(f"static const ec_slave_image_cmd_t {slave_name}_cmds[] = {{")
+            for i, cmd in enumerate(cmds):
+                comment = f"  // {cmd['comment']}" if cmd['comment'] else ""
+                lines.append(f"    {{ {cmd['state']}, {'true' if cmd['complete_access'] else 'false'}, "
+                             f"0x{cmd['index']:04x}, 0x{cmd['subindex']:02x}, {len(cmd['data'])}, {slave_name}_cmd{i}_data }},{comment}")
+            lines.append("};")
+            lines.append("")
+
+        lines.append(f"static const ec_slave_image_t {slave_name}_image = {{")
+        lines.append(f"    {sizes['Outputs']}, {sizes['Inputs']}, {expected_wc},")
+        lines.append(f"    {sm_start}, {sm_count}, {len(fmmus)},")
+        lines.append(f"    {slave_name}_sm_pages,")
+        lines.append(f"    {slave_name}_fmmu_pages,")
+        lines.append(f"    {f'{slave_name}_cmds' if cmds else 'NULL'}, {len(cmds)},")
+        lines.append(f"    {f'{slave_name}_image_entries' if entry_offsets else 'NULL'}, {len(entry_offsets)}")
+        lines.append("};")
+        lines.append("")
+
+        return lines
+
     def generate_c_code(self) -> str:
         """生成C代码"""
         lines = [
@@ -240,95 +399,104 @@ class ENIParser:
             ""
         ]
 
+        generated = []
+
         for slave_idx, slave in enumerate(self.slaves):
             slave_info = slave['info']
             process_data = slave['process_data']
 
             slave_name = self.generate_slave_name(slave_info)
 
+            # 相同的设备只生成一次配置
+            ident = (slave_info.get('vendor_id', 0), slave_info.get('product_code', 0))
+            if ident in [g[0] for g in generated]:
+                continue
+
             lines.append(f"// Slave {slave_idx + 1}: {slave_info.get('name', 'Unknown')}")
             lines.append(f"// Vendor ID: 0x{slave_info.get('vendor_id', 0):08X}")
             lines.append(f"// Product Code: 0x{slave_info.get('product_code', 0):08X}")
             lines.append("")
 
-            # 生成RxPDO entries (输出)
-            rx_entries_generated = set()
-            for pdo in process_data['rx_pdos']:
-                pdo_index = pdo.get('index', 0)
-                pdo_hex = f"{pdo_index:04x}"
-                entries_name = f"{slave_name}_output_pdo_entries"
-
-                if entries_name not in rx_entries_generated:
-                    lines.append(f"static ec_pdo_entry_info_t {entries_name}[] = {{")
-
-                    # 生成每个entry
-                    for entry in pdo.get('entries', []):
-                        comment = entry.get('name', 'Padding')
-                        lines.append(f"    {{ 0x{entry['index']:04x}, 0x{entry['subindex']:02x}, 0x{entry['bit_length']:02x} }},  // {comment}")
+            # 每个PDO一个entry数组, RxPDO (输出) 在前, TxPDO (输入) 在后
+            for pdo in process_data['rx_pdos'] + process_data['tx_pdos']:
+                entries_name = f"{slave_name}_{pdo.get('index', 0):04x}_entries"
 
-                    lines.append("};")
-                    lines.append("")
-                    rx_entries_generated.add(entries_name)
+                lines.append(f"static ec_pdo_entry_info_t {entries_name}[] = {{")
 
-            # 生成TxPDO entries (输入)
-            tx_entries_generated = set()
-            for pdo in process_data['tx_pdos']:
-                pdo_index = pdo.get('index', 0)
-                pdo_hex = f"{pdo_index:04x}"
-                entries_name = f"{slave_name}_input_pdo_entries"
+                # 生成每个entry
+                for entry in pdo.get('entries', []):
+                    comment = entry.get('name', 'Padding')
+                    lines.append(f"    {{ 0x{entry['index']:04x}, 0x{entry['subindex']:02x}, 0x{entry['bit_length']:02x} }},  // {comment}")
 
-                if entries_name not in tx_entries_generated:
-                    lines.append(f"static ec_pdo_entry_info_t {entries_name}[] = {{")
-
-                    # 生成每个entry
-                    for entry in pdo.get('entries', []):
-                        comment = entry.get('name', 'Padding')
-                        lines.append(f"    {{ 0x{entry['index']:04x}, 0x{entry['subindex']:02x}, 0x{entry['bit_length']:02x} }},  // {comment}")
+                lines.append("};")
+                lines.append("")
 
-                    lines.append("};")
-                    lines.append("")
-                    tx_entries_generated.add(entries_name)
+            if not (process_data['rx_pdos'] or process_data['tx_pdos']):
+                continue
 
             # 生成统一的PDO info数组（合并RxPDO和TxPDO）
-            if process_data['rx_pdos'] or process_data['tx_pdos']:
-                lines.append(f"static ec_pdo_info_t {slave_name}_pdos[] = {{")
-
-                # 添加RxPDO (输出)
-                for pdo in process_data['rx_pdos']:
-                    pdo_index = pdo.get('index', 0)
-                    entries_name = f"{slave_name}_output_pdo_entries"
-                    entry_count = len(pdo.get('entries', []))
-                    lines.append(f"    {{ 0x{pdo_index:04x}, {entry_count}, {entries_name} }},")
-
-                # 添加TxPDO (输入)
-                for pdo in process_data['tx_pdos']:
-                    pdo_index = pdo.get('index', 0)
-                    entries_name = f"{slave_name}_input_pdo_entries"
-                    entry_count = len(pdo.get('entries', []))
-                    lines.append(f"    {{ 0x{pdo_index:04x}, {entry_count}, {entries_name} }},")
-
-                lines.append("};")
-                lines.append("")
+            lines.append(f"static ec_pdo_info_t {slave_name}_pdos[] = {{")
+            for pdo in process_data['rx_pdos'] + process_data['tx_pdos']:
+                pdo_index = pdo.get('index', 0)
+                entries_name = f"{slave_name}_{pdo_index:04x}_entries"
+                entry_count = len(pdo.get('entries', []))
+                lines.append(f"    {{ 0x{pdo_index:04x}, {entry_count}, {entries_name} }},")
+            lines.append("};")
+            lines.append("")
 
             # 生成同步管理器配置
-            if process_data['rx_pdos'] or process_data['tx_pdos']:
-                lines.append(f"static ec_sync_info_t {slave_name}_syncs[] = {{")
+            lines.append(f"static ec_sync_info_t {slave_name}_syncs[] = {{")
 
-                pdo_index = 0  # PDO数组中的索引
+            pdo_index = 0  # PDO数组中的索引
+            sync_count = 0
 
-                # 添加SM2 (输出)
-                if process_data['rx_pdos']:
-                    rx_pdo_count = len(process_data['rx_pdos'])
-                    lines.append(f"    {{ 2, EC_DIR_OUTPUT, {rx_pdo_count}, &{slave_name}_pdos[{pdo_index}], EC_WD_DISABLE }},")
-                    pdo_index += rx_pdo_count
+            # 添加SM2 (输出)
+            if process_data['rx_pdos']:
+                rx_pdo_count = len(process_data['rx_pdos'])
+                lines.append(f"    {{ 2, EC_DIR_OUTPUT, {rx_pdo_count}, &{slave_name}_pdos[{pdo_index}], EC_WD_DISABLE }},")
+                pdo_index += rx_pdo_count
+                sync_count += 1
 
-                # 添加SM3 (输入)
-                if process_data['tx_pdos']:
-                    tx_pdo_count = len(process_data['tx_pdos'])
-                    lines.append(f"    {{ 3, EC_DIR_INPUT, {tx_pdo_count}, &{slave_name}_pdos[{pdo_index}], EC_WD_DISABLE }},")
+            # 添加SM3 (输入)
+            if process_data['tx_pdos']:
+                tx_pdo_count = len(process_data['tx_pdos'])
+                lines.append(f"    {{ 3, EC_DIR_INPUT, {tx_pdo_count}, &{slave_name}_pdos[{pdo_index}], EC_WD_DISABLE }},")
+                sync_count += 1
 
-                lines.append("};")
-                lines.append("")
+            lines.append("};")
+            lines.append("")
+
+            image_lines = self.generate_image(slave, slave_name)
+            lines.extend(image_lines)
+
+            generated.append((ident, slave_name, sync_count, bool(image_lines)))
+
+        # 按厂商ID和产品代码查找配置
+        lines.append("static inline int eni_find_slave_sync_info(uint32_t vendor_id, uint32_t product_code, ec_sync_info_t **syncs, uint8_t *sync_count)")
+        lines.append("{")
+        for (vendor_id, product_code), slave_name, sync_count, _ in generated:
+            lines.append(f"    if ((vendor_id == 0x{vendor_id:08x}) && (product_code == 0x{product_code:08x})) {{")
+            lines.append(f"        *syncs = {slave_name}_syncs;")
+            lines.append(f"        *sync_count = {sync_count};")
+            lines.append("        return 0;")
+            lines.append("    }")
+        lines.append("    return -1;")
+        lines.append("}")
+        lines.append("")
+
+        # 按厂商ID和产品代码查找配置镜像, 写入ec_slave_config_t的image
+        lines.append("static inline int eni_find_slave_image(uint32_t vendor_id, uint32_t product_code, const ec_slave_image_t **image)")
+        lines.append("{")
+        for (vendor_id, product_code), slave_name, _, has_image in generated:
+            if not has_image:
+                continue
+            lines.append(f"    if ((vendor_id == 0x{vendor_id:08x}) && (product_code == 0x{product_code:08x})) {{")
+            lines.append(f"        *image = &{slave_name}_image;")
+            lines.append("        return 0;")
+            lines.append("    }")
+        lines.append("    return -1;")
+        lines.append("}")
+        lines.append("")
 
         return "\n".join(lines)
 
@@ -24,6 +24,7 @@ class EtherCATXMLParser:
         self.serial_number = 0x00000000  # 序列号
         self.device_name = ""
         self.device_type = ""
+        self.eeprom_size = 2048
 
         # 邮箱配置
         self.mailbox_protocols = 0x0
@@ -31,6 +32,15 @@ class EtherCATXMLParser:
         self.boot_tx_mailbox = {}
         self.std_rx_mailbox = {}
         self.std_tx_mailbox = {}
+        self.coe_details = 0x00
+        self.sms = []
+
+        # 默认PDO, 设备自带的加上每个Slot的默认模块, (index, sm, name, flags, entries)
+        self.rxpdos = []
+        self.txpdos = []
+
+        # 头部字0-4, 没有Eeprom/ConfigData时的默认值
+        self.config_data = struct.pack('<HHHHH', 0x800C, 0x6681, 0x0000, 0x0000, 0x0000)
 
         # 字符串表
         self.strings = []
@@ -72,9 +82,12 @@ class EtherCATXMLParser:
             self.device_name = name_elem.text.strip()
 
         # 获取设备类型
-        type_name = device_elem.find('Type/Name')
-        if type_name is not None and type_name.text:
-            self.device_type = type_name.text.strip()
+        if type_elem is not None and type_elem.text:
+            self.device_type = type_elem.text.strip()
+
+        size_elem = device_elem.find('Eeprom/ByteSize')
+        if size_elem is not None and size_elem.text:
+            self.eeprom_size = int(size_elem.text.strip())
 
     def parse_vendor_info(self, vendor_elem):
         """解析厂商信息"""
@@ -84,33 +97,130 @@ class EtherCATXMLParser:
 
     def parse_mailbox_info(self, device_elem):
         """解析邮箱信息"""
-        mailbox_elem = device_elem.find('.//Mailbox')
+        # 只看Device下的Mailbox，Info/Mailbox只包含超时配置
+        mailbox_elem = device_elem.find('Mailbox')
         if mailbox_elem is not None:
-            # 检查支持的协议
+            # 检查支持的协议，与EC_MBXPROT_*一致
             self.mailbox_protocols = 0
 
+            if mailbox_elem.find('AoE') is not None:
+                self.mailbox_protocols |= 0x01  # AoE
+            if mailbox_elem.find('EoE') is not None:
+                self.mailbox_protocols |= 0x02  # EoE
             if mailbox_elem.find('CoE') is not None:
                 self.mailbox_protocols |= 0x04  # CoE
+                coe_elem = mailbox_elem.find('CoE')
+                self.coe_details = 0x01  # SDO
+                for bit, attr in ((0x02, 'SdoInfo'), (0x04, 'PdoAssign'), (0x08, 'PdoConfig'),
+                                  (0x10, 'PdoUpload'), (0x20, 'CompleteAccess')):
+                    if coe_elem.get(attr, 'false').lower() in ('true', '1'):
+                        self.coe_details |= bit
             if mailbox_elem.find('FoE') is not None:
                 self.mailbox_protocols |= 0x08  # FoE
-            if mailbox_elem.find('EoE') is not None:
-                self.mailbox_protocols |= 0x10  # EoE
             if mailbox_elem.find('SoE') is not None:
-                self.mailbox_protocols |= 0x20  # SoE
+                self.mailbox_protocols |= 0x10  # SoE
+            if mailbox_elem.find('VoE') is not None:
+                self.mailbox_protocols |= 0x20  # VoE
 
-        # 从SM配置中获取邮箱地址和大小
-        sm_elems = device_elem.findall('.//Sm')
-        for i, sm_elem in enumerate(sm_elems):
+        # 从SM配置中获取邮箱地址和大小，类型由Sm的文本决定
+        sm_types = {'MBoxOut': 1, 'MBoxIn': 2, 'Outputs': 3, 'Inputs': 4}
+        for sm_elem in device_elem.findall('Sm'):
             start_addr = self.parse_hex_value(sm_elem.get('StartAddress', '0'))
             size = self.parse_hex_value(sm_elem.get('DefaultSize', '0'))
+            control = self.parse_hex_value(sm_elem.get('ControlByte', '0'))
+            enable = self.parse_hex_value(sm_elem.get('Enable', '0'))
+            sm_type = sm_types.get((sm_elem.text or '').strip(), 0)
+
+            self.sms.append((start_addr, size, control, enable, sm_type))
 
-            if i == 0:  # MBoxOut (接收)
+            if sm_type == 1:  # MBoxOut (接收)
                 self.boot_rx_mailbox = {"offset": start_addr, "size": size}
                 self.std_rx_mailbox = {"offset": start_addr, "size": size}
-            elif i == 1:  # MBoxIn (发送)
+            elif sm_type == 2:  # MBoxIn (发送)
                 self.boot_tx_mailbox = {"offset": start_addr, "size": size}
                 self.std_tx_mailbox = {"offset": start_addr, "size": size}
 
+        # Eeprom/ConfigData是头部的前几个字 (PDI控制, PDI配置, 同步脉冲, PDI配置2, 别名)
+        config_elem = device_elem.find('Eeprom/ConfigData')
+        if config_elem is not None and config_elem.text:
+            data = bytes.fromhex(config_elem.text.strip())
+            self.config_data = data[:10] + self.config_data[len(data[:10]):]
+
+    # SII Entry的DataType, ETG.1000.6的数据类型编号
+    DATA_TYPES = {'BOOL': 0x01, 'BIT': 0x01, 'SINT': 0x02, 'INT': 0x03, 'DINT': 0x04,
+                  'USINT': 0x05, 'UINT': 0x06, 'UDINT': 0x07, 'REAL': 0x08,
+                  'LREAL': 0x11, 'LINT': 0x15, 'ULINT': 0x1B}
+
+    def parse_pdo(self, pdo_elem, slot: int = 0, pdo_increment: int = 0, index_increment: int = 0,
+                  from_module: bool = False):
+        """解析一个RxPdo/TxPdo, DependOnSlot的索引按slot偏移"""
+        index_elem = pdo_elem.find('Index')
+        index = self.parse_hex_value(index_elem.text)
+        flags = 0x0080 if from_module else 0x0000  # PDOFROMMODULE
+        if index_elem.get('DependOnSlot', 'false').lower() in ('true', '1'):
+            index += slot * pdo_increment
+            flags |= 0x0200  # PDODEPENDONSLOT
+        if pdo_elem.get('Mandatory', 'false').lower() in ('true', '1'):
+            flags |= 0x0001
+        if pdo_elem.get('Fixed', 'false').lower() in ('true', '1'):
+            flags |= 0x0010
+
+        # 没有Sm的PDO是可选的, SII里为0xFF
+        sm = pdo_elem.get('Sm')
+        sm = int(sm) if sm is not None else 0xFF
+
+        entries = []
+        for entry_elem in pdo_elem.findall('Entry'):
+            entry_index_elem = entry_elem.find('Index')
+            entry_index = self.parse_hex_value(entry_index_elem.text)
+            if entry_index and entry_index_elem.get('DependOnSlot', 'false').lower() in ('true', '1'):
+                entry_index += slot * index_increment
+            subindex_elem = entry_elem.find('SubIndex')
+            subindex = self.parse_hex_value(subindex_elem.text) if subindex_elem is not None else 0
+            bitlen = int(entry_elem.find('BitLen').text.strip())
+            name_elem = entry_elem.find('Name')
+            name = name_elem.text.strip() if name_elem is not None and name_elem.text else ""
+            type_elem = entry_elem.find('DataType')
+            data_type = self.DATA_TYPES.get(type_elem.text.strip(), 0) if type_elem is not None and type_elem.text else 0
+            entries.append((entry_index, subindex, name, data_type, bitlen))
+
+        name_elem = pdo_elem.find('Name')
+        name = name_elem.text.strip() if name_elem is not None and name_elem.text else ""
+
+        return (index, sm, name, flags, entries)
+
+    def parse_pdo_info(self, device_elem, modules_elem):
+        """解析设备的PDO和每个Slot默认模块的PDO"""
+        for pdo_elem in device_elem.findall('RxPdo'):
+            self.rxpdos.append(self.parse_pdo(pdo_elem))
+        for pdo_elem in device_elem.findall('TxPdo'):
+            self.txpdos.append(self.parse_pdo(pdo_elem))
+
+        slots_elem = device_elem.find('Slots')
+        if slots_elem is None or modules_elem is None:
+            return
+
+        modules = {}
+        for module_elem in modules_elem.findall('Module'):
+            type_elem = module_elem.find('Type')
+            if type_elem is not None and type_elem.get('ModuleIdent'):
+                modules[self.parse_hex_value(type_elem.get('ModuleIdent'))] = module_elem
+
+        pdo_increment = self.parse_hex_value(slots_elem.get('SlotPdoIncrement', '0'))
+        index_increment = self.parse_hex_value(slots_elem.get('SlotIndexIncrement', '0'))
+
+        for slot, slot_elem in enumerate(slots_elem.findall('Slot')):
+            for ident_elem in slot_elem.findall('ModuleIdent'):
+                if ident_elem.get('Default', '0') not in ('1', 'true'):
+                    continue
+                module_elem = modules.get(self.parse_hex_value(ident_elem.text))
+                if module_elem is None:
+                    continue
+                for pdo_elem in module_elem.findall('RxPdo'):
+                    self.rxpdos.append(self.parse_pdo(pdo_elem, slot, pdo_increment, index_increment, True))
+                for pdo_elem in module_elem.findall('TxPdo'):
+                    self.txpdos.append(self.parse_pdo(pdo_elem, slot, pdo_increment, index_increment, True))
+
     def add_string(self, text: str) -> int:
         """添加字符串到字符串表，返回索引"""
         if not text:
@@ -148,68 +258,48 @@ class EtherCATXMLParser:
         return bytes(data)
 
     def create_general_category(self) -> bytes:
-        """创建通用类别(Category 30)"""
+        """创建通用类别(Category 30), 32字节, 与ec_sii_general_t一致"""
         data = bytearray()
 
-        # Group Type String Index (2 bytes)
-        group_idx = self.add_string("ECAT_Device")
-        data.extend(struct.pack('<H', group_idx))
-
-        # Image Name String Index (2 bytes)
-        image_idx = self.add_string("ECAT_CIA402")
-        data.extend(struct.pack('<H', image_idx))
-
-        # Order Number String Index (2 bytes)
-        order_idx = self.add_string("")
-        data.extend(struct.pack('<H', order_idx))
-
-        # Device Name String Index (2 bytes)
-        name_idx = self.add_string(self.device_name)
-        data.extend(struct.pack('<H', name_idx))
-
-        # CoE Details (2 bytes) - 支持SDO, PDO配置
-        coe_details = 0x0027  # Enable SDO, SDO Info, PDO Assign, PDO Config
-        data.extend(struct.pack('<H', coe_details))
+        # 字符串索引各1字节: Group Type, Image Name, Order Number, Device Name
+        data.append(self.add_string("ECAT_Device"))
+        data.append(self.add_string("ECAT_CIA402"))
+        data.append(self.add_string(self.device_type))
+        data.append(self.add_string(self.device_name))
 
-        # FoE Details (2 bytes)
-        foe_details = 0x0000
-        data.extend(struct.pack('<H', foe_details))
+        # Reserved (1 byte)
+        data.append(0x00)
 
-        # EoE Details (2 bytes)
-        eoe_details = 0x0000
-        data.extend(struct.pack('<H', eoe_details))
+        # CoE Details (1 byte) - 来自Mailbox/CoE的属性
+        data.append(self.coe_details)
 
-        # SoE Channels (1 byte)
-        soe_channels = 0x00
-        data.append(soe_channels)
+        # FoE Details, EoE Details (1 byte each)
+        data.append(0x01 if self.mailbox_protocols & 0x08 else 0x00)
+        data.append(0x01 if self.mailbox_protocols & 0x02 else 0x00)
 
-        # DS402 Channels (1 byte)
-        ds402_channels = 0x01
-        data.append(ds402_channels)
-
-        # SysmanClass (1 byte)
-        sysman_class = 0x00
-        data.append(sysman_class)
+        # SoE Channels, DS402 Channels, SysmanClass (1 byte each)
+        data.append(0x00)
+        data.append(0x01)
+        data.append(0x00)
 
         # Flags (1 byte)
         flags = 0x01  # Enable SafeOp
         data.append(flags)
 
         # Current Consumption (2 bytes)
-        current = 0x0000
-        data.extend(struct.pack('<H', current))
+        data.extend(struct.pack('<h', 0))
+
+        # Reserved (2 bytes)
+        data.extend(struct.pack('<H', 0x0000))
 
-        # Group Type and Image Name for 2nd device (if any)
-        data.extend(struct.pack('<H', 0x0000))  # Group Type 2
-        data.extend(struct.pack('<H', 0x0000))  # Image Name 2
+        # Physical Port (2 bytes), 端口0/1为MII
+        data.extend(struct.pack('<H', 0x0011))
 
         # Physical Memory Address (2 bytes)
-        phys_addr = 0x0000
-        data.extend(struct.pack('<H', phys_addr))
+        data.extend(struct.pack('<H', 0x0000))
 
-        # 填充到偶数长度
-        if len(data) % 2:
-            data.append(0)
+        # Padding (12 bytes)
+        data.extend(b'\x00' * 12)
 
         return bytes(data)
 
@@ -238,31 +328,40 @@ class EtherCATXMLParser:
         """创建同步管理器类别(Category 41)"""
         data = bytearray()
 
-        # SM配置数据结构: StartAddr(2) + Length(2) + ControlByte(1) + Enable(1)
-        sm_configs = [
-            # SM0: MBoxOut (接收邮箱)
-            (self.boot_rx_mailbox["offset"], self.boot_rx_mailbox["size"], 0x26, 0x01),
-            # SM1: MBoxIn (发送邮箱)
-            (self.boot_tx_mailbox["offset"], self.boot_tx_mailbox["size"], 0x22, 0x01),
-            # SM2: Process Data Output
-            (0x1100, 0x0000, 0x64, 0x00),  # 长度为0表示未配置
-            # SM3: Process Data Input
-            (0x1400, 0x0000, 0x20, 0x00),  # 长度为0表示未配置
-            # SM4-7: 未使用
-            (0x0000, 0x0000, 0x00, 0x00),
-            (0x0000, 0x0000, 0x00, 0x00),
-            (0x0000, 0x0000, 0x00, 0x00),
-            (0x0000, 0x0000, 0x00, 0x00),
-        ]
-
-        for start_addr, length, control, enable in sm_configs:
+        # SM配置数据结构: StartAddr(2) + Length(2) + ControlByte(1) + Status(1) + Enable(1) + Type(1)
+        for start_addr, length, control, enable, sm_type in self.sms:
             data.extend(struct.pack('<H', start_addr))  # Start Address
             data.extend(struct.pack('<H', length))      # Length
             data.append(control)                        # Control Byte
+            data.append(0x00)                           # Status (不使用)
             data.append(enable)                         # Enable
+            data.append(sm_type)                        # Type
 
         return bytes(data)
 
+    def create_pdo_category(self, pdos) -> bytes:
+        """创建TxPDO/RxPDO类别(Category 50/51)"""
+        data = bytearray()
+
+        # PDO: Index(2) + nEntry(1) + SyncM(1) + Synchronization(1) + NameIdx(1) + Flags(2)
+        # Entry: Index(2) + SubIndex(1) + NameIdx(1) + DataType(1) + BitLen(1) + Flags(2)
+        for index, sm, name, flags, entries in pdos:
+            data.extend(struct.pack('<HBBBBH', index, len(entries), sm, 0x00, self.add_string(name), flags))
+            for entry_index, subindex, entry_name, data_type, bitlen in entries:
+                data.extend(struct.pack('<HBBBBH', entry_index, subindex, self.add_string(entry_name),
+                                        data_type, bitlen, 0x0000))
+
+        return bytes(data)
+
+    def calc_crc8(self, data: bytes) -> int:
+        """头部校验和, CRC8 多项式0x07, 初值0xFF"""
+        crc = 0xFF
+        for b in data:
+            crc ^= b
+            for _ in range(8):
+                crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+        return crc
+
     def create_category(self, category_type: int, data: bytes) -> bytes:
         """创建类别头部+数据"""
         header = bytearray()
@@ -282,27 +381,15 @@ class EtherCATXMLParser:
 
         # === EEPROM Header (固定128字节) ===
 
-        # PDI Control (2 bytes) - 0x800C (Digital I/O + SII EEPROM)
-        eeprom_data.extend(struct.pack('<H', 0x800C))
-
-        # PDI Configuration (2 bytes) - 0x6681
-        eeprom_data.extend(struct.pack('<H', 0x6681))
-
-        # Sync Impulse Length (2 bytes)
-        eeprom_data.extend(struct.pack('<H', 0x0000))
+        # 字0-4: PDI Control, PDI Configuration, Sync Impulse Length, PDI Configuration 2, Station Alias
+        eeprom_data.extend(self.config_data)
 
-        # PDI Configuration 2 (2 bytes)
-        eeprom_data.extend(struct.pack('<H', 0x0000))
-
-        # Station Alias (2 bytes)
-        eeprom_data.extend(struct.pack('<H', 0x3412))
-
-        # Reserved (2 bytes)
-        eeprom_data.extend(struct.pack('<H', 0x0000))
+        # Reserved (4 bytes)
+        eeprom_data.extend(b'\x00' * 4)
 
         # Checksum (2 bytes) - 稍后计算
         checksum_pos = len(eeprom_data)
-        eeprom_data.extend(struct.pack('<H', 0x0077))  # 临时值
+        eeprom_data.extend(struct.pack('<H', 0x0000))
 
         # Vendor ID (4 bytes)
         eeprom_data.extend(struct.pack('<L', self.vendor_id))
@@ -316,6 +403,9 @@ class EtherCATXMLParser:
         # Serial Number (4 bytes)
         eeprom_data.extend(struct.pack('<L', self.serial_number))
 
+        # Reserved (8 bytes)
+        eeprom_data.extend(b'\x00' * 8)
+
         # Bootstrap Mailbox Receive Offset (2 bytes)
         eeprom_data.extend(struct.pack('<H', self.boot_rx_mailbox["offset"]))
 
@@ -343,21 +433,28 @@ class EtherCATXMLParser:
         # Mailbox Protocol (2 bytes)
         eeprom_data.extend(struct.pack('<H', self.mailbox_protocols))
 
-        # Reserved bytes to reach 128 bytes header
-        current_size = len(eeprom_data)
-        header_size = 128
-        if current_size < header_size:
-            eeprom_data.extend(b'\x00' * (header_size - current_size))
+        # Reserved bytes up to word 0x3E
+        eeprom_data.extend(b'\x00' * (0x7C - len(eeprom_data)))
+
+        # Size (2 bytes), (ByteSize / 128) - 1 in KBit
+        eeprom_data.extend(struct.pack('<H', self.eeprom_size * 8 // 1024 - 1))
+
+        # Version (2 bytes)
+        eeprom_data.extend(struct.pack('<H', 0x0001))
 
         # === Categories Section ===
 
+        # General和PDO先生成, 它们会把名称加入字符串表
+        general_data = self.create_general_category()
+        txpdo_data = self.create_pdo_category(self.txpdos)
+        rxpdo_data = self.create_pdo_category(self.rxpdos)
+
         # Category 10: Strings
         strings_data = self.create_strings_category()
         if strings_data:
             eeprom_data.extend(self.create_category(10, strings_data))
 
         # Category 30: General
-        general_data = self.create_general_category()
         eeprom_data.extend(self.create_category(30, general_data))
 
         # Category 40: FMMU
@@ -368,27 +465,22 @@ class EtherCATXMLParser:
         sm_data = self.create_sm_category()
         eeprom_data.extend(self.create_category(41, sm_data))
 
+        # Category 50/51: TxPDO, RxPDO
+        if txpdo_data:
+            eeprom_data.extend(self.create_category(50, txpdo_data))
+        if rxpdo_data:
+            eeprom_data.extend(self.create_category(51, rxpdo_data))
+
         # End of Categories marker
         eeprom_data.extend(struct.pack('<H', 0xFFFF))
         eeprom_data.extend(struct.pack('<H', 0x0000))
 
-        # 填充到合适的大小 (通常是2KB)
-        target_size = 2048
-        if len(eeprom_data) < target_size:
-            eeprom_data.extend(b'\xFF' * (target_size - len(eeprom_data)))
-
-        # 重新计算校验和 (SII头部校验和)
-        checksum = 0
-        # 计算前14字节的校验和，跳过校验和字段本身
-        for i in range(0, 14, 2):
-            if i != 12:  # 跳过校验和位置
-                word = struct.unpack('<H', eeprom_data[i:i+2])[0]
-                checksum += word
-
-        checksum = (~checksum + 1) & 0xFFFF  # 2's complement
+        # 填充到Eeprom/ByteSize (通常是2KB)
+        if len(eeprom_data) < self.eeprom_size:
+            eeprom_data.extend(b'\xFF' * (self.eeprom_size - len(eeprom_data)))
 
-        # 更新校验和
-        struct.pack_into('<H', eeprom_data, checksum_pos, checksum)
+        # 头部校验和: 前14字节的CRC8, 高字节为0
+        struct.pack_into('<H', eeprom_data, checksum_pos, self.calc_crc8(eeprom_data[0:14]))
 
         return bytes(eeprom_data)
 
@@ -408,11 +500,13 @@ class EtherCATXMLParser:
             if device_elem is not None:
                 self.parse_device_info(device_elem)
                 self.parse_mailbox_info(device_elem)
+                self.parse_pdo_info(device_elem, root.find('.//Modules'))
 
             print(f"Parsed XML: Vendor=0x{self.vendor_id:08X}, Product=0x{self.product_code:08X}")
             print(f"Device Name: {self.device_name}")
             print(f"Mailbox RX: 0x{self.std_rx_mailbox['offset']:04X}({self.std_rx_mailbox['size']})")
             print(f"Mailbox TX: 0x{self.std_tx_mailbox['offset']:04X}({self.std_tx_mailbox['size']})")
+            print(f"PDOs: " + ", ".join(f"0x{pdo[0]:04X}(Sm{pdo[1]})" for pdo in self.rxpdos + self.txpdos))
 
             return True
 
@@ -453,15 +547,17 @@ class EtherCATXMLParser:
 
 def main():
     if len(sys.argv) < 3:
-        print("Usage: python esi_parse.py <input.xml> <output.bin> [output.h]")
+        print("Usage: python esi_parse.py <input.xml> <output.bin> [output.h] [array_name]")
         print("  input.xml  - EtherCAT ESI XML file")
         print("  output.bin - Output binary EEPROM file")
         print("  output.h   - Optional C header file output")
+        print("  array_name - Optional C array name, default cherryecat_eepromdata")
         sys.exit(1)
 
     input_file = sys.argv[1]
     output_file = sys.argv[2]
     header_file = sys.argv[3] if len(sys.argv) > 3 else None
+    array_name = sys.argv[4] if len(sys.argv) > 4 else "cherryecat_eepromdata"
 
     if not os.path.exists(input_file):
         print(f"Error: Input file '{input_file}' not found")
@@ -499,7 +595,7 @@ def main():
     # 生成C头文件(可选)
     if header_file:
         try:
-            header_content = parser.generate_c_header()
+            header_content = parser.generate_c_header(array_name)
             with open(header_file, 'w') as f:
                 f.write(header_content)
             print(f"✓ Generated C header file: {header_file}")
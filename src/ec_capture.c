@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+
+#ifdef CONFIG_EC_CAPTURE
+
+/*
+ * Frames are copied into fixed slots inside a critical section, tx and rx may come from
+ * different contexts. After a trigger half of the ring is filled with the frames that follow,
+ * then the capture stops, so the ring holds the frames around the event.
+ */
+
+#define EC_PCAP_MAGIC_NS   0xa1b23c4d /* pcap with nanosecond timestamps */
+#define EC_PCAP_DLT_EN10MB 1
+
+void ec_capture_frame(ec_master_t *master, uint8_t netdev_idx, uint8_t dir, const uint8_t *frame, uint32_t size)
+{
+    ec_capture_t *capture = &master->capture;
+    ec_capture_frame_t *entry;
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    if (!capture->enable) {
+        ec_osal_leave_critical_section(flags);
+        return;
+    }
+
+    entry = &capture->frames[capture->head];
+    capture->head = (capture->head + 1 == CONFIG_EC_CAPTURE_FRAMES) ? 0 : (capture->head + 1);
+    capture->count++;
+
+    entry->time = jiffies;
+    entry->size = size;
+    entry->caplen = MIN(size, CONFIG_EC_CAPTURE_SNAPLEN);
+    entry->netdev_idx = netdev_idx;
+    entry->dir = dir;
+    ec_memcpy(entry->data, frame, entry->caplen);
+
+    if (capture->triggered && (--capture->post_count == 0)) {
+        capture->enable = false;
+    }
+    ec_osal_leave_critical_section(flags);
+}
+
+void ec_capture_trigger(ec_master_t *master, uint8_t trigger)
+{
+    ec_capture_t *capture = &master->capture;
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    if (capture->enable && (capture->trigger_mask & trigger) && !capture->triggered) {
+        capture->triggered = trigger;
+        capture->post_count = CONFIG_EC_CAPTURE_FRAMES / 2;
+    }
+    ec_osal_leave_critical_section(flags);
+}
+
+void ec_master_capture_start(ec_master_t *master, uint8_t trigger_mask)
+{
+    ec_capture_t *capture = &master->capture;
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    capture->trigger_mask = trigger_mask;
+    capture->triggered = 0;
+    capture->post_count = 0;
+    capture->count = 0;
+    capture->head = 0;
+    capture->enable = true;
+    ec_osal_leave_critical_section(flags);
+}
+
+void ec_master_capture_stop(ec_master_t *master)
+{
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    master->capture.enable = false;
+    ec_osal_leave_critical_section(flags);
+}
+
+uint32_t ec_master_capture_export(ec_master_t *master, ec_capture_write_t write, void *arg)
+{
+    ec_capture_t *capture = &master->capture;
+    ec_capture_frame_t *entry;
+    uint8_t header[24];
+    uint32_t count;
+    uint32_t index;
+
+    ec_master_capture_stop(master);
+
+    count = MIN(capture->count, CONFIG_EC_CAPTURE_FRAMES);
+    index = (capture->count > CONFIG_EC_CAPTURE_FRAMES) ? capture->head : 0;
+
+    EC_WRITE_U32(&header[0], EC_PCAP_MAGIC_NS);
+    EC_WRITE_U16(&header[4], 2);
+    EC_WRITE_U16(&header[6], 4);
+    EC_WRITE_U32(&header[8], 0);
+    EC_WRITE_U32(&header[12], 0);
+    EC_WRITE_U32(&header[16], CONFIG_EC_CAPTURE_SNAPLEN);
+    EC_WRITE_U32(&header[20], EC_PCAP_DLT_EN10MB);
+    write(arg, header, 24);
+
+    for (uint32_t i = 0; i < count; i++) {
+        entry = &capture->frames[index];
+        index = (index + 1 == CONFIG_EC_CAPTURE_FRAMES) ? 0 : (index + 1);
+
+        EC_WRITE_U32(&header[0], (uint32_t)(entry->time / 1000000000ULL));
+        EC_WRITE_U32(&header[4], (uint32_t)(entry->time % 1000000000ULL));
+        EC_WRITE_U32(&header[8], entry->caplen);
+        EC_WRITE_U32(&header[12], entry->size);
+        write(arg, header, 16);
+        write(arg, entry->data, entry->caplen);
+    }
+
+    return count;
+}
+
+#endif
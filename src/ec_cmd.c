@@ -64,9 +64,25 @@ static void ec_master_cmd_show_help(void)
     EC_LOG_RAW("  sii_read -p [idx]                              Read SII\n");
     EC_LOG_RAW("  sii_write -p [idx]                             Write SII\n");
     EC_LOG_RAW("  wc                                             Show master working counter\n");
+    EC_LOG_RAW("  wc -v                                          Show working counter fault statistics\n");
+    EC_LOG_RAW("  wc -c                                          Clear working counter fault statistics\n");
+#ifdef CONFIG_EC_DC_MONITOR
+    EC_LOG_RAW("  dc -v                                          Show DC system time difference statistics\n");
+    EC_LOG_RAW("  dc -c                                          Clear DC system time difference statistics\n");
+#endif
     EC_LOG_RAW("  perf -s                                        Start performance test\n");
     EC_LOG_RAW("  perf -d                                        Stop performance test\n");
     EC_LOG_RAW("  perf -v                                        Show performance statistics\n");
+#ifdef CONFIG_EC_CAPTURE
+    EC_LOG_RAW("  capture -s [mask]                              Start frame capture, stop on trigger <mask> (1 timeout, 2 wc, 4 unmatched)\n");
+    EC_LOG_RAW("  capture -d                                     Stop frame capture and dump it as pcap hex (xxd -r -p)\n");
+    EC_LOG_RAW("  capture -v                                     Show frame capture state\n");
+#endif
+#ifdef CONFIG_EC_TRACE
+    EC_LOG_RAW("  trace -s [freeze_ns]                           Start cycle trace, stop when period deviates more than <freeze_ns>\n");
+    EC_LOG_RAW("  trace -d                                       Stop cycle trace and dump it as Chrome/Perfetto json\n");
+    EC_LOG_RAW("  trace -v                                       Show cycle trace state\n");
+#endif
     EC_LOG_RAW("  help                                           Show this help\n\n");
 }
 
@@ -230,7 +246,7 @@ static void ec_cmd_show_slave_detail(ec_master_t *master, uint32_t slave_idx)
 
     EC_LOG_RAW("Port  Type  Link  Loop    Signal  NextSlave");
     if (slave_data.base_dc_supported) {
-        EC_LOG_RAW("  RxTime [ns]  Diff [ns]   NextDc [ns]");
+        EC_LOG_RAW("  RxTime [ns]  Diff [ns]   NextDc [ns]  Var [ns^2]  Samples");
     }
     EC_LOG_RAW("\n");
 
@@ -250,12 +266,14 @@ static void ec_cmd_show_slave_detail(ec_master_t *master, uint32_t slave_idx)
 
         if (slave_data.base_dc_supported) {
             if (!slave_data.ports[port_idx].link.loop_closed) {
-                EC_LOG_RAW("  %11u  %10d  %10d",
+                EC_LOG_RAW("  %11u  %10d  %10d   %10u  %u",
                            slave_data.ports[port_idx].receive_time,
                            slave_data.ports[port_idx].receive_time - slave_data.ports[0].receive_time,
-                           slave_data.ports[port_idx].delay_to_next_dc);
+                           slave_data.ports[port_idx].delay_to_next_dc,
+                           slave_data.ports[port_idx].receive_time_var,
+                           slave_data.ports[port_idx].receive_time_samples);
             } else {
-                EC_LOG_RAW("  %11s  %10s  %10s", "-", "-", "-");
+                EC_LOG_RAW("  %11s  %10s  %10s   %10s  %s", "-", "-", "-", "-", "-");
             }
         }
 
@@ -377,6 +395,66 @@ static void ec_cmd_show_slave_pdos(ec_master_t *master, uint32_t slave_idx)
     }
 }
 
+#ifdef CONFIG_EC_PERF_HIST
+static const char *ec_perf_hist_string[EC_PERF_HIST_NUM] = {
+    "Period   ",
+    "Send exec",
+    "Recv exec",
+    "RTT      ",
+    "DC offset",
+};
+
+static void ec_cmd_show_perf_hist(ec_master_t *master, bool buckets)
+{
+    static ec_perf_hist_t hist;
+
+    for (uint8_t i = 0; i < EC_PERF_HIST_NUM; i++) {
+        ec_master_get_perf_hist(master, i, &hist);
+
+        EC_LOG_RAW("%s p50 = %10u, p99 = %10u, p99.9 = %10u, max = %10u ns, samples = %u\n",
+                   ec_perf_hist_string[i],
+                   ec_perf_hist_percentile(&hist, 500),
+                   ec_perf_hist_percentile(&hist, 990),
+                   ec_perf_hist_percentile(&hist, 999),
+                   hist.count ? hist.max : 0,
+                   hist.count);
+
+        if (!buckets) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < EC_PERF_HIST_BUCKETS; j++) {
+            if (hist.buckets[j] == 0) {
+                continue;
+            }
+            if (j == (EC_PERF_HIST_BUCKETS - 1)) {
+                EC_LOG_RAW("    >= %10u ns: %u\n", ec_perf_hist_bucket_low(j), hist.buckets[j]);
+            } else {
+                EC_LOG_RAW("    %10u - %10u ns: %u\n",
+                           ec_perf_hist_bucket_low(j),
+                           ec_perf_hist_bucket_low(j + 1) - 1,
+                           hist.buckets[j]);
+            }
+        }
+    }
+}
+#endif
+
+#ifdef CONFIG_EC_CAPTURE
+static void ec_cmd_capture_write_hex(void *arg, const uint8_t *data, uint32_t size)
+{
+    uint32_t *column = (uint32_t *)arg;
+
+    for (uint32_t i = 0; i < size; i++) {
+        EC_LOG_RAW("%02x", data[i]);
+        if (++(*column) == 32) {
+            *column = 0;
+            EC_LOG_RAW("\n");
+        }
+    }
+}
+#endif
+
 static void ec_cmd_slave_state_request(ec_master_t *master, uint32_t slave_idx, ec_slave_state_t state)
 {
     if (slave_idx >= master->slave_count) {
@@ -459,7 +537,8 @@ int ethercat(int argc, const char **argv)
         ec_master_cmd_show_help();
         return 0;
     } else if (strcmp(argv[1], "start") == 0) {
-        static ec_slave_config_t slave_config[32];
+        static ec_slave_config_t *slave_config = NULL;
+        static uint32_t slave_config_count = 0;
         uint8_t motor_mode;
 
         if (argc == 4) {
@@ -468,6 +547,29 @@ int ethercat(int argc, const char **argv)
             motor_mode = 0;
         }
 
+        // grows with the bus, the configs stay referenced by the slaves after the command
+        if (global_cmd_master->slave_count > slave_config_count) {
+            ec_slave_config_t *configs = ec_osal_malloc(global_cmd_master->slave_count * sizeof(ec_slave_config_t));
+            if (!configs) {
+                EC_LOG_ERR("No memory for %u slave configs\n", global_cmd_master->slave_count);
+                return -1;
+            }
+
+            if (slave_config) {
+                for (uint32_t i = 0; i < global_cmd_master->slave_count; i++) {
+                    if (global_cmd_master->slaves[i].config >= slave_config &&
+                        global_cmd_master->slaves[i].config < &slave_config[slave_config_count]) {
+                        global_cmd_master->slaves[i].config = NULL;
+                    }
+                }
+                ec_osal_free(slave_config);
+            }
+
+            slave_config = configs;
+            slave_config_count = global_cmd_master->slave_count;
+        }
+        memset(slave_config, 0, slave_config_count * sizeof(ec_slave_config_t));
+
         for (uint32_t i = 0; i < global_cmd_master->slave_count; i++) {
             ret = ec_master_find_slave_sync_info(global_cmd_master->slaves[i].sii.vendor_id,
                                                  global_cmd_master->slaves[i].sii.product_code,
@@ -475,6 +577,12 @@ int ethercat(int argc, const char **argv)
                                                  motor_mode,
                                                  &slave_config[i].sync,
                                                  &slave_config[i].sync_count);
+            // not in the table, fall back to the PDO layout of the SII
+            if (ret != 0 && global_cmd_master->slaves[i].sii.sync_count) {
+                slave_config[i].sync = global_cmd_master->slaves[i].sii.sync;
+                slave_config[i].sync_count = global_cmd_master->slaves[i].sii.sync_count;
+                ret = 0;
+            }
             if (ret != 0) {
                 EC_LOG_ERR("Failed to find slave sync info: vendor_id=0x%08x, product_code=0x%08x\n",
                            global_cmd_master->slaves[i].sii.vendor_id,
@@ -574,20 +682,107 @@ int ethercat(int argc, const char **argv)
                        global_cmd_master->index,
                        global_cmd_master->actual_working_counter,
                        global_cmd_master->expected_working_counter);
-#ifdef CONFIG_EC_PDO_MULTI_DOMAIN
+            for (uint8_t i = 0; i < global_cmd_master->domain_count; i++) {
+                ec_domain_t *domain = &global_cmd_master->domains[i];
+
+                if (domain->slave_count == 0) {
+                    continue;
+                }
+
+                EC_LOG_RAW("  Domain %u (1/%u cycles, offset %u) (actual/expect): %u/%u\n",
+                           domain->index,
+                           domain->cycle_divisor,
+                           domain->actual_cycle_offset,
+                           domain->actual_working_counter,
+                           domain->expected_working_counter);
+                if (domain->lwr_expected_working_counter || domain->lrd_expected_working_counter) {
+                    EC_LOG_RAW("    LRW (actual/expect): %u/%u\n",
+                               domain->lrw_actual_working_counter,
+                               domain->lrw_expected_working_counter);
+                    EC_LOG_RAW("    LWR (actual/expect): %u/%u\n",
+                               domain->lwr_actual_working_counter,
+                               domain->lwr_expected_working_counter);
+                    EC_LOG_RAW("    LRD (actual/expect): %u/%u\n",
+                               domain->lrd_actual_working_counter,
+                               domain->lrd_expected_working_counter);
+                }
+            }
+            return 0;
+        } else if (argc == 3 && strcmp(argv[2], "-v") == 0) {
+            // ethercat wc -v
+            EC_LOG_RAW("Master %d working counter errors: %u, diagnoses: %u\n",
+                       global_cmd_master->index,
+                       global_cmd_master->stats.wc_errors,
+                       global_cmd_master->stats.wc_diags);
             for (uint32_t i = 0; i < global_cmd_master->slave_count; i++) {
-                EC_LOG_RAW("%-3u  %u:%04x         (actual/expect): %u/%u\n",
+                EC_LOG_RAW("%-3u  %u:%04x  faults: %-8u last state: %s, alstatus code: 0x%04x\n",
                            global_cmd_master->index,
                            i,
                            global_cmd_master->slaves[i].autoinc_address,
-                           global_cmd_master->slaves[i].actual_working_counter,
-                           global_cmd_master->slaves[i].expected_working_counter);
+                           global_cmd_master->slaves[i].wc_fault_count,
+                           ec_state_string(global_cmd_master->slaves[i].wc_diag_alstatus & 0xff, 0),
+                           global_cmd_master->slaves[i].wc_diag_alstatus_code);
             }
-#endif
+            return 0;
+        } else if (argc == 3 && strcmp(argv[2], "-c") == 0) {
+            // ethercat wc -c
+            uintptr_t flags;
+
+            flags = ec_osal_enter_critical_section();
+            ec_master_clear_wc_error_count(global_cmd_master);
+            ec_osal_leave_critical_section(flags);
             return 0;
         } else {
         }
-    } else if (argc >= 5 && strcmp(argv[1], "coe_read") == 0) {
+    }
+#ifdef CONFIG_EC_DC_MONITOR
+    else if (argc == 3 && strcmp(argv[1], "dc") == 0) {
+        if (strcmp(argv[2], "-v") == 0) {
+            // ethercat dc -v
+            ec_dc_monitor_stats_t stats;
+
+            EC_LOG_RAW("Master %d DC bus deviation <= %u ns, slaves out of sync: %u\n",
+                       global_cmd_master->index,
+                       ec_master_get_dc_bus_deviation(global_cmd_master),
+                       global_cmd_master->dc_monitor.out_of_sync);
+            EC_LOG_RAW("Histogram buckets: <64, <128, <256, <512, <1k, <2k, <4k, >=4k ns\n");
+            for (uint32_t i = 0; i < global_cmd_master->slave_count; i++) {
+                if (!global_cmd_master->slaves[i].base_dc_supported ||
+                    (&global_cmd_master->slaves[i] == global_cmd_master->dc_ref_clock)) {
+                    continue;
+                }
+
+                ec_master_get_slave_dc_stats(global_cmd_master, i, &stats);
+                EC_LOG_RAW("%-3u  %u:%04x  %s last: %8d ns, max: %8u ns, samples: %u, lost: %u, no response: %u\n",
+                           global_cmd_master->index,
+                           i,
+                           global_cmd_master->slaves[i].autoinc_address,
+                           stats.out_of_sync ? "UNSYNC" : "SYNC  ",
+                           stats.last_ns,
+                           stats.max_ns,
+                           stats.samples,
+                           stats.sync_loss_count,
+                           stats.no_response);
+                EC_LOG_RAW("     ");
+                for (uint8_t j = 0; j < EC_DC_MONITOR_HIST_BUCKETS; j++) {
+                    EC_LOG_RAW(" %8u", stats.hist[j]);
+                }
+                EC_LOG_RAW("\n");
+            }
+            return 0;
+        } else if (strcmp(argv[2], "-c") == 0) {
+            // ethercat dc -c
+            uintptr_t flags;
+
+            flags = ec_osal_enter_critical_section();
+            ec_master_clear_dc_stats(global_cmd_master);
+            ec_osal_leave_critical_section(flags);
+            return 0;
+        } else {
+        }
+    }
+#endif
+    else if (argc >= 5 && strcmp(argv[1], "coe_read") == 0) {
         // ethercat coe_read -p [slave_idx] [index] [subindex]
         static ec_datagram_t datagram;
         static uint8_t output_buffer[512];
@@ -874,6 +1069,11 @@ int ethercat(int argc, const char **argv)
 
             global_cmd_master->min_offset_ns = INT32_MAX;
             global_cmd_master->max_offset_ns = INT32_MIN;
+#ifdef CONFIG_EC_PERF_HIST
+            for (uint8_t i = 0; i < EC_PERF_HIST_NUM; i++) {
+                ec_perf_hist_clear(&global_cmd_master->perf_hist[i]);
+            }
+#endif
             ec_osal_leave_critical_section(flags);
             return 0;
         } else if (strcmp(argv[2], "-d") == 0) {
@@ -901,12 +1101,70 @@ int ethercat(int argc, const char **argv)
                 EC_LOG_RAW("Offset    min = %10d, max = %10d ns\n",
                            global_cmd_master->min_offset_ns,
                            global_cmd_master->max_offset_ns);
+                EC_LOG_RAW("DC ctrl   %s, drift = %10d ns/cycle\n",
+                           ec_dc_ctrl_is_locked(&global_cmd_master->dc_ctrl) ? "locked  " : "unlocked",
+                           ec_dc_ctrl_get_drift(&global_cmd_master->dc_ctrl));
+                EC_LOG_RAW("DC clock  %s, drift = %10d ppb, error = %10d ns\n",
+                           global_cmd_master->dc_clock.valid ? "valid   " : "invalid ",
+                           ec_dc_clock_get_drift_ppb(&global_cmd_master->dc_clock),
+                           global_cmd_master->dc_clock.last_error);
+#ifdef CONFIG_EC_PERF_HIST
+                ec_cmd_show_perf_hist(global_cmd_master, i == 9);
+#endif
 
                 ec_osal_msleep(1000);
             }
             return 0;
         }
-    } else {
+    }
+#ifdef CONFIG_EC_CAPTURE
+    else if (argc >= 3 && strcmp(argv[1], "capture") == 0) {
+        if (strcmp(argv[2], "-s") == 0) {
+            // ethercat capture -s [trigger_mask]
+            ec_master_capture_start(global_cmd_master, (argc >= 4) ? strtoul(argv[3], NULL, 0) : 0);
+            return 0;
+        } else if (strcmp(argv[2], "-d") == 0) {
+            // ethercat capture -d
+            uint32_t column = 0;
+
+            ec_master_capture_export(global_cmd_master, ec_cmd_capture_write_hex, &column);
+            if (column) {
+                EC_LOG_RAW("\n");
+            }
+            return 0;
+        } else if (strcmp(argv[2], "-v") == 0) {
+            // ethercat capture -v
+            EC_LOG_RAW("Capture %s, %u frames captured, trigger mask 0x%02x, triggered 0x%02x\n",
+                       global_cmd_master->capture.enable ? "running" : "stopped",
+                       global_cmd_master->capture.count,
+                       global_cmd_master->capture.trigger_mask,
+                       global_cmd_master->capture.triggered);
+            return 0;
+        } else {
+        }
+    }
+#endif
+#ifdef CONFIG_EC_TRACE
+    else if (argc >= 3 && strcmp(argv[1], "trace") == 0) {
+        if (strcmp(argv[2], "-s") == 0) {
+            // ethercat trace -s [freeze_ns]
+            ec_master_trace_start(global_cmd_master, (argc >= 4) ? strtoul(argv[3], NULL, 0) : 0);
+            return 0;
+        } else if (strcmp(argv[2], "-d") == 0) {
+            // ethercat trace -d
+            ec_master_trace_dump(global_cmd_master);
+            return 0;
+        } else if (strcmp(argv[2], "-v") == 0) {
+            // ethercat trace -v
+            EC_LOG_RAW("Trace %s, %u cycles recorded\n",
+                       ec_master_trace_running(global_cmd_master) ? "running" : "stopped",
+                       global_cmd_master->trace.cycle);
+            return 0;
+        } else {
+        }
+    }
+#endif
+    else {
     }
 
     EC_LOG_RAW("Invalid command: %s\n", argv[1]);
@@ -5,37 +5,27 @@
  */
 #include "ec_master.h"
 
-typedef struct __PACKED {
-    ec_coe_header_t coe_header;
-    ec_sdo_header_common_t sdo_header;
-    uint16_t index;
-    uint8_t subindex;
-    uint8_t data[4];
-} ec_coe_download_common_header_t;
-
-typedef struct __PACKED {
-    ec_coe_header_t coe_header;
-    ec_sdo_header_segment_t sdo_header;
-} ec_coe_download_segment_header_t;
-
-typedef ec_coe_download_common_header_t ec_coe_upload_common_header_t;
-typedef ec_coe_download_segment_header_t ec_coe_upload_segment_header_t;
+/* Requests are written byte by byte, the headers are little endian on the wire:
+ *
+ * 0: CoE header (2), 2: SDO command (1), 3: index (2), 5: subindex (1), 6: data or size (4)
+ * 0: CoE header (2), 2: SDO segment command (1), 3: segment data
+ */
 
 /** CoE download request header size.
  */
-#define EC_COE_DOWN_REQ_HEADER_SIZE (sizeof(ec_coe_download_common_header_t))
+#define EC_COE_DOWN_REQ_HEADER_SIZE 10
 
 /** CoE upload request header size.
  */
-#define EC_COE_UP_REQ_HEADER_SIZE (sizeof(ec_coe_upload_common_header_t))
+#define EC_COE_UP_REQ_HEADER_SIZE 10
 
 /** CoE download segment request header size.
  */
-#define EC_COE_DOWN_SEG_REQ_HEADER_SIZE (sizeof(ec_coe_download_segment_header_t))
+#define EC_COE_DOWN_SEG_REQ_HEADER_SIZE 3
 
 /** CoE upload segment request header size.
  */
-#define EC_COE_UP_SEG_REQ_HEADER_SIZE (sizeof(ec_coe_upload_segment_header_t))
+#define EC_COE_UP_SEG_REQ_HEADER_SIZE 3
 
 /** Minimum size of download segment.
  */
@@ -55,26 +45,18 @@ static int ec_coe_download_expedited(ec_master_t *master,
     uint8_t *data;
     uint8_t mbox_proto;
     uint32_t recv_size;
-    ec_coe_download_common_header_t *download_common;
     int ret;
 
     data = ec_mailbox_fill_send(master, slave_index, datagram, EC_MBOX_TYPE_COE, EC_COE_DOWN_REQ_HEADER_SIZE);
 
-    download_common = (ec_coe_download_common_header_t *)data;
-    download_common->coe_header.number = 0;
-    download_common->coe_header.reserved = 0;
-    download_common->coe_header.service = EC_COE_SERVICE_SDO_REQUEST;
-    download_common->sdo_header.size_indicator = 1;
-    download_common->sdo_header.transfertype = 1; // expedited
-    download_common->sdo_header.data_set_size = 4 - size;
-    download_common->sdo_header.complete_access = complete_access ? 1 : 0;
-    download_common->sdo_header.command = EC_COE_REQUEST_DOWNLOAD;
-
-    download_common->index = index;
-    download_common->subindex = complete_access ? 0x00 : subindex;
-
-    ec_memcpy(download_common->data, buf, size);
-    memset(download_common->data + size, 0x00, 4 - size);
+    EC_WRITE_U16(data, EC_COE_HEADER(EC_COE_SERVICE_SDO_REQUEST));
+    EC_WRITE_U8(data + 2, EC_SDO_CMD_SIZE_INDICATOR | EC_SDO_CMD_EXPEDITED | EC_SDO_CMD_DATA_SET_SIZE(4 - size) |
+                              (complete_access ? EC_SDO_CMD_COMPLETE_ACCESS : 0) | EC_SDO_CMD(EC_COE_REQUEST_DOWNLOAD));
+    EC_WRITE_U16(data + 3, index);
+    EC_WRITE_U8(data + 5, complete_access ? 0x00 : subindex);
+
+    ec_memcpy(data + 6, buf, size);
+    memset(data + 6 + size, 0x00, 4 - size);
     ret = ec_mailbox_send(master, slave_index, datagram);
     if (ret < 0) {
         return ret;
@@ -123,25 +105,17 @@ static int ec_coe_download_common(ec_master_t *master,
     uint8_t *data;
     uint8_t mbox_proto;
     uint32_t recv_size;
-    ec_coe_download_common_header_t *download_common;
     int ret;
 
     data = ec_mailbox_fill_send(master, slave_index, datagram, EC_MBOX_TYPE_COE, size + EC_COE_DOWN_REQ_HEADER_SIZE);
 
-    download_common = (ec_coe_download_common_header_t *)data;
-    download_common->coe_header.number = 0;
-    download_common->coe_header.reserved = 0;
-    download_common->coe_header.service = EC_COE_SERVICE_SDO_REQUEST;
-    download_common->sdo_header.size_indicator = 1;
-    download_common->sdo_header.transfertype = 0; // normal
-    download_common->sdo_header.data_set_size = 0;
-    download_common->sdo_header.complete_access = complete_access ? 1 : 0;
-    download_common->sdo_header.command = EC_COE_REQUEST_DOWNLOAD;
+    EC_WRITE_U16(data, EC_COE_HEADER(EC_COE_SERVICE_SDO_REQUEST));
+    EC_WRITE_U8(data + 2, EC_SDO_CMD_SIZE_INDICATOR | (complete_access ? EC_SDO_CMD_COMPLETE_ACCESS : 0) |
+                              EC_SDO_CMD(EC_COE_REQUEST_DOWNLOAD));
+    EC_WRITE_U16(data + 3, index);
+    EC_WRITE_U8(data + 5, complete_access ? 0x00 : subindex);
 
-    download_common->index = index;
-    download_common->subindex = complete_access ? 0x00 : subindex;
-
-    ec_memcpy(download_common->data, &size, 4);
+    EC_WRITE_U32(data + 6, size);
     ec_memcpy(data + EC_COE_DOWN_REQ_HEADER_SIZE, buf, size);
     ret = ec_mailbox_send(master, slave_index, datagram);
     if (ret < 0) {
@@ -191,7 +165,6 @@ static int ec_coe_download_segment(ec_master_t *master,
     uint8_t mbox_proto;
     uint32_t data_size, recv_size;
     uint32_t seg_size;
-    ec_coe_download_segment_header_t *download_seg;
     int ret;
 
     if (size > EC_COE_DOWN_SEG_MIN_DATA_SIZE) {
@@ -204,15 +177,9 @@ static int ec_coe_download_segment(ec_master_t *master,
 
     data = ec_mailbox_fill_send(master, slave_index, datagram, EC_MBOX_TYPE_COE, data_size + EC_COE_DOWN_SEG_REQ_HEADER_SIZE);
 
-    download_seg = (ec_coe_download_segment_header_t *)data;
-    download_seg->coe_header.number = 0;
-    download_seg->coe_header.reserved = 0;
-    download_seg->coe_header.service = EC_COE_SERVICE_SDO_REQUEST;
-
-    download_seg->sdo_header.more_follows = last ? 1 : 0;
-    download_seg->sdo_header.toggle = toggle ? 1 : 0;
-    download_seg->sdo_header.command = EC_COE_REQUEST_SEGMENT_DOWNLOAD;
-    download_seg->sdo_header.segdata_size = seg_size;
+    EC_WRITE_U16(data, EC_COE_HEADER(EC_COE_SERVICE_SDO_REQUEST));
+    EC_WRITE_U8(data + 2, (last ? EC_SDO_SEG_LAST : 0) | EC_SDO_SEG_DATA_SIZE(seg_size) |
+                              (toggle ? EC_SDO_SEG_TOGGLE : 0) | EC_SDO_CMD(EC_COE_REQUEST_SEGMENT_DOWNLOAD));
 
     ec_memcpy(data + EC_COE_DOWN_SEG_REQ_HEADER_SIZE, seg_data, size);
     if (size < EC_COE_DOWN_SEG_MIN_DATA_SIZE) {
@@ -337,8 +304,6 @@ int ec_coe_upload(ec_master_t *master,
     uint8_t rec_subindex;
     uint32_t data_size, total_size, offset;
     bool expedited, size_specified;
-    ec_coe_upload_common_header_t *upload_common;
-    ec_coe_upload_segment_header_t *upload_seg;
     bool toggle;
     bool last;
     int ret;
@@ -347,20 +312,12 @@ int ec_coe_upload(ec_master_t *master,
 
     data = ec_mailbox_fill_send(master, slave_index, datagram, EC_MBOX_TYPE_COE, EC_COE_UP_REQ_HEADER_SIZE);
 
-    upload_common = (ec_coe_upload_common_header_t *)data;
-    upload_common->coe_header.number = 0;
-    upload_common->coe_header.reserved = 0;
-    upload_common->coe_header.service = EC_COE_SERVICE_SDO_REQUEST;
-    upload_common->sdo_header.size_indicator = 0;
-    upload_common->sdo_header.transfertype = 0;
-    upload_common->sdo_header.data_set_size = 0;
-    upload_common->sdo_header.complete_access = complete_access ? 1 : 0;
-    upload_common->sdo_header.command = EC_COE_REQUEST_UPLOAD;
-
-    upload_common->index = index;
-    upload_common->subindex = complete_access ? 0x00 : subindex;
+    EC_WRITE_U16(data, EC_COE_HEADER(EC_COE_SERVICE_SDO_REQUEST));
+    EC_WRITE_U8(data + 2, (complete_access ? EC_SDO_CMD_COMPLETE_ACCESS : 0) | EC_SDO_CMD(EC_COE_REQUEST_UPLOAD));
+    EC_WRITE_U16(data + 3, index);
+    EC_WRITE_U8(data + 5, complete_access ? 0x00 : subindex);
 
-    memset(upload_common->data, 0x00, 4);
+    memset(data + 6, 0x00, 4);
     ret = ec_mailbox_send(master, slave_index, datagram);
     if (ret < 0) {
         return ret;
@@ -447,14 +404,8 @@ int ec_coe_upload(ec_master_t *master,
             while (1) {
                 data = ec_mailbox_fill_send(master, slave_index, datagram, EC_MBOX_TYPE_COE, EC_COE_UP_REQ_HEADER_SIZE);
 
-                upload_seg = (ec_coe_upload_segment_header_t *)data;
-                upload_seg->coe_header.number = 0;
-                upload_seg->coe_header.reserved = 0;
-                upload_seg->coe_header.service = EC_COE_SERVICE_SDO_REQUEST;
-                upload_seg->sdo_header.more_follows = 0;
-                upload_seg->sdo_header.toggle = toggle ? 1 : 0;
-                upload_seg->sdo_header.command = EC_COE_REQUEST_SEGMENT_UPLOAD;
-                upload_seg->sdo_header.segdata_size = 0;
+                EC_WRITE_U16(data, EC_COE_HEADER(EC_COE_SERVICE_SDO_REQUEST));
+                EC_WRITE_U8(data + 2, (toggle ? EC_SDO_SEG_TOGGLE : 0) | EC_SDO_CMD(EC_COE_REQUEST_SEGMENT_UPLOAD));
                 memset(data + EC_COE_DOWN_SEG_REQ_HEADER_SIZE, 0x00, 7);
                 ret = ec_mailbox_send(master, slave_index, datagram);
                 if (ret < 0) {
@@ -3,119 +3,281 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "ec_master.h"
 
-#define ALIGN_UP_DWORD(x) ((uint32_t)(uintptr_t)(x) & (sizeof(uint32_t) - 1))
+/* before ec_master.h, the __R/__W macros of esc_register.h clash with the intrinsic headers */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_FEATURE_MVE)
+#include <arm_mve.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+#include "ec_master.h"
 
-static inline void dword2array(char *addr, uint32_t w)
-{
-    addr[0] = w;
-    addr[1] = w >> 8;
-    addr[2] = w >> 16;
-    addr[3] = w >> 24;
-}
+/*
+ * ec_memcpy() and ec_memset() move every datagram payload and PDO image, the implementation is
+ * chosen at build time:
+ *
+ * - CONFIG_EC_MEMCPY_LIBC: memcpy() and memset() of the libc
+ * - the vector unit the compiler targets: AVX2 or SSE2, NEON, Helium (MVE) or RVV, with
+ *   unaligned vector loads and stores, the tail is one vector overlapping the previous one
+ * - else, or with CONFIG_EC_MEMCPY_NO_SIMD, machine words: the destination is aligned first,
+ *   a misaligned source is read as aligned words and shifted together, so no core sees an
+ *   unaligned word access
+ *
+ * Source and destination must not overlap.
+ */
 
-EC_FAST_CODE_SECTION void *ec_memcpy(void *s1, const void *s2, size_t n)
+#if !defined(CONFIG_EC_MEMCPY_LIBC) && !defined(CONFIG_EC_MEMCPY_NO_SIMD)
+#if defined(__AVX2__)
+#define EC_MEM_VEC_SIZE           32
+#define EC_MEM_VEC_T              __m256i
+#define EC_MEM_VEC_LOAD(p)        _mm256_loadu_si256((const __m256i *)(p))
+#define EC_MEM_VEC_STORE(p, v)    _mm256_storeu_si256((__m256i *)(p), (v))
+#define EC_MEM_VEC_DUP(c)         _mm256_set1_epi8((char)(c))
+#elif defined(__SSE2__)
+#define EC_MEM_VEC_SIZE           16
+#define EC_MEM_VEC_T              __m128i
+#define EC_MEM_VEC_LOAD(p)        _mm_loadu_si128((const __m128i *)(p))
+#define EC_MEM_VEC_STORE(p, v)    _mm_storeu_si128((__m128i *)(p), (v))
+#define EC_MEM_VEC_DUP(c)         _mm_set1_epi8((char)(c))
+#elif defined(__ARM_FEATURE_MVE)
+#define EC_MEM_VEC_SIZE           16
+#define EC_MEM_VEC_T              uint8x16_t
+#define EC_MEM_VEC_LOAD(p)        vldrbq_u8((const uint8_t *)(p))
+#define EC_MEM_VEC_STORE(p, v)    vstrbq_u8((uint8_t *)(p), (v))
+#define EC_MEM_VEC_DUP(c)         vdupq_n_u8((uint8_t)(c))
+#elif defined(__ARM_NEON)
+#define EC_MEM_VEC_SIZE           16
+#define EC_MEM_VEC_T              uint8x16_t
+#define EC_MEM_VEC_LOAD(p)        vld1q_u8((const uint8_t *)(p))
+#define EC_MEM_VEC_STORE(p, v)    vst1q_u8((uint8_t *)(p), (v))
+#define EC_MEM_VEC_DUP(c)         vdupq_n_u8((uint8_t)(c))
+#elif defined(__riscv_vector) && defined(__riscv_v_intrinsic) && (__riscv_v_intrinsic >= 11000)
+#define EC_MEM_RVV
+#endif
+#endif
+
+#if defined(__GNUC__)
+typedef uintptr_t __attribute__((__may_alias__)) ec_mem_word_t;
+#else
+typedef uintptr_t ec_mem_word_t;
+#endif
+
+#define EC_MEM_WORD_SIZE sizeof(ec_mem_word_t)
+#define EC_MEM_WORD_MISALIGN(x) ((uintptr_t)(x) & (EC_MEM_WORD_SIZE - 1))
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define EC_MEM_MERGE(lo, hi, shift) (((lo) << (shift)) | ((hi) >> (EC_MEM_WORD_SIZE * 8 - (shift))))
+#else
+#define EC_MEM_MERGE(lo, hi, shift) (((lo) >> (shift)) | ((hi) << (EC_MEM_WORD_SIZE * 8 - (shift))))
+#endif
+
+static inline void ec_memcpy_words(uint8_t *b1, const uint8_t *b2, size_t n)
 {
-    char *b1 = (char *)s1;
-    const char *b2 = (const char *)s2;
-    uint32_t *w1;
-    const uint32_t *w2;
+    ec_mem_word_t *w1;
+    const ec_mem_word_t *w2;
+    ec_mem_word_t lo, hi;
+    uint32_t shift;
 
-    if (ALIGN_UP_DWORD(b1) == ALIGN_UP_DWORD(b2)) {
-        while (ALIGN_UP_DWORD(b1) != 0 && n > 0) {
+    if (n >= 2 * EC_MEM_WORD_SIZE) {
+        while (EC_MEM_WORD_MISALIGN(b1) != 0) {
             *b1++ = *b2++;
             --n;
         }
 
-        w1 = (uint32_t *)b1;
-        w2 = (const uint32_t *)b2;
+        w1 = (ec_mem_word_t *)b1;
+        shift = EC_MEM_WORD_MISALIGN(b2) * 8;
 
-        while (n >= 4 * sizeof(uint32_t)) {
-            *w1++ = *w2++;
-            *w1++ = *w2++;
-            *w1++ = *w2++;
-            *w1++ = *w2++;
-            n -= 4 * sizeof(uint32_t);
-        }
+        if (shift == 0) {
+            w2 = (const ec_mem_word_t *)b2;
+
+            while (n >= 4 * EC_MEM_WORD_SIZE) {
+                w1[0] = w2[0];
+                w1[1] = w2[1];
+                w1[2] = w2[2];
+                w1[3] = w2[3];
+                w1 += 4;
+                w2 += 4;
+                n -= 4 * EC_MEM_WORD_SIZE;
+            }
 
-        while (n >= sizeof(uint32_t)) {
-            *w1++ = *w2++;
-            n -= sizeof(uint32_t);
+            while (n >= EC_MEM_WORD_SIZE) {
+                *w1++ = *w2++;
+                n -= EC_MEM_WORD_SIZE;
+            }
+        } else {
+            // aligned words overlapping the source, none of them reaches behind its end
+            w2 = (const ec_mem_word_t *)(b2 - shift / 8);
+            lo = *w2++;
+
+            while (n >= 2 * EC_MEM_WORD_SIZE) {
+                hi = *w2++;
+                *w1++ = EC_MEM_MERGE(lo, hi, shift);
+                lo = hi;
+                n -= EC_MEM_WORD_SIZE;
+            }
         }
 
-        b1 = (char *)w1;
-        b2 = (const char *)w2;
+        b2 += (uint8_t *)w1 - b1;
+        b1 = (uint8_t *)w1;
+    }
 
-        while (n--) {
-            *b1++ = *b2++;
-        }
-    } else {
-        while (n > 0 && ALIGN_UP_DWORD(b2) != 0) {
-            *b1++ = *b2++;
+    while (n--) {
+        *b1++ = *b2++;
+    }
+}
+
+static inline void ec_memset_words(uint8_t *b, uint8_t c, size_t n)
+{
+    ec_mem_word_t *w;
+    ec_mem_word_t word;
+
+    if (n >= 2 * EC_MEM_WORD_SIZE) {
+        while (EC_MEM_WORD_MISALIGN(b) != 0) {
+            *b++ = c;
             --n;
         }
 
-        w2 = (const uint32_t *)b2;
-
-        while (n >= 4 * sizeof(uint32_t)) {
-            dword2array(b1, *w2++);
-            b1 += sizeof(uint32_t);
-            dword2array(b1, *w2++);
-            b1 += sizeof(uint32_t);
-            dword2array(b1, *w2++);
-            b1 += sizeof(uint32_t);
-            dword2array(b1, *w2++);
-            b1 += sizeof(uint32_t);
-            n -= 4 * sizeof(uint32_t);
+        w = (ec_mem_word_t *)b;
+        word = (ec_mem_word_t)-1 / 0xff * c;
+
+        while (n >= 4 * EC_MEM_WORD_SIZE) {
+            w[0] = word;
+            w[1] = word;
+            w[2] = word;
+            w[3] = word;
+            w += 4;
+            n -= 4 * EC_MEM_WORD_SIZE;
         }
 
-        while (n >= sizeof(uint32_t)) {
-            dword2array(b1, *w2++);
-            b1 += sizeof(uint32_t);
-            n -= sizeof(uint32_t);
+        while (n >= EC_MEM_WORD_SIZE) {
+            *w++ = word;
+            n -= EC_MEM_WORD_SIZE;
         }
 
-        b2 = (const char *)w2;
+        b = (uint8_t *)w;
+    }
 
-        while (n--) {
-            *b1++ = *b2++;
-        }
+    while (n--) {
+        *b++ = c;
     }
-    return s1;
 }
 
-EC_FAST_CODE_SECTION void ec_memset(void *s, int c, size_t n)
+EC_FAST_CODE_SECTION void *ec_memcpy(void *s1, const void *s2, size_t n)
 {
-    char *b = (char *)s;
-    uint32_t *w;
-
-    while (ALIGN_UP_DWORD(b) != 0 && n > 0) {
-        *b++ = (char)c;
-        --n;
+#if defined(CONFIG_EC_MEMCPY_LIBC)
+    return memcpy(s1, s2, n);
+#elif defined(EC_MEM_RVV)
+    uint8_t *b1 = (uint8_t *)s1;
+    const uint8_t *b2 = (const uint8_t *)s2;
+    size_t vl;
+
+    for (; n > 0; n -= vl, b1 += vl, b2 += vl) {
+        vl = __riscv_vsetvl_e8m8(n);
+        __riscv_vse8_v_u8m8(b1, __riscv_vle8_v_u8m8(b2, vl), vl);
+    }
+    return s1;
+#elif defined(EC_MEM_VEC_SIZE)
+    uint8_t *b1 = (uint8_t *)s1;
+    const uint8_t *b2 = (const uint8_t *)s2;
+    EC_MEM_VEC_T v0, v1, v2, v3;
+    size_t head;
+
+    if (n < EC_MEM_VEC_SIZE) {
+        ec_memcpy_words(b1, b2, n);
+        return s1;
     }
 
-    w = (uint32_t *)b;
-    c = (c & 0xff) | ((c & 0xff) << 8) | ((c & 0xff) << 16) | ((c & 0xff) << 24);
+    // first vector unaligned, then aligned stores from the next boundary on
+    EC_MEM_VEC_STORE(b1, EC_MEM_VEC_LOAD(b2));
+    head = EC_MEM_VEC_SIZE - ((uintptr_t)b1 & (EC_MEM_VEC_SIZE - 1));
+    b1 += head;
+    b2 += head;
+    n -= head;
+
+    while (n > 4 * EC_MEM_VEC_SIZE) {
+        v0 = EC_MEM_VEC_LOAD(b2);
+        v1 = EC_MEM_VEC_LOAD(b2 + EC_MEM_VEC_SIZE);
+        v2 = EC_MEM_VEC_LOAD(b2 + 2 * EC_MEM_VEC_SIZE);
+        v3 = EC_MEM_VEC_LOAD(b2 + 3 * EC_MEM_VEC_SIZE);
+        EC_MEM_VEC_STORE(b1, v0);
+        EC_MEM_VEC_STORE(b1 + EC_MEM_VEC_SIZE, v1);
+        EC_MEM_VEC_STORE(b1 + 2 * EC_MEM_VEC_SIZE, v2);
+        EC_MEM_VEC_STORE(b1 + 3 * EC_MEM_VEC_SIZE, v3);
+        b1 += 4 * EC_MEM_VEC_SIZE;
+        b2 += 4 * EC_MEM_VEC_SIZE;
+        n -= 4 * EC_MEM_VEC_SIZE;
+    }
 
-    while (n >= 4 * sizeof(uint32_t)) {
-        *w++ = c;
-        *w++ = c;
-        *w++ = c;
-        *w++ = c;
-        n -= 4 * sizeof(uint32_t);
+    while (n > EC_MEM_VEC_SIZE) {
+        EC_MEM_VEC_STORE(b1, EC_MEM_VEC_LOAD(b2));
+        b1 += EC_MEM_VEC_SIZE;
+        b2 += EC_MEM_VEC_SIZE;
+        n -= EC_MEM_VEC_SIZE;
     }
 
-    while (n >= sizeof(uint32_t)) {
-        *w++ = c;
-        n -= sizeof(uint32_t);
+    // last vector ends at the last byte, overlapping what is already copied
+    EC_MEM_VEC_STORE(b1 + n - EC_MEM_VEC_SIZE, EC_MEM_VEC_LOAD(b2 + n - EC_MEM_VEC_SIZE));
+    return s1;
+#else
+    ec_memcpy_words((uint8_t *)s1, (const uint8_t *)s2, n);
+    return s1;
+#endif
+}
+
+EC_FAST_CODE_SECTION void ec_memset(void *s, int c, size_t n)
+{
+#if defined(CONFIG_EC_MEMCPY_LIBC)
+    memset(s, c, n);
+#elif defined(EC_MEM_RVV)
+    uint8_t *b = (uint8_t *)s;
+    size_t vl = __riscv_vsetvlmax_e8m8();
+    vuint8m8_t v = __riscv_vmv_v_x_u8m8((uint8_t)c, vl);
+
+    for (; n > 0; n -= vl, b += vl) {
+        vl = __riscv_vsetvl_e8m8(n);
+        __riscv_vse8_v_u8m8(b, v, vl);
+    }
+#elif defined(EC_MEM_VEC_SIZE)
+    uint8_t *b = (uint8_t *)s;
+    EC_MEM_VEC_T v;
+    size_t head;
+
+    if (n < EC_MEM_VEC_SIZE) {
+        ec_memset_words(b, (uint8_t)c, n);
+        return;
     }
 
-    b = (char *)w;
+    v = EC_MEM_VEC_DUP(c);
+    EC_MEM_VEC_STORE(b, v);
+    head = EC_MEM_VEC_SIZE - ((uintptr_t)b & (EC_MEM_VEC_SIZE - 1));
+    b += head;
+    n -= head;
+
+    while (n > 4 * EC_MEM_VEC_SIZE) {
+        EC_MEM_VEC_STORE(b, v);
+        EC_MEM_VEC_STORE(b + EC_MEM_VEC_SIZE, v);
+        EC_MEM_VEC_STORE(b + 2 * EC_MEM_VEC_SIZE, v);
+        EC_MEM_VEC_STORE(b + 3 * EC_MEM_VEC_SIZE, v);
+        b += 4 * EC_MEM_VEC_SIZE;
+        n -= 4 * EC_MEM_VEC_SIZE;
+    }
 
-    while (n--) {
-        *b++ = (char)c;
+    while (n > EC_MEM_VEC_SIZE) {
+        EC_MEM_VEC_STORE(b, v);
+        b += EC_MEM_VEC_SIZE;
+        n -= EC_MEM_VEC_SIZE;
     }
+
+    EC_MEM_VEC_STORE(b + n - EC_MEM_VEC_SIZE, v);
+#else
+    ec_memset_words((uint8_t *)s, (uint8_t)c, n);
+#endif
 }
 
 typedef struct {
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_dc_clock.h"
+
+/*
+ * DC time is modelled as a linear function of the local timestamp:
+ *
+ *     dc(t) = dc_ref + (t - local_ref) * (1 + drift)
+ *
+ * Every sample (local time when the FRMW was sent, DC time it read) is compared with the
+ * prediction, the error e corrects the phase by e / 4 and the rate by e / (64 * interval),
+ * a second order loop that follows a constant rate offset without remaining phase error.
+ */
+#define EC_DC_CLOCK_PHASE_SHIFT 2
+#define EC_DC_CLOCK_RATE_SHIFT  6
+
+void ec_dc_clock_init(ec_dc_clock_t *clock, uint32_t interval_ns)
+{
+    clock->local_ref = 0;
+    clock->dc_ref = 0;
+    clock->drift = 0;
+    clock->inv_interval = (uint32_t)((1ULL << 32) / interval_ns);
+    clock->last_error = 0;
+    clock->samples = 0;
+    clock->valid = false;
+}
+
+void ec_dc_clock_update(ec_dc_clock_t *clock, uint64_t local_ns, uint64_t dc_ns)
+{
+    uint64_t predict;
+    int64_t error;
+
+    predict = ec_dc_clock_predict(clock, local_ns);
+    error = (int64_t)(dc_ns - predict);
+
+    if (!clock->valid || (error > EC_DC_CLOCK_RESYNC_NS) || (error < -EC_DC_CLOCK_RESYNC_NS)) {
+        clock->dc_ref = dc_ns;
+        clock->drift = 0;
+        clock->last_error = 0;
+        clock->samples = 0;
+        clock->valid = true;
+    } else {
+        clock->dc_ref = predict + (error >> EC_DC_CLOCK_PHASE_SHIFT);
+        clock->drift += (error * clock->inv_interval) >> EC_DC_CLOCK_RATE_SHIFT;
+        clock->last_error = (int32_t)error;
+        clock->samples++;
+    }
+    clock->local_ref = local_ns;
+}
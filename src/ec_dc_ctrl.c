@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "ec_dc_ctrl.h"
+
+/*
+ * The master period is corrected by u[n] each cycle, the phase error then evolves as
+ *
+ *     e[n + 1] = e[n] + u[n] + d
+ *
+ * where d is the drift between master clock and DC clock per cycle. d is estimated from
+ * e[n + 1] - e[n] - u[n] with a first order filter and fed forward, the PI part only has
+ * to remove the remaining phase error:
+ *
+ *     u[n] = -(d + kp * e[n] + ki * sum(e))
+ */
+
+void ec_dc_ctrl_default_config(ec_dc_ctrl_config_t *config)
+{
+    config->kp = EC_DC_CTRL_Q16(0.1);
+    config->ki = EC_DC_CTRL_Q16(0.01);
+    config->kf = EC_DC_CTRL_Q16(0.0625);
+    config->integral_limit_ns = 5000;
+    config->output_limit_ns = 10000;
+    config->lock_threshold_ns = 1000;
+    config->lock_cycles = 100;
+}
+
+void ec_dc_ctrl_init(ec_dc_ctrl_t *ctrl, const ec_dc_ctrl_config_t *config, uint32_t cycle_time)
+{
+    memcpy(&ctrl->config, config, sizeof(ec_dc_ctrl_config_t));
+    ctrl->cycle_time = cycle_time;
+    ec_dc_ctrl_reset(ctrl);
+}
+
+void ec_dc_ctrl_reset(ec_dc_ctrl_t *ctrl)
+{
+    ctrl->phase_ref = 0;
+    ctrl->phase_valid = false;
+    ctrl->integral = 0;
+    ctrl->drift = 0;
+    ctrl->last_error = 0;
+    ctrl->last_output = 0;
+    ctrl->first = true;
+    ctrl->lock_count = 0;
+    ctrl->locked = false;
+}
+
+int32_t ec_dc_ctrl_phase_error(ec_dc_ctrl_t *ctrl, uint64_t time)
+{
+    int64_t half_cycle = ctrl->cycle_time / 2;
+    int64_t delta = 0;
+
+    /* Track the cycle boundary instead of doing a 64 bit modulo every cycle,
+     * resynchronize only if the error leaves +-cycle/2 (first call, lost cycles).
+     */
+    if (ctrl->phase_valid) {
+        delta = (int64_t)(time - ctrl->phase_ref);
+    }
+
+    if (!ctrl->phase_valid || (delta > half_cycle) || (delta < -half_cycle)) {
+        ctrl->phase_ref = time - (time % ctrl->cycle_time);
+        if ((time - ctrl->phase_ref) > (uint64_t)half_cycle) {
+            ctrl->phase_ref += ctrl->cycle_time;
+        }
+        delta = (int64_t)(time - ctrl->phase_ref);
+        ctrl->phase_valid = true;
+    }
+
+    ctrl->phase_ref += ctrl->cycle_time;
+
+    return (int32_t)delta;
+}
+
+int32_t ec_dc_ctrl_update(ec_dc_ctrl_t *ctrl, int32_t error_ns)
+{
+    const ec_dc_ctrl_config_t *config = &ctrl->config;
+    int64_t integral_limit = (int64_t)config->integral_limit_ns << 16;
+    int64_t integral;
+    int64_t output;
+    int32_t measured;
+    uint32_t abs_error;
+
+    // feed-forward drift estimation
+    if (!ctrl->first && config->kf) {
+        measured = error_ns - ctrl->last_error - ctrl->last_output;
+        ctrl->drift += ((int64_t)config->kf * (((int64_t)measured << 16) - ctrl->drift)) >> 16;
+    }
+    ctrl->first = false;
+
+    integral = ctrl->integral + (int64_t)config->ki * error_ns;
+    if (integral > integral_limit) {
+        integral = integral_limit;
+    } else if (integral < -integral_limit) {
+        integral = -integral_limit;
+    }
+
+    output = -(((int64_t)config->kp * error_ns + integral + ctrl->drift) >> 16);
+
+    // anti-windup: keep the integral if the output saturates in the same direction
+    if (output > config->output_limit_ns) {
+        output = config->output_limit_ns;
+        if (error_ns < 0) {
+            integral = ctrl->integral;
+        }
+    } else if (output < -config->output_limit_ns) {
+        output = -config->output_limit_ns;
+        if (error_ns > 0) {
+            integral = ctrl->integral;
+        }
+    }
+    ctrl->integral = integral;
+
+    // lock detection with hysteresis
+    abs_error = error_ns < 0 ? -error_ns : error_ns;
+    if (abs_error < config->lock_threshold_ns) {
+        if (ctrl->lock_count < config->lock_cycles) {
+            ctrl->lock_count++;
+        } else {
+            ctrl->locked = true;
+        }
+    } else {
+        ctrl->lock_count = 0;
+        if (abs_error > (config->lock_threshold_ns * 2)) {
+            ctrl->locked = false;
+        }
+    }
+
+    ctrl->last_error = error_ns;
+    ctrl->last_output = (int32_t)output;
+
+    return (int32_t)output;
+}
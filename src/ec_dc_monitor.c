@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+
+#ifdef CONFIG_EC_DC_MONITOR
+
+/*
+ * Every CONFIG_EC_DC_MONITOR_INTERVAL cycles one 4 byte datagram reading SYS_TIME_DIFF is
+ * added to the cyclic frame. The samples walk round robin over all DC slaves (FPRD), followed
+ * by one BRD for the whole bus. SYS_TIME_DIFF is sign/magnitude, a BRD ORs the magnitudes of
+ * all slaves, which gives an upper bound of the largest deviation on the bus.
+ */
+
+static uint8_t ec_dc_monitor_hist_bucket(uint32_t abs_ns)
+{
+    uint8_t bucket = 0;
+
+    abs_ns >>= 6;
+    while (abs_ns && (bucket < (EC_DC_MONITOR_HIST_BUCKETS - 1))) {
+        abs_ns >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static bool ec_dc_monitor_slave_valid(ec_master_t *master, ec_slave_t *slave)
+{
+    /* The reference clock is the source of the system time, its difference is meaningless. */
+    return slave->base_dc_supported && (slave != master->dc_ref_clock);
+}
+
+static void ec_dc_monitor_slave_update(ec_master_t *master, ec_slave_t *slave)
+{
+    ec_dc_monitor_t *monitor = &master->dc_monitor;
+    ec_dc_monitor_stats_t *stats = &slave->dc_stats;
+    uint32_t value;
+    uint32_t abs_ns;
+
+    if ((monitor->datagram.state != EC_DATAGRAM_RECEIVED) ||
+        (monitor->datagram.working_counter != 1)) {
+        stats->no_response++;
+        return;
+    }
+
+    value = EC_READ_U32(monitor->data);
+    abs_ns = ESC_SYS_TIME_DIFF_NUM_GET(value);
+
+    stats->samples++;
+    stats->last_ns = ESC_SYS_TIME_DIFF_DIFF_GET(value) ? -(int32_t)abs_ns : (int32_t)abs_ns;
+    stats->max_ns = MAX(abs_ns, stats->max_ns);
+    stats->hist[ec_dc_monitor_hist_bucket(abs_ns)]++;
+
+    // lost sync detection with hysteresis
+    if (!stats->out_of_sync && (abs_ns > CONFIG_EC_DC_MONITOR_THRESHOLD_NS)) {
+        stats->out_of_sync = true;
+        stats->sync_loss_count++;
+        monitor->out_of_sync++;
+        EC_SLAVE_LOG_WRN("Slave %u: DC out of sync, system time difference %d ns\n",
+                         slave->index, stats->last_ns);
+    } else if (stats->out_of_sync && (abs_ns < (CONFIG_EC_DC_MONITOR_THRESHOLD_NS / 2))) {
+        stats->out_of_sync = false;
+        monitor->out_of_sync--;
+        EC_SLAVE_LOG_INFO("Slave %u: DC in sync again, system time difference %d ns\n",
+                          slave->index, stats->last_ns);
+    }
+}
+
+static void ec_dc_monitor_bus_update(ec_master_t *master)
+{
+    ec_dc_monitor_t *monitor = &master->dc_monitor;
+
+    if ((monitor->datagram.state != EC_DATAGRAM_RECEIVED) ||
+        (monitor->datagram.working_counter == 0)) {
+        return;
+    }
+
+    monitor->bus_max_ns = ESC_SYS_TIME_DIFF_NUM_GET(EC_READ_U32(monitor->data));
+    monitor->bus_samples++;
+}
+
+static void ec_dc_monitor_queue(ec_master_t *master)
+{
+    ec_dc_monitor_t *monitor = &master->dc_monitor;
+    ec_slave_t *slave;
+    uint32_t index;
+
+    // the BRD slot is always valid, so this ends after one round at the latest
+    for (uint32_t i = 0; i <= master->slave_count; i++) {
+        index = monitor->next_index;
+        monitor->next_index = (index >= master->slave_count) ? 0 : (index + 1);
+
+        if (index >= master->slave_count) {
+            ec_datagram_brd(&monitor->datagram, ESCREG_OF(ESCREG->SYS_TIME_DIFF), sizeof(monitor->data));
+            monitor->datagram.netdev_idx = EC_NETDEV_MAIN;
+            break;
+        }
+
+        slave = &master->slaves[index];
+        if (ec_dc_monitor_slave_valid(master, slave)) {
+            ec_datagram_fprd(&monitor->datagram, slave->station_address, ESCREG_OF(ESCREG->SYS_TIME_DIFF), sizeof(monitor->data));
+            monitor->datagram.netdev_idx = slave->netdev_idx;
+            break;
+        }
+    }
+
+    monitor->slave_index = index;
+    ec_datagram_zero(&monitor->datagram);
+    ec_master_queue_datagram(master, &monitor->datagram);
+    monitor->pending = true;
+}
+
+void ec_dc_monitor_init(ec_master_t *master)
+{
+    ec_dc_monitor_t *monitor = &master->dc_monitor;
+
+    ec_datagram_init_static(&monitor->datagram, monitor->data, sizeof(monitor->data));
+    monitor->cycle_count = CONFIG_EC_DC_MONITOR_INTERVAL;
+    monitor->next_index = 0;
+    monitor->slave_index = 0;
+    monitor->pending = false;
+
+    ec_master_clear_dc_stats(master);
+}
+
+void ec_dc_monitor_clear(ec_master_t *master)
+{
+    ec_datagram_clear(&master->dc_monitor.datagram);
+    master->dc_monitor.pending = false;
+}
+
+EC_FAST_CODE_SECTION void ec_dc_monitor_process(ec_master_t *master)
+{
+    ec_dc_monitor_t *monitor = &master->dc_monitor;
+
+    if (!master->dc_ref_clock) {
+        return;
+    }
+
+    if (monitor->pending) {
+        if ((monitor->datagram.state == EC_DATAGRAM_QUEUED) ||
+            (monitor->datagram.state == EC_DATAGRAM_SENT)) {
+            return;
+        }
+        monitor->pending = false;
+
+        if (monitor->slave_index >= master->slave_count) {
+            ec_dc_monitor_bus_update(master);
+        } else {
+            ec_dc_monitor_slave_update(master, &master->slaves[monitor->slave_index]);
+        }
+    }
+
+    if (--monitor->cycle_count) {
+        return;
+    }
+    monitor->cycle_count = CONFIG_EC_DC_MONITOR_INTERVAL;
+
+    ec_dc_monitor_queue(master);
+}
+
+int ec_master_get_slave_dc_stats(ec_master_t *master, uint32_t slave_index, ec_dc_monitor_stats_t *stats)
+{
+    uintptr_t flags;
+
+    if (slave_index >= master->slave_count) {
+        return -EC_ERR_INVAL;
+    }
+
+    flags = ec_osal_enter_critical_section();
+    memcpy(stats, &master->slaves[slave_index].dc_stats, sizeof(ec_dc_monitor_stats_t));
+    ec_osal_leave_critical_section(flags);
+
+    return 0;
+}
+
+uint32_t ec_master_get_dc_bus_deviation(ec_master_t *master)
+{
+    return master->dc_monitor.bus_max_ns;
+}
+
+void ec_master_clear_dc_stats(ec_master_t *master)
+{
+    master->dc_monitor.bus_max_ns = 0;
+    master->dc_monitor.bus_samples = 0;
+    master->dc_monitor.out_of_sync = 0;
+
+    for (uint32_t i = 0; i < master->slave_count; i++) {
+        memset(&master->slaves[i].dc_stats, 0, sizeof(ec_dc_monitor_stats_t));
+    }
+}
+
+#endif
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+
+void ec_domain_init(ec_domain_t *domain, ec_master_t *master, uint8_t index, uint32_t cycle_divisor, uint32_t cycle_offset)
+{
+    memset(domain, 0, sizeof(ec_domain_t));
+
+    domain->master = master;
+    domain->index = index;
+    domain->cycle_divisor = cycle_divisor ? cycle_divisor : 1;
+    domain->cycle_offset = cycle_offset;
+    domain->actual_cycle_offset = 0;
+
+    ec_datagram_init_static(&domain->lrw_datagram, NULL, 0);
+    ec_datagram_init_static(&domain->lwr_datagram, NULL, 0);
+    ec_datagram_init_static(&domain->lrd_datagram, NULL, 0);
+}
+
+void ec_domain_clear(ec_domain_t *domain)
+{
+    ec_datagram_clear(&domain->lrw_datagram);
+    ec_datagram_clear(&domain->lwr_datagram);
+    ec_datagram_clear(&domain->lrd_datagram);
+
+    domain->scheduled = false;
+    domain->wc_check = false;
+    domain->wc_valid = false;
+    domain->dispatch = NULL;
+    domain->dispatch_count = 0;
+}
+
+static void ec_domain_layout_slave_pdo(ec_domain_t *domain, ec_slave_t *slave)
+{
+    ec_master_t *master = domain->master;
+    const ec_slave_image_t *image = slave->config->image;
+    uint32_t bitlen;
+    uint8_t sm_idx;
+
+    slave->logical_start_address = master->actual_pdo_size;
+    slave->odata_size = 0;
+    slave->idata_size = 0;
+
+    // sizes of a configuration image are final, ec_slave_config() writes its SM and FMMU pages
+    if (image) {
+        // an image that does not fit the device gets no process data, ec_slave_config() rejects it too
+        if (ec_slave_image_check(slave) < 0) {
+            slave->expected_working_counter = 0;
+            return;
+        }
+
+        slave->odata_size = image->odata_size;
+        slave->idata_size = image->idata_size;
+        master->actual_pdo_size += image->odata_size + image->idata_size;
+    } else {
+        for (uint8_t i = 0; i < slave->config->sync_count; i++) {
+            bitlen = 0;
+
+            sm_idx = slave->config->sync[i].index;
+            EC_ASSERT_MSG(sm_idx < slave->sm_count, "Slave %u: Invalid sync manager index %u\n",
+                          slave->index, sm_idx);
+
+            slave->sm_info[sm_idx].pdo_assign.count = slave->config->sync[i].n_pdos;
+
+            EC_ASSERT_MSG(slave->sm_info[sm_idx].pdo_assign.count <= CONFIG_EC_PER_SM_MAX_PDOS,
+                          "Slave %u: Too many PDOs %u for SM %u\n",
+                          slave->index, slave->sm_info[sm_idx].pdo_assign.count, sm_idx);
+
+            for (uint32_t j = 0; j < slave->config->sync[i].n_pdos; j++) {
+                slave->sm_info[sm_idx].pdo_assign.entry[j] = slave->config->sync[i].pdos[j].index;
+
+                slave->sm_info[sm_idx].pdo_mapping[j].count = slave->config->sync[i].pdos[j].n_entries;
+
+                EC_ASSERT_MSG(slave->sm_info[sm_idx].pdo_mapping[j].count <= CONFIG_EC_PER_PDO_MAX_PDO_ENTRIES,
+                              "Slave %u: Too many entries %u for PDO 0x%04X\n",
+                              slave->index, slave->sm_info[sm_idx].pdo_mapping[j].count,
+                              slave->config->sync[i].pdos[j].index);
+
+                for (uint32_t k = 0; k < slave->config->sync[i].pdos[j].n_entries; k++) {
+                    uint32_t entry = (slave->config->sync[i].pdos[j].entries[k].index << 16) |
+                                     (slave->config->sync[i].pdos[j].entries[k].subindex & 0xFF) << 8 |
+                                     (slave->config->sync[i].pdos[j].entries[k].bit_length & 0xFF);
+                    slave->sm_info[sm_idx].pdo_mapping[j].entry[k] = entry;
+
+                    bitlen += slave->config->sync[i].pdos[j].entries[k].bit_length;
+                }
+            }
+
+            // update SM
+            slave->sm_info[sm_idx].length = (bitlen + 7) / 8;
+            slave->sm_info[sm_idx].enable = true;
+
+            // update FMMU
+            slave->sm_info[sm_idx].fmmu.data_size = (bitlen + 7) / 8;
+            slave->sm_info[sm_idx].fmmu.logical_start_address = master->actual_pdo_size;
+            slave->sm_info[sm_idx].fmmu.dir = slave->config->sync[i].dir;
+            slave->sm_info[sm_idx].fmmu_enable = true;
+            master->actual_pdo_size += (bitlen + 7) / 8;
+
+            if (slave->config->sync[i].dir == EC_DIR_INPUT) {
+                slave->idata_size += (bitlen + 7) / 8;
+            }
+            if (slave->config->sync[i].dir == EC_DIR_OUTPUT) {
+                slave->odata_size += (bitlen + 7) / 8;
+            }
+        }
+    }
+
+    EC_ASSERT_MSG(master->actual_pdo_size <= CONFIG_EC_MAX_PDO_BUFSIZE,
+                  "Slave %u: PDO size %u exceeds CONFIG_EC_MAX_PDO_BUFSIZE\n",
+                  slave->index, master->actual_pdo_size);
+
+    if (slave->sii.general.flags.enable_not_lrw) {
+        /* LWR is counted once by every slave with outputs, LRD once by every slave with inputs. */
+        slave->expected_working_counter = (slave->odata_size ? 1 : 0) + (slave->idata_size ? 1 : 0);
+        domain->lwr_expected_working_counter += slave->odata_size ? 1 : 0;
+        domain->lrd_expected_working_counter += slave->idata_size ? 1 : 0;
+    } else if (image) {
+        slave->expected_working_counter = image->expected_working_counter;
+        domain->lrw_expected_working_counter += slave->expected_working_counter;
+    } else {
+        /* LRW is counted +2 by a slave with output FMMUs and +1 by a slave with input FMMUs. */
+        slave->expected_working_counter = (slave->odata_size ? 2 : 0) + (slave->idata_size ? 1 : 0);
+        domain->lrw_expected_working_counter += slave->expected_working_counter;
+    }
+    domain->expected_working_counter += slave->expected_working_counter;
+    domain->slave_count++;
+
+    EC_SLAVE_LOG_INFO("Slave %u: Domain %u, logical address 0x%08x, obyte %u, ibyte %u, expected working counter %u%s\n",
+                      slave->index, domain->index,
+                      slave->logical_start_address, slave->odata_size, slave->idata_size,
+                      slave->expected_working_counter,
+                      slave->sii.general.flags.enable_not_lrw ? " (LWR/LRD)" : "");
+}
+
+void ec_domain_layout(ec_domain_t *domain)
+{
+    ec_master_t *master = domain->master;
+    ec_slave_t *slave;
+    uint8_t *data;
+    uint32_t not_lrw_size;
+
+    domain->logical_start_address = master->actual_pdo_size;
+    domain->slave_count = 0;
+    domain->expected_working_counter = 0;
+    domain->actual_working_counter = 0;
+    domain->lrw_expected_working_counter = 0;
+    domain->lwr_expected_working_counter = 0;
+    domain->lrd_expected_working_counter = 0;
+    domain->lrw_actual_working_counter = 0;
+    domain->lwr_actual_working_counter = 0;
+    domain->lrd_actual_working_counter = 0;
+    domain->scheduled = false;
+    domain->wc_check = false;
+    domain->wc_valid = false;
+
+    /* Slaves with LRW support come first so that they share one LRW datagram,
+     * slaves without LRW support are placed behind them and use LWR + LRD.
+     */
+    for (uint32_t slave_idx = 0; slave_idx < master->slave_count; slave_idx++) {
+        slave = &master->slaves[slave_idx];
+        if ((slave->domain == domain) && !slave->sii.general.flags.enable_not_lrw) {
+            ec_domain_layout_slave_pdo(domain, slave);
+        }
+    }
+
+    domain->lrw_data_size = master->actual_pdo_size - domain->logical_start_address;
+
+    for (uint32_t slave_idx = 0; slave_idx < master->slave_count; slave_idx++) {
+        slave = &master->slaves[slave_idx];
+        if ((slave->domain == domain) && slave->sii.general.flags.enable_not_lrw) {
+            ec_domain_layout_slave_pdo(domain, slave);
+        }
+    }
+
+    domain->data_size = master->actual_pdo_size - domain->logical_start_address;
+    not_lrw_size = domain->data_size - domain->lrw_data_size;
+
+    EC_ASSERT_MSG(domain->lrw_data_size <= EC_MAX_DATA_SIZE && not_lrw_size <= EC_MAX_DATA_SIZE,
+                  "Domain %u: PDO size %u does not fit into one frame\n",
+                  domain->index, domain->data_size);
+
+    data = &master->pdo_buffer[EC_NETDEV_MAIN][domain->logical_start_address];
+
+    ec_datagram_init_static(&domain->lrw_datagram, data, domain->lrw_data_size);
+    ec_datagram_lrw(&domain->lrw_datagram, domain->logical_start_address, domain->lrw_data_size);
+
+    /* LWR and LRD share the same logical range, output FMMUs ignore LRD and input FMMUs ignore LWR. */
+    ec_datagram_init_static(&domain->lwr_datagram,
+                            data + domain->lrw_data_size,
+                            domain->lwr_expected_working_counter ? not_lrw_size : 0);
+    ec_datagram_lwr(&domain->lwr_datagram, domain->logical_start_address + domain->lrw_data_size,
+                    domain->lwr_expected_working_counter ? not_lrw_size : 0);
+
+    ec_datagram_init_static(&domain->lrd_datagram,
+                            data + domain->lrw_data_size,
+                            domain->lrd_expected_working_counter ? not_lrw_size : 0);
+    ec_datagram_lrd(&domain->lrd_datagram, domain->logical_start_address + domain->lrw_data_size,
+                    domain->lrd_expected_working_counter ? not_lrw_size : 0);
+
+    ec_memset(data, 0, domain->data_size);
+
+    if (domain->slave_count) {
+        EC_LOG_INFO("Domain %u: %u slaves, logical address 0x%08x, size %u, expected working counter %u\n",
+                    domain->index, domain->slave_count,
+                    domain->logical_start_address, domain->data_size,
+                    domain->expected_working_counter);
+    }
+}
+
+EC_FAST_CODE_SECTION void ec_domain_queue(ec_domain_t *domain)
+{
+    ec_master_t *master = domain->master;
+
+    if (domain->lrw_datagram.data_size) {
+        ec_master_queue_datagram(master, &domain->lrw_datagram);
+    }
+    if (domain->lwr_datagram.data_size) {
+        ec_master_queue_datagram(master, &domain->lwr_datagram);
+    }
+    if (domain->lrd_datagram.data_size) {
+        ec_master_queue_datagram(master, &domain->lrd_datagram);
+    }
+
+    domain->scheduled = true;
+    domain->wc_check = true;
+}
+
+/* Unused PDO datagrams (no data) never block the domain. */
+static inline bool ec_domain_datagram_done(ec_datagram_t *datagram)
+{
+    return (datagram->data_size == 0) || (datagram->state == EC_DATAGRAM_RECEIVED);
+}
+
+EC_FAST_CODE_SECTION bool ec_domain_done(ec_domain_t *domain)
+{
+    return ec_domain_datagram_done(&domain->lrw_datagram) &&
+           ec_domain_datagram_done(&domain->lwr_datagram) &&
+           ec_domain_datagram_done(&domain->lrd_datagram);
+}
+
+void ec_domain_build_dispatch(ec_domain_t *domain, ec_pdo_dispatch_t *dispatch)
+{
+    ec_master_t *master = domain->master;
+    ec_slave_t *slave;
+
+    domain->dispatch = dispatch;
+    domain->dispatch_count = 0;
+
+    for (uint32_t i = 0; i < master->slave_count; i++) {
+        slave = &master->slaves[i];
+
+        if ((slave->domain == domain) && slave->config->pdo_callback) {
+            dispatch->callback = slave->config->pdo_callback;
+            dispatch->slave = slave;
+            dispatch->output = &master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address];
+            dispatch->input = &master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address + slave->odata_size];
+            dispatch++;
+            domain->dispatch_count++;
+        }
+    }
+}
+
+/* The FRMW reading the reference clock is queued before the domains, if it came back in
+ * the same frame as the inputs its time is exact, otherwise it is taken from the clock model.
+ */
+static EC_FAST_CODE_SECTION uint64_t ec_domain_input_dc_time(ec_domain_t *domain)
+{
+    ec_master_t *master = domain->master;
+    ec_datagram_t *sync_datagram = &master->dc_all_sync_datagram;
+    ec_datagram_t *datagram;
+
+    if (!master->dc_ref_clock) {
+        return 0;
+    }
+
+    datagram = domain->lrw_datagram.data_size ? &domain->lrw_datagram : &domain->lrd_datagram;
+
+    if ((sync_datagram->state == EC_DATAGRAM_RECEIVED) &&
+        (sync_datagram->jiffies_received == datagram->jiffies_received)) {
+        return ec_master_dc_sync_time(master);
+    }
+
+    if (master->dc_clock.valid) {
+        return ec_dc_clock_predict(&master->dc_clock, datagram->jiffies_sent);
+    }
+
+    return 0;
+}
+
+/* Working counter of one datagram group, a group without data is not sent and counts 0. */
+static inline uint32_t ec_domain_group_wc(const ec_datagram_t *datagram)
+{
+    return datagram->data_size ? datagram->working_counter : 0;
+}
+
+EC_FAST_CODE_SECTION void ec_domain_process(ec_domain_t *domain)
+{
+    ec_pdo_dispatch_t *dispatch;
+
+    domain->scheduled = false;
+    domain->input_dc_time = ec_domain_input_dc_time(domain);
+    domain->lrw_actual_working_counter = ec_domain_group_wc(&domain->lrw_datagram);
+    domain->lwr_actual_working_counter = ec_domain_group_wc(&domain->lwr_datagram);
+    domain->lrd_actual_working_counter = ec_domain_group_wc(&domain->lrd_datagram);
+    domain->actual_working_counter = domain->lrw_actual_working_counter +
+                                     domain->lwr_actual_working_counter +
+                                     domain->lrd_actual_working_counter;
+
+    if (domain->callback) {
+        domain->callback(domain, &domain->master->pdo_buffer[EC_NETDEV_MAIN][domain->logical_start_address], domain->callback_arg);
+        return;
+    }
+
+    // dispatch is NULL if no slave of the master has a PDO callback
+    for (uint32_t i = 0; i < domain->dispatch_count; i++) {
+        dispatch = &domain->dispatch[i];
+        dispatch->callback(dispatch->slave, dispatch->output, dispatch->input);
+    }
+}
+
+bool ec_domain_wc_check(ec_domain_t *domain)
+{
+    if (!ec_domain_done(domain)) {
+        return false;
+    }
+
+    // every group against its own expected WC, an extra count in one must not hide a missing one in another
+    return (ec_domain_group_wc(&domain->lrw_datagram) == domain->lrw_expected_working_counter) &&
+           (ec_domain_group_wc(&domain->lwr_datagram) == domain->lwr_expected_working_counter) &&
+           (ec_domain_group_wc(&domain->lrd_datagram) == domain->lrd_expected_working_counter);
+}
+
+static int ec_domain_find_pdo_entry(ec_domain_t *domain,
+                                    const ec_pdo_entry_reg_t *reg,
+                                    uint32_t *offset,
+                                    uint8_t *bit_position)
+{
+    ec_master_t *master = domain->master;
+    ec_slave_t *slave;
+    const ec_slave_image_t *image;
+    const ec_sync_info_t *sync;
+    const ec_pdo_entry_info_t *entry;
+    uint32_t bit_offset;
+
+    if (reg->slave_position >= master->slave_count) {
+        EC_LOG_ERR("PDO entry 0x%04x:%02x: Invalid slave position %u\n",
+                   reg->index, reg->subindex, reg->slave_position);
+        return -EC_ERR_INVAL;
+    }
+
+    slave = &master->slaves[reg->slave_position];
+
+    if ((reg->vendor_id && (reg->vendor_id != slave->sii.vendor_id)) ||
+        (reg->product_code && (reg->product_code != slave->sii.product_code))) {
+        EC_LOG_ERR("Slave %u: Invalid slave type 0x%08x:0x%08x, expected 0x%08x:0x%08x\n",
+                   slave->index, slave->sii.vendor_id, slave->sii.product_code,
+                   reg->vendor_id, reg->product_code);
+        return -EC_ERR_INVAL;
+    }
+
+    if (slave->domain != domain) {
+        EC_LOG_ERR("Slave %u: Not in domain %u\n", slave->index, domain->index);
+        return -EC_ERR_INVAL;
+    }
+
+    // the process data of a configuration image is laid out as a whole, its entries carry their offset
+    image = slave->config->image;
+    for (uint16_t i = 0; image && (i < image->entry_count); i++) {
+        if ((image->entries[i].index == reg->index) && (image->entries[i].subindex == reg->subindex) &&
+            ((image->entries[i].bit_offset / 8) < (slave->odata_size + slave->idata_size))) {
+            *offset = slave->logical_start_address - domain->logical_start_address + image->entries[i].bit_offset / 8;
+            *bit_position = image->entries[i].bit_offset % 8;
+            return 0;
+        }
+    }
+
+    for (uint8_t i = 0; !image && (i < slave->config->sync_count); i++) {
+        sync = &slave->config->sync[i];
+        bit_offset = 0;
+
+        for (uint32_t j = 0; j < sync->n_pdos; j++) {
+            for (uint32_t k = 0; k < sync->pdos[j].n_entries; k++) {
+                entry = &sync->pdos[j].entries[k];
+
+                if ((entry->index == reg->index) && (entry->subindex == reg->subindex)) {
+                    *offset = slave->sm_info[sync->index].fmmu.logical_start_address - domain->logical_start_address +
+                              bit_offset / 8;
+                    *bit_position = bit_offset % 8;
+                    return 0;
+                }
+
+                bit_offset += entry->bit_length;
+            }
+        }
+    }
+
+    EC_LOG_ERR("Slave %u: PDO entry 0x%04x:%02x is not mapped\n",
+               slave->index, reg->index, reg->subindex);
+    return -EC_ERR_INVAL;
+}
+
+int ec_domain_resolve_pdo_entries(ec_domain_t *domain)
+{
+    const ec_pdo_entry_reg_t *reg;
+    uint32_t offset;
+    uint8_t bit_position;
+    int ret;
+
+    if (!domain->regs) {
+        return 0;
+    }
+
+    for (reg = domain->regs; reg->index; reg++) {
+        ret = ec_domain_find_pdo_entry(domain, reg, &offset, &bit_position);
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (reg->bit_position) {
+            *reg->bit_position = bit_position;
+        } else if (bit_position) {
+            EC_LOG_ERR("Slave %u: PDO entry 0x%04x:%02x is not byte aligned\n",
+                       reg->slave_position, reg->index, reg->subindex);
+            return -EC_ERR_INVAL;
+        }
+
+        if (reg->offset) {
+            *reg->offset = offset;
+        }
+    }
+
+    return 0;
+}
+
+ec_domain_t *ec_master_create_domain(ec_master_t *master, uint32_t cycle_divisor, uint32_t cycle_offset)
+{
+    ec_domain_t *domain;
+
+    if (master->started) {
+        EC_LOG_ERR("Domains cannot be created while master is started\n");
+        return NULL;
+    }
+
+    if (master->domain_count >= CONFIG_EC_MAX_DOMAINS) {
+        EC_LOG_ERR("Too many domains, max is %u\n", CONFIG_EC_MAX_DOMAINS);
+        return NULL;
+    }
+
+    domain = &master->domains[master->domain_count];
+    ec_domain_init(domain, master, master->domain_count, cycle_divisor, cycle_offset);
+    master->domain_count++;
+
+    return domain;
+}
+
+uint8_t *ec_domain_data(ec_domain_t *domain)
+{
+    return &domain->master->pdo_buffer[EC_NETDEV_MAIN][domain->logical_start_address];
+}
+
+uint32_t ec_domain_size(ec_domain_t *domain)
+{
+    return domain->data_size;
+}
+
+int ec_domain_reg_pdo_entry_list(ec_domain_t *domain, const ec_pdo_entry_reg_t *regs)
+{
+    if (domain->master->started) {
+        return -EC_ERR_INVAL;
+    }
+
+    domain->regs = regs;
+    return 0;
+}
+
+int ec_domain_set_callback(ec_domain_t *domain, ec_domain_callback_t callback, void *arg)
+{
+    if (domain->master->started) {
+        return -EC_ERR_INVAL;
+    }
+
+    domain->callback = callback;
+    domain->callback_arg = arg;
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "ec_master.h"
 
 #define EC_DATAGRAM_TIMEOUT_NS (50 * 1000 * 1000ULL) // 50ms
+#define EC_DOMAIN_BALANCE_SLOTS 64
 
 void ec_master_period_process(void *arg);
 
@@ -89,7 +90,7 @@ EC_FAST_CODE_SECTION void ec_master_send_datagrams(ec_master_t *master, uint8_t
             // EtherCAT datagram header
             EC_WRITE_U8(cur_data, datagram->type);
             EC_WRITE_U8(cur_data + 1, datagram->index);
-            ec_memcpy(cur_data + 2, datagram->address, EC_ADDR_LEN);
+            EC_WRITE_U32(cur_data + 2, EC_READ_U32(datagram->address));
             EC_WRITE_U16(cur_data + 6, datagram->data_size & 0x7FF);
             EC_WRITE_U16(cur_data + 8, 0x0000); // IRQ
             follows_word = cur_data + 6;
@@ -119,11 +120,13 @@ EC_FAST_CODE_SECTION void ec_master_send_datagrams(ec_master_t *master, uint8_t
         EC_LOG_DBG("frame size: %u\n", cur_data - frame_data);
 
         // send frame
+        EC_TRACE_PERIOD_POINT(master, EC_TRACE_NETDEV_SEND);
         if (ec_netdev_send(master->netdev[netdev_idx], cur_data - frame_data) < 0) {
             EC_LOG_ERR("ec_netdev_send() failed.\n");
         }
 
         jiffies_sent = jiffies;
+        EC_TRACE_PERIOD_POINT_AT(master, EC_TRACE_NETDEV_SENT, jiffies_sent);
 
         // set datagram states and sending timestamps
         ec_dlist_for_each_entry_safe(datagram, next, &sent_datagrams, sent)
@@ -209,6 +212,7 @@ EC_FAST_CODE_SECTION void ec_master_receive_datagrams(ec_master_t *master,
                        datagram_index, datagram_type, data_size,
                        master->netdev[netdev_idx]->name);
             master->stats.unmatched++;
+            EC_CAPTURE_TRIGGER(master, EC_CAPTURE_TRIGGER_UNMATCHED);
 
             cur_data += data_size + EC_DATAGRAM_WC_SIZE;
             continue;
@@ -235,7 +239,7 @@ EC_FAST_CODE_SECTION void ec_master_receive_datagrams(ec_master_t *master,
     }
 }
 
-EC_FAST_CODE_SECTION void ec_master_send(ec_master_t *master)
+static EC_FAST_CODE_SECTION void ec_master_send_at(ec_master_t *master, uint64_t now)
 {
     ec_datagram_t *datagram, *n;
     uint8_t netdev_idx;
@@ -243,7 +247,7 @@ EC_FAST_CODE_SECTION void ec_master_send(ec_master_t *master)
     // update netdev statistics
     for (netdev_idx = EC_NETDEV_MAIN; netdev_idx < CONFIG_EC_MAX_NETDEVS;
          netdev_idx++) {
-        ec_netdev_update_stats(master->netdev[netdev_idx]);
+        ec_netdev_update_stats(master->netdev[netdev_idx], now);
     }
 
     // dequeue all datagrams that timed out
@@ -252,10 +256,11 @@ EC_FAST_CODE_SECTION void ec_master_send(ec_master_t *master)
         if (datagram->state != EC_DATAGRAM_SENT)
             continue;
 
-        if ((jiffies - datagram->jiffies_sent) > EC_DATAGRAM_TIMEOUT_NS) {
+        if ((now - datagram->jiffies_sent) > EC_DATAGRAM_TIMEOUT_NS) {
             datagram->state = EC_DATAGRAM_TIMED_OUT;
             ec_master_unqueue_datagram(master, datagram);
             master->stats.timeouts++;
+            EC_CAPTURE_TRIGGER(master, EC_CAPTURE_TRIGGER_TIMEOUT);
         }
     }
 
@@ -284,12 +289,17 @@ EC_FAST_CODE_SECTION void ec_master_send(ec_master_t *master)
     }
 }
 
+EC_FAST_CODE_SECTION void ec_master_send(ec_master_t *master)
+{
+    ec_master_send_at(master, jiffies);
+}
+
 EC_FAST_CODE_SECTION void ec_master_receive(ec_master_t *master,
                                             uint8_t netdev_idx,
                                             const uint8_t *frame_data,
                                             size_t size)
 {
-    ec_slave_t *slave;
+    ec_domain_t *domain;
     uint64_t start_time;
     uint32_t exec_ns;
 
@@ -301,42 +311,54 @@ EC_FAST_CODE_SECTION void ec_master_receive(ec_master_t *master,
         return;
     }
 
-    master->actual_working_counter = 0;
-#ifndef CONFIG_EC_PDO_MULTI_DOMAIN
-    if (master->pdo_datagram.state == EC_DATAGRAM_RECEIVED) {
-        for (uint32_t i = 0; i < master->slave_count; i++) {
-            slave = &master->slaves[i];
-
-            if (slave->config && slave->config->pdo_callback) {
-                slave->config->pdo_callback(slave,
-                                            (uint8_t *)&master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address],
-                                            (uint8_t *)&master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address + slave->odata_size]);
+#ifdef CONFIG_EC_TRACE
+    uint64_t parsed_time = master->trace.enable ? ec_timestamp_get_time_ns() : 0;
+    bool traced = false;
+#endif
+
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
+
+        if (domain->scheduled && ec_domain_done(domain)) {
+            ec_domain_process(domain);
+#ifdef CONFIG_EC_TRACE
+            traced = (parsed_time != 0);
+#endif
+#ifdef CONFIG_EC_PERF_HIST
+            if (master->perf_enable) {
+                ec_datagram_t *datagram = domain->lrw_datagram.data_size ? &domain->lrw_datagram : &domain->lrd_datagram;
+
+                ec_perf_hist_record(&master->perf_hist[EC_PERF_HIST_RTT],
+                                    (uint32_t)(datagram->jiffies_received - datagram->jiffies_sent));
             }
-        }
-        master->actual_working_counter = master->pdo_datagram.working_counter;
-    }
-#else
-    for (uint32_t i = 0; i < master->slave_count; i++) {
-        slave = &master->slaves[i];
+#endif
 
-        if (slave->pdo_datagram.state == EC_DATAGRAM_RECEIVED) {
-            if (slave->config && slave->config->pdo_callback) {
-                slave->config->pdo_callback(slave,
-                                            (uint8_t *)&master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address],
-                                            (uint8_t *)&master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address + slave->odata_size]);
+            master->actual_working_counter = 0;
+            for (uint8_t j = 0; j < master->domain_count; j++) {
+                master->actual_working_counter += master->domains[j].actual_working_counter;
             }
-            master->actual_working_counter += slave->pdo_datagram.working_counter;
-            slave->actual_working_counter = slave->pdo_datagram.working_counter;
         }
     }
-#endif
+
     exec_ns = ec_timestamp_get_time_ns() - start_time;
     if (master->perf_enable) {
         master->min_recv_exec_ns = MIN(exec_ns, master->min_recv_exec_ns);
         master->max_recv_exec_ns = MAX(exec_ns, master->max_recv_exec_ns);
         master->total_recv_exec_ns += exec_ns;
         master->recv_exec_count++;
+#ifdef CONFIG_EC_PERF_HIST
+        ec_perf_hist_record(&master->perf_hist[EC_PERF_HIST_RECV_EXEC], exec_ns);
+#endif
     }
+
+#ifdef CONFIG_EC_TRACE
+    // only the frame carrying the domain data is part of the timeline
+    if (traced) {
+        EC_TRACE_POINT_AT(master, EC_TRACE_RX_ENTRY, start_time);
+        EC_TRACE_POINT_AT(master, EC_TRACE_RX_PARSED, parsed_time);
+        EC_TRACE_POINT_AT(master, EC_TRACE_RX_END, start_time + exec_ns);
+    }
+#endif
 }
 
 static void ec_netdev_linkpoll_timer(void *argument)
@@ -416,6 +438,11 @@ int ec_master_init(ec_master_t *master, uint8_t master_index)
     ec_datagram_init(&master->dc_ref_sync_datagram, 8);
     ec_datagram_init(&master->dc_all_sync_datagram, 8);
 
+    ec_dc_ctrl_default_config(&master->dc_ctrl_config);
+
+    ec_domain_init(&master->domains[0], master, 0, 1, 0);
+    master->domain_count = 1;
+
     master->scan_lock = ec_osal_mutex_create();
     if (!master->scan_lock) {
         return -1;
@@ -452,11 +479,84 @@ void ec_master_deinit(ec_master_t *master)
 {
 }
 
+/* Choose cycle offsets of domains with EC_DOMAIN_CYCLE_OFFSET_AUTO, largest first,
+ * so that the number of PDO bytes per cycle stays as even as possible.
+ */
+static void ec_master_balance_domains(ec_master_t *master)
+{
+    uint32_t load[EC_DOMAIN_BALANCE_SLOTS];
+    uint32_t slots = 1;
+    uint32_t a, b, best_offset, best_load, max_load;
+    ec_domain_t *domain;
+    bool placed[CONFIG_EC_MAX_DOMAINS];
+
+    memset(load, 0, sizeof(load));
+
+    // slots cover the least common multiple of all divisors
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        a = slots;
+        b = master->domains[i].cycle_divisor;
+        while (b) {
+            uint32_t t = a % b;
+            a = b;
+            b = t;
+        }
+        slots = slots / a * master->domains[i].cycle_divisor;
+        if (slots > EC_DOMAIN_BALANCE_SLOTS) {
+            slots = EC_DOMAIN_BALANCE_SLOTS;
+            break;
+        }
+    }
+
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
+        placed[i] = (domain->cycle_offset != EC_DOMAIN_CYCLE_OFFSET_AUTO);
+        if (placed[i]) {
+            domain->actual_cycle_offset = domain->cycle_offset % domain->cycle_divisor;
+            for (uint32_t k = domain->actual_cycle_offset; k < slots; k += domain->cycle_divisor) {
+                load[k] += domain->data_size;
+            }
+        }
+    }
+
+    while (1) {
+        domain = NULL;
+        for (uint8_t i = 0; i < master->domain_count; i++) {
+            if (!placed[i] && (!domain || master->domains[i].data_size > domain->data_size)) {
+                domain = &master->domains[i];
+            }
+        }
+
+        if (!domain) {
+            break;
+        }
+
+        best_offset = 0;
+        best_load = UINT32_MAX;
+        for (uint32_t offset = 0; offset < domain->cycle_divisor; offset++) {
+            max_load = 0;
+            for (uint32_t k = offset; k < slots; k += domain->cycle_divisor) {
+                max_load = MAX(max_load, load[k]);
+            }
+            if (max_load < best_load) {
+                best_load = max_load;
+                best_offset = offset;
+            }
+        }
+
+        domain->actual_cycle_offset = best_offset;
+        for (uint32_t k = best_offset; k < slots; k += domain->cycle_divisor) {
+            load[k] += domain->data_size;
+        }
+        placed[domain->index] = true;
+    }
+}
+
 int ec_master_start(ec_master_t *master)
 {
     ec_slave_t *slave;
-    uint32_t bitlen;
-    uint8_t sm_idx;
+    ec_domain_t *domain;
+    uint32_t dispatch_count;
 
     EC_ASSERT_MSG(master->cycle_time >= (40 * 1000), "Cycle time %u ns is too small. Minimum is 40000 ns.\n", master->cycle_time);
     EC_ASSERT_MSG(master->cycle_time >= master->shift_time, "Shift time %u ns is larger than cycle time %u ns.\n", master->shift_time, master->cycle_time);
@@ -477,7 +577,14 @@ int ec_master_start(ec_master_t *master)
     master->phase = EC_OPERATION;
     master->nonperiod_suspend = true;
     master->interval = 0;
-    master->dc_sync_integral = 0;
+    ec_dc_ctrl_init(&master->dc_ctrl, &master->dc_ctrl_config, master->cycle_time);
+    ec_dc_clock_init(&master->dc_clock, master->cycle_time);
+    ec_datagram_init_static(&master->wc_diag_datagram, master->wc_diag_data, sizeof(master->wc_diag_data));
+    master->wc_diag_pending = false;
+    master->wc_diag_time = 0;
+#ifdef CONFIG_EC_DC_MONITOR
+    ec_dc_monitor_init(master);
+#endif
 
     // wait for non-periodic thread to suspend
     while (master->nonperiod_suspend) {
@@ -487,84 +594,62 @@ int ec_master_start(ec_master_t *master)
     for (uint32_t slave_idx = 0; slave_idx < master->slave_count; slave_idx++) {
         slave = &master->slaves[slave_idx];
 
-        EC_ASSERT_MSG(slave->config != NULL, "Slave %u has no configuration\n", slave_idx);
+        // no configuration, exchange the PDOs the SII describes
+        if (!slave->config) {
+            EC_LOG_INFO("Slave %u has no configuration, using %u sync managers of the SII\n",
+                        slave_idx, slave->sii.sync_count);
+            memset(&slave->default_config, 0, sizeof(ec_slave_config_t));
+            slave->default_config.sync = slave->sii.sync;
+            slave->default_config.sync_count = slave->sii.sync_count;
+            slave->config = &slave->default_config;
+        }
 
-        slave->logical_start_address = master->actual_pdo_size;
-        slave->odata_size = 0;
-        slave->idata_size = 0;
-        for (uint8_t i = 0; i < slave->config->sync_count; i++) {
-            bitlen = 0;
+        slave->domain = slave->config->domain ? slave->config->domain : &master->domains[0];
+        EC_ASSERT_MSG(slave->domain->master == master, "Slave %u: Domain belongs to another master\n", slave_idx);
+    }
 
-            sm_idx = slave->config->sync[i].index;
-            EC_ASSERT_MSG(sm_idx < slave->sm_count, "Slave %u: Invalid sync manager index %u\n",
-                          slave_idx, sm_idx);
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
 
-            slave->sm_info[sm_idx].pdo_assign.count = slave->config->sync[i].n_pdos;
+        ec_domain_layout(domain);
+        master->expected_working_counter += domain->expected_working_counter;
 
-            EC_ASSERT_MSG(slave->sm_info[sm_idx].pdo_assign.count <= CONFIG_EC_PER_SM_MAX_PDOS,
-                          "Slave %u: Too many PDOs %u for SM %u\n",
-                          slave_idx, slave->sm_info[sm_idx].pdo_assign.count, sm_idx);
+        EC_ASSERT_MSG(ec_domain_resolve_pdo_entries(domain) == 0,
+                      "Domain %u: Failed to resolve registered PDO entries\n", domain->index);
+    }
 
-            for (uint32_t j = 0; j < slave->config->sync[i].n_pdos; j++) {
-                slave->sm_info[sm_idx].pdo_assign.entry[j] = slave->config->sync[i].pdos[j].index;
+    ec_master_balance_domains(master);
 
-                slave->sm_info[sm_idx].pdo_mapping[j].count = slave->config->sync[i].pdos[j].n_entries;
+    dispatch_count = 0;
+    for (uint32_t slave_idx = 0; slave_idx < master->slave_count; slave_idx++) {
+        if (master->slaves[slave_idx].config->pdo_callback) {
+            dispatch_count++;
+        }
+    }
 
-                EC_ASSERT_MSG(slave->sm_info[sm_idx].pdo_mapping[j].count <= CONFIG_EC_PER_PDO_MAX_PDO_ENTRIES,
-                              "Slave %u: Too many entries %u for PDO 0x%04X\n",
-                              slave_idx, slave->sm_info[sm_idx].pdo_mapping[j].count,
-                              slave->config->sync[i].pdos[j].index);
+    if (master->pdo_dispatch) {
+        ec_osal_free(master->pdo_dispatch);
+        master->pdo_dispatch = NULL;
+    }
 
-                for (uint32_t k = 0; k < slave->config->sync[i].pdos[j].n_entries; k++) {
-                    uint32_t entry = (slave->config->sync[i].pdos[j].entries[k].index << 16) |
-                                     (slave->config->sync[i].pdos[j].entries[k].subindex & 0xFF) << 8 |
-                                     (slave->config->sync[i].pdos[j].entries[k].bit_length & 0xFF);
-                    slave->sm_info[sm_idx].pdo_mapping[j].entry[k] = entry;
+    if (dispatch_count) {
+        master->pdo_dispatch = ec_osal_malloc(sizeof(ec_pdo_dispatch_t) * dispatch_count);
+        EC_ASSERT_MSG(master->pdo_dispatch != NULL, "Failed to allocate PDO dispatch table\n");
+    }
 
-                    bitlen += slave->config->sync[i].pdos[j].entries[k].bit_length;
-                }
-            }
+    dispatch_count = 0;
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
 
-            // update SM
-            slave->sm_info[sm_idx].length = (bitlen + 7) / 8;
-            slave->sm_info[sm_idx].enable = true;
+        ec_domain_build_dispatch(domain, master->pdo_dispatch ? master->pdo_dispatch + dispatch_count : NULL);
+        dispatch_count += domain->dispatch_count;
+    }
 
-            // update FMMU
-            slave->sm_info[sm_idx].fmmu.data_size = (bitlen + 7) / 8;
-            slave->sm_info[sm_idx].fmmu.logical_start_address = master->actual_pdo_size;
-            slave->sm_info[sm_idx].fmmu.dir = slave->config->sync[i].dir;
-            slave->sm_info[sm_idx].fmmu_enable = true;
-            master->actual_pdo_size += (bitlen + 7) / 8;
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
+        domain->cycle_count = domain->actual_cycle_offset;
+    }
 
-            if (slave->config->sync[i].dir == EC_DIR_INPUT) {
-                slave->idata_size += (bitlen + 7) / 8;
-            }
-            if (slave->config->sync[i].dir == EC_DIR_OUTPUT) {
-                slave->odata_size += (bitlen + 7) / 8;
-            }
-        }
-#ifdef CONFIG_EC_PDO_MULTI_DOMAIN
-        ec_datagram_init_static(&slave->pdo_datagram,
-                                &master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address],
-                                slave->odata_size + slave->idata_size);
-        ec_datagram_lrw(&slave->pdo_datagram, slave->logical_start_address, slave->odata_size + slave->idata_size);
-        ec_datagram_zero(&slave->pdo_datagram);
-#endif
-        slave->expected_working_counter = 3;
-        master->expected_working_counter += slave->expected_working_counter;
-
-        EC_SLAVE_LOG_INFO("Slave %u: Logical address 0x%08x, obyte %u, ibyte %u, expected working counter %u\n",
-                          slave->index,
-                          slave->logical_start_address, slave->odata_size, slave->idata_size,
-                          slave->expected_working_counter);
-    }
-#ifndef CONFIG_EC_PDO_MULTI_DOMAIN
-    ec_datagram_init_static(&master->pdo_datagram,
-                            &master->pdo_buffer[EC_NETDEV_MAIN][0],
-                            master->actual_pdo_size);
-    ec_datagram_lrw(&master->pdo_datagram, 0, master->actual_pdo_size);
-    ec_datagram_zero(&master->pdo_datagram);
-#endif
     ec_htimer_start(master->cycle_time / 1000, ec_master_period_process, master);
 
     for (uint32_t i = 0; i < master->slave_count; i++) {
@@ -589,6 +674,10 @@ int ec_master_stop(ec_master_t *master)
     ec_osal_mutex_take(master->scan_lock);
     master->started = false;
 
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        master->domains[i].wc_valid = false;
+    }
+
     for (uint32_t i = 0; i < master->slave_count; i++) {
         master->slaves[i].requested_state = EC_SLAVE_STATE_PREOP;
         master->slaves[i].alstatus_code = 0;
@@ -612,12 +701,18 @@ int ec_master_stop(ec_master_t *master)
 
 out:
     ec_htimer_stop();
-#ifndef CONFIG_EC_PDO_MULTI_DOMAIN
-    ec_datagram_clear(&master->pdo_datagram);
-#else
-    for (uint32_t i = 0; i < master->slave_count; i++) {
-        ec_datagram_clear(&master->slaves[i].pdo_datagram);
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        ec_domain_clear(&master->domains[i]);
     }
+
+    if (master->pdo_dispatch) {
+        ec_osal_free(master->pdo_dispatch);
+        master->pdo_dispatch = NULL;
+    }
+    ec_datagram_clear(&master->wc_diag_datagram);
+    master->wc_diag_pending = false;
+#ifdef CONFIG_EC_DC_MONITOR
+    ec_dc_monitor_clear(master);
 #endif
 
     ec_master_enter_idle(master);
@@ -712,6 +807,39 @@ uint8_t *ec_master_get_slave_domain_input(ec_master_t *master, uint32_t slave_in
     return &master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address + slave->odata_size];
 }
 
+uint64_t ec_master_get_slave_input_dc_time(ec_master_t *master, uint32_t slave_index)
+{
+    if ((slave_index >= master->slave_count) || !master->slaves[slave_index].domain) {
+        return 0;
+    }
+
+    return master->slaves[slave_index].domain->input_dc_time;
+}
+
+int ec_master_get_slave_input_snapshot(ec_master_t *master, uint32_t slave_index, uint8_t *buf, uint32_t size, uint64_t *dc_time)
+{
+    ec_slave_t *slave;
+    uintptr_t flags;
+
+    if (slave_index >= master->slave_count) {
+        return -EC_ERR_INVAL;
+    }
+
+    slave = &master->slaves[slave_index];
+    if (!slave->domain || (size > slave->idata_size)) {
+        return -EC_ERR_INVAL;
+    }
+
+    flags = ec_osal_enter_critical_section();
+    ec_memcpy(buf, &master->pdo_buffer[EC_NETDEV_MAIN][slave->logical_start_address + slave->odata_size], size);
+    if (dc_time) {
+        *dc_time = slave->domain->input_dc_time;
+    }
+    ec_osal_leave_critical_section(flags);
+
+    return 0;
+}
+
 uint32_t ec_master_get_slave_domain_size(ec_master_t *master, uint32_t slave_index)
 {
     ec_slave_t *slave;
@@ -751,30 +879,219 @@ uint32_t ec_master_get_slave_domain_isize(ec_master_t *master, uint32_t slave_in
     return slave->idata_size;
 }
 
+uint32_t ec_master_get_wc_error_count(ec_master_t *master)
+{
+    return master->stats.wc_errors;
+}
+
+uint32_t ec_master_get_slave_wc_fault_count(ec_master_t *master, uint32_t slave_index)
+{
+    if (slave_index >= master->slave_count) {
+        return 0;
+    }
+
+    return master->slaves[slave_index].wc_fault_count;
+}
+
+void ec_master_clear_wc_error_count(ec_master_t *master)
+{
+    master->stats.wc_errors = 0;
+    master->stats.wc_diags = 0;
+
+    for (uint32_t i = 0; i < master->slave_count; i++) {
+        master->slaves[i].wc_fault_count = 0;
+    }
+}
+
+uint64_t ec_master_dc_time_from_local(ec_master_t *master, uint64_t local_ns)
+{
+    uintptr_t flags;
+    uint64_t dc_ns;
+
+    if (!master->dc_clock.valid) {
+        return 0;
+    }
+
+    flags = ec_osal_enter_critical_section();
+    dc_ns = ec_dc_clock_predict(&master->dc_clock, local_ns);
+    ec_osal_leave_critical_section(flags);
+
+    return dc_ns;
+}
+
+uint64_t ec_master_get_dc_time_ns(ec_master_t *master)
+{
+    return ec_master_dc_time_from_local(master, ec_timestamp_get_time_ns());
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_master_dc_sync_time(ec_master_t *master)
+{
+    ec_datagram_t *datagram = &master->dc_all_sync_datagram;
+    uint64_t predict;
+
+    if (master->dc_ref_clock->base_dc_range == EC_DC_64) {
+        return EC_READ_U64(datagram->data);
+    }
+
+    if (!master->dc_clock.valid) {
+        return EC_READ_U32(datagram->data);
+    }
+
+    // extend the 32 bit system time with the upper bits of the prediction
+    predict = ec_dc_clock_predict(&master->dc_clock, datagram->jiffies_sent);
+    return predict + (int32_t)(EC_READ_U32(datagram->data) - (uint32_t)predict);
+}
+
+static void ec_master_dc_clock_update(ec_master_t *master)
+{
+    ec_dc_clock_update(&master->dc_clock, master->dc_all_sync_datagram.jiffies_sent, ec_master_dc_sync_time(master));
+}
+
 EC_FAST_CODE_SECTION void ec_master_dc_sync_with_pi(ec_master_t *master, uint64_t dc_ref_time, int32_t *offsettime)
 {
-    int64_t delta;
+    int32_t delta;
+
+    delta = ec_dc_ctrl_phase_error(&master->dc_ctrl, dc_ref_time - master->shift_time);
+    *offsettime = ec_dc_ctrl_update(&master->dc_ctrl, delta);
+}
+
+/* One datagram per cycle: a BRD of AL status first, single slaves are read only if it shows a problem. */
+static void ec_master_wc_diag_queue(ec_master_t *master, uint32_t index)
+{
+    ec_slave_t *slave;
+
+    if (index >= master->slave_count) {
+        ec_datagram_brd(&master->wc_diag_datagram, ESCREG_OF(ESCREG->AL_STAT), 2);
+        master->wc_diag_datagram.netdev_idx = EC_NETDEV_MAIN;
+    } else {
+        slave = &master->slaves[index];
+        ec_datagram_fprd(&master->wc_diag_datagram, slave->station_address, ESCREG_OF(ESCREG->AL_STAT), sizeof(master->wc_diag_data));
+        master->wc_diag_datagram.netdev_idx = slave->netdev_idx;
+    }
+
+    master->wc_diag_index = index;
+    ec_datagram_zero(&master->wc_diag_datagram);
+    ec_master_queue_datagram(master, &master->wc_diag_datagram);
+}
+
+/* All slaves answered the BRD and the ORed AL status is the one state all of them were requested to. */
+static bool ec_master_wc_diag_bus_ok(ec_master_t *master)
+{
+    uint8_t requested = 0;
+
+    if ((master->wc_diag_datagram.state != EC_DATAGRAM_RECEIVED) ||
+        (master->wc_diag_datagram.working_counter != master->slave_count)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < master->slave_count; i++) {
+        requested |= master->slaves[i].requested_state;
+    }
+
+    // a mix of requested states can not be told apart in the ORed status
+    return !(requested & (requested - 1)) && ((EC_READ_U16(master->wc_diag_data) & 0x1f) == requested);
+}
+
+static void ec_master_wc_diag_slave_check(ec_master_t *master, ec_slave_t *slave)
+{
+    uint8_t al_state;
+
+    if ((master->wc_diag_datagram.state != EC_DATAGRAM_RECEIVED) ||
+        (master->wc_diag_datagram.working_counter != 1)) {
+        slave->wc_fault_count++;
+        EC_SLAVE_LOG_WRN("Slave %u: WC fault, no response\n", slave->index);
+        return;
+    }
+
+    slave->wc_diag_alstatus = EC_READ_U16(master->wc_diag_data);
+    slave->wc_diag_alstatus_code = EC_READ_U16(master->wc_diag_data + 4);
+    al_state = slave->wc_diag_alstatus & 0xff;
+
+    if (al_state != slave->requested_state) {
+        slave->wc_fault_count++;
+        EC_SLAVE_LOG_WRN("Slave %u: WC fault, state %s, alstatus code: 0x%04x (%s)\n",
+                         slave->index,
+                         ec_state_string(al_state, 0),
+                         slave->wc_diag_alstatus_code,
+                         ec_alstatus_string(slave->wc_diag_alstatus_code));
+    }
+}
+
+static void ec_master_wc_diag_process(ec_master_t *master)
+{
+    if ((master->wc_diag_datagram.state == EC_DATAGRAM_QUEUED) ||
+        (master->wc_diag_datagram.state == EC_DATAGRAM_SENT)) {
+        return;
+    }
+
+    if (master->wc_diag_index >= master->slave_count) {
+        if (ec_master_wc_diag_bus_ok(master)) {
+            EC_LOG_WRN("WC fault, all %u slaves are in the requested state\n", master->slave_count);
+            master->wc_diag_pending = false;
+            return;
+        }
+        ec_master_wc_diag_queue(master, 0);
+        return;
+    }
+
+    ec_master_wc_diag_slave_check(master, &master->slaves[master->wc_diag_index]);
+
+    if ((master->wc_diag_index + 1) < master->slave_count) {
+        ec_master_wc_diag_queue(master, master->wc_diag_index + 1);
+    } else {
+        master->wc_diag_pending = false;
+    }
+}
+
+static void ec_master_wc_monitor(ec_master_t *master, uint64_t now)
+{
+    ec_domain_t *domain;
+    bool wc_error = false;
+
+    if (master->wc_diag_pending) {
+        ec_master_wc_diag_process(master);
+    }
+
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
+
+        if (!domain->wc_check) {
+            continue;
+        }
+        domain->wc_check = false;
 
-    delta = (dc_ref_time - master->shift_time) % master->cycle_time;
-    if (delta > (master->cycle_time / 2)) {
-        delta = delta - master->cycle_time;
+        if (ec_domain_wc_check(domain)) {
+            domain->wc_valid = true;
+            continue;
+        }
+
+        /* Only a drop from a complete working counter is a fault, not the startup phase. */
+        if (domain->wc_valid) {
+            wc_error = true;
+        }
     }
-    if (delta > 0) {
-        master->dc_sync_integral++;
+
+    if (!wc_error) {
+        return;
     }
-    if (delta < 0) {
-        master->dc_sync_integral--;
+
+    master->stats.wc_errors++;
+    EC_CAPTURE_TRIGGER(master, EC_CAPTURE_TRIGGER_WC);
+
+    if (!master->wc_diag_pending &&
+        ((now - master->wc_diag_time) >= (CONFIG_EC_WC_DIAG_INTERVAL_MS * 1000000ULL))) {
+        master->wc_diag_time = now;
+        master->wc_diag_pending = true;
+        master->stats.wc_diags++;
+        ec_master_wc_diag_queue(master, master->slave_count);
     }
-    *offsettime = -(delta / 100) - (master->dc_sync_integral / 20); // Kp = 0.1f, Ki = 0.05f
 }
 
 EC_FAST_CODE_SECTION void ec_master_period_process(void *arg)
 {
     ec_master_t *master = (ec_master_t *)arg;
     uint64_t dc_ref_systime = 0;
-#ifdef CONFIG_EC_PDO_MULTI_DOMAIN
-    ec_slave_t *slave;
-#endif
+    ec_domain_t *domain;
     int32_t offsettime = 0;
     uint64_t start_time;
     uint32_t period_ns;
@@ -785,6 +1102,13 @@ EC_FAST_CODE_SECTION void ec_master_period_process(void *arg)
     }
 
     start_time = ec_timestamp_get_time_ns();
+#ifdef CONFIG_EC_TRACE
+    ec_trace_cycle_begin(&master->trace, start_time);
+#endif
+
+    if (master->dc_ref_clock && (master->dc_all_sync_datagram.state == EC_DATAGRAM_RECEIVED)) {
+        ec_master_dc_clock_update(master);
+    }
 
     if (master->dc_ref_clock) {
         if (master->dc_sync_with_dc_ref_enable) {
@@ -793,12 +1117,12 @@ EC_FAST_CODE_SECTION void ec_master_period_process(void *arg)
 
                 ec_master_dc_sync_with_pi(master, dc_ref_systime, &offsettime);
 
-                ec_htimer_update(master->cycle_time / 1000 + offsettime / 1000);
+                ec_htimer_update_ns(master->cycle_time + offsettime);
             }
         } else {
-            EC_WRITE_U32(master->dc_ref_sync_datagram.data, ec_timestamp_get_time_ns() & 0xffffffff);
+            EC_WRITE_U32(master->dc_ref_sync_datagram.data, start_time & 0xffffffff);
             if (master->dc_ref_clock->base_dc_range == EC_DC_64) {
-                EC_WRITE_U32(master->dc_ref_sync_datagram.data + 4, (uint32_t)(ec_timestamp_get_time_ns() >> 32));
+                EC_WRITE_U32(master->dc_ref_sync_datagram.data + 4, (uint32_t)(start_time >> 32));
             }
             ec_master_queue_datagram(master, &master->dc_ref_sync_datagram);
         }
@@ -809,19 +1133,30 @@ EC_FAST_CODE_SECTION void ec_master_period_process(void *arg)
         ec_master_queue_datagram(master, &master->dc_all_sync_datagram);
     }
 
-#ifndef CONFIG_EC_PDO_MULTI_DOMAIN
-    ec_master_queue_datagram(master, &master->pdo_datagram);
-#else
-    for (uint32_t i = 0; i < master->slave_count; i++) {
-        slave = &master->slaves[i];
-        ec_master_queue_datagram(master, &slave->pdo_datagram);
-    }
+    ec_master_wc_monitor(master, start_time);
+#ifdef CONFIG_EC_DC_MONITOR
+    ec_dc_monitor_process(master);
 #endif
-    ec_master_send(master);
+
+    for (uint8_t i = 0; i < master->domain_count; i++) {
+        domain = &master->domains[i];
+
+        if (domain->cycle_count == 0) {
+            domain->cycle_count = domain->cycle_divisor;
+            ec_domain_queue(domain);
+        }
+        domain->cycle_count--;
+    }
+
+    EC_TRACE_POINT(master, EC_TRACE_SEND_START);
+    ec_master_send_at(master, start_time);
 
     period_ns = start_time - master->last_start_time;
     exec_ns = ec_timestamp_get_time_ns() - start_time;
     master->last_start_time = start_time;
+#ifdef CONFIG_EC_TRACE
+    ec_trace_cycle_end(&master->trace, start_time + exec_ns, period_ns, master->cycle_time);
+#endif
 
     if (master->perf_enable) {
         master->min_period_ns = MIN(period_ns, master->min_period_ns);
@@ -836,6 +1171,15 @@ EC_FAST_CODE_SECTION void ec_master_period_process(void *arg)
 
         master->min_offset_ns = MIN(offsettime, master->min_offset_ns);
         master->max_offset_ns = MAX(offsettime, master->max_offset_ns);
+
+#ifdef CONFIG_EC_PERF_HIST
+        ec_perf_hist_record(&master->perf_hist[EC_PERF_HIST_PERIOD], period_ns);
+        ec_perf_hist_record(&master->perf_hist[EC_PERF_HIST_SEND_EXEC], exec_ns);
+        if (master->dc_ref_clock && master->dc_sync_with_dc_ref_enable) {
+            ec_perf_hist_record(&master->perf_hist[EC_PERF_HIST_DC_OFFSET],
+                                (offsettime < 0) ? -(uint32_t)offsettime : (uint32_t)offsettime);
+        }
+#endif
     }
 
     master->interval++;
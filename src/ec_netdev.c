@@ -16,11 +16,11 @@ const unsigned int netdev_rate_intervals[] = {
     1, 10, 60
 };
 
-EC_FAST_CODE_SECTION void ec_netdev_update_stats(ec_netdev_t *netdev)
+EC_FAST_CODE_SECTION void ec_netdev_update_stats(ec_netdev_t *netdev, uint64_t now)
 {
     unsigned int i;
 
-    if ((jiffies - netdev->stats.last_jiffies) < 1000000000ULL) {
+    if ((now - netdev->stats.last_jiffies) < 1000000000ULL) {
         return;
     }
 
@@ -54,7 +54,7 @@ EC_FAST_CODE_SECTION void ec_netdev_update_stats(ec_netdev_t *netdev)
     netdev->stats.last_tx_bytes = netdev->stats.tx_bytes;
     netdev->stats.last_rx_bytes = netdev->stats.rx_bytes;
     netdev->stats.loss_count = loss;
-    netdev->stats.last_jiffies = jiffies;
+    netdev->stats.last_jiffies = now;
 }
 
 ec_netdev_t *ec_netdev_init(uint8_t netdev_index)
@@ -125,6 +125,9 @@ EC_FAST_CODE_SECTION uint8_t *ec_netdev_get_txbuf(ec_netdev_t *netdev)
 
 EC_FAST_CODE_SECTION int ec_netdev_send(ec_netdev_t *netdev, uint32_t size)
 {
+    EC_CAPTURE_FRAME(netdev->master, netdev->index, EC_CAPTURE_DIR_TX,
+                     ec_netdev_low_level_get_txbuf(netdev), size + ETH_HLEN);
+
     if (ec_netdev_low_level_output(netdev, size + ETH_HLEN) == 0) {
         netdev->stats.tx_count++;
         netdev->stats.tx_bytes += ETH_HLEN + size;
@@ -144,5 +147,7 @@ EC_FAST_CODE_SECTION void ec_netdev_receive(ec_netdev_t *netdev, uint8_t *frame,
     netdev->stats.rx_count++;
     netdev->stats.rx_bytes += size;
 
+    EC_CAPTURE_FRAME(netdev->master, netdev->index, EC_CAPTURE_DIR_RX, frame, size);
+
     ec_master_receive(netdev->master, netdev->index, ec_data, ec_size);
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+
+#ifdef CONFIG_EC_PERF_HIST
+
+void ec_perf_hist_clear(ec_perf_hist_t *hist)
+{
+    memset(hist, 0, sizeof(ec_perf_hist_t));
+    hist->min = 0xffffffff;
+}
+
+uint32_t ec_perf_hist_bucket_low(uint32_t index)
+{
+    uint32_t msb;
+
+    if (index < (1UL << EC_PERF_HIST_SUB_BITS)) {
+        return index;
+    }
+    if (index >= (EC_PERF_HIST_BUCKETS - 1)) {
+        return 1UL << EC_PERF_HIST_MAX_BITS;
+    }
+
+    msb = (index >> EC_PERF_HIST_SUB_BITS) + EC_PERF_HIST_SUB_BITS - 1;
+    return ((1UL << EC_PERF_HIST_SUB_BITS) | (index & ((1UL << EC_PERF_HIST_SUB_BITS) - 1))) << (msb - EC_PERF_HIST_SUB_BITS);
+}
+
+/* Returns the upper bound of the bucket holding the given permille of the samples [ns]. */
+uint32_t ec_perf_hist_percentile(const ec_perf_hist_t *hist, uint32_t permille)
+{
+    uint64_t target;
+    uint64_t sum = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    target = ((uint64_t)hist->count * permille + 999) / 1000;
+    target = MAX(target, 1);
+
+    for (uint32_t i = 0; i < (EC_PERF_HIST_BUCKETS - 1); i++) {
+        sum += hist->buckets[i];
+        if (sum >= target) {
+            return MIN(ec_perf_hist_bucket_low(i + 1) - 1, hist->max);
+        }
+    }
+
+    return hist->max;
+}
+
+int ec_master_get_perf_hist(ec_master_t *master, ec_perf_hist_type_t type, ec_perf_hist_t *hist)
+{
+    uintptr_t flags;
+
+    if (type >= EC_PERF_HIST_NUM) {
+        return -EC_ERR_INVAL;
+    }
+
+    flags = ec_osal_enter_critical_section();
+    memcpy(hist, &master->perf_hist[type], sizeof(ec_perf_hist_t));
+    ec_osal_leave_critical_section(flags);
+
+    return 0;
+}
+
+void ec_master_clear_perf_hist(ec_master_t *master)
+{
+    uintptr_t flags;
+
+    for (uint8_t i = 0; i < EC_PERF_HIST_NUM; i++) {
+        flags = ec_osal_enter_critical_section();
+        ec_perf_hist_clear(&master->perf_hist[i]);
+        ec_osal_leave_critical_section(flags);
+    }
+}
+
+#endif
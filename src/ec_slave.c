@@ -7,14 +7,25 @@
 
 /** Maximum clock difference (in ns) before going to SAFEOP.
  *
- * Wait for DC time difference to drop under this absolute value before
- * requesting SAFEOP.
+ * Slaves above this absolute value after the drift compensation are reported.
  */
 #define EC_DC_MAX_SYNC_DIFF_NS 100
 
-/** Maximum count to wait for clock discipline.
+/** Number of datagrams queued back to back, so that they share one frame.
  */
-#define EC_DC_SYNC_WAIT_COUNT (15000)
+#define EC_DC_BATCH_SIZE (16)
+
+/** Number of FRMW batches the drift compensation keeps in flight, at most 256 datagrams.
+ */
+#define EC_DC_BURST_WINDOW (8)
+
+/** Number of port receive time samples taken for the delay measurement.
+ */
+#define EC_DC_DELAY_SAMPLES (8)
+
+/** Samples closer than this (in ns) to the median are never rejected as outliers.
+ */
+#define EC_DC_DELAY_OUTLIER_NS (20)
 
 /** Time offset (in ns), that is added to cyclic start time.
  */
@@ -53,6 +64,12 @@ static void ec_slave_clear(ec_slave_t *slave)
         slave->sii.strings = NULL;
     }
 
+    if (slave->sii.sync) {
+        ec_osal_free(slave->sii.sync);
+        slave->sii.sync = NULL;
+        slave->sii.sync_count = 0;
+    }
+
     if (slave->sm_info) {
         ec_osal_free(slave->sm_info);
         slave->sm_info = NULL;
@@ -105,6 +122,130 @@ errorout1:
     return ret;
 }
 
+/** Next SII category of the given type from cat on, NULL behind the last category. */
+static const uint16_t *ec_slave_next_sii_category(const uint16_t *cat, uint16_t type)
+{
+    while (EC_READ_U16(cat) != 0xFFFF) {
+        if (EC_READ_U16(cat) == type) {
+            return cat;
+        }
+        cat += 2 + EC_READ_U16(cat + 1);
+    }
+
+    return NULL;
+}
+
+/** Build the default PDO layout from all RXPDO and TXPDO categories.
+ *
+ * A device may describe its PDOs in one category or in one category per PDO, all of them
+ * are parsed. Sync managers, PDOs and entries share one allocation, output sync managers
+ * come first. PDOs without a valid sync manager are optional ones of the device and are left out.
+ */
+static int ec_slave_fetch_sii_pdos(ec_slave_t *slave, const uint16_t *categories)
+{
+    const uint16_t cat_type[2] = { EC_SII_TYPE_RXPDO, EC_SII_TYPE_TXPDO };
+    const ec_direction_t cat_dir[2] = { EC_DIR_OUTPUT, EC_DIR_INPUT };
+    uint32_t sm_mask[2] = { 0, 0 };
+    uint32_t pdo_count = 0, entry_count = 0;
+    uint8_t sync_count = 0;
+    ec_sync_info_t *sync;
+    ec_pdo_info_t *pdo;
+    ec_pdo_entry_info_t *entry;
+    const uint16_t *cat;
+    const uint8_t *data;
+    size_t offset, cat_size;
+    uint8_t n_entries, sm_idx;
+
+    // count pass, PDO header and entries are 8 bytes each
+    for (uint8_t c = 0; c < 2; c++) {
+        for (cat = ec_slave_next_sii_category(categories, cat_type[c]); cat;
+             cat = ec_slave_next_sii_category(cat + 2 + EC_READ_U16(cat + 1), cat_type[c])) {
+            cat_size = EC_READ_U16(cat + 1) * 2;
+
+            for (offset = 0; (offset + 8) <= cat_size; offset += 8 + n_entries * 8) {
+                data = (const uint8_t *)(cat + 2) + offset;
+                n_entries = EC_READ_U8(data + 2);
+                sm_idx = EC_READ_U8(data + 3);
+
+                if ((offset + 8 + n_entries * 8) > cat_size) {
+                    EC_SLAVE_LOG_ERR("Slave %u PDO 0x%04x exceeds its SII category\n", slave->index, EC_READ_U16(data));
+                    return -EC_ERR_SII;
+                }
+                if (sm_idx >= slave->sm_count || sm_idx >= EC_MAX_SYNC_MANAGERS) {
+                    continue;
+                }
+
+                if (!(sm_mask[c] & (1UL << sm_idx))) {
+                    sm_mask[c] |= 1UL << sm_idx;
+                    sync_count++;
+                }
+                pdo_count++;
+                entry_count += n_entries;
+            }
+        }
+    }
+
+    if (!sync_count) {
+        return 0;
+    }
+
+    sync = ec_osal_malloc(sizeof(ec_sync_info_t) * sync_count +
+                          sizeof(ec_pdo_info_t) * pdo_count +
+                          sizeof(ec_pdo_entry_info_t) * entry_count);
+    if (!sync) {
+        return -EC_ERR_NOMEM;
+    }
+
+    pdo = (ec_pdo_info_t *)(sync + sync_count);
+    entry = (ec_pdo_entry_info_t *)(pdo + pdo_count);
+
+    slave->sii.sync = sync;
+    slave->sii.sync_count = sync_count;
+
+    // fill pass, one sync manager after the other, its PDOs in the order of the categories
+    for (uint8_t c = 0; c < 2; c++) {
+        for (sm_idx = 0; sm_idx < slave->sm_count; sm_idx++) {
+            if (!(sm_mask[c] & (1UL << sm_idx))) {
+                continue;
+            }
+
+            sync->index = sm_idx;
+            sync->dir = cat_dir[c];
+            sync->n_pdos = 0;
+            sync->pdos = pdo;
+            sync->watchdog_mode = EC_WD_DEFAULT;
+
+            for (cat = ec_slave_next_sii_category(categories, cat_type[c]); cat;
+                 cat = ec_slave_next_sii_category(cat + 2 + EC_READ_U16(cat + 1), cat_type[c])) {
+                cat_size = EC_READ_U16(cat + 1) * 2;
+
+                for (offset = 0; (offset + 8) <= cat_size; offset += 8 + n_entries * 8) {
+                    data = (const uint8_t *)(cat + 2) + offset;
+                    n_entries = EC_READ_U8(data + 2);
+                    if (EC_READ_U8(data + 3) != sm_idx) {
+                        continue;
+                    }
+
+                    pdo->index = EC_READ_U16(data);
+                    pdo->n_entries = n_entries;
+                    pdo->entries = entry;
+                    for (uint8_t i = 0; i < n_entries; i++) {
+                        entry->index = EC_READ_U16(data + 8 + i * 8);
+                        entry->subindex = EC_READ_U8(data + 8 + i * 8 + 2);
+                        entry->bit_length = EC_READ_U8(data + 8 + i * 8 + 5);
+                        entry++;
+                    }
+                    pdo++;
+                    sync->n_pdos++;
+                }
+            }
+            sync++;
+        }
+    }
+
+    return 0;
+}
+
 /** Get timeout in ns.
  *
  * For defaults see ETG2000_S_R_V1i0i15 section 5.3.6.2.
@@ -423,10 +564,55 @@ static inline void ec_slave_fmmu_config(ec_sm_info_t *sm, uint8_t *data)
     EC_WRITE_U16(data + 14, 0x0000); // reserved
 }
 
+int ec_slave_image_check(const ec_slave_t *slave)
+{
+    const ec_slave_image_t *image = slave->config->image;
+    const uint8_t *fmmu_page;
+
+    // the pages are written as they are, an image of another device would overrun its SMs and FMMUs
+    if ((((uint32_t)image->sm_start + image->sm_count) > slave->sm_count) || (image->fmmu_count > slave->base_fmmu_count)) {
+        EC_SLAVE_LOG_ERR("Slave %u: Configuration image needs SM %u..%u and %u FMMUs, slave has %u SMs and %u FMMUs\n",
+                         slave->index, image->sm_start, image->sm_start + image->sm_count - 1, image->fmmu_count,
+                         slave->sm_count, slave->base_fmmu_count);
+        return -EC_ERR_INVAL;
+    }
+
+    for (uint8_t i = 0; i < image->fmmu_count; i++) {
+        fmmu_page = image->fmmu_pages + EC_FMMU_PAGE_SIZE * i;
+        if (((uint64_t)EC_READ_U32(fmmu_page) + EC_READ_U16(fmmu_page + 4)) > (image->odata_size + image->idata_size)) {
+            EC_SLAVE_LOG_ERR("Slave %u: FMMU %u of the configuration image is outside of its process data\n", slave->index, i);
+            return -EC_ERR_INVAL;
+        }
+    }
+
+    return 0;
+}
+
+static int ec_slave_image_download(ec_slave_t *slave, ec_datagram_t *datagram, uint8_t state)
+{
+    const ec_slave_image_t *image = slave->config->image;
+    const ec_slave_image_cmd_t *cmd;
+    int ret;
+
+    for (uint16_t i = 0; i < image->cmd_count; i++) {
+        cmd = &image->cmds[i];
+        if (cmd->state != state) {
+            continue;
+        }
+
+        ret = ec_coe_download(slave->master, slave->index, datagram, cmd->index, cmd->subindex, cmd->data, cmd->size, cmd->complete_access);
+        if (ret < 0) {
+            EC_SLAVE_LOG_ERR("Slave %u: Init command 0x%04x:%02x failed\n", slave->index, cmd->index, cmd->subindex);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
 static int ec_slave_config(ec_slave_t *slave)
 {
     ec_datagram_t *datagram;
-    uint64_t start_time;
     uint8_t step = 0;
     bool coe_support;
     uint8_t pdo_sm_count;
@@ -561,7 +747,26 @@ static int ec_slave_config(ec_slave_t *slave)
         goto errorout;
     }
 
-    if (slave->config && slave->sii.general.coe_details.enable_pdo_assign && coe_support) {
+    if (slave->config && slave->config->image) {
+        ret = ec_slave_image_check(slave);
+        if (ret < 0) {
+            step = 9;
+            goto errorout;
+        }
+
+        if (slave->config->image->cmd_count && !coe_support) {
+            EC_SLAVE_LOG_ERR("Slave %u does not support CoE for the init commands\n", slave->index);
+            ret = -EC_ERR_NOSUPP;
+            step = 9;
+            goto errorout;
+        }
+
+        ret = ec_slave_image_download(slave, datagram, EC_SLAVE_STATE_SAFEOP);
+        if (ret < 0) {
+            step = 9;
+            goto errorout;
+        }
+    } else if (slave->config && slave->sii.general.coe_details.enable_pdo_assign && coe_support) {
         uint32_t data;
 
         /* Config PDO assignments for 0x1c12, 0x1c13
@@ -669,7 +874,33 @@ static int ec_slave_config(ec_slave_t *slave)
         }
     }
 
-    if (slave->config) {
+    if (slave->config && slave->config->image) {
+        const ec_slave_image_t *image = slave->config->image;
+
+        // SM and FMMU pages of the image, FMMU logical addresses are relative to the slave
+        ec_datagram_fpwr(datagram, slave->station_address,
+                         ESCREG_OF(ESCREG->SYNCM[image->sm_start]), EC_SYNC_PAGE_SIZE * image->sm_count);
+        ec_memcpy(datagram->data, image->sm_pages, EC_SYNC_PAGE_SIZE * image->sm_count);
+        datagram->netdev_idx = slave->netdev_idx;
+        ret = ec_master_queue_ext_datagram(slave->master, datagram, true, true);
+        if (ret < 0) {
+            step = 21;
+            goto errorout;
+        }
+
+        ec_datagram_fpwr(datagram, slave->station_address, ESCREG_OF(ESCREG->FMMU[0]), EC_FMMU_PAGE_SIZE * image->fmmu_count);
+        ec_memcpy(datagram->data, image->fmmu_pages, EC_FMMU_PAGE_SIZE * image->fmmu_count);
+        for (uint8_t i = 0; i < image->fmmu_count; i++) {
+            EC_WRITE_U32(datagram->data + EC_FMMU_PAGE_SIZE * i,
+                         EC_READ_U32(datagram->data + EC_FMMU_PAGE_SIZE * i) + slave->logical_start_address);
+        }
+        datagram->netdev_idx = slave->netdev_idx;
+        ret = ec_master_queue_ext_datagram(slave->master, datagram, true, true);
+        if (ret < 0) {
+            step = 22;
+            goto errorout;
+        }
+    } else if (slave->config) {
         // Config process data sm
         ec_datagram_fpwr(datagram, slave->station_address,
                          ESCREG_OF(ESCREG->SYNCM[pdo_sm_offset]), EC_SYNC_PAGE_SIZE * pdo_sm_count);
@@ -700,17 +931,7 @@ static int ec_slave_config(ec_slave_t *slave)
     if (slave->config && slave->config->dc_assign_activate) {
         EC_ASSERT_MSG(slave->base_dc_supported, "Slave %u does not support DC", slave->index);
 
-        // set DC system time offset and transmission delay
-        ec_datagram_fpwr(datagram, slave->station_address, ESCREG_OF(ESCREG->SYS_TIME_OFFSET), 12);
-        EC_WRITE_U64(datagram->data, slave->system_time_offset);
-        EC_WRITE_U32(datagram->data + 8, slave->transmission_delay);
-        datagram->netdev_idx = slave->netdev_idx;
-        ret = ec_master_queue_ext_datagram(slave->master, datagram, true, true);
-        if (ret < 0) {
-            return ret;
-        }
-
-        // set DC cycle times
+        // set DC cycle times, system time offset and transmission delay are written by the drift compensation
         ec_datagram_fpwr(datagram, slave->station_address, ESCREG_OF(ESCREG->SYNC0_CYC_TIME), 8);
         EC_WRITE_U32(datagram->data, slave->config->dc_sync[0].cycle_time);
         EC_WRITE_U32(datagram->data + 4, slave->config->dc_sync[1].cycle_time);
@@ -721,8 +942,6 @@ static int ec_slave_config(ec_slave_t *slave)
             goto errorout;
         }
 
-        start_time = 0;
-    read_check:
         ec_datagram_fprd(datagram, slave->station_address, ESCREG_OF(ESCREG->SYS_TIME_DIFF), 4);
         ec_datagram_zero(datagram);
         datagram->netdev_idx = slave->netdev_idx;
@@ -732,15 +951,9 @@ static int ec_slave_config(ec_slave_t *slave)
             goto errorout;
         }
 
-        uint32_t time_diff = EC_READ_U32(datagram->data) & 0x7fffffff;
+        uint32_t time_diff = ESC_SYS_TIME_DIFF_NUM_GET(EC_READ_U32(datagram->data));
         if (time_diff > EC_DC_MAX_SYNC_DIFF_NS) {
-            start_time++;
-            if (start_time > EC_DC_SYNC_WAIT_COUNT) {
-                step = 25;
-                ret = -EC_ERR_TIMEOUT;
-                goto errorout;
-            }
-            goto read_check;
+            EC_SLAVE_LOG_WRN("Slave %u DC time diff: %u ns, not in sync yet\n", slave->index, time_diff);
         } else {
             EC_SLAVE_LOG_INFO("Slave %u DC time diff: %u ns\n", slave->index, time_diff);
         }
@@ -783,9 +996,17 @@ static int ec_slave_config(ec_slave_t *slave)
         goto errorout;
     }
 
+    if (slave->config && slave->config->image) {
+        ret = ec_slave_image_download(slave, datagram, EC_SLAVE_STATE_OP);
+        if (ret < 0) {
+            step = 29;
+            goto errorout;
+        }
+    }
+
     ret = ec_slave_state_change(slave, EC_SLAVE_STATE_OP);
     if (ret < 0) {
-        step = 29;
+        step = 30;
         goto errorout;
     }
 
@@ -909,6 +1130,504 @@ static void ec_master_calc_dc(ec_master_t *master)
     ec_master_calc_transmission_delays(master);
 }
 
+typedef struct {
+    ec_datagram_t datagrams[EC_DC_BATCH_SIZE];
+    uint8_t data[EC_DC_BATCH_SIZE][16];
+    ec_slave_t *slaves[EC_DC_BATCH_SIZE]; /**< Slave each datagram is addressed to. */
+    uint32_t count;                       /**< Number of filled datagrams. */
+    ec_osal_sem_t done;                   /**< Given when the last datagram of a queued batch is dequeued. */
+} ec_dc_batch_t;
+
+static ec_dc_batch_t *ec_dc_batch_alloc(void)
+{
+    ec_dc_batch_t *batch;
+
+    batch = ec_osal_malloc(sizeof(ec_dc_batch_t));
+    if (!batch) {
+        return NULL;
+    }
+
+    batch->done = ec_osal_sem_create(1, 0);
+    if (!batch->done) {
+        ec_osal_free(batch);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < EC_DC_BATCH_SIZE; i++) {
+        ec_datagram_init_static(&batch->datagrams[i], batch->data[i], sizeof(batch->data[i]));
+        batch->datagrams[i].waiter = false;
+        batch->datagrams[i].wait = batch->done;
+    }
+    batch->count = 0;
+    return batch;
+}
+
+static void ec_dc_batch_free(ec_dc_batch_t *batch)
+{
+    for (uint32_t i = 0; i < EC_DC_BATCH_SIZE; i++) {
+        ec_datagram_clear(&batch->datagrams[i]);
+    }
+    ec_osal_sem_delete(batch->done);
+    ec_osal_free(batch);
+}
+
+/** Queues the filled datagrams of a batch without waiting, the last one gives batch->done. */
+static void ec_dc_batch_queue(ec_master_t *master, ec_dc_batch_t *batch)
+{
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    for (uint32_t i = 0; i < batch->count; i++) {
+        ec_master_queue_datagram(master, &batch->datagrams[i]);
+    }
+    batch->datagrams[batch->count - 1].waiter = true;
+    ec_osal_sem_give(master->nonperiod_sem);
+    ec_osal_leave_critical_section(flags);
+}
+
+/** Waits until a batch queued by ec_dc_batch_queue() is received or timed out. */
+static int ec_dc_batch_wait(ec_dc_batch_t *batch)
+{
+    int ret;
+
+    ret = ec_osal_sem_take(batch->done, EC_OSAL_WAITING_FOREVER);
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        if (batch->datagrams[i].state != EC_DATAGRAM_RECEIVED) {
+            return -EC_ERR_TIMEOUT;
+        }
+    }
+    return 0;
+}
+
+/** Queues the filled datagrams of a batch and waits until they are processed.
+ *
+ * The main datagram closes the batch with a 1 byte BRD, it is the only one that
+ * is waited for. All datagrams must use the same netdev.
+ */
+static int ec_dc_batch_send(ec_master_t *master, ec_dc_batch_t *batch, uint8_t netdev_idx)
+{
+    ec_datagram_t *datagram = &master->main_datagram;
+    uintptr_t flags;
+    int ret;
+
+    flags = ec_osal_enter_critical_section();
+    for (uint32_t i = 0; i < batch->count; i++) {
+        ec_master_queue_datagram(master, &batch->datagrams[i]);
+    }
+    ec_osal_leave_critical_section(flags);
+
+    ec_datagram_brd(datagram, ESCREG_OF(ESCREG->TYPE), 1);
+    ec_datagram_zero(datagram);
+    datagram->netdev_idx = netdev_idx;
+    ret = ec_master_queue_ext_datagram(master, datagram, true, true);
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        if (batch->datagrams[i].state != EC_DATAGRAM_RECEIVED) {
+            return -EC_ERR_TIMEOUT;
+        }
+    }
+    return 0;
+}
+
+/** Writes system time offset and transmission delay of all DC slaves. */
+static int ec_master_dc_write_offsets(ec_master_t *master, ec_dc_batch_t *batch)
+{
+    ec_slave_t *slave;
+    ec_datagram_t *datagram;
+    uint8_t netdev_idx = EC_NETDEV_MAIN;
+    int ret;
+
+    batch->count = 0;
+    for (uint32_t slave_index = 0; slave_index <= master->slave_count; slave_index++) {
+        slave = (slave_index < master->slave_count) ? &master->slaves[slave_index] : NULL;
+
+        if (slave && !slave->base_dc_supported) {
+            continue;
+        }
+
+        // flush at the end, if the batch is full or the next slave is on another netdev
+        if (batch->count && (!slave || (batch->count == EC_DC_BATCH_SIZE) || (slave->netdev_idx != netdev_idx))) {
+            ret = ec_dc_batch_send(master, batch, netdev_idx);
+            if (ret < 0) {
+                return ret;
+            }
+            batch->count = 0;
+        }
+
+        if (!slave) {
+            break;
+        }
+
+        netdev_idx = slave->netdev_idx;
+        datagram = &batch->datagrams[batch->count];
+        batch->slaves[batch->count++] = slave;
+
+        ec_datagram_fpwr(datagram, slave->station_address, ESCREG_OF(ESCREG->SYS_TIME_OFFSET), 12);
+        EC_WRITE_U64(datagram->data, slave->system_time_offset);
+        EC_WRITE_U32(datagram->data + 8, slave->transmission_delay);
+        datagram->netdev_idx = slave->netdev_idx;
+    }
+
+    return 0;
+}
+
+/** Reads the time difference of all DC slaves behind the reference clock.
+ *
+ * One BRD gives an upper bound for the whole bus, only if it is above the limit
+ * the slaves are read one by one to report which of them are not in sync.
+ */
+static int ec_master_dc_check_time_diff(ec_master_t *master, ec_dc_batch_t *batch, uint32_t *max_diff)
+{
+    ec_slave_t *ref = master->dc_ref_clock;
+    ec_slave_t *slave;
+    ec_datagram_t *datagram = &master->main_datagram;
+    uint32_t time_diff;
+    int ret;
+
+    ec_datagram_brd(datagram, ESCREG_OF(ESCREG->SYS_TIME_DIFF), 4);
+    ec_datagram_zero(datagram);
+    datagram->netdev_idx = ref->netdev_idx;
+    ret = ec_master_queue_ext_datagram(master, datagram, true, true);
+    if (ret < 0) {
+        return ret;
+    }
+
+    *max_diff = ESC_SYS_TIME_DIFF_NUM_GET(EC_READ_U32(datagram->data));
+    if (*max_diff <= EC_DC_MAX_SYNC_DIFF_NS) {
+        return 0;
+    }
+
+    batch->count = 0;
+    for (uint32_t slave_index = 0; slave_index <= master->slave_count; slave_index++) {
+        slave = (slave_index < master->slave_count) ? &master->slaves[slave_index] : NULL;
+
+        if (slave && (!slave->base_dc_supported || (slave == ref) || (slave->netdev_idx != ref->netdev_idx))) {
+            continue;
+        }
+
+        if (batch->count && (!slave || (batch->count == EC_DC_BATCH_SIZE))) {
+            ret = ec_dc_batch_send(master, batch, ref->netdev_idx);
+            if (ret < 0) {
+                return ret;
+            }
+
+            for (uint32_t i = 0; i < batch->count; i++) {
+                time_diff = ESC_SYS_TIME_DIFF_NUM_GET(EC_READ_U32(batch->datagrams[i].data));
+                if (time_diff > EC_DC_MAX_SYNC_DIFF_NS) {
+                    EC_SLAVE_LOG_WRN("Slave %u DC time diff %u ns after drift compensation\n",
+                                     batch->slaves[i]->index, time_diff);
+                }
+            }
+            batch->count = 0;
+        }
+
+        if (!slave) {
+            break;
+        }
+
+        datagram = &batch->datagrams[batch->count];
+        batch->slaves[batch->count++] = slave;
+
+        ec_datagram_fprd(datagram, slave->station_address, ESCREG_OF(ESCREG->SYS_TIME_DIFF), 4);
+        ec_datagram_zero(datagram);
+        datagram->netdev_idx = slave->netdev_idx;
+    }
+
+    return 0;
+}
+
+/** Sorts a few samples in place. */
+static void ec_dc_delay_sort(int32_t *samples, uint32_t count)
+{
+    int32_t value;
+    uint32_t j;
+
+    for (uint32_t i = 1; i < count; i++) {
+        value = samples[i];
+        for (j = i; (j > 0) && (samples[j - 1] > value); j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = value;
+    }
+}
+
+/** Averages the samples of one port after rejecting outliers.
+ *
+ * Samples further than 3 * MAD (median absolute deviation), but at least
+ * EC_DC_DELAY_OUTLIER_NS, from the median are rejected.
+ *
+ * \return Mean of the remaining samples [ns].
+ */
+static int32_t ec_dc_delay_filter(int32_t *samples, uint32_t count, uint32_t *variance, uint8_t *used)
+{
+    int32_t dev[EC_DC_DELAY_SAMPLES];
+    int32_t median, limit, diff;
+    int64_t sum = 0, sum_sq = 0;
+    int32_t mean;
+    uint32_t n = 0;
+
+    ec_dc_delay_sort(samples, count);
+    median = samples[count / 2];
+
+    for (uint32_t i = 0; i < count; i++) {
+        dev[i] = samples[i] > median ? samples[i] - median : median - samples[i];
+    }
+    ec_dc_delay_sort(dev, count);
+    limit = MAX(3 * dev[count / 2], EC_DC_DELAY_OUTLIER_NS);
+
+    for (uint32_t i = 0; i < count; i++) {
+        diff = samples[i] - median;
+        if ((diff > limit) || (diff < -limit)) {
+            continue;
+        }
+        sum += diff;
+        n++;
+    }
+
+    // the median itself is never rejected, so n >= 1
+    mean = median + (int32_t)(sum / n);
+
+    for (uint32_t i = 0; i < count; i++) {
+        diff = samples[i] - median;
+        if ((diff > limit) || (diff < -limit)) {
+            continue;
+        }
+        diff = samples[i] - mean;
+        sum_sq += (int64_t)diff * diff;
+    }
+
+    *variance = (uint32_t)MIN(sum_sq / n, 0xffffffff);
+    *used = n;
+    return mean;
+}
+
+/** Measures the port receive times of all DC slaves.
+ *
+ * Takes EC_DC_DELAY_SAMPLES samples, each one BWR to RCV_TIME[0] per netdev followed by
+ * packed FPRDs of the receive times. For every port the time relative to port 0 is
+ * averaged after outlier rejection, the variance is kept per port for diagnosis.
+ */
+static int ec_master_measure_port_delays(ec_master_t *master)
+{
+    ec_datagram_t *datagram = &master->main_datagram;
+    ec_dc_batch_t *batch;
+    ec_slave_t *slave;
+    int32_t *samples;
+    uint32_t dc_count = 0;
+    uint32_t dc_index;
+    uint8_t netdev_idx = EC_NETDEV_MAIN;
+    int ret = 0;
+
+    for (uint32_t i = 0; i < master->slave_count; i++) {
+        if (master->slaves[i].base_dc_supported) {
+            dc_count++;
+        }
+    }
+
+    if (!dc_count) {
+        return 0;
+    }
+
+    // samples[dc_index][port - 1][sample]
+    samples = ec_osal_malloc(sizeof(int32_t) * dc_count * (EC_MAX_PORTS - 1) * EC_DC_DELAY_SAMPLES);
+    if (!samples) {
+        return -EC_ERR_NOMEM;
+    }
+
+    batch = ec_dc_batch_alloc();
+    if (!batch) {
+        ec_osal_free(samples);
+        return -EC_ERR_NOMEM;
+    }
+
+    for (uint32_t sample = 0; sample < EC_DC_DELAY_SAMPLES; sample++) {
+        // latch receive times
+        for (uint8_t i = EC_NETDEV_MAIN; i < CONFIG_EC_MAX_NETDEVS; i++) {
+            if (master->slaves_working_counter[i] == 0) {
+                continue;
+            }
+
+            ec_datagram_bwr(datagram, ESCREG_OF(ESCREG->RCV_TIME[0]), 4);
+            ec_datagram_zero(datagram);
+            datagram->netdev_idx = i;
+            ret = ec_master_queue_ext_datagram(master, datagram, true, true);
+            if (ret < 0) {
+                goto out;
+            }
+        }
+
+        batch->count = 0;
+        dc_index = 0;
+        for (uint32_t slave_index = 0; slave_index <= master->slave_count; slave_index++) {
+            slave = (slave_index < master->slave_count) ? &master->slaves[slave_index] : NULL;
+
+            if (slave && !slave->base_dc_supported) {
+                continue;
+            }
+
+            if (batch->count && (!slave || (batch->count == EC_DC_BATCH_SIZE) || (slave->netdev_idx != netdev_idx))) {
+                ret = ec_dc_batch_send(master, batch, netdev_idx);
+                if (ret < 0) {
+                    goto out;
+                }
+
+                for (uint32_t i = 0; i < batch->count; i++, dc_index++) {
+                    uint8_t *data = batch->datagrams[i].data;
+
+                    for (uint8_t port = 1; port < EC_MAX_PORTS; port++) {
+                        samples[(dc_index * (EC_MAX_PORTS - 1) + port - 1) * EC_DC_DELAY_SAMPLES + sample] =
+                            (int32_t)(EC_READ_U32(data + 4 * port) - EC_READ_U32(data));
+                    }
+                }
+                batch->count = 0;
+            }
+
+            if (!slave) {
+                break;
+            }
+
+            netdev_idx = slave->netdev_idx;
+            batch->slaves[batch->count] = slave;
+            ec_datagram_fprd(&batch->datagrams[batch->count], slave->station_address, ESCREG_OF(ESCREG->RCV_TIME[0]), 16);
+            ec_datagram_zero(&batch->datagrams[batch->count]);
+            batch->datagrams[batch->count].netdev_idx = slave->netdev_idx;
+            batch->count++;
+        }
+    }
+
+    dc_index = 0;
+    for (uint32_t slave_index = 0; slave_index < master->slave_count; slave_index++) {
+        slave = &master->slaves[slave_index];
+
+        if (!slave->base_dc_supported) {
+            continue;
+        }
+
+        slave->ports[0].receive_time = 0;
+        slave->ports[0].receive_time_var = 0;
+        slave->ports[0].receive_time_samples = EC_DC_DELAY_SAMPLES;
+
+        for (uint8_t port = 1; port < EC_MAX_PORTS; port++) {
+            ec_slave_port_t *slave_port = &slave->ports[port];
+
+            slave_port->receive_time = ec_dc_delay_filter(&samples[(dc_index * (EC_MAX_PORTS - 1) + port - 1) * EC_DC_DELAY_SAMPLES],
+                                                          EC_DC_DELAY_SAMPLES,
+                                                          &slave_port->receive_time_var,
+                                                          &slave_port->receive_time_samples);
+
+            if (!slave_port->link.loop_closed) {
+                EC_SLAVE_LOG_DBG("Slave %u port %u: receive time diff %d ns, variance %u ns^2, %u/%u samples\n",
+                                 slave->index, port, (int32_t)slave_port->receive_time,
+                                 slave_port->receive_time_var, slave_port->receive_time_samples, EC_DC_DELAY_SAMPLES);
+            }
+        }
+        dc_index++;
+    }
+
+out:
+    ec_dc_batch_free(batch);
+    ec_osal_free(samples);
+    return ret;
+}
+
+/** Static drift compensation.
+ *
+ * Writes the system time offsets and transmission delays, then distributes the
+ * reference clock with CONFIG_EC_DC_DRIFT_COMP_COUNT FRMW datagrams packed EC_DC_BATCH_SIZE
+ * per frame, so that every DC slave can adjust its clock before any slave goes to
+ * SAFEOP. EC_DC_BURST_WINDOW batches are kept in flight, a batch is only waited for
+ * when its datagrams are needed again, and once for all of them at the end. The
+ * duration only depends on the number of frames, not on the slave count.
+ */
+static int ec_master_dc_drift_compensation(ec_master_t *master)
+{
+    ec_slave_t *ref = master->dc_ref_clock;
+    ec_dc_batch_t *batches[EC_DC_BURST_WINDOW] = { NULL };
+    ec_dc_batch_t *batch;
+    uint32_t frames = (CONFIG_EC_DC_DRIFT_COMP_COUNT + EC_DC_BATCH_SIZE - 1) / EC_DC_BATCH_SIZE;
+    uint32_t queued = 0;
+    uint32_t waited = 0;
+    uint32_t max_diff = 0;
+    int ret = 0;
+
+    if (!ref) {
+        return 0;
+    }
+
+    for (uint32_t w = 0; w < EC_DC_BURST_WINDOW; w++) {
+        batches[w] = ec_dc_batch_alloc();
+        if (!batches[w]) {
+            ret = -EC_ERR_NOMEM;
+            goto out;
+        }
+    }
+
+    ret = ec_master_dc_write_offsets(master, batches[0]);
+    if (ret < 0) {
+        goto out;
+    }
+
+    for (uint32_t w = 0; w < EC_DC_BURST_WINDOW; w++) {
+        for (uint32_t i = 0; i < EC_DC_BATCH_SIZE; i++) {
+            ec_datagram_frmw(&batches[w]->datagrams[i], ref->station_address, ESCREG_OF(ESCREG->SYS_TIME),
+                             ref->base_dc_range == EC_DC_64 ? 8 : 4);
+            batches[w]->datagrams[i].netdev_idx = ref->netdev_idx;
+        }
+        batches[w]->count = EC_DC_BATCH_SIZE;
+    }
+
+    for (queued = 0; queued < frames; queued++) {
+        batch = batches[queued % EC_DC_BURST_WINDOW];
+
+        // reuse the oldest batch of the window once it is back
+        if (queued >= EC_DC_BURST_WINDOW) {
+            ret = ec_dc_batch_wait(batch);
+            waited++;
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        for (uint32_t i = 0; i < EC_DC_BATCH_SIZE; i++) {
+            ec_datagram_zero(&batch->datagrams[i]);
+        }
+        ec_dc_batch_queue(master, batch);
+    }
+
+    // sync once at the end, batches in flight are waited for even after an error
+    for (; waited < queued; waited++) {
+        if ((ec_dc_batch_wait(batches[waited % EC_DC_BURST_WINDOW]) < 0) && (ret == 0)) {
+            ret = -EC_ERR_TIMEOUT;
+        }
+    }
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = ec_master_dc_check_time_diff(master, batches[0], &max_diff);
+    if (ret < 0) {
+        goto out;
+    }
+
+    EC_LOG_INFO("DC drift compensation done, %u FRMW, max time diff: %u ns\n",
+                frames * EC_DC_BATCH_SIZE, max_diff);
+
+out:
+    for (uint32_t w = 0; w < EC_DC_BURST_WINDOW; w++) {
+        if (batches[w]) {
+            ec_dc_batch_free(batches[w]);
+        }
+    }
+    return ret;
+}
+
 static void ec_master_scan_slaves_state(ec_master_t *master)
 {
     ec_datagram_t *datagram;
@@ -993,11 +1712,12 @@ void ec_slaves_scanning(ec_master_t *master)
         ec_datagram_zero(datagram);
         datagram->netdev_idx = netdev_idx;
         ret = ec_master_queue_ext_datagram(master, datagram, true, true);
-        if (ret < 0) {
+        if ((ret < 0) && (ret != -EC_ERR_WC)) { // no response on an empty bus is not an error
             return;
         }
 
-        if (datagram->working_counter != master->slaves_working_counter[netdev_idx]) {
+        if ((datagram->working_counter != master->slaves_working_counter[netdev_idx]) ||
+            (!datagram->working_counter && !master->scan_done)) {
             master->rescan_request = true;
             master->slaves_working_counter[netdev_idx] = datagram->working_counter;
             EC_LOG_INFO("%u slaves responding on %s device\n",
@@ -1038,7 +1758,9 @@ void ec_slaves_scanning(ec_master_t *master)
         }
 
         if (!count) {
-            step = 1;
+            // an empty bus is a valid result, the master can still run cycles, e.g. over a loopback
+            EC_LOG_INFO("No slaves found\n");
+            master->scan_done = true;
             goto mutex_unlock;
         }
 
@@ -1162,20 +1884,6 @@ void ec_slaves_scanning(ec_master_t *master)
                     goto mutex_unlock;
                 }
 
-                // Read DC port receive times
-                ec_datagram_fprd(datagram, slave->station_address, ESCREG_OF(ESCREG->RCV_TIME[0]), 16);
-                ec_datagram_zero(datagram);
-                datagram->netdev_idx = slave->netdev_idx;
-                ret = ec_master_queue_ext_datagram(master, datagram, true, true);
-                if (ret < 0) {
-                    step = 9;
-                    goto mutex_unlock;
-                }
-
-                for (uint8_t i = 0; i < EC_MAX_PORTS; i++) {
-                    slave->ports[i].receive_time = EC_READ_U32(datagram->data + 4 * i);
-                }
-
                 ec_datagram_fprd(datagram, slave->station_address, ESCREG_OF(ESCREG->RCVT_ECAT_PU), 8);
                 ec_datagram_zero(datagram);
                 datagram->netdev_idx = slave->netdev_idx;
@@ -1315,8 +2023,8 @@ void ec_slaves_scanning(ec_master_t *master)
                         for (uint8_t i = 0; i < slave->sm_count; i++) {
                             ec_sii_sm_t *sm = (ec_sii_sm_t *)((uint8_t *)cat_data + i * sizeof(ec_sii_sm_t));
 
-                            slave->sm_info[i].physical_start_address = sm->physical_start_address;
-                            slave->sm_info[i].length = sm->length;
+                            slave->sm_info[i].physical_start_address = EC_READ_U16(&sm->physical_start_address);
+                            slave->sm_info[i].length = EC_READ_U16(&sm->length);
                             slave->sm_info[i].control = sm->control;
                             slave->sm_info[i].enable = sm->active;
                         }
@@ -1335,9 +2043,33 @@ void ec_slaves_scanning(ec_master_t *master)
                 cat_data += cat_size;
             }
 
+            // PDO categories reference sync managers, the SM category may come later
+            ret = ec_slave_fetch_sii_pdos(slave, slave->sii_image + EC_FIRST_SII_CATEGORY_OFFSET);
+            if (ret < 0) {
+                step = 19;
+                goto mutex_unlock;
+            }
+
             EC_SLAVE_LOG_INFO("Slave %u parse eeprom success\n", slave->index);
+        }
 
-            ret = ec_slave_config(slave);
+        // port receive times for the delay calculation
+        ret = ec_master_measure_port_delays(master);
+        if (ret < 0) {
+            step = 18;
+            goto mutex_unlock;
+        }
+
+        ec_master_calc_dc(master);
+
+        ret = ec_master_dc_drift_compensation(master);
+        if (ret < 0) {
+            step = 17;
+            goto mutex_unlock;
+        }
+
+        for (uint32_t slave_index = 0; slave_index < master->slave_count; slave_index++) {
+            ret = ec_slave_config(master->slaves + slave_index);
             if (ret < 0) {
                 step = 16;
                 goto mutex_unlock;
@@ -1347,8 +2079,6 @@ void ec_slaves_scanning(ec_master_t *master)
         EC_LOG_INFO("Bus scanning completed in %u ms\n", (unsigned int)((jiffies - scan_jiffies) / 1000000));
         master->scan_done = true;
 
-        ec_master_calc_dc(master);
-
     mutex_unlock:
         ec_osal_mutex_give(master->scan_lock);
         if (step != 0) {
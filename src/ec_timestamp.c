@@ -5,7 +5,38 @@
  */
 #include "ec_master.h"
 
+/*
+ * ns = cycles * 10^9 / freq is evaluated as cycles * mult >> shift, with the largest shift for
+ * which mult still fits into 32 bits. The cycle counter is split into two 32 bit halves, so no
+ * product exceeds 64 bits and the hot path needs no 64 bit division.
+ */
+static uint32_t g_clock_time_mult;
+static uint32_t g_clock_time_shift;
+
+void ec_timestamp_calc_mult(uint32_t freq)
+{
+    uint64_t mult;
+    uint32_t shift;
+
+    for (shift = 32; shift > 0; shift--) {
+        mult = (((uint64_t)1000000000 << shift) + (freq / 2)) / freq;
+        if (mult <= UINT32_MAX) {
+            break;
+        }
+    }
+
+    g_clock_time_mult = (uint32_t)mult;
+    g_clock_time_shift = shift;
+}
+
+EC_FAST_CODE_SECTION uint64_t ec_timestamp_cycles_to_ns(uint64_t cycles)
+{
+    return (((cycles >> 32) * g_clock_time_mult) << (32 - g_clock_time_shift)) +
+           (((cycles & 0xffffffff) * g_clock_time_mult) >> g_clock_time_shift);
+}
+
 #ifndef CONFIG_EC_TIMESTAMP_CUSTOM
+
 #if defined(__riscv) || defined(__ICCRISCV__)
 
 #define READ_CSR(csr_num) ({ uint32_t v; __asm volatile("csrr %0, %1" : "=r"(v) : "i"(csr_num)); v; })
@@ -28,11 +59,9 @@ static inline uint64_t riscv_csr_get_core_mcycle(void)
     return result;
 }
 
-static uint32_t g_clock_time_div;
-
 void ec_timestamp_init(void)
 {
-    g_clock_time_div = ec_get_cpu_frequency() / 1000000;
+    ec_timestamp_calc_mult(ec_get_cpu_frequency());
 
     uint64_t start_cycle = ec_timestamp_get_time_ns();
     ec_osal_msleep(10);
@@ -42,7 +71,7 @@ void ec_timestamp_init(void)
 
 EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
 {
-    return (riscv_csr_get_core_mcycle() * 1000) / g_clock_time_div;
+    return ec_timestamp_cycles_to_ns(riscv_csr_get_core_mcycle());
 }
 
 #elif defined(__arm__) || defined(__ICCARM__) || defined(__ARMCC_VERSION)
@@ -56,7 +85,6 @@ EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
 
 static volatile uint32_t g_dwt_high = 0;
 static volatile uint32_t g_dwt_last_low = 0;
-static uint32_t g_clock_time_div;
 
 static inline uint64_t arm_dwt_get_cycle_count(void)
 {
@@ -72,7 +100,7 @@ static inline uint64_t arm_dwt_get_cycle_count(void)
 
 void ec_timestamp_init(void)
 {
-    g_clock_time_div = ec_get_cpu_frequency() / 1000000;
+    ec_timestamp_calc_mult(ec_get_cpu_frequency());
 
     g_dwt_high = 0;
     g_dwt_last_low = 0;
@@ -91,7 +119,7 @@ void ec_timestamp_init(void)
 
 EC_FAST_CODE_SECTION uint64_t ec_timestamp_get_time_ns(void)
 {
-    return (arm_dwt_get_cycle_count() * 1000) / g_clock_time_div;
+    return ec_timestamp_cycles_to_ns(arm_dwt_get_cycle_count());
 }
 #else
 #error "Unsupported architecture"
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "ec_master.h"
+
+#ifdef CONFIG_EC_TRACE
+
+/*
+ * One record per master cycle, every trace point writes its own slot of the current record, so
+ * the period and the receive context never write the same location and need no lock. The dump
+ * stops the trace first and exports the Chrome trace event format, which chrome://tracing and
+ * ui.perfetto.dev open directly.
+ */
+
+enum {
+    EC_TRACE_TID_PERIOD = 1,
+    EC_TRACE_TID_WIRE,
+    EC_TRACE_TID_RX,
+};
+
+typedef struct {
+    const char *name;
+    uint8_t tid;
+    uint8_t begin;
+    uint8_t end;
+} ec_trace_phase_t;
+
+static const ec_trace_phase_t ec_trace_phases[] = {
+    { "period", EC_TRACE_TID_PERIOD, EC_TRACE_PERIOD_START, EC_TRACE_PERIOD_END },
+    { "frame build", EC_TRACE_TID_PERIOD, EC_TRACE_SEND_START, EC_TRACE_NETDEV_SEND },
+    { "netdev send", EC_TRACE_TID_PERIOD, EC_TRACE_NETDEV_SEND, EC_TRACE_NETDEV_SENT },
+    { "round trip", EC_TRACE_TID_WIRE, EC_TRACE_NETDEV_SENT, EC_TRACE_RX_ENTRY },
+    { "datagram parse", EC_TRACE_TID_RX, EC_TRACE_RX_ENTRY, EC_TRACE_RX_PARSED },
+    { "pdo process", EC_TRACE_TID_RX, EC_TRACE_RX_PARSED, EC_TRACE_RX_END },
+};
+
+static const char *ec_trace_thread_names[] = {
+    NULL,
+    "period (timer)",
+    "wire",
+    "receive (rx isr)",
+};
+
+void ec_master_trace_start(ec_master_t *master, uint32_t freeze_ns)
+{
+    ec_trace_t *trace = &master->trace;
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    trace->enable = false;
+    trace->in_period = false;
+    trace->freeze_pending = false;
+    trace->freeze_ns = freeze_ns;
+    trace->cycle = 0;
+    trace->head = 0;
+    trace->current = &trace->records[0];
+    trace->enable = true;
+    ec_osal_leave_critical_section(flags);
+}
+
+void ec_master_trace_stop(ec_master_t *master)
+{
+    uintptr_t flags;
+
+    flags = ec_osal_enter_critical_section();
+    master->trace.enable = false;
+    master->trace.freeze_pending = false;
+    ec_osal_leave_critical_section(flags);
+}
+
+bool ec_master_trace_running(ec_master_t *master)
+{
+    return master->trace.enable;
+}
+
+static void ec_trace_print_us(const char *key, uint64_t ns)
+{
+    EC_LOG_RAW("\"%s\":%u.%03u", key, (unsigned int)(ns / 1000), (unsigned int)(ns % 1000));
+}
+
+void ec_master_trace_dump(ec_master_t *master)
+{
+    ec_trace_t *trace = &master->trace;
+    const ec_trace_phase_t *phase;
+    ec_trace_record_t *record;
+    uint64_t base;
+    uint64_t last_start = 0;
+    uint32_t count;
+    uint32_t index;
+
+    ec_master_trace_stop(master);
+
+    count = MIN(trace->cycle, CONFIG_EC_TRACE_CYCLES);
+    index = (trace->cycle > CONFIG_EC_TRACE_CYCLES) ? trace->head : 0;
+    base = count ? trace->records[index].start : 0;
+
+    EC_LOG_RAW("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    EC_LOG_RAW("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"ec_master %u\"}}",
+               master->index, master->index);
+    for (uint8_t tid = EC_TRACE_TID_PERIOD; tid <= EC_TRACE_TID_RX; tid++) {
+        EC_LOG_RAW(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                   master->index, tid, ec_trace_thread_names[tid]);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        record = &trace->records[index];
+        index = (index + 1 == CONFIG_EC_TRACE_CYCLES) ? 0 : (index + 1);
+
+        for (uint8_t j = 0; j < sizeof(ec_trace_phases) / sizeof(ec_trace_phases[0]); j++) {
+            phase = &ec_trace_phases[j];
+
+            if ((record->offset[phase->begin] == EC_TRACE_NONE) ||
+                (record->offset[phase->end] == EC_TRACE_NONE) ||
+                (record->offset[phase->end] < record->offset[phase->begin])) {
+                continue;
+            }
+
+            EC_LOG_RAW(",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,",
+                       phase->name, master->index, phase->tid);
+            ec_trace_print_us("ts", record->start - base + record->offset[phase->begin]);
+            EC_LOG_RAW(",");
+            ec_trace_print_us("dur", record->offset[phase->end] - record->offset[phase->begin]);
+            EC_LOG_RAW(",\"args\":{\"cycle\":%u", record->cycle);
+            if ((phase->begin == EC_TRACE_PERIOD_START) && last_start) {
+                EC_LOG_RAW(",\"period_ns\":%u", (unsigned int)(record->start - last_start));
+            }
+            EC_LOG_RAW("}}");
+        }
+        last_start = record->start;
+    }
+
+    EC_LOG_RAW("\n]}\n");
+}
+
+#endif